@@ -0,0 +1,309 @@
+/*
+ * ASMOPT.C - Assembly Peephole Optimizer Implementation
+ * CST-405 Compiler Project
+ *
+ * This file implements the peephole pass over the machine IR. Every rule
+ * is tried at every instruction, and the rounds repeat until no rule
+ * applies (one rewrite often exposes the next: a forwarded load leaves a
+ * copy chain). The rules know no target: they see instructions through
+ * their opcode class and effects (mir.c), and ask the target description
+ * to build the copies and memory operands they rewrite into.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "asmopt.h"
+
+#define REG_BIT(r) (1ULL << (r))
+#define MAX_ROUNDS 8
+
+/* Rule: rewrites made at an instruction (0 if it does not apply) */
+typedef struct {
+    const char* name;
+    int (*apply)(MirProgram* program, int line, AsmOptStats* stats);
+} AsmRule;
+
+/* ============================================================
+ * HELPERS
+ * ============================================================ */
+
+/* Helper: Destination and source operand of a copy (0 if the line is not one) */
+static int copy_operands(MirProgram* program, int line, int* dest, int* source) {
+    MirInstr* instr = &program->lines[line];
+    if (instr->kind != MIR_INSTR || instr->deleted) return 0;
+    const MirOpcode* opcode = mir_opcode(program, instr);
+    if (opcode->opclass != MIR_CLASS_COPY) return 0;
+    *dest = -1;
+    *source = -1;
+    for (int i = 0; i < instr->num_operands; i++) {
+        char role = (char)tolower((unsigned char)opcode->roles[i]);
+        if (role == 'd' && *dest < 0) *dest = i;
+        if (role == 'u' && *source < 0) *source = i;
+    }
+    return *dest >= 0 && *source >= 0;
+}
+
+/* Helper: Is the line a word load "reg = [m]"? */
+static int is_load(MirProgram* program, int line, MirOperand* reg, MirOperand* memory) {
+    int dest, source;
+    if (!copy_operands(program, line, &dest, &source)) return 0;
+    MirInstr* instr = &program->lines[line];
+    *reg = instr->operands[dest];
+    *memory = instr->operands[source];
+    return mir_plain_register(program, reg) && mir_word_memory(program, memory);
+}
+
+/* Helper: Is the line a word store "[m] = reg/imm"? */
+static int is_store(MirProgram* program, int line, MirOperand* value, MirOperand* memory) {
+    int dest, source;
+    if (!copy_operands(program, line, &dest, &source)) return 0;
+    MirInstr* instr = &program->lines[line];
+    *value = instr->operands[source];
+    *memory = instr->operands[dest];
+    return mir_word_memory(program, memory) &&
+           (mir_plain_register(program, value) || value->kind == MIR_OP_IMM);
+}
+
+/* Helper: Is the operand the whole register 'reg'? */
+static int is_register(const MirOperand* operand, int reg) {
+    return operand->kind == MIR_OP_REG && operand->reg == reg && operand->view == 0;
+}
+
+/* Helper: Remove an instruction */
+static void delete_instruction(MirProgram* program, int line, AsmOptStats* stats) {
+    mir_delete(program, line);
+    stats->removed++;
+}
+
+/* ============================================================
+ * RULES
+ * ============================================================ */
+
+/* Helper: The value of word 'memory' is in 'value' (a register or an
+ * immediate) after 'line': turn the loads of it that follow in the block
+ * into copies */
+static int forward_value(MirProgram* program, int line, const MirOperand* value, const MirOperand* memory,
+                         AsmOptStats* stats) {
+    unsigned long long holder = value->kind == MIR_OP_REG ? REG_BIT(value->reg) : 0;
+    unsigned long long address = mir_address_registers(memory);
+    int hits = 0;
+
+    for (int i = mir_next(program, line); i >= 0; i = mir_next(program, i)) {
+        MirEffects effects = mir_effects(program, i);
+        MirOperand dest, loaded;
+        if (effects.barrier) break;
+        if (is_load(program, i, &dest, &loaded) && mir_same_operand(&loaded, memory)) {
+            if (value->kind == MIR_OP_REG && dest.reg == value->reg) {
+                delete_instruction(program, i, stats);
+                hits++;
+                continue;
+            }
+            if (program->target->copy(program->target, &program->lines[i], &dest, value)) {
+                stats->rewritten++;
+                hits++;
+            }
+        }
+        if (effects.writes & (holder | address)) break;
+        if (effects.store >= 0 &&
+            mir_may_alias(program, &program->lines[i].operands[effects.store], memory)) {
+            break;
+        }
+    }
+    return hits;
+}
+
+/* Rule: a load of a word the block just stored */
+static int rule_store_forwarding(MirProgram* program, int line, AsmOptStats* stats) {
+    MirOperand value, memory;
+    if (!is_store(program, line, &value, &memory)) return 0;
+    return forward_value(program, line, &value, &memory, stats);
+}
+
+/* Rule: a load of a word the block already loaded */
+static int rule_redundant_reload(MirProgram* program, int line, AsmOptStats* stats) {
+    MirOperand reg, memory;
+    if (!is_load(program, line, &reg, &memory)) return 0;
+    if (mir_address_registers(&memory) & REG_BIT(reg.reg)) return 0;
+    return forward_value(program, line, &reg, &memory, stats);
+}
+
+/* Rule: a store the block overwrites before anything may read it */
+static int rule_dead_store(MirProgram* program, int line, AsmOptStats* stats) {
+    MirOperand value, memory, other;
+    if (!is_store(program, line, &value, &memory)) return 0;
+    unsigned long long address = mir_address_registers(&memory);
+
+    for (int i = mir_next(program, line); i >= 0; i = mir_next(program, i)) {
+        MirEffects effects = mir_effects(program, i);
+        if (effects.barrier) return 0;
+        if (effects.load >= 0 && mir_may_alias(program, &program->lines[i].operands[effects.load], &memory)) {
+            return 0;
+        }
+        if (is_store(program, i, &value, &other) && mir_same_operand(&other, &memory)) {
+            delete_instruction(program, line, stats);
+            return 1;
+        }
+        if (effects.writes & address) return 0;
+    }
+    return 0;
+}
+
+/* Rule: "a = x; op ..., a, ..." -> "op ..., x, ..." when a is dead after op */
+static int rule_copy_propagation(MirProgram* program, int line, AsmOptStats* stats) {
+    int dest, source;
+    if (!copy_operands(program, line, &dest, &source)) return 0;
+    MirInstr* copy = &program->lines[line];
+    MirOperand from = copy->operands[dest];
+    MirOperand to = copy->operands[source];
+    if (!mir_plain_register(program, &from) || to.kind != MIR_OP_REG || to.view != 0 || to.reg == from.reg) {
+        return 0;
+    }
+    int next = mir_next(program, line);
+    if (next < 0) return 0;
+    MirEffects effects = mir_effects(program, next);
+    if (!(effects.reads & REG_BIT(from.reg))) return 0;
+    if (!(effects.writes & REG_BIT(from.reg)) && mir_live_after(program, next, from.reg)) return 0;
+
+    /* Read x in the operands and addresses that read a */
+    MirInstr* user = &program->lines[next];
+    MirInstr saved = *user;
+    const MirOpcode* opcode = mir_opcode(program, user);
+    int index_allowed = !(program->target->reserved & REG_BIT(to.reg));
+    for (int i = 0; i < user->num_operands; i++) {
+        MirOperand* operand = &user->operands[i];
+        if (opcode->roles[i] == 'u' && is_register(operand, from.reg)) {
+            operand->reg = to.reg;
+        } else if (operand->kind == MIR_OP_MEM) {
+            if (operand->reg == from.reg) operand->reg = to.reg;
+            if (operand->index == from.reg && index_allowed) operand->index = to.reg;
+        }
+    }
+    if (mir_effects(program, next).reads & REG_BIT(from.reg)) {
+        *user = saved;
+        return 0;
+    }
+    stats->rewritten++;
+    delete_instruction(program, line, stats);
+    return 1;
+}
+
+/* Rule: "a = [m]; op ..., a" -> "op ..., [m]" when a is dead after op
+ * and the target has the form */
+static int rule_load_folding(MirProgram* program, int line, AsmOptStats* stats) {
+    const MirTarget* target = program->target;
+    MirOperand reg, memory;
+    if (!target->fold_load || !is_load(program, line, &reg, &memory)) return 0;
+    if (mir_address_registers(&memory) & REG_BIT(reg.reg)) return 0;
+    int next = mir_next(program, line);
+    if (next < 0) return 0;
+    MirEffects effects = mir_effects(program, next);
+    if (!(effects.reads & REG_BIT(reg.reg)) || (effects.writes & REG_BIT(reg.reg))) return 0;
+    if (mir_live_after(program, next, reg.reg)) return 0;
+
+    MirInstr* user = &program->lines[next];
+    MirInstr saved = *user;
+    if (!target->fold_load(target, user, reg.reg, &memory) ||
+        (mir_effects(program, next).reads & REG_BIT(reg.reg))) {
+        *user = saved;
+        return 0;
+    }
+    stats->rewritten++;
+    delete_instruction(program, line, stats);
+    return 1;
+}
+
+/* Rule: "a = x; y = a" -> "y = x", and "a = op ...; y = a" -> "y = op ...",
+ * when a is dead */
+static int rule_copy_chain(MirProgram* program, int line, AsmOptStats* stats) {
+    MirInstr* instr = &program->lines[line];
+    if (instr->kind != MIR_INSTR || instr->deleted || instr->num_operands == 0) return 0;
+    const MirOpcode* opcode = mir_opcode(program, instr);
+    int next = mir_next(program, line);
+    int dest, source, copy_dest, copy_source;
+    if (next < 0 || !copy_operands(program, next, &copy_dest, &copy_source)) return 0;
+    MirInstr* copy = &program->lines[next];
+    MirOperand y = copy->operands[copy_dest];
+    MirOperand a = copy->operands[copy_source];
+    if (!mir_plain_register(program, &a)) return 0;
+    if (y.kind == MIR_OP_MEM && (!mir_word_memory(program, &y) || (mir_address_registers(&y) & REG_BIT(a.reg)))) {
+        return 0;
+    }
+    if (y.kind == MIR_OP_REG && (!mir_plain_register(program, &y) || y.reg == a.reg)) return 0;
+
+    if (copy_operands(program, line, &dest, &source)) {
+        /* a = x; y = a */
+        MirOperand x = instr->operands[source];
+        if (!is_register(&instr->operands[dest], a.reg)) return 0;
+        if (x.kind == MIR_OP_REG && (x.view != 0 || x.reg == a.reg)) return 0;
+        if (x.kind == MIR_OP_MEM && !mir_word_memory(program, &x)) return 0;
+        if (mir_live_after(program, next, a.reg)) return 0;
+        if (mir_same_operand(&x, &y)) {
+            delete_instruction(program, next, stats);       /* Copy back to where it came from */
+        } else {
+            MirInstr rewritten = *copy;
+            if (!program->target->copy(program->target, &rewritten, &y, &x)) return 0;
+            *copy = rewritten;
+            stats->rewritten++;
+        }
+        delete_instruction(program, line, stats);
+        return 1;
+    }
+
+    /* a = op ...; y = a: compute into y when a is all op writes */
+    if (y.kind != MIR_OP_REG || opcode->opclass == MIR_CLASS_CALL || opcode->roles[0] != 'd') return 0;
+    if (!is_register(&instr->operands[0], a.reg) || (opcode->defs & REG_BIT(y.reg))) return 0;
+    MirEffects effects = mir_effects(program, line);
+    if (effects.store >= 0 || (effects.writes & ~(REG_BIT(a.reg) | opcode->defs))) return 0;
+    if (mir_live_after(program, next, a.reg)) return 0;
+    instr->operands[0].reg = y.reg;
+    stats->rewritten++;
+    delete_instruction(program, next, stats);
+    return 1;
+}
+
+/* The rules, tried in this order at every instruction */
+static const AsmRule asm_rules[] = {
+    { "store-to-load forwarding", rule_store_forwarding },
+    { "redundant reload",         rule_redundant_reload },
+    { "dead store",               rule_dead_store },
+    { "copy propagation",         rule_copy_propagation },
+    { "load folding",             rule_load_folding },
+    { "copy chain",               rule_copy_chain },
+};
+
+#define NUM_ASM_RULES ((int)(sizeof(asm_rules) / sizeof(asm_rules[0])))
+
+/* Apply the rules until none applies */
+void optimize_mir(MirProgram* program, AsmOptStats* stats) {
+    for (int i = 0; i < program->count; i++) {
+        if (program->lines[i].kind == MIR_INSTR) stats->instructions++;
+    }
+    for (int round = 0; round < MAX_ROUNDS; round++) {
+        int changed = 0;
+        for (int r = 0; r < NUM_ASM_RULES; r++) {
+            for (int i = 0; i < program->count; i++) {
+                if (program->lines[i].deleted || program->lines[i].kind != MIR_INSTR) continue;
+                int hits = asm_rules[r].apply(program, i, stats);
+                stats->hits[r] += hits;
+                changed += hits;
+            }
+        }
+        if (!changed) break;
+    }
+}
+
+/* Print the statistics; 'verbose' adds the hits of every rule */
+void print_asmopt_stats(AsmOptStats* stats, int verbose) {
+    printf("\n============== PEEPHOLE OPTIMIZER STATISTICS ==============\n\n");
+    printf("Instructions read:         %d\n", stats->instructions);
+    printf("Instructions removed:      %d\n", stats->removed);
+    printf("Instructions rewritten:    %d\n", stats->rewritten);
+    if (verbose) {
+        printf("\nRule hits:\n");
+        for (int r = 0; r < NUM_ASM_RULES; r++) {
+            printf("  %-26s %d\n", asm_rules[r].name, stats->hits[r]);
+        }
+    }
+    printf("\n==========================================================\n\n");
+}
@@ -0,0 +1,50 @@
+/*
+ * ASMOPT.H - Assembly Peephole Optimizer Header
+ * CST-405 Compiler Project
+ *
+ * This file defines the machine-level peephole pass both back ends run
+ * on their machine IR (see mir.h) before it is printed. The TAC
+ * optimizer cannot see what the templates and patterns leave behind (a
+ * value stored to its slot and loaded straight back, a copy into a
+ * scratch register that only feeds a compare), so the pass applies a
+ * table of rules, written once for every target:
+ * - store-to-load forwarding: a load of a slot the block just stored
+ *   becomes a register copy, or disappears if it loads the stored register
+ * - redundant reload: a load of a slot the block already loaded into a
+ *   register that still holds it becomes a copy of that register
+ * - dead store: a store the block overwrites before anything can read it
+ * - copy propagation: "a = x" followed by an instruction that reads a,
+ *   after which a is dead, becomes that instruction reading x
+ * - load folding: a load into a register only the next instruction
+ *   reads becomes a memory operand of that instruction, where the target
+ *   has such a form ("mov rax, [m]; cmp rax, y" -> "cmp qword [m], y")
+ * - copy chains: "a = x; y = a" becomes "y = x", and an instruction that
+ *   computes a for a copy into y computes y instead
+ * The rules read the effects, liveness and aliasing of mir.c, and build
+ * their rewrites with the target's copy and load folding hooks. Adding a
+ * rule is one entry in the rule table of asmopt.c; each rule counts its
+ * hits, listed with --verbose.
+ */
+
+#ifndef ASMOPT_H
+#define ASMOPT_H
+
+#include "mir.h"
+
+#define ASMOPT_MAX_RULES 16     /* Rules in the table */
+
+/* Peephole statistics */
+typedef struct {
+    int instructions;           /* Instructions read */
+    int removed;                /* Instructions removed */
+    int rewritten;              /* Instructions rewritten in place */
+    int hits[ASMOPT_MAX_RULES]; /* Per rule: times it applied */
+} AsmOptStats;
+
+/* Apply the rules until none applies (the blocks must be built) */
+void optimize_mir(MirProgram* program, AsmOptStats* stats);
+
+/* Print the statistics; 'verbose' adds the hits of every rule */
+void print_asmopt_stats(AsmOptStats* stats, int verbose);
+
+#endif /* ASMOPT_H */
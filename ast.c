@@ -49,6 +49,16 @@ ASTNode* create_declaration_node(char* var_name) {
 ASTNode* create_assignment_node(char* var_name, ASTNode* expr) {
     ASTNode* node = create_ast_node(NODE_ASSIGNMENT);
     node->data.assignment.var_name = strdup(var_name);
+    node->data.assignment.index = NULL;
+    node->data.assignment.expr = expr;
+    return node;
+}
+
+/* Create an array element assignment node: arr[index] = expr; */
+ASTNode* create_array_assignment_node(char* array_name, ASTNode* index, ASTNode* expr) {
+    ASTNode* node = create_ast_node(NODE_ASSIGNMENT);
+    node->data.assignment.var_name = strdup(array_name);
+    node->data.assignment.index = index;
     node->data.assignment.expr = expr;
     return node;
 }
@@ -259,8 +269,16 @@ void print_ast(ASTNode* node, int indent) {
             break;
 
         case NODE_ASSIGNMENT:
-            printf("ASSIGNMENT: %s = (line %d)\n",
-                   node->data.assignment.var_name, node->line_number);
+            if (node->data.assignment.index) {
+                printf("ARRAY ASSIGNMENT: %s[] = (line %d)\n",
+                       node->data.assignment.var_name, node->line_number);
+                for (int i = 0; i < indent + 1; i++) printf("  ");
+                printf("INDEX:\n");
+                print_ast(node->data.assignment.index, indent + 2);
+            } else {
+                printf("ASSIGNMENT: %s = (line %d)\n",
+                       node->data.assignment.var_name, node->line_number);
+            }
             print_ast(node->data.assignment.expr, indent + 1);
             break;
 
@@ -433,6 +451,7 @@ void free_ast(ASTNode* node) {
 
         case NODE_ASSIGNMENT:
             free(node->data.assignment.var_name);
+            free_ast(node->data.assignment.index);
             free_ast(node->data.assignment.expr);
             break;
 
@@ -64,6 +64,7 @@ typedef struct ASTNode {
         /* For assignments */
         struct {
             char* var_name;
+            struct ASTNode* index;  /* Element index for arr[i] = expr (NULL for scalars) */
             struct ASTNode* expr;
         } assignment;
 
@@ -173,6 +174,9 @@ ASTNode* create_declaration_node(char* var_name);
 /* Create an assignment node: x = expr; */
 ASTNode* create_assignment_node(char* var_name, ASTNode* expr);
 
+/* Create an array element assignment node: arr[index] = expr; (ARRAY FEATURE) */
+ASTNode* create_array_assignment_node(char* array_name, ASTNode* index, ASTNode* expr);
+
 /* Create a print node: print(expr); */
 ASTNode* create_print_node(ASTNode* expr);
 
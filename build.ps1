@@ -39,7 +39,22 @@ gcc -Wall -g -c ast.c
 gcc -Wall -g -c symtable.c
 gcc -Wall -g -c semantic.c
 gcc -Wall -g -c ircode.c
+gcc -Wall -g -c cfg.c
+gcc -Wall -g -c range.c
+gcc -Wall -g -c loop_opt.c
+gcc -Wall -g -c inliner.c
+gcc -Wall -g -c strength.c
+gcc -Wall -g -c passes.c
 gcc -Wall -g -c optimizer.c
+gcc -Wall -g -c checks.c
+gcc -Wall -g -c regalloc.c
+gcc -Wall -g -c frame.c
+gcc -Wall -g -c isel.c
+gcc -Wall -g -c mir.c
+gcc -Wall -g -c asmopt.c
+gcc -Wall -g -c elfobj.c
+gcc -Wall -g -c x86enc.c
+gcc -Wall -g -c jit.c
 gcc -Wall -g -c codegen.c
 gcc -Wall -g -c codegen_mips.c
 gcc -Wall -g -c diagnostics.c
@@ -47,7 +62,7 @@ gcc -Wall -g -c security.c
 
 Write-Host ""
 Write-Host "Linking compiler..."
-gcc -Wall -g -o compiler.exe compiler.o parser.tab.o lex.yy.o ast.o symtable.o semantic.o ircode.o optimizer.o codegen.o codegen_mips.o diagnostics.o security.o
+gcc -Wall -g -o compiler.exe compiler.o parser.tab.o lex.yy.o ast.o symtable.o semantic.o ircode.o cfg.o range.o loop_opt.o inliner.o strength.o passes.o optimizer.o checks.o regalloc.o frame.o isel.o mir.o asmopt.o elfobj.o x86enc.o jit.o codegen.o codegen_mips.o diagnostics.o security.o
 
 if ($LASTEXITCODE -ne 0) {
     Write-Host "ERROR: Linking failed"
@@ -0,0 +1,840 @@
+/*
+ * CFG.C - Control Flow Graph Implementation
+ * CST-405 Compiler Project
+ *
+ * This file builds basic blocks and control flow edges for one function
+ * of the Three-Address Code, computes the dominator tree and the loop
+ * nesting forest, computes live variables, keeps these analyses (and
+ * the value ranges of range.c) in a
+ * cache for the pass manager, and provides the name tables used by the
+ * dataflow-based optimizations.
+ */
+
+#include "cfg.h"
+#include "range.h"
+#include "diagnostics.h"
+
+/* Helper: Does this instruction end a basic block? */
+static int ends_block(TACInstruction* inst) {
+    return inst->opcode == TAC_GOTO || inst->opcode == TAC_IF_FALSE ||
+           inst->opcode == TAC_RETURN || inst->opcode == TAC_RETURN_VOID;
+}
+
+/* Helper: Add a control flow edge from -> to */
+static void add_edge(CFG* cfg, int from, int to) {
+    BasicBlock* src = &cfg->blocks[from];
+    BasicBlock* dst = &cfg->blocks[to];
+
+    /* IF_FALSE whose target is the fall-through block has one real edge */
+    for (int i = 0; i < src->num_succs; i++) {
+        if (src->succs[i] == to) return;
+    }
+    src->succs[src->num_succs++] = to;
+
+    if (dst->num_preds == dst->pred_capacity) {
+        dst->pred_capacity = dst->pred_capacity ? dst->pred_capacity * 2 : 4;
+        dst->preds = (int*)safe_realloc(dst->preds, dst->pred_capacity * sizeof(int),
+                                        "CFG predecessors");
+    }
+    dst->preds[dst->num_preds++] = from;
+}
+
+/* Return the first instruction after the function starting at 'start' */
+TACInstruction* function_end(TACInstruction* start) {
+    TACInstruction* inst = start ? start->next : NULL;
+    while (inst && inst->opcode != TAC_FUNCTION_LABEL) {
+        inst = inst->next;
+    }
+    return inst;
+}
+
+/* Build the CFG of one function */
+CFG* build_cfg(TACInstruction* start) {
+    CFG* cfg = (CFG*)safe_calloc(1, sizeof(CFG), "CFG");
+    cfg->end = function_end(start);
+
+    /* Collect the instructions of the function in layout order */
+    int capacity = 16;
+    cfg->insts = (TACInstruction**)safe_malloc(capacity * sizeof(TACInstruction*), "CFG instructions");
+    for (TACInstruction* inst = start; inst && inst != cfg->end; inst = inst->next) {
+        if (cfg->num_insts == capacity) {
+            capacity *= 2;
+            cfg->insts = (TACInstruction**)safe_realloc(cfg->insts,
+                                                        capacity * sizeof(TACInstruction*),
+                                                        "CFG instructions");
+        }
+        cfg->insts[cfg->num_insts++] = inst;
+    }
+
+    /* Find block leaders: the first instruction, every label, and every
+     * instruction that follows a jump or return */
+    char* leader = (char*)safe_calloc(cfg->num_insts + 1, 1, "CFG leaders");
+    if (cfg->num_insts > 0) leader[0] = 1;
+    for (int i = 0; i < cfg->num_insts; i++) {
+        if (cfg->insts[i]->opcode == TAC_LABEL) leader[i] = 1;
+        if (ends_block(cfg->insts[i]) && i + 1 < cfg->num_insts) leader[i + 1] = 1;
+    }
+
+    int num_blocks = 0;
+    for (int i = 0; i < cfg->num_insts; i++) num_blocks += leader[i];
+    cfg->blocks = (BasicBlock*)safe_calloc(num_blocks > 0 ? num_blocks : 1,
+                                           sizeof(BasicBlock), "CFG blocks");
+    cfg->num_blocks = num_blocks;
+
+    int b = -1;
+    for (int i = 0; i < cfg->num_insts; i++) {
+        if (leader[i]) {
+            b++;
+            cfg->blocks[b].start = i;
+            cfg->blocks[b].idom = -1;
+            cfg->blocks[b].rpo = -1;
+        }
+        cfg->blocks[b].count++;
+    }
+    free(leader);
+
+    /* Connect blocks: jumps go to their label, everything except GOTO and
+     * RETURN falls through to the next block */
+    for (b = 0; b < cfg->num_blocks; b++) {
+        TACInstruction* last = block_last(cfg, b);
+        int has_next = b + 1 < cfg->num_blocks;
+
+        switch (last->opcode) {
+            case TAC_GOTO: {
+                int target = find_label_block(cfg, last->label);
+                if (target >= 0) add_edge(cfg, b, target);
+                break;
+            }
+            case TAC_IF_FALSE: {
+                if (has_next) add_edge(cfg, b, b + 1);
+                int target = find_label_block(cfg, last->label);
+                if (target >= 0) add_edge(cfg, b, target);
+                break;
+            }
+            case TAC_RETURN:
+            case TAC_RETURN_VOID:
+                break;
+            default:
+                if (has_next) add_edge(cfg, b, b + 1);
+                break;
+        }
+    }
+
+    /* Number reachable blocks in reverse postorder (iterative DFS) */
+    cfg->rpo_order = (int*)safe_malloc((cfg->num_blocks + 1) * sizeof(int), "CFG order");
+    if (cfg->num_blocks > 0) {
+        int* stack = (int*)safe_malloc(cfg->num_blocks * sizeof(int), "CFG stack");
+        int* next_succ = (int*)safe_calloc(cfg->num_blocks, sizeof(int), "CFG stack");
+        char* visited = (char*)safe_calloc(cfg->num_blocks, 1, "CFG visited");
+        int* postorder = (int*)safe_malloc(cfg->num_blocks * sizeof(int), "CFG order");
+        int sp = 0, count = 0;
+
+        stack[sp++] = 0;
+        visited[0] = 1;
+        while (sp > 0) {
+            int top = stack[sp - 1];
+            BasicBlock* blk = &cfg->blocks[top];
+            if (next_succ[top] < blk->num_succs) {
+                int s = blk->succs[next_succ[top]++];
+                if (!visited[s]) {
+                    visited[s] = 1;
+                    stack[sp++] = s;
+                }
+            } else {
+                postorder[count++] = top;
+                sp--;
+            }
+        }
+
+        for (int i = 0; i < count; i++) {
+            int blk = postorder[count - 1 - i];
+            cfg->rpo_order[i] = blk;
+            cfg->blocks[blk].rpo = i;
+        }
+        cfg->num_reachable = count;
+
+        free(stack);
+        free(next_succ);
+        free(visited);
+        free(postorder);
+    }
+
+    return cfg;
+}
+
+/* Find the block that starts with the given label */
+int find_label_block(CFG* cfg, const char* label) {
+    if (!label) return -1;
+    for (int b = 0; b < cfg->num_blocks; b++) {
+        TACInstruction* first = block_first(cfg, b);
+        if (first->opcode == TAC_LABEL && first->label &&
+            strcmp(first->label, label) == 0) {
+            return b;
+        }
+    }
+    return -1;
+}
+
+/* Return the first instruction of a block */
+TACInstruction* block_first(CFG* cfg, int block) {
+    return cfg->insts[cfg->blocks[block].start];
+}
+
+/* Return the last instruction of a block */
+TACInstruction* block_last(CFG* cfg, int block) {
+    BasicBlock* blk = &cfg->blocks[block];
+    return cfg->insts[blk->start + blk->count - 1];
+}
+
+/* Free a CFG */
+void free_cfg(CFG* cfg) {
+    if (!cfg) return;
+    for (int b = 0; b < cfg->num_blocks; b++) {
+        free(cfg->blocks[b].preds);
+    }
+    free(cfg->blocks);
+    free(cfg->insts);
+    free(cfg->rpo_order);
+    free(cfg);
+}
+
+/* Helper: Walk up the dominator tree to the nearest common dominator */
+static int intersect(CFG* cfg, int a, int b) {
+    while (a != b) {
+        while (cfg->blocks[a].rpo > cfg->blocks[b].rpo) a = cfg->blocks[a].idom;
+        while (cfg->blocks[b].rpo > cfg->blocks[a].rpo) b = cfg->blocks[b].idom;
+    }
+    return a;
+}
+
+/* Compute immediate dominators
+ * Reference: Cooper, Harvey and Kennedy, "A Simple, Fast Dominance Algorithm"
+ */
+void compute_dominators(CFG* cfg) {
+    if (cfg->num_reachable == 0) return;
+
+    int entry = cfg->rpo_order[0];
+    for (int b = 0; b < cfg->num_blocks; b++) cfg->blocks[b].idom = -1;
+    cfg->blocks[entry].idom = entry;
+
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int i = 1; i < cfg->num_reachable; i++) {
+            int b = cfg->rpo_order[i];
+            BasicBlock* blk = &cfg->blocks[b];
+            int new_idom = -1;
+
+            for (int p = 0; p < blk->num_preds; p++) {
+                int pred = blk->preds[p];
+                if (cfg->blocks[pred].idom < 0) continue;   /* Not processed yet */
+                new_idom = (new_idom < 0) ? pred : intersect(cfg, pred, new_idom);
+            }
+
+            if (new_idom != blk->idom) {
+                blk->idom = new_idom;
+                changed = 1;
+            }
+        }
+    }
+
+    /* The entry has no immediate dominator */
+    cfg->blocks[entry].idom = -1;
+    cfg->dominators_valid = 1;
+}
+
+/* Check whether block a dominates block b */
+int dominates(CFG* cfg, int a, int b) {
+    if (cfg->blocks[b].rpo < 0) return 0;
+    while (b >= 0) {
+        if (a == b) return 1;
+        b = cfg->blocks[b].idom;
+    }
+    return 0;
+}
+
+/* Helper: Does block b fall through (rather than jump) into block b + 1? */
+static int falls_through(CFG* cfg, int b) {
+    TACOpcode op = block_last(cfg, b)->opcode;
+    return op != TAC_GOTO && op != TAC_RETURN && op != TAC_RETURN_VOID;
+}
+
+/* Helper: Find the preheader of a loop: the single block outside the loop
+ * that enters the header, laid out right before it with no other successor */
+static int find_preheader(CFG* cfg, Loop* loop) {
+    BasicBlock* header = &cfg->blocks[loop->header];
+    int preheader = -1;
+
+    for (int p = 0; p < header->num_preds; p++) {
+        int pred = header->preds[p];
+        if (loop->in_loop[pred]) continue;
+        if (preheader >= 0) return -1;
+        preheader = pred;
+    }
+
+    if (preheader != loop->header - 1 || cfg->blocks[preheader].num_succs != 1) return -1;
+    return preheader;
+}
+
+/* Helper: Order loops by size so inner loops come first */
+static int compare_loops(const void* a, const void* b) {
+    const Loop* la = (const Loop*)a;
+    const Loop* lb = (const Loop*)b;
+    if (la->num_blocks != lb->num_blocks) return la->num_blocks - lb->num_blocks;
+    return la->header - lb->header;
+}
+
+/* Find the natural loops of a function */
+LoopForest* find_loops(CFG* cfg) {
+    LoopForest* forest = (LoopForest*)safe_calloc(1, sizeof(LoopForest), "loop forest");
+    forest->loops = (Loop*)safe_calloc(cfg->num_blocks > 0 ? cfg->num_blocks : 1,
+                                       sizeof(Loop), "loop forest");
+    forest->innermost = (int*)safe_malloc((cfg->num_blocks + 1) * sizeof(int), "loop forest");
+    for (int b = 0; b < cfg->num_blocks; b++) forest->innermost[b] = -1;
+
+    int* worklist = (int*)safe_malloc((cfg->num_blocks + 1) * sizeof(int), "loop forest");
+
+    /* An edge b -> h is a back edge when h dominates b; all back edges
+     * into the same header form one loop */
+    for (int i = 0; i < cfg->num_reachable; i++) {
+        int h = cfg->rpo_order[i];
+        Loop* loop = NULL;
+        int count = 0;
+
+        for (int p = 0; p < cfg->blocks[h].num_preds; p++) {
+            int tail = cfg->blocks[h].preds[p];
+            if (cfg->blocks[tail].rpo < 0 || !dominates(cfg, h, tail)) continue;
+
+            if (!loop) {
+                loop = &forest->loops[forest->num_loops++];
+                loop->header = h;
+                loop->parent = -1;
+                loop->preheader = -1;
+                loop->in_loop = (char*)safe_calloc(cfg->num_blocks, 1, "loop forest");
+                loop->in_loop[h] = 1;
+            }
+            loop->num_back_edges++;
+
+            /* Walk backwards from the tail until the header is reached */
+            if (!loop->in_loop[tail]) {
+                loop->in_loop[tail] = 1;
+                worklist[count++] = tail;
+            }
+            while (count > 0) {
+                int x = worklist[--count];
+                for (int q = 0; q < cfg->blocks[x].num_preds; q++) {
+                    int pred = cfg->blocks[x].preds[q];
+                    if (cfg->blocks[pred].rpo >= 0 && !loop->in_loop[pred]) {
+                        loop->in_loop[pred] = 1;
+                        worklist[count++] = pred;
+                    }
+                }
+            }
+        }
+
+        if (loop) {
+            loop->blocks = (int*)safe_malloc(cfg->num_blocks * sizeof(int), "loop forest");
+            for (int b = 0; b < cfg->num_blocks; b++) {
+                if (loop->in_loop[b]) loop->blocks[loop->num_blocks++] = b;
+            }
+        }
+    }
+    free(worklist);
+
+    qsort(forest->loops, forest->num_loops, sizeof(Loop), compare_loops);
+
+    /* Nesting: the parent of a loop is the smallest later loop containing
+     * its header; the innermost loop of a block is the first one found */
+    for (int l = 0; l < forest->num_loops; l++) {
+        Loop* loop = &forest->loops[l];
+        for (int outer = l + 1; outer < forest->num_loops; outer++) {
+            if (forest->loops[outer].in_loop[loop->header]) {
+                loop->parent = outer;
+                break;
+            }
+        }
+        for (int i = 0; i < loop->num_blocks; i++) {
+            if (forest->innermost[loop->blocks[i]] < 0) forest->innermost[loop->blocks[i]] = l;
+        }
+        loop->preheader = find_preheader(cfg, loop);
+    }
+    for (int l = forest->num_loops - 1; l >= 0; l--) {
+        Loop* loop = &forest->loops[l];
+        loop->depth = loop->parent < 0 ? 1 : forest->loops[loop->parent].depth + 1;
+    }
+
+    return forest;
+}
+
+/* Insert preheaders for the loops that lack one */
+int insert_preheaders(TACCode* code, CFG* cfg, LoopForest* forest) {
+    int inserted = 0;
+
+    for (int l = 0; l < forest->num_loops; l++) {
+        Loop* loop = &forest->loops[l];
+        if (loop->preheader >= 0 || loop->header == 0) continue;
+
+        TACInstruction* header_label = block_first(cfg, loop->header);
+        if (header_label->opcode != TAC_LABEL) continue;
+
+        char* label = new_label();
+        TACInstruction* pos = cfg->insts[cfg->blocks[loop->header].start - 1];
+
+        /* A loop block laid out before the header must keep jumping to it */
+        int prev = loop->header - 1;
+        if (loop->in_loop[prev] && falls_through(cfg, prev)) {
+            TACInstruction* jump = create_tac_instruction(TAC_GOTO, NULL, NULL, NULL,
+                                                          header_label->label);
+            insert_tac_after(code, pos, jump);
+            pos = jump;
+        }
+        insert_tac_after(code, pos, create_tac_instruction(TAC_LABEL, NULL, NULL, NULL, label));
+
+        /* Entries from outside the loop now jump to the preheader */
+        BasicBlock* header = &cfg->blocks[loop->header];
+        for (int p = 0; p < header->num_preds; p++) {
+            int pred = header->preds[p];
+            TACInstruction* last = block_last(cfg, pred);
+            if (loop->in_loop[pred]) continue;
+            if ((last->opcode == TAC_GOTO || last->opcode == TAC_IF_FALSE) &&
+                strcmp(last->label, header_label->label) == 0) {
+                free(last->label);
+                last->label = safe_strdup(label, "preheader");
+            }
+        }
+
+        debug_print("Inserted preheader %s for loop at %s", label, header_label->label);
+        free(label);
+        inserted++;
+    }
+
+    return inserted;
+}
+
+/* Free a loop forest */
+void free_loops(LoopForest* forest) {
+    if (!forest) return;
+    for (int l = 0; l < forest->num_loops; l++) {
+        free(forest->loops[l].blocks);
+        free(forest->loops[l].in_loop);
+    }
+    free(forest->loops);
+    free(forest->innermost);
+    free(forest);
+}
+
+/* Unlink and free the instructions marked dead */
+int remove_dead_instructions(TACCode* code, CFG* cfg, const char* dead) {
+    int removed = 0;
+    TACInstruction* prev = cfg->insts[0];
+
+    for (int i = 1; i < cfg->num_insts; i++) {
+        TACInstruction* inst = cfg->insts[i];
+        if (dead[i]) {
+            free_tac_instruction(inst);
+            code->instruction_count--;
+            removed++;
+        } else {
+            prev->next = inst;
+            prev = inst;
+        }
+    }
+
+    prev->next = cfg->end;
+    if (!cfg->end) code->tail = prev;
+    return removed;
+}
+
+/* Relink the instructions of a function in a new order */
+void relink_function(TACCode* code, CFG* cfg, TACInstruction** order, int count) {
+    for (int i = 0; i + 1 < count; i++) {
+        order[i]->next = order[i + 1];
+    }
+    order[count - 1]->next = cfg->end;
+    if (!cfg->end) code->tail = order[count - 1];
+}
+
+/* Live variable sets: one bit per interned name */
+#define LIVE_WORD(id) ((id) / 32)
+#define LIVE_BIT(id)  (1u << ((id) % 32))
+
+/* Compute the live variables of a function. Blocks are visited in
+ * reverse layout order until no live-in set changes. */
+Liveness* compute_liveness(CFG* cfg) {
+    Liveness* live = (Liveness*)safe_calloc(1, sizeof(Liveness), "liveness");
+    live->names = create_name_table(cfg->num_insts);
+    intern_cfg_names(live->names, cfg);
+
+    int words = live->names->count / 32 + 1;
+    int sets = cfg->num_blocks > 0 ? cfg->num_blocks : 1;
+    live->num_words = words;
+    live->live_in = (unsigned int*)safe_calloc(sets * words, sizeof(unsigned int), "liveness");
+    live->live_out = (unsigned int*)safe_calloc(sets * words, sizeof(unsigned int), "liveness");
+    live->memory = (unsigned int*)safe_calloc(words, sizeof(unsigned int), "liveness");
+
+    for (int id = 0; id < live->names->count; id++) {
+        if (!is_temp_name(live->names->names[id])) {
+            live->memory[LIVE_WORD(id)] |= LIVE_BIT(id);
+        }
+    }
+
+    unsigned int* set = (unsigned int*)safe_malloc(words * sizeof(unsigned int), "liveness");
+    int changed = 1;
+
+    while (changed) {
+        changed = 0;
+        for (int b = cfg->num_blocks - 1; b >= 0; b--) {
+            BasicBlock* blk = &cfg->blocks[b];
+            unsigned int* out = live_out_set(live, b);
+            unsigned int* in = live->live_in + b * words;
+
+            /* Memory variables outlive the function */
+            if (blk->num_succs == 0) {
+                memcpy(out, live->memory, words * sizeof(unsigned int));
+            } else {
+                memset(out, 0, words * sizeof(unsigned int));
+                for (int s = 0; s < blk->num_succs; s++) {
+                    unsigned int* succ_in = live->live_in + blk->succs[s] * words;
+                    for (int w = 0; w < words; w++) out[w] |= succ_in[w];
+                }
+            }
+
+            memcpy(set, out, words * sizeof(unsigned int));
+            for (int i = blk->start + blk->count - 1; i >= blk->start; i--) {
+                liveness_transfer(live, set, cfg->insts[i]);
+            }
+
+            if (memcmp(set, in, words * sizeof(unsigned int)) != 0) {
+                memcpy(in, set, words * sizeof(unsigned int));
+                changed = 1;
+            }
+        }
+    }
+
+    free(set);
+    return live;
+}
+
+/* Pointer to the live-out set of a block */
+unsigned int* live_out_set(Liveness* live, int block) {
+    return live->live_out + block * live->num_words;
+}
+
+/* Step a live set backward over one instruction: the definition dies,
+ * the operands become live, and a call may read any memory variable */
+void liveness_transfer(Liveness* live, unsigned int* set, TACInstruction* inst) {
+    const char* def = tac_def(inst);
+    if (def) {
+        int id = lookup_name_id(live->names, def);
+        if (id >= 0) set[LIVE_WORD(id)] &= ~LIVE_BIT(id);
+    }
+
+    if (inst->opcode == TAC_CALL) {
+        for (int w = 0; w < live->num_words; w++) set[w] |= live->memory[w];
+    }
+
+    const char* uses[3];
+    int n = tac_uses(inst, uses);
+    for (int u = 0; u < n; u++) {
+        int id = lookup_name_id(live->names, uses[u]);
+        if (id >= 0) set[LIVE_WORD(id)] |= LIVE_BIT(id);
+    }
+}
+
+/* Check whether a variable is in a live set */
+int is_live_in_set(Liveness* live, const unsigned int* set, const char* name) {
+    int id = lookup_name_id(live->names, name);
+    return id >= 0 && (set[LIVE_WORD(id)] & LIVE_BIT(id)) != 0;
+}
+
+/* Free liveness information */
+void free_liveness(Liveness* live) {
+    if (!live) return;
+    free_name_table(live->names);
+    free(live->live_in);
+    free(live->live_out);
+    free(live->memory);
+    free(live);
+}
+
+/* Analyses cached for one function */
+typedef struct {
+    TACInstruction* start;      /* First instruction of the function */
+    CFG* cfg;                   /* CFG (dominators computed on demand) */
+    LoopForest* forest;         /* Loop forest (NULL until requested) */
+    Liveness* live;             /* Live variables (NULL until requested) */
+    RangeAnalysis* ranges;      /* Value ranges (NULL until requested) */
+} CachedAnalyses;
+
+static CachedAnalyses* analysis_cache = NULL;
+static int cache_count = 0;
+static int cache_capacity = 0;
+static int cache_enabled = 0;
+static int cache_hits = 0;
+static int cache_misses = 0;
+
+/* Helper: Free the analyses of a cache entry */
+static void free_cached_analyses(CachedAnalyses* entry) {
+    free_range_analysis(entry->ranges);
+    free_liveness(entry->live);
+    free_loops(entry->forest);
+    free_cfg(entry->cfg);
+    entry->cfg = NULL;
+    entry->forest = NULL;
+    entry->live = NULL;
+    entry->ranges = NULL;
+}
+
+/* Helper: Find the cache entry of a function, adding an empty one */
+static CachedAnalyses* find_cache_entry(TACInstruction* start) {
+    for (int i = 0; i < cache_count; i++) {
+        if (analysis_cache[i].start == start) return &analysis_cache[i];
+    }
+
+    if (cache_count == cache_capacity) {
+        cache_capacity = cache_capacity ? cache_capacity * 2 : 8;
+        analysis_cache = (CachedAnalyses*)safe_realloc(analysis_cache,
+                                                       cache_capacity * sizeof(CachedAnalyses),
+                                                       "analysis cache");
+    }
+
+    CachedAnalyses* entry = &analysis_cache[cache_count++];
+    entry->start = start;
+    entry->cfg = NULL;
+    entry->forest = NULL;
+    entry->live = NULL;
+    entry->ranges = NULL;
+    return entry;
+}
+
+/* Helper: Entry to fill for a request (a scratch entry while the cache is off) */
+static CachedAnalyses* request_entry(TACInstruction* start, CachedAnalyses* scratch) {
+    if (cache_enabled) return find_cache_entry(start);
+    scratch->start = start;
+    scratch->cfg = NULL;
+    scratch->forest = NULL;
+    scratch->live = NULL;
+    scratch->ranges = NULL;
+    return scratch;
+}
+
+/* Helper: Count a request as a hit or a miss */
+static void count_request(int computed) {
+    if (!cache_enabled) return;
+    if (computed) cache_misses++;
+    else cache_hits++;
+}
+
+/* Helper: Make sure the entry has a CFG (with dominators if asked) */
+static CFG* entry_cfg(CachedAnalyses* entry, int dominators, int* computed) {
+    if (!entry->cfg) {
+        entry->cfg = build_cfg(entry->start);
+        *computed = 1;
+    }
+    if (dominators && !entry->cfg->dominators_valid && entry->cfg->num_reachable > 0) {
+        compute_dominators(entry->cfg);
+        *computed = 1;
+    }
+    return entry->cfg;
+}
+
+/* Turn the analysis cache on or off (turning it off drops everything) */
+void enable_analysis_cache(int enable) {
+    invalidate_analyses(0);
+    free(analysis_cache);
+    analysis_cache = NULL;
+    cache_capacity = 0;
+    cache_enabled = enable;
+    cache_hits = 0;
+    cache_misses = 0;
+}
+
+/* CFG of a function */
+CFG* get_function_cfg(TACInstruction* start) {
+    CachedAnalyses scratch;
+    CachedAnalyses* entry = request_entry(start, &scratch);
+    int computed = 0;
+    CFG* cfg = entry_cfg(entry, 0, &computed);
+    count_request(computed);
+    return cfg;
+}
+
+/* CFG of a function with its dominators computed */
+CFG* get_function_dominators(TACInstruction* start) {
+    CachedAnalyses scratch;
+    CachedAnalyses* entry = request_entry(start, &scratch);
+    int computed = 0;
+    CFG* cfg = entry_cfg(entry, 1, &computed);
+    count_request(computed);
+    return cfg;
+}
+
+/* CFG, dominators and loop forest of a function */
+CFG* get_function_loops(TACInstruction* start, LoopForest** forest) {
+    CachedAnalyses scratch;
+    CachedAnalyses* entry = request_entry(start, &scratch);
+    int computed = 0;
+    CFG* cfg = entry_cfg(entry, 1, &computed);
+    if (!entry->forest) {
+        entry->forest = find_loops(cfg);
+        computed = 1;
+    }
+    count_request(computed);
+    *forest = entry->forest;
+    return cfg;
+}
+
+/* CFG and live variables of a function */
+CFG* get_function_liveness(TACInstruction* start, Liveness** live) {
+    CachedAnalyses scratch;
+    CachedAnalyses* entry = request_entry(start, &scratch);
+    int computed = 0;
+    CFG* cfg = entry_cfg(entry, 0, &computed);
+    if (!entry->live) {
+        entry->live = compute_liveness(cfg);
+        computed = 1;
+    }
+    count_request(computed);
+    *live = entry->live;
+    return cfg;
+}
+
+/* CFG, dominators and value ranges of a function */
+CFG* get_function_ranges(TACInstruction* start, RangeAnalysis** ranges) {
+    CachedAnalyses scratch;
+    CachedAnalyses* entry = request_entry(start, &scratch);
+    int computed = 0;
+    CFG* cfg = entry_cfg(entry, 1, &computed);
+    if (!entry->ranges) {
+        entry->ranges = analyze_ranges(cfg);
+        computed = 1;
+    }
+    count_request(computed);
+    *ranges = entry->ranges;
+    return cfg;
+}
+
+/* Give back analyses (only uncached ones are freed) */
+void release_analyses(CFG* cfg, LoopForest* forest, Liveness* live) {
+    if (cache_enabled) return;
+    free_liveness(live);
+    free_loops(forest);
+    free_cfg(cfg);
+}
+
+/* Give back value ranges and their CFG (only uncached ones are freed) */
+void release_ranges(CFG* cfg, RangeAnalysis* ranges) {
+    if (cache_enabled) return;
+    free_range_analysis(ranges);
+    free_cfg(cfg);
+}
+
+/* Drop the cached analyses of one function */
+void invalidate_function_analyses(TACInstruction* start) {
+    for (int i = 0; i < cache_count; i++) {
+        if (analysis_cache[i].start != start) continue;
+        free_cached_analyses(&analysis_cache[i]);
+        analysis_cache[i] = analysis_cache[--cache_count];
+        return;
+    }
+}
+
+/* Drop every cached analysis not listed in 'preserved'. Liveness and
+ * ranges are indexed by block, so they never outlive the CFG they were
+ * computed on. */
+void invalidate_analyses(int preserved) {
+    if (!(preserved & ANALYSIS_CFG)) {
+        for (int i = 0; i < cache_count; i++) free_cached_analyses(&analysis_cache[i]);
+        cache_count = 0;
+        return;
+    }
+
+    if (!(preserved & ANALYSIS_LIVENESS)) {
+        for (int i = 0; i < cache_count; i++) {
+            free_liveness(analysis_cache[i].live);
+            analysis_cache[i].live = NULL;
+        }
+    }
+
+    if (!(preserved & ANALYSIS_RANGES)) {
+        for (int i = 0; i < cache_count; i++) {
+            free_range_analysis(analysis_cache[i].ranges);
+            analysis_cache[i].ranges = NULL;
+        }
+    }
+}
+
+/* Number of analysis requests served from the cache / computed */
+void get_analysis_cache_counts(int* hits, int* misses) {
+    *hits = cache_hits;
+    *misses = cache_misses;
+}
+
+/* Create an empty name table */
+NameTable* create_name_table(int expected_names) {
+    NameTable* table = (NameTable*)safe_calloc(1, sizeof(NameTable), "name table");
+    table->capacity = expected_names > 8 ? expected_names : 8;
+    table->num_buckets = table->capacity * 2 + 1;
+    table->names = (char**)safe_malloc(table->capacity * sizeof(char*), "name table");
+    table->chain = (int*)safe_malloc(table->capacity * sizeof(int), "name table");
+    table->buckets = (int*)safe_malloc(table->num_buckets * sizeof(int), "name table");
+    for (int i = 0; i < table->num_buckets; i++) table->buckets[i] = -1;
+    return table;
+}
+
+/* Return the id of a name or -1 */
+int lookup_name_id(NameTable* table, const char* name) {
+    int id = table->buckets[hash(name, table->num_buckets)];
+    while (id >= 0) {
+        if (strcmp(table->names[id], name) == 0) return id;
+        id = table->chain[id];
+    }
+    return -1;
+}
+
+/* Return the id of a name, adding it if it is new */
+int intern_name(NameTable* table, const char* name) {
+    int id = lookup_name_id(table, name);
+    if (id >= 0) return id;
+
+    if (table->count == table->capacity) {
+        table->capacity *= 2;
+        table->names = (char**)safe_realloc(table->names, table->capacity * sizeof(char*),
+                                            "name table");
+        table->chain = (int*)safe_realloc(table->chain, table->capacity * sizeof(int),
+                                          "name table");
+    }
+
+    id = table->count++;
+    unsigned int bucket = hash(name, table->num_buckets);
+    table->names[id] = safe_strdup(name, "name table");
+    table->chain[id] = table->buckets[bucket];
+    table->buckets[bucket] = id;
+    return id;
+}
+
+/* Intern every variable operand of the instructions in a CFG */
+void intern_cfg_names(NameTable* table, CFG* cfg) {
+    for (int i = 0; i < cfg->num_insts; i++) {
+        TACInstruction* inst = cfg->insts[i];
+        const char* uses[3];
+        int n = tac_uses(inst, uses);
+        for (int u = 0; u < n; u++) intern_name(table, uses[u]);
+
+        const char* def = tac_def(inst);
+        if (def) intern_name(table, def);
+
+        const char* array = tac_array(inst);
+        if (array) intern_name(table, array);
+    }
+}
+
+/* Free a name table */
+void free_name_table(NameTable* table) {
+    if (!table) return;
+    for (int i = 0; i < table->count; i++) free(table->names[i]);
+    free(table->names);
+    free(table->chain);
+    free(table->buckets);
+    free(table);
+}
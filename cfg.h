@@ -0,0 +1,225 @@
+/*
+ * CFG.H - Control Flow Graph Header
+ * CST-405 Compiler Project
+ *
+ * This file defines the control flow graph (CFG) that the global
+ * optimizations build over the Three-Address Code of one function.
+ *
+ * A basic block is a maximal run of TAC instructions with a single
+ * entry (its first instruction) and a single exit (its last one).
+ * Blocks are stored in layout order, so the instructions of block b
+ * are cfg->insts[b.start .. b.start + b.count - 1].
+ *
+ * The pass manager keeps the analyses of each function in a cache
+ * between passes; see ANALYSIS CACHE below.
+ */
+
+#ifndef CFG_H
+#define CFG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ircode.h"
+
+/* Basic block of a function */
+typedef struct {
+    int start;                  /* Index of first instruction in cfg->insts */
+    int count;                  /* Number of instructions in the block */
+    int succs[2];               /* Successor blocks (fall-through first) */
+    int num_succs;              /* Number of successors (0, 1 or 2) */
+    int* preds;                 /* Predecessor blocks */
+    int num_preds;              /* Number of predecessors */
+    int pred_capacity;          /* Allocated size of preds */
+    int idom;                   /* Immediate dominator (-1 for entry/unreachable) */
+    int rpo;                    /* Reverse postorder number (-1 if unreachable) */
+} BasicBlock;
+
+/* Control flow graph of one function */
+typedef struct {
+    TACInstruction** insts;     /* Instructions of the function in layout order */
+    int num_insts;              /* Number of instructions */
+    TACInstruction* end;        /* First instruction after the function (NULL at end) */
+    BasicBlock* blocks;         /* Blocks in layout order (block 0 is the entry) */
+    int num_blocks;             /* Number of blocks */
+    int* rpo_order;             /* Reachable blocks in reverse postorder */
+    int num_reachable;          /* Number of reachable blocks */
+    int dominators_valid;       /* Set once compute_dominators() has run */
+} CFG;
+
+/* Natural loop: a header block plus every block that can reach one of
+ * its back edges without passing through the header */
+typedef struct {
+    int header;                 /* Header block (target of the back edges) */
+    int* blocks;                /* Member blocks in layout order (header included) */
+    int num_blocks;             /* Number of member blocks */
+    char* in_loop;              /* Per CFG block: is the block a member? */
+    int num_back_edges;         /* Number of back edges into the header */
+    int parent;                 /* Innermost enclosing loop (-1 if outermost) */
+    int depth;                  /* Nesting depth (1 for outermost loops) */
+    int preheader;              /* Preheader block (-1 if the loop has none) */
+} Loop;
+
+/* Loop nesting forest of one function (inner loops come before outer ones) */
+typedef struct {
+    Loop* loops;                /* Loops ordered by size */
+    int num_loops;              /* Number of loops */
+    int* innermost;             /* Per CFG block: innermost loop containing it (-1 if none) */
+} LoopForest;
+
+/* Interning table mapping variable names to dense ids (0, 1, 2, ...) so
+ * analyses can keep per-variable facts in plain arrays */
+typedef struct {
+    char** names;               /* Interned names indexed by id */
+    int count;                  /* Number of interned names */
+    int capacity;               /* Allocated size of names/chain */
+    int* buckets;               /* Hash buckets (first id or -1) */
+    int* chain;                 /* Next id in the same bucket */
+    int num_buckets;            /* Number of hash buckets */
+} NameTable;
+
+/* Live variables at the block boundaries of one function. Sets are
+ * bitsets of num_words words indexed by the ids of 'names'. Variables
+ * other than temporaries live in memory: they are live at every exit
+ * and across every call. */
+typedef struct {
+    NameTable* names;           /* Variables of the function */
+    int num_words;              /* Words per bitset */
+    unsigned int* live_in;      /* Per block: variables live at block entry */
+    unsigned int* live_out;     /* Per block: variables live at block exit */
+    unsigned int* memory;       /* Variables that are not temporaries */
+} Liveness;
+
+/* Value ranges of a function (defined in range.h) */
+typedef struct RangeAnalysis RangeAnalysis;
+
+/* Analyses kept by the analysis cache (a pass lists the ones it preserves) */
+#define ANALYSIS_CFG        1   /* Blocks, edges, dominators and loops */
+#define ANALYSIS_LIVENESS   2   /* Live variables */
+#define ANALYSIS_RANGES     4   /* Value ranges */
+#define ANALYSIS_ALL        (ANALYSIS_CFG | ANALYSIS_LIVENESS | ANALYSIS_RANGES)
+
+/* CFG CONSTRUCTION */
+
+/* Build the CFG of the function starting at 'start' (a FUNCTION label, or
+ * the head of the code). The function ends before the next FUNCTION label. */
+CFG* build_cfg(TACInstruction* start);
+
+/* Return the first instruction after the function starting at 'start' */
+TACInstruction* function_end(TACInstruction* start);
+
+/* Find the block that starts with the given label (-1 if none) */
+int find_label_block(CFG* cfg, const char* label);
+
+/* Return the first/last instruction of a block */
+TACInstruction* block_first(CFG* cfg, int block);
+TACInstruction* block_last(CFG* cfg, int block);
+
+/* Free a CFG (the instructions themselves are not freed) */
+void free_cfg(CFG* cfg);
+
+/* DOMINATORS */
+
+/* Compute immediate dominators (Cooper-Harvey-Kennedy iterative algorithm) */
+void compute_dominators(CFG* cfg);
+
+/* Check whether block a dominates block b */
+int dominates(CFG* cfg, int a, int b);
+
+/* LOOPS */
+
+/* Find the natural loops of a function (dominators must be computed) */
+LoopForest* find_loops(CFG* cfg);
+
+/* Give every loop without a preheader a new one: a label placed just
+ * before the header that all entries from outside the loop go through.
+ * Returns the number inserted; the CFG must be rebuilt if non-zero. */
+int insert_preheaders(TACCode* code, CFG* cfg, LoopForest* forest);
+
+/* Free a loop forest */
+void free_loops(LoopForest* forest);
+
+/* IR EDITING */
+
+/* Unlink and free every instruction i (i > 0) with dead[i] set.
+ * The CFG must be rebuilt afterwards. Returns number removed. */
+int remove_dead_instructions(TACCode* code, CFG* cfg, const char* dead);
+
+/* Relink the instructions of a function in the given order. order[0]
+ * must be cfg->insts[0]. The CFG must be rebuilt afterwards. */
+void relink_function(TACCode* code, CFG* cfg, TACInstruction** order, int count);
+
+/* LIVENESS */
+
+/* Compute the live variables of a function (backward dataflow) */
+Liveness* compute_liveness(CFG* cfg);
+
+/* Pointer to the live-out set of a block */
+unsigned int* live_out_set(Liveness* live, int block);
+
+/* Step a live set backward over one instruction */
+void liveness_transfer(Liveness* live, unsigned int* set, TACInstruction* inst);
+
+/* Check whether a variable is in a live set */
+int is_live_in_set(Liveness* live, const unsigned int* set, const char* name);
+
+/* Free liveness information */
+void free_liveness(Liveness* live);
+
+/* ANALYSIS CACHE */
+
+/* While the cache is enabled, the get_function_* functions keep their
+ * results per function (keyed by the function's first instruction) and
+ * return them again until they are invalidated. A pass that edits the
+ * IR must invalidate what it changed before asking for analyses again;
+ * the pass manager invalidates after every pass that changed the IR.
+ * While the cache is disabled every call computes fresh results. */
+void enable_analysis_cache(int enable);
+
+/* CFG of a function */
+CFG* get_function_cfg(TACInstruction* start);
+
+/* CFG of a function with its dominators computed */
+CFG* get_function_dominators(TACInstruction* start);
+
+/* CFG, dominators and loop forest of a function */
+CFG* get_function_loops(TACInstruction* start, LoopForest** forest);
+
+/* CFG and live variables of a function */
+CFG* get_function_liveness(TACInstruction* start, Liveness** live);
+
+/* CFG, dominators and value ranges of a function */
+CFG* get_function_ranges(TACInstruction* start, RangeAnalysis** ranges);
+
+/* Give back analyses obtained from get_function_* (frees them unless
+ * they are cached; any argument may be NULL) */
+void release_analyses(CFG* cfg, LoopForest* forest, Liveness* live);
+void release_ranges(CFG* cfg, RangeAnalysis* ranges);
+
+/* Drop the cached analyses of one function */
+void invalidate_function_analyses(TACInstruction* start);
+
+/* Drop every cached analysis not listed in 'preserved' (ANALYSIS_* flags) */
+void invalidate_analyses(int preserved);
+
+/* Number of analysis requests served from the cache / computed */
+void get_analysis_cache_counts(int* hits, int* misses);
+
+/* NAME TABLES */
+
+/* Create an empty name table */
+NameTable* create_name_table(int expected_names);
+
+/* Return the id of a name, adding it if it is new */
+int intern_name(NameTable* table, const char* name);
+
+/* Return the id of a name or -1 if it has not been interned */
+int lookup_name_id(NameTable* table, const char* name);
+
+/* Intern every variable operand of the instructions in a CFG */
+void intern_cfg_names(NameTable* table, CFG* cfg);
+
+/* Free a name table */
+void free_name_table(NameTable* table);
+
+#endif /* CFG_H */
@@ -0,0 +1,483 @@
+/*
+ * CHECKS.C - Runtime Check Planning Implementation
+ * CST-405 Compiler Project
+ *
+ * This file decides, function by function, which array accesses and
+ * divisions keep a runtime check in --checked mode. It reads the value
+ * ranges and the loop forest from the analysis cache (cfg.h), flags the
+ * instructions whose checks stay, and inserts the hoisted loop checks
+ * once the whole function has been planned.
+ */
+
+#include "checks.h"
+#include "cfg.h"
+#include "range.h"
+#include "symtable.h"
+#include "diagnostics.h"
+
+/* A loop check waiting to be inserted into a preheader */
+typedef struct {
+    TACInstruction* pos;        /* Insert after this instruction */
+    TACInstruction* check;      /* TAC_CHECK_BOUNDS or TAC_CHECK_DIVISOR */
+    int loop;                   /* Loop it was hoisted out of */
+} HoistedCheck;
+
+/* An instruction whose check was hoisted (kept in place again if its
+ * loop cannot take the hoisted check after all) */
+typedef struct {
+    TACInstruction* inst;
+    int loop;
+    int check;                  /* CHECK_BOUNDS or CHECK_DIVISOR */
+} HoistedSite;
+
+/* Planning state of one function */
+typedef struct {
+    TACCode* code;
+    CFG* cfg;
+    LoopForest* forest;
+    RangeAnalysis* ranges;
+    HoistedCheck* hoisted;      /* Loop checks to insert */
+    int num_hoisted;
+    int capacity;
+    HoistedSite* sites;         /* Instructions they cover */
+    int num_sites;
+    int sites_capacity;
+} CheckPlan;
+
+/* Helper: Where a check runs once before loop l (NULL if nowhere):
+ * the end of the preheader, before its jump into the header */
+static TACInstruction* preheader_position(CFG* cfg, Loop* loop) {
+    if (loop->preheader < 0) return NULL;
+
+    BasicBlock* blk = &cfg->blocks[loop->preheader];
+    TACInstruction* last = block_last(cfg, loop->preheader);
+    if (last->opcode != TAC_GOTO && last->opcode != TAC_IF_FALSE) return last;
+    return blk->count >= 2 ? cfg->insts[blk->start + blk->count - 2] : NULL;
+}
+
+/* Helper: Exit test of a loop whose header is just 'L: t = a relop b;
+ * if_false t goto exit' (NULL if the header has any other shape) */
+static TACInstruction* loop_test(CFG* cfg, Loop* loop) {
+    BasicBlock* hblk = &cfg->blocks[loop->header];
+    if (hblk->count != 3) return NULL;
+
+    TACInstruction* label = cfg->insts[hblk->start];
+    TACInstruction* test = cfg->insts[hblk->start + 1];
+    TACInstruction* branch = cfg->insts[hblk->start + 2];
+    if (label->opcode != TAC_LABEL || test->opcode != TAC_RELOP ||
+        branch->opcode != TAC_IF_FALSE || strcmp(branch->op1, test->result) != 0) {
+        return NULL;
+    }
+
+    int exit = find_label_block(cfg, branch->label);
+    if (exit < 0 || loop->in_loop[exit]) return NULL;
+    return test;
+}
+
+/* Helper: Does block b run on every trip of a loop that only leaves
+ * through its header (b dominates every latch)? */
+static int dominates_latches(CFG* cfg, Loop* loop, int b) {
+    for (int i = 0; i < loop->num_blocks; i++) {
+        int lb = loop->blocks[i];
+        BasicBlock* blk = &cfg->blocks[lb];
+        for (int s = 0; s < blk->num_succs; s++) {
+            if (blk->succs[s] == loop->header && !dominates(cfg, b, lb)) return 0;
+        }
+    }
+    return 1;
+}
+
+/* Helper: Does block b run on every trip of loop l, with the header test
+ * as the only way out? Then a check before the loop fails exactly when
+ * some trip would fail it. */
+static int runs_every_trip(CFG* cfg, LoopForest* forest, int l, int b) {
+    Loop* loop = &forest->loops[l];
+
+    for (int other = 0; other < forest->num_loops; other++) {
+        if (forest->loops[other].parent == l) return 0;          /* Not innermost */
+    }
+
+    for (int i = 0; i < loop->num_blocks; i++) {
+        int lb = loop->blocks[i];
+        BasicBlock* blk = &cfg->blocks[lb];
+
+        /* A call could change anything or never come back */
+        for (int j = blk->start; j < blk->start + blk->count; j++) {
+            if (cfg->insts[j]->opcode == TAC_CALL) return 0;
+        }
+        if (lb == loop->header) continue;
+
+        if (blk->num_succs == 0) return 0;                       /* Returns from the loop */
+        for (int s = 0; s < blk->num_succs; s++) {
+            if (!loop->in_loop[blk->succs[s]]) return 0;
+        }
+    }
+    return dominates_latches(cfg, loop, b);
+}
+
+/* Helper: Count the definitions of a variable in loop l (last one in *where) */
+static int loop_definitions(CFG* cfg, Loop* loop, const char* name, int* where) {
+    int count = 0;
+    for (int i = 0; i < loop->num_blocks; i++) {
+        BasicBlock* blk = &cfg->blocks[loop->blocks[i]];
+        for (int j = blk->start; j < blk->start + blk->count; j++) {
+            const char* def = tac_def(cfg->insts[j]);
+            if (def && strcmp(def, name) == 0) {
+                count++;
+                if (where) *where = j;
+            }
+        }
+    }
+    return count;
+}
+
+/* Helper: Is definition d of 'var' the step 'var = var + amount'
+ * (possibly through a temporary computed earlier in the same block)? */
+static int steps_by(CheckPlan* plan, int d, const char* var, long long amount) {
+    CFG* cfg = plan->cfg;
+    TACInstruction* def = cfg->insts[d];
+
+    if (def->opcode == TAC_ASSIGN && !is_number(def->op1)) {
+        BasicBlock* blk = &cfg->blocks[plan->ranges->block_of[d]];
+        const char* temp = def->op1;
+        int k;
+        for (k = d - 1; k >= blk->start; k--) {
+            const char* kdef = tac_def(cfg->insts[k]);
+            if (!kdef) continue;
+            if (strcmp(kdef, var) == 0) return 0;
+            if (strcmp(kdef, temp) == 0) break;
+        }
+        if (k < blk->start) return 0;
+        d = k;
+        def = cfg->insts[k];
+    }
+
+    if (def->opcode != TAC_ADD) return 0;
+
+    const char* step = NULL;
+    if (strcmp(def->op1, var) == 0) step = def->op2;
+    else if (strcmp(def->op2, var) == 0) step = def->op1;
+    if (!step) return 0;
+
+    Interval range = range_before(plan->ranges, d, step);
+    return range.lo == amount && range.hi == amount;
+}
+
+/* Helper: Is 'var' updated exactly once in the loop, by adding 'amount',
+ * on every trip? The update is returned in *where. */
+static int loop_step(CheckPlan* plan, Loop* loop, const char* var, long long amount, int* where) {
+    if (loop_definitions(plan->cfg, loop, var, where) != 1) return 0;
+    if (!dominates_latches(plan->cfg, loop, plan->ranges->block_of[*where])) return 0;
+    return steps_by(plan, *where, var, amount);
+}
+
+/* Helper: Does the byte offset 'offset' hold counter * element size at
+ * the loop header on every trip? It must start as 'offset = counter *
+ * size' in the preheader and step by the element size on every trip, as
+ * the strength-reduced accesses of a counted loop do. */
+static int tracks_counter(CheckPlan* plan, Loop* loop, const char* offset, const char* counter) {
+    CFG* cfg = plan->cfg;
+    int size = plan->code->element_size;
+    int update;
+    if (loop->preheader < 0 || !loop_step(plan, loop, offset, size, &update)) return 0;
+    if (!loop_step(plan, loop, counter, 1, &update)) return 0;
+
+    /* Last definition of either name in the preheader sets the offset */
+    BasicBlock* blk = &cfg->blocks[loop->preheader];
+    for (int j = blk->start + blk->count - 1; j >= blk->start; j--) {
+        TACInstruction* inst = cfg->insts[j];
+        const char* def = tac_def(inst);
+        if (!def) continue;
+        if (strcmp(def, counter) == 0) return 0;
+        if (strcmp(def, offset) != 0) continue;
+        if (inst->opcode != TAC_MUL) return 0;
+
+        const char* scale;
+        if (strcmp(inst->op1, counter) == 0) scale = inst->op2;
+        else if (strcmp(inst->op2, counter) == 0) scale = inst->op1;
+        else return 0;
+        Interval range = range_before(plan->ranges, j, scale);
+        return range.lo == size && range.hi == size;
+    }
+    return 0;
+}
+
+/* Helper: Queue a loop check, unless the same check is already queued,
+ * and remember the instruction it covers */
+static void add_hoisted(CheckPlan* plan, TACInstruction* inst, int l, TACInstruction* pos,
+                        TACOpcode opcode, const char* result, const char* op1, const char* op2,
+                        const char* relop) {
+    if (plan->num_sites == plan->sites_capacity) {
+        plan->sites_capacity = plan->sites_capacity ? plan->sites_capacity * 2 : 8;
+        plan->sites = (HoistedSite*)safe_realloc(plan->sites, plan->sites_capacity * sizeof(HoistedSite),
+                                                 "runtime checks");
+    }
+    plan->sites[plan->num_sites].inst = inst;
+    plan->sites[plan->num_sites].loop = l;
+    plan->sites[plan->num_sites].check = opcode == TAC_CHECK_BOUNDS ? CHECK_BOUNDS : CHECK_DIVISOR;
+    plan->num_sites++;
+
+    for (int h = 0; h < plan->num_hoisted; h++) {
+        TACInstruction* check = plan->hoisted[h].check;
+        if (plan->hoisted[h].pos == pos && check->opcode == opcode &&
+            strcmp(check->result, result) == 0 && strcmp(check->op1, op1) == 0 &&
+            strcmp(check->op2, op2) == 0 && strcmp(check->label, relop) == 0) {
+            return;
+        }
+    }
+
+    if (plan->num_hoisted == plan->capacity) {
+        plan->capacity = plan->capacity ? plan->capacity * 2 : 8;
+        plan->hoisted = (HoistedCheck*)safe_realloc(plan->hoisted,
+                                                    plan->capacity * sizeof(HoistedCheck),
+                                                    "runtime checks");
+    }
+
+    TACInstruction* check = create_tac_instruction(opcode, result, op1, op2, relop);
+    check->line = inst->line;
+    plan->hoisted[plan->num_hoisted].pos = pos;
+    plan->hoisted[plan->num_hoisted].check = check;
+    plan->hoisted[plan->num_hoisted].loop = l;
+    plan->num_hoisted++;
+}
+
+/* Helper: Cover an array access by one check of the loop bound. The
+ * index must be the loop counter itself (or a byte offset that tracks
+ * it), counting up by one from a non-negative start while 'counter <
+ * limit' (or '<=') holds. */
+static int hoist_bounds_check(CheckPlan* plan, int j, TACInstruction* inst) {
+    CFG* cfg = plan->cfg;
+    int b = plan->ranges->block_of[j];
+    int l = plan->forest->innermost[b];
+    if (l < 0) return 0;
+
+    Loop* loop = &plan->forest->loops[l];
+    TACInstruction* test = loop_test(cfg, loop);
+    if (!test || !runs_every_trip(cfg, plan->forest, l, b)) return 0;
+
+    const char* index = (inst->opcode == TAC_ARRAY_LOAD ||
+                         inst->opcode == TAC_ARRAY_LOAD_OFFSET) ? inst->op2 : inst->op1;
+    int offset = inst->opcode == TAC_ARRAY_LOAD_OFFSET || inst->opcode == TAC_ARRAY_STORE_OFFSET;
+    if (is_number(index)) return 0;
+
+    /* Either side of the test may be the counter */
+    const char* counter = NULL;
+    const char* relop = NULL;
+    const char* limit = NULL;
+    for (int side = 0; side < 2 && !counter; side++) {
+        const char* candidate = side == 0 ? test->op1 : test->op2;
+        if (is_number(candidate)) continue;
+        if (offset ? !tracks_counter(plan, loop, index, candidate)
+                   : strcmp(candidate, index) != 0) {
+            continue;
+        }
+        counter = candidate;
+        relop = side == 0 ? test->label : mirror_relop(test->label);
+        limit = side == 0 ? test->op2 : test->op1;
+    }
+    if (!counter) return 0;
+    if (strcmp(relop, "<") != 0 && strcmp(relop, "<=") != 0) return 0;
+    if (!is_number(limit) && loop_definitions(cfg, loop, limit, NULL) > 0) return 0;
+
+    /* Lower end from the counter range at the test, upper end from the test */
+    Interval range = range_before(plan->ranges, cfg->blocks[loop->header].start + 1, counter);
+    if (range.lo == RANGE_MIN || range.lo < 0) return 0;
+
+    /* The index still holds the tested value: its only update comes after
+     * the access on every trip, and adds exactly one element */
+    int update;
+    if (!loop_step(plan, loop, index, offset ? plan->code->element_size : 1, &update)) return 0;
+    int ub = plan->ranges->block_of[update];
+    if (ub == b ? update < j : !dominates(cfg, b, ub)) return 0;
+
+    TACInstruction* pos = preheader_position(cfg, loop);
+    if (!pos) return 0;
+
+    add_hoisted(plan, inst, l, pos, TAC_CHECK_BOUNDS, tac_array(inst), counter, limit, relop);
+    return 1;
+}
+
+/* Helper: Cover a division by a loop-invariant divisor by one check */
+static int hoist_divisor_check(CheckPlan* plan, int j, TACInstruction* inst) {
+    CFG* cfg = plan->cfg;
+    int b = plan->ranges->block_of[j];
+    int l = plan->forest->innermost[b];
+    if (l < 0) return 0;
+
+    Loop* loop = &plan->forest->loops[l];
+    TACInstruction* test = loop_test(cfg, loop);
+    if (!test || !runs_every_trip(cfg, plan->forest, l, b)) return 0;
+    if (loop_definitions(cfg, loop, inst->op2, NULL) > 0) return 0;
+
+    TACInstruction* pos = preheader_position(cfg, loop);
+    if (!pos) return 0;
+
+    add_hoisted(plan, inst, l, pos, TAC_CHECK_DIVISOR, inst->op2, test->op1, test->op2, test->label);
+    return 1;
+}
+
+/* Helper: Plan the checks of one instruction */
+static void plan_instruction(CheckPlan* plan, int j, CheckStats* stats) {
+    TACInstruction* inst = plan->cfg->insts[j];
+    RangeAnalysis* ranges = plan->ranges;
+    const char* array = tac_array(inst);
+
+    if (array) {
+        Symbol* sym = plan->code->symbols ? lookup_symbol(plan->code->symbols, array) : NULL;
+        if (!sym || !sym->is_array) return;
+        stats->bounds_sites++;
+
+        if (!range_reached(ranges, j)) {
+            stats->bounds_eliminated++;
+            return;
+        }
+
+        Interval index = range_array_index(ranges, j, plan->code->element_size);
+        if (range_is_bounded(index) && index.lo >= 0 && index.hi < sym->array_size) {
+            char range_str[64];
+            debug_print("Bounds check of %s removed: index %s", array,
+                        range_to_string(index, range_str, sizeof(range_str)));
+            stats->bounds_eliminated++;
+        } else if (hoist_bounds_check(plan, j, inst)) {
+            stats->bounds_hoisted++;
+        } else {
+            inst->checks |= CHECK_BOUNDS;
+        }
+        return;
+    }
+
+    if (inst->opcode != TAC_DIV && inst->opcode != TAC_MOD) return;
+    stats->divisor_sites++;
+
+    if (!range_reached(ranges, j)) {
+        stats->divisor_eliminated++;
+    } else if (is_number(inst->op2)) {
+        if (atoll(inst->op2) != 0) stats->divisor_eliminated++;
+        else inst->checks |= CHECK_DIVISOR;
+    } else if (!range_contains(range_before(ranges, j, inst->op2), 0)) {
+        stats->divisor_eliminated++;
+    } else if (hoist_divisor_check(plan, j, inst)) {
+        stats->divisor_hoisted++;
+    } else {
+        inst->checks |= CHECK_DIVISOR;
+    }
+}
+
+/* Helper: Can loop l take its hoisted check? A trap before the first
+ * trip must look the same as the trap in the trip that would fail: the
+ * loop prints nothing (the prints of the passing trips would be lost),
+ * no check stays in place in it and one check covers the whole loop
+ * (either could fail first otherwise). */
+static int keeps_hoisted(CheckPlan* plan, int l) {
+    CFG* cfg = plan->cfg;
+    Loop* loop = &plan->forest->loops[l];
+    for (int i = 0; i < loop->num_blocks; i++) {
+        BasicBlock* blk = &cfg->blocks[loop->blocks[i]];
+        for (int j = blk->start; j < blk->start + blk->count; j++) {
+            if (cfg->insts[j]->opcode == TAC_PRINT || cfg->insts[j]->checks) return 0;
+        }
+    }
+
+    int checks = 0;
+    for (int h = 0; h < plan->num_hoisted; h++) {
+        if (plan->hoisted[h].loop == l) checks++;
+    }
+    return checks == 1;
+}
+
+/* Helper: Drop the hoisted checks of loops that cannot take them; their
+ * instructions are checked in place again */
+static void settle_hoisted(CheckPlan* plan, CheckStats* stats) {
+    for (int l = 0; l < plan->forest->num_loops; l++) {
+        int has_sites = 0;
+        for (int s = 0; s < plan->num_sites; s++) {
+            if (plan->sites[s].loop == l) has_sites = 1;
+        }
+        if (!has_sites || keeps_hoisted(plan, l)) continue;
+
+        for (int s = 0; s < plan->num_sites; s++) {
+            HoistedSite* site = &plan->sites[s];
+            if (site->loop != l) continue;
+            site->inst->checks |= site->check;
+            if (site->check == CHECK_BOUNDS) stats->bounds_hoisted--;
+            else stats->divisor_hoisted--;
+        }
+        debug_print("Loop checks at %s kept in place",
+                    block_first(plan->cfg, plan->forest->loops[l].header)->label);
+
+        int kept = 0;
+        for (int h = 0; h < plan->num_hoisted; h++) {
+            if (plan->hoisted[h].loop == l) free_tac_instruction(plan->hoisted[h].check);
+            else plan->hoisted[kept++] = plan->hoisted[h];
+        }
+        plan->num_hoisted = kept;
+    }
+}
+
+/* Plan the runtime checks of every function */
+void plan_runtime_checks(TACCode* code, CheckStats* stats) {
+    memset(stats, 0, sizeof(CheckStats));
+    enable_analysis_cache(1);
+
+    TACInstruction* start = code->head;
+    while (start) {
+        CheckPlan plan;
+        memset(&plan, 0, sizeof(plan));
+        plan.code = code;
+        plan.cfg = get_function_loops(start, &plan.forest);
+        get_function_ranges(start, &plan.ranges);
+
+        for (int j = 0; j < plan.cfg->num_insts; j++) {
+            plan_instruction(&plan, j, stats);
+        }
+        settle_hoisted(&plan, stats);
+
+        /* Insert the loop checks now that no more instruction indexes are needed */
+        TACInstruction* end = plan.cfg->end;
+        for (int h = 0; h < plan.num_hoisted; h++) {
+            TACInstruction* check = plan.hoisted[h].check;
+            Loop* loop = &plan.forest->loops[plan.hoisted[h].loop];
+            const char* header = block_first(plan.cfg, loop->header)->label;
+            if (check->opcode == TAC_CHECK_BOUNDS) {
+                printf("[CHECKS] Bounds check of %s[%s] hoisted out of the loop at %s (%s %s %s)\n",
+                       check->result, check->op1, header, check->op1, check->label, check->op2);
+            } else {
+                printf("[CHECKS] Divisor check of %s hoisted out of the loop at %s\n", check->result, header);
+            }
+            insert_tac_after(code, plan.hoisted[h].pos, check);
+        }
+        stats->hoisted_checks += plan.num_hoisted;
+
+        release_analyses(plan.cfg, plan.forest, NULL);
+        release_ranges(NULL, plan.ranges);
+        if (plan.num_hoisted > 0) invalidate_function_analyses(start);
+        free(plan.hoisted);
+        free(plan.sites);
+        start = end;
+    }
+
+    enable_analysis_cache(0);
+}
+
+/* Print how many checks were eliminated */
+void print_check_stats(CheckStats* stats) {
+    int sites = stats->bounds_sites + stats->divisor_sites;
+    int removed = stats->bounds_eliminated + stats->bounds_hoisted +
+                  stats->divisor_eliminated + stats->divisor_hoisted;
+
+    printf("\n================ RUNTIME CHECK STATISTICS ==============\n\n");
+    printf("Array accesses:            %d\n", stats->bounds_sites);
+    printf("  Proven in bounds:        %d\n", stats->bounds_eliminated);
+    printf("  Hoisted out of loops:    %d\n", stats->bounds_hoisted);
+    printf("  Checked in place:        %d\n",
+           stats->bounds_sites - stats->bounds_eliminated - stats->bounds_hoisted);
+    printf("Divisions and modulos:     %d\n", stats->divisor_sites);
+    printf("  Proven non-zero:         %d\n", stats->divisor_eliminated);
+    printf("  Hoisted out of loops:    %d\n", stats->divisor_hoisted);
+    printf("  Checked in place:        %d\n",
+           stats->divisor_sites - stats->divisor_eliminated - stats->divisor_hoisted);
+    printf("Loop preheader checks:     %d\n", stats->hoisted_checks);
+    printf("----------------------------------------\n");
+    printf("Checks eliminated:         %d of %d\n", removed, sites);
+    printf("\n========================================================\n\n");
+}
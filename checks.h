@@ -0,0 +1,52 @@
+/*
+ * CHECKS.H - Runtime Check Planning Header
+ * CST-405 Compiler Project
+ *
+ * This file defines the planning step of the --checked mode, which runs
+ * on the optimized TAC right before code generation. Every array access
+ * and every division or modulo gets a runtime check (CHECK_* flags on the
+ * instruction) unless it can be dropped:
+ * - The value ranges (range.h) prove the index is inside the array or
+ *   the divisor is never zero, or the instruction can never execute
+ * - The access is in a counted loop 'i < n' (or 'i <= n') stepped by one
+ *   and indexes by i (or by a strength-reduced byte offset that tracks
+ *   i), so a single TAC_CHECK_BOUNDS of n in the loop preheader covers every
+ *   iteration; a loop-invariant divisor is checked once by a
+ *   TAC_CHECK_DIVISOR the same way
+ * A hoisted check only traps when the loop runs, and only when the loop
+ * would have reached the failing access itself, so it reports the same
+ * line; it just reports it before the loop starts. A loop keeps its
+ * checks in place when that would show: it prints, another check stays
+ * in it, or it needs more than one hoisted check.
+ */
+
+#ifndef CHECKS_H
+#define CHECKS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ircode.h"
+
+/* Runtime check planning statistics */
+typedef struct {
+    int bounds_sites;           /* Array accesses considered */
+    int bounds_eliminated;      /* ... proven in bounds (or unreachable) */
+    int bounds_hoisted;         /* ... covered by a check before their loop */
+    int divisor_sites;          /* Divisions and modulos considered */
+    int divisor_eliminated;     /* ... proven to have a non-zero divisor */
+    int divisor_hoisted;        /* ... covered by a check before their loop */
+    int hoisted_checks;         /* Checks placed in loop preheaders */
+} CheckStats;
+
+/* CHECK PLANNING FUNCTIONS */
+
+/* Decide which runtime checks the code needs, flag the instructions that
+ * keep theirs and insert the hoisted loop checks. Needs code->symbols
+ * for the array sizes. */
+void plan_runtime_checks(TACCode* code, CheckStats* stats);
+
+/* Print how many checks were eliminated */
+void print_check_stats(CheckStats* stats);
+
+#endif /* CHECKS_H */
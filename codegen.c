@@ -3,11 +3,354 @@
  * CST-405 Compiler Project
  *
  * This file implements code generation from Three-Address Code (TAC)
- * to x86-64 assembly language. The generated code uses a simple
- * stack-based calling convention.
+ * to x86-64 assembly language. Calls follow the System V AMD64
+ * convention: the first six arguments travel in rdi, rsi, rdx, rcx, r8
+ * and r9, the rest on the stack. Globals live in .bss; parameters,
+ * locals and temporaries live in the function's rbp frame, and values
+ * the register allocator assigns a register live there instead. Leaf
+ * functions set up no rbp frame: they address their values from rsp,
+ * in the red zone when they fit. Assignments, arithmetic, compares and
+ * branches are covered by the tree patterns of the instruction selector
+ * (see isel.h); the other instructions use fixed templates.
  */
 
+#include <ctype.h>
 #include "codegen.h"
+#include "strength.h"
+#include "diagnostics.h"
+
+/* Registers the allocator hands out. rax, rcx, rdx and r11 stay free
+ * as scratch registers for the instruction sequences below. */
+static const char* const x86_register_names[] = {
+    "rbx", "r12", "r13", "r14", "r15",      /* Callee-saved */
+    "rsi", "rdi", "r8", "r9", "r10"         /* Caller-saved */
+};
+static const int x86_callee_saved[] = { 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 };
+
+/* Integer argument registers, in argument order (rdx and rcx are scratch
+ * registers, not handed out) */
+#define X86_REG_ARGS 6
+static const char* const x86_arg_registers[X86_REG_ARGS] = { "rdi", "rsi", "rdx", "rcx", "r8", "r9" };
+static const int x86_arg_register_index[X86_REG_ARGS] = { 6, 5, -1, -1, 7, 8 };
+static const RegisterFile x86_registers = { x86_register_names, x86_callee_saved, 10, 1,
+                                            x86_arg_register_index, X86_REG_ARGS };
+
+/* Frames: 8-byte words, stack arguments above the saved rbp and return
+ * address (the seventh argument nearest), and rsp 16-byte aligned once
+ * the frame is allocated. Leaf functions have only the return address
+ * above their frame and may use the 128-byte red zone below rsp. */
+static const FrameTarget x86_frame = { 8, 0, 16, 16, X86_REG_ARGS, 0, 8, 128, 1 };
+
+/* ============================================================
+ * MACHINE IR TARGET
+ * ============================================================ */
+
+/* Names of the machine IR registers (numbered in x86enc.h) by view: the
+ * whole register, then its 32-, 16- and 8-bit parts */
+static const char* const x86_mir_names[4][16] = {
+    { "rax", "rbx", "rcx", "rdx", "rsi", "rdi", "rbp", "rsp",
+      "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15" },
+    { "eax", "ebx", "ecx", "edx", "esi", "edi", "ebp", "esp",
+      "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d" },
+    { "ax", "bx", "cx", "dx", "si", "di", "bp", "sp",
+      "r8w", "r9w", "r10w", "r11w", "r12w", "r13w", "r14w", "r15w" },
+    { "al", "bl", "cl", "dl", "sil", "dil", "bpl", "spl",
+      "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b" }
+};
+
+#define X86_BIT(r) (1ULL << (r))
+#define X86_MULDIV (X86_BIT(X86_RAX) | X86_BIT(X86_RDX))
+#define X86_STACK (X86_BIT(X86_RSP))
+/* A call reads the argument registers (rax: vector argument count) and
+ * clobbers the caller-saved ones; a return reads the result and the
+ * callee-saved registers */
+#define X86_CALL_USES (X86_BIT(X86_RAX) | X86_BIT(X86_RDI) | X86_BIT(X86_RSI) | X86_BIT(X86_RDX) | \
+                       X86_BIT(X86_RCX) | X86_BIT(X86_R8) | X86_BIT(X86_R9) | X86_BIT(X86_RBP) | \
+                       X86_BIT(X86_RSP))
+#define X86_CALL_DEFS (X86_BIT(X86_RAX) | X86_BIT(X86_RCX) | X86_BIT(X86_RDX) | X86_BIT(X86_RSI) | \
+                       X86_BIT(X86_RDI) | X86_BIT(X86_R8) | X86_BIT(X86_R9) | X86_BIT(X86_R10) | \
+                       X86_BIT(X86_R11))
+#define X86_RETURN_USES (X86_BIT(X86_RAX) | X86_BIT(X86_RBX) | X86_BIT(X86_RBP) | X86_BIT(X86_RSP) | \
+                         X86_BIT(X86_R12) | X86_BIT(X86_R13) | X86_BIT(X86_R14) | X86_BIT(X86_R15))
+#define X86_JCC(cc) { "j" cc, 1, MIR_CLASS_BRANCH, "l", 0, 0, 0 }, { "set" cc, 1, MIR_CLASS_ALU, "d", 0, 0, 0 }
+
+/* The instructions the generator emits */
+static const MirOpcode x86_opcodes[] = {
+    { "mov",    2, MIR_CLASS_COPY,    "du", 0, 0, 0 },
+    { "movzx",  2, MIR_CLASS_ALU,     "du", 0, 0, 0 },
+    { "movsx",  2, MIR_CLASS_ALU,     "du", 0, 0, 0 },
+    { "movsxd", 2, MIR_CLASS_ALU,     "du", 0, 0, 0 },
+    { "lea",    2, MIR_CLASS_ALU,     "da", 0, 0, 0 },
+    { "add",    2, MIR_CLASS_ALU,     "bu", 0, 0, 0 },
+    { "sub",    2, MIR_CLASS_ALU,     "bu", 0, 0, MIR_ZERO_IDIOM },
+    { "and",    2, MIR_CLASS_ALU,     "bu", 0, 0, 0 },
+    { "or",     2, MIR_CLASS_ALU,     "bu", 0, 0, 0 },
+    { "xor",    2, MIR_CLASS_ALU,     "bu", 0, 0, MIR_ZERO_IDIOM },
+    { "adc",    2, MIR_CLASS_ALU,     "bu", 0, 0, 0 },
+    { "sbb",    2, MIR_CLASS_ALU,     "bu", 0, 0, 0 },
+    { "shl",    2, MIR_CLASS_ALU,     "bu", 0, 0, 0 },
+    { "sal",    2, MIR_CLASS_ALU,     "bu", 0, 0, 0 },
+    { "shr",    2, MIR_CLASS_ALU,     "bu", 0, 0, 0 },
+    { "sar",    2, MIR_CLASS_ALU,     "bu", 0, 0, 0 },
+    { "imul",   2, MIR_CLASS_ALU,     "bu", 0, 0, 0 },
+    { "imul",   3, MIR_CLASS_ALU,     "duu", 0, 0, 0 },
+    { "imul",   1, MIR_CLASS_ALU,     "u", X86_MULDIV, X86_MULDIV, 0 },
+    { "mul",    1, MIR_CLASS_ALU,     "u", X86_MULDIV, X86_MULDIV, 0 },
+    { "idiv",   1, MIR_CLASS_ALU,     "u", X86_MULDIV, X86_MULDIV, 0 },
+    { "div",    1, MIR_CLASS_ALU,     "u", X86_MULDIV, X86_MULDIV, 0 },
+    { "neg",    1, MIR_CLASS_ALU,     "b", 0, 0, 0 },
+    { "not",    1, MIR_CLASS_ALU,     "b", 0, 0, 0 },
+    { "inc",    1, MIR_CLASS_ALU,     "b", 0, 0, 0 },
+    { "dec",    1, MIR_CLASS_ALU,     "b", 0, 0, 0 },
+    { "cqo",    0, MIR_CLASS_ALU,     "", X86_BIT(X86_RAX), X86_BIT(X86_RDX), 0 },
+    { "cdq",    0, MIR_CLASS_ALU,     "", X86_BIT(X86_RAX), X86_BIT(X86_RDX), 0 },
+    { "cmp",    2, MIR_CLASS_COMPARE, "uu", 0, 0, 0 },
+    { "test",   2, MIR_CLASS_COMPARE, "uu", 0, 0, 0 },
+    { "push",   1, MIR_CLASS_ALU,     "u", X86_STACK, X86_STACK, MIR_MEMORY },
+    { "pop",    1, MIR_CLASS_ALU,     "d", X86_STACK, X86_STACK, MIR_MEMORY },
+    { "leave",  0, MIR_CLASS_ALU,     "", X86_BIT(X86_RBP), X86_STACK | X86_BIT(X86_RBP), MIR_MEMORY },
+    { "nop",    0, MIR_CLASS_ALU,     "", 0, 0, 0 },
+    { "jmp",    1, MIR_CLASS_JUMP,    "l", 0, 0, 0 },
+    X86_JCC("e"), X86_JCC("ne"), X86_JCC("z"), X86_JCC("nz"), X86_JCC("l"), X86_JCC("le"),
+    X86_JCC("g"), X86_JCC("ge"), X86_JCC("b"), X86_JCC("be"), X86_JCC("a"), X86_JCC("ae"),
+    X86_JCC("s"), X86_JCC("ns"), X86_JCC("o"), X86_JCC("no"),
+    { "call",   1, MIR_CLASS_CALL,    "l", X86_CALL_USES, X86_CALL_DEFS, MIR_MEMORY },
+    { "ret",    0, MIR_CLASS_RETURN,  "", X86_RETURN_USES, 0, 0 }
+};
+
+/* Helper: Register and view of a register name (MIR_NO_REG if none) */
+static int x86_mir_register(const char* text, int* view) {
+    for (int v = 0; v < 4; v++) {
+        for (int r = 0; r < 16; r++) {
+            if (!strcmp(text, x86_mir_names[v][r])) {
+                *view = v;
+                return r;
+            }
+        }
+    }
+    return MIR_NO_REG;
+}
+
+/* Helper: Is the text a decimal integer literal? */
+static int x86_mir_integer(const char* text, long long* value) {
+    char* end;
+    if (!isdigit((unsigned char)text[text[0] == '-']) || strlen(text) > 20) return 0;
+    *value = strtoll(text, &end, 10);
+    return *end == '\0';
+}
+
+/* Helper: Add one term of an address ("rbp", "rax*8", "16", "arr") */
+static int x86_mir_address_term(const char* term, int negative, MirOperand* operand) {
+    long long value;
+    int view;
+    const char* star = strchr(term, '*');
+    if (star) {
+        char reg[16];
+        if ((size_t)(star - term) >= sizeof(reg) || operand->index != MIR_NO_REG || negative) return 0;
+        memcpy(reg, term, star - term);
+        reg[star - term] = '\0';
+        operand->index = x86_mir_register(reg, &view);
+        operand->scale = atoi(star + 1);
+        return operand->index != MIR_NO_REG && view == 0;
+    }
+    if (x86_mir_integer(term, &value)) {
+        operand->value += negative ? -value : value;
+        return 1;
+    }
+    int r = x86_mir_register(term, &view);
+    if (r != MIR_NO_REG) {
+        if (view != 0 || negative) return 0;
+        if (operand->reg == MIR_NO_REG) {
+            operand->reg = r;
+        } else if (operand->index == MIR_NO_REG) {
+            operand->index = r;
+            operand->scale = 1;
+        } else {
+            return 0;
+        }
+        return 1;
+    }
+    if (operand->symbol[0] != '\0' || negative || !(isalpha((unsigned char)term[0]) || term[0] == '_')) return 0;
+    snprintf(operand->symbol, sizeof(operand->symbol), "%s", term);
+    return 1;
+}
+
+/* Read an operand: "rax", "eax", "42", "qword 42", "[rbp - 8]",
+ * "qword [arr + rax*8]", "printf wrt ..plt" */
+static int x86_parse_operand(const char* text, char role, MirOperand* operand) {
+    static const char* const sizes[] = { "byte", "word", "dword", "qword" };
+    const char* p = text;
+    operand->reg = MIR_NO_REG;
+    operand->index = MIR_NO_REG;
+    for (int s = 0; s < 4; s++) {
+        size_t n = strlen(sizes[s]);
+        if (!strncmp(p, sizes[s], n) && p[n] == ' ') {
+            operand->size = 1 << s;
+            p += n + 1;
+            while (*p == ' ') p++;
+            break;
+        }
+    }
+
+    if (*p == '[') {
+        char term[MIR_NAME_SIZE];
+        size_t length = 0;
+        int negative = 0;
+        const char* close = strchr(p, ']');
+        if (!close || close[1] != '\0') return 0;
+        operand->kind = MIR_OP_MEM;
+        for (const char* q = p + 1; q <= close; q++) {
+            if (*q == '+' || *q == '-' || q == close) {
+                term[length] = '\0';
+                if (length > 0 && !x86_mir_address_term(term, negative, operand)) return 0;
+                if (length == 0 && q != close && (negative || q != p + 1)) return 0;
+                negative = *q == '-';
+                length = 0;
+            } else if (*q != ' ') {
+                if (length + 1 == sizeof(term)) return 0;
+                term[length++] = *q;
+            }
+        }
+        return role != 'l';
+    }
+    if (role == 'a') return 0;
+
+    int view;
+    operand->reg = x86_mir_register(p, &view);
+    if (operand->reg != MIR_NO_REG && operand->size == 0) {
+        operand->kind = MIR_OP_REG;
+        operand->view = view;
+        return role != 'l';
+    }
+    operand->reg = MIR_NO_REG;
+    if (x86_mir_integer(p, &operand->value)) {
+        operand->kind = MIR_OP_IMM;
+        return role == 'u';
+    }
+    if (operand->size != 0 || !(isalpha((unsigned char)*p) || *p == '_' || *p == '.')) return 0;
+    operand->kind = MIR_OP_SYMBOL;      /* Label or function, or the address of a global */
+    snprintf(operand->symbol, sizeof(operand->symbol), "%s", p);
+    return role == 'u' || role == 'l';
+}
+
+/* Print an operand */
+static void x86_format_operand(const MirOperand* operand, char* text, size_t size) {
+    static const char* const sizes[] = { "", "byte ", "word ", "", "dword ", "", "", "", "qword " };
+    const char* prefix = operand->size >= 1 && operand->size <= 8 ? sizes[operand->size] : "";
+    switch (operand->kind) {
+        case MIR_OP_REG:
+            snprintf(text, size, "%s", x86_mir_names[operand->view][operand->reg]);
+            break;
+        case MIR_OP_IMM:
+            snprintf(text, size, "%s%lld", prefix, operand->value);
+            break;
+        case MIR_OP_MEM: {
+            int n = snprintf(text, size, "%s[", prefix);
+            const char* separator = "";
+            if (operand->symbol[0] != '\0') {
+                n += snprintf(text + n, size - n, "%s", operand->symbol);
+                separator = " + ";
+            }
+            if (operand->reg != MIR_NO_REG) {
+                n += snprintf(text + n, size - n, "%s%s", separator, x86_mir_names[0][operand->reg]);
+                separator = " + ";
+            }
+            if (operand->index != MIR_NO_REG) {
+                n += snprintf(text + n, size - n, "%s%s", separator, x86_mir_names[0][operand->index]);
+                if (operand->scale != 1) n += snprintf(text + n, size - n, "*%d", operand->scale);
+                separator = " + ";
+            }
+            if (operand->value != 0 || *separator == '\0') {
+                if (operand->value < 0 && *separator) {
+                    n += snprintf(text + n, size - n, " - %lld", -operand->value);
+                } else {
+                    n += snprintf(text + n, size - n, "%s%lld", separator, operand->value);
+                }
+            }
+            snprintf(text + n, size - n, "]");
+            break;
+        }
+        case MIR_OP_SYMBOL:
+            snprintf(text, size, "%s", operand->symbol);
+            break;
+        default:
+            text[0] = '\0';
+            break;
+    }
+}
+
+/* Helper: Does an immediate fit a sign-extended 32-bit field? */
+static int x86_imm32(const MirOperand* operand) {
+    return operand->kind == MIR_OP_IMM && operand->value >= -2147483648LL && operand->value <= 2147483647LL;
+}
+
+/* Build "mov dest, source": a register takes any word; memory takes a
+ * register or a 32-bit immediate */
+static int x86_mir_copy(const MirTarget* target, MirInstr* instr, const MirOperand* dest, const MirOperand* source) {
+    MirOperand operands[2] = { *dest, *source };
+    if (dest->kind == MIR_OP_MEM) {
+        if (source->kind != MIR_OP_REG && !x86_imm32(source)) return 0;
+        operands[0].size = source->kind == MIR_OP_IMM ? 8 : 0;
+    } else if (dest->kind != MIR_OP_REG) {
+        return 0;
+    }
+    operands[1].size = 0;
+    return mir_set(target, instr, "mov", 2, operands);
+}
+
+/* Make an instruction read 'memory' where it reads 'reg': one operand of
+ * a compare, or the source of a two-operand ALU instruction */
+static int x86_fold_load(const MirTarget* target, MirInstr* instr, int reg, const MirOperand* memory) {
+    const char* mnemonic = target->opcodes[instr->opcode].mnemonic;
+    MirOperand* a = &instr->operands[0];
+    MirOperand* b = &instr->operands[1];
+    MirOperand word = *memory;
+    int a_reg = a->kind == MIR_OP_REG && a->reg == reg && a->view == 0;
+    int b_reg = b->kind == MIR_OP_REG && b->reg == reg && b->view == 0;
+    if (instr->num_operands != 2) return 0;
+
+    if (!strcmp(mnemonic, "test") && a_reg && b_reg) {
+        MirOperand operands[2];
+        memset(&operands[1], 0, sizeof(MirOperand));
+        operands[0] = word;
+        operands[0].size = 8;
+        operands[1].kind = MIR_OP_IMM;
+        operands[1].reg = MIR_NO_REG;
+        operands[1].index = MIR_NO_REG;
+        return mir_set(target, instr, "cmp", 2, operands);
+    }
+    if (!strcmp(mnemonic, "cmp") && a_reg != b_reg) {
+        MirOperand* other = a_reg ? b : a;
+        if (other->kind == MIR_OP_MEM) return 0;
+        word.size = a_reg ? 8 : 0;
+        *(a_reg ? a : b) = word;
+        return 1;
+    }
+    if ((!strcmp(mnemonic, "add") || !strcmp(mnemonic, "sub") || !strcmp(mnemonic, "and") ||
+         !strcmp(mnemonic, "or") || !strcmp(mnemonic, "xor") || !strcmp(mnemonic, "imul")) &&
+        b_reg && !a_reg && a->kind == MIR_OP_REG && a->view == 0) {
+        word.size = 0;
+        *b = word;
+        return 1;
+    }
+    return 0;
+}
+
+/* Is the line a section switch? */
+static int x86_mir_section(const char* line) {
+    while (isspace((unsigned char)*line)) line++;
+    if (strncmp(line, "section ", 8) != 0) return -1;
+    return strstr(line, ".text") != NULL;
+}
+
+/* x86-64 as the machine IR sees it */
+static const MirTarget x86_mir = {
+    "x86-64", ';', 8, x86_opcodes, (int)(sizeof(x86_opcodes) / sizeof(x86_opcodes[0])),
+    X86_BIT(X86_RBP) | X86_BIT(X86_RSP),        /* Frames */
+    X86_BIT(X86_RBP) | X86_BIT(X86_RSP),        /* Reserved */
+    (1ULL << 2) | (1ULL << 3),                  /* Writing ax or al keeps the rest */
+    x86_mir_section, x86_parse_operand, x86_format_operand, x86_mir_copy, x86_fold_load
+};
 
 /* Create a new code generator instance */
 CodeGenerator* create_code_generator(const char* output_filename, SymbolTable* symtab) {
@@ -17,48 +360,89 @@ CodeGenerator* create_code_generator(const char* output_filename, SymbolTable* s
         exit(1);
     }
 
-    gen->output_file = fopen(output_filename, "w");
-    if (!gen->output_file) {
-        fprintf(stderr, "Fatal Error: Cannot open output file '%s'\n", output_filename);
-        free(gen);
-        exit(1);
-    }
+    gen->output_filename = safe_strdup(output_filename, "code generator");
+    gen->object = 0;
+    gen->run = 0;
+    gen->elf = NULL;
+    gen->mir = create_mir(&x86_mir);
 
-    gen->stack_offset = 0;
     gen->symtab = symtab;
+    gen->checked = 0;
+    gen->regalloc = 1;
+    gen->pie = 0;
+    gen->alloc = NULL;
+    gen->position = 0;
+    memset(&gen->regalloc_stats, 0, sizeof(RegAllocStats));
+    gen->frame = NULL;
+    memset(&gen->frame_stats, 0, sizeof(FrameStats));
+    gen->isel = 1;
+    gen->grammar = NULL;
+    gen->forest = NULL;
+    memset(&gen->isel_stats, 0, sizeof(IselStats));
+    gen->args = NULL;
+    gen->num_args = 0;
+    gen->args_capacity = 0;
+    gen->peephole = 1;
+    gen->verbose = 0;
+    memset(&gen->peephole_stats, 0, sizeof(AsmOptStats));
+    memset(&gen->encode_stats, 0, sizeof(X86EncodeStats));
 
     return gen;
 }
 
+/* Helper: reg = address of a data label (rip-relative in PIE code) */
+static void gen_label_address(CodeGenerator* gen, const char* reg, const char* label, const char* comment) {
+    if (gen->pie) mir_emit(gen->mir, "    lea %s, [%s]  ; %s\n", reg, label, comment);
+    else mir_emit(gen->mir, "    mov %s, %s  ; %s\n", reg, label, comment);
+}
+
+/* Helper: Call operand of a C library function (through the PLT in PIE code) */
+static const char* library_function(CodeGenerator* gen, const char* name) {
+    static char buffer[64];
+    snprintf(buffer, sizeof(buffer), gen->pie ? "%s wrt ..plt" : "%s", name);
+    return buffer;
+}
+
 /* Generate the assembly prologue (program initialization) */
 void gen_prologue(CodeGenerator* gen) {
-    fprintf(gen->output_file, "; CST-405 Compiler - Generated Assembly Code\n");
-    fprintf(gen->output_file, "; Target: x86-64 (64-bit)\n");
-    fprintf(gen->output_file, "; Calling Convention: System V AMD64 ABI\n\n");
+    mir_emit(gen->mir, "; CST-405 Compiler - Generated Assembly Code\n");
+    mir_emit(gen->mir, "; Target: x86-64 (64-bit)\n");
+    mir_emit(gen->mir, "; Calling Convention: System V AMD64 ABI\n\n");
+    if (gen->pie) {
+        /* Position-independent: labels without a register are rip-relative
+         * and library calls go through the PLT */
+        mir_emit(gen->mir, "default rel\n\n");
+    }
 
-    fprintf(gen->output_file, "section .note.GNU-stack noalloc noexec nowrite progbits\n\n");
+    mir_emit(gen->mir, "section .note.GNU-stack noalloc noexec nowrite progbits\n\n");
 
-    fprintf(gen->output_file, "section .data\n");
-    fprintf(gen->output_file, "    ; Data section for constants\n");
-    fprintf(gen->output_file, "    fmt_int: db \"%%d\", 10, 0  ; Format string for printing integers\n\n");
+    mir_emit(gen->mir, "section .data\n");
+    mir_emit(gen->mir, "    ; Data section for constants\n");
+    mir_emit(gen->mir, "    fmt_int: db \"%%d\", 10, 0  ; Format string for printing integers\n");
+    if (gen->checked) {
+        mir_emit(gen->mir, "    check_bounds_msg: db \"Runtime error: array index out of bounds at line %%d\", 10, 0\n");
+        mir_emit(gen->mir, "    check_divide_msg: db \"Runtime error: division by zero at line %%d\", 10, 0\n");
+    }
+    mir_emit(gen->mir, "\n");
 
-    fprintf(gen->output_file, "section .bss\n");
-    fprintf(gen->output_file, "    ; BSS section for uninitialized data\n");
+    mir_emit(gen->mir, "section .bss\n");
+    mir_emit(gen->mir, "    ; BSS section for uninitialized data\n");
 
-    /* Allocate space for all variables in the symbol table (not functions) */
+    /* Allocate space for the global variables in the symbol table;
+     * parameters, locals and temporaries live in stack frames */
     if (gen->symtab) {
         for (int i = 0; i < gen->symtab->size; i++) {
             Symbol* sym = gen->symtab->table[i];
             while (sym) {
-                /* Only allocate space for variables, not functions */
-                if (sym->kind == SYMBOL_VARIABLE) {
+                /* Only allocate space for global variables, not functions */
+                if (sym->kind == SYMBOL_VARIABLE && strcmp(sym->scope, "global") == 0) {
                     if (sym->is_array) {
                         /* Arrays need space for multiple elements */
-                        fprintf(gen->output_file, "    %s: resq %d  ; Array: %s[%d]\n",
+                        mir_emit(gen->mir, "    %s: resq %d  ; Array: %s[%d]\n",
                                 sym->name, sym->array_size, sym->name, sym->array_size);
                     } else {
                         /* Regular variables need 1 qword */
-                        fprintf(gen->output_file, "    %s: resq 1  ; Variable: %s\n",
+                        mir_emit(gen->mir, "    %s: resq 1  ; Variable: %s\n",
                                 sym->name, sym->name);
                     }
                 }
@@ -67,29 +451,580 @@ void gen_prologue(CodeGenerator* gen) {
         }
     }
 
-    /* Allocate space for temporaries (t0-t99) */
-    fprintf(gen->output_file, "\n    ; Temporary variables\n");
-    for (int i = 0; i < 100; i++) {
-        fprintf(gen->output_file, "    t%d: resq 1\n", i);
+    mir_emit(gen->mir, "\nsection .text\n");
+    mir_emit(gen->mir, "    global main\n");
+    mir_emit(gen->mir, "    extern printf  ; External C library function\n");
+    if (gen->checked) {
+        mir_emit(gen->mir, "    extern exit    ; Used by the runtime check routines\n");
     }
+    mir_emit(gen->mir, "\n");
 
-    fprintf(gen->output_file, "\nsection .text\n");
-    fprintf(gen->output_file, "    global main\n");
-    fprintf(gen->output_file, "    extern printf  ; External C library function\n\n");
-
-    fprintf(gen->output_file, "main:\n");
-    fprintf(gen->output_file, "    ; Function prologue\n");
-    fprintf(gen->output_file, "    push rbp\n");
-    fprintf(gen->output_file, "    mov rbp, rsp\n\n");
+    /* Every statement lives in a function: the program starts at the
+     * 'main' function of the TAC */
 }
 
-/* Generate the assembly epilogue (program termination) */
+/* Runtime check failure routines and their messages */
+static const char* const check_routines[2][2] = {
+    { "__check_bounds_failed", "check_bounds_msg" },
+    { "__check_divide_failed", "check_divide_msg" }
+};
+
+/* Generate the assembly epilogue (program termination: main returns
+ * to the C runtime, so only the runtime check routines remain) */
 void gen_epilogue(CodeGenerator* gen) {
-    fprintf(gen->output_file, "\n    ; Function epilogue\n");
-    fprintf(gen->output_file, "    mov rsp, rbp\n");
-    fprintf(gen->output_file, "    pop rbp\n");
-    fprintf(gen->output_file, "    mov rax, 0    ; Return 0 (success)\n");
-    fprintf(gen->output_file, "    ret\n");
+    if (!gen->checked) return;
+
+    /* Runtime check failures: print the source line (in rdi) and exit(1) */
+    for (int r = 0; r < 2; r++) {
+        mir_emit(gen->mir, "\n%s:\n", check_routines[r][0]);
+        mir_emit(gen->mir, "    mov rsi, rdi      ; Source line\n");
+        gen_label_address(gen, "rdi", check_routines[r][1], "Message");
+        mir_emit(gen->mir, "    and rsp, -16      ; Align stack to 16 bytes\n");
+        mir_emit(gen->mir, "    xor rax, rax      ; No vector registers used\n");
+        mir_emit(gen->mir, "    call %s\n", library_function(gen, "printf"));
+        mir_emit(gen->mir, "    mov rdi, 1\n");
+        mir_emit(gen->mir, "    call %s\n", library_function(gen, "exit"));
+    }
+}
+
+/* Labels placed after the runtime checks */
+static int check_label_count = 0;
+
+/* Helper: Memory operand of a frame offset: from rbp, or from rsp in a
+ * leaf function */
+static const char* frame_address(CodeGenerator* gen, int offset) {
+    static char buffers[4][32];
+    static int next = 0;
+
+    char* buffer = buffers[next];
+    next = (next + 1) % 4;
+    const char* base = gen->frame->leaf ? "rsp" : "rbp";
+    if (gen->frame->leaf) offset = stack_pointer_offset(gen->frame, offset);
+    if (offset < 0) snprintf(buffer, sizeof(buffers[0]), "[%s - %d]", base, -offset);
+    else if (offset > 0) snprintf(buffer, sizeof(buffers[0]), "[%s + %d]", base, offset);
+    else snprintf(buffer, sizeof(buffers[0]), "[%s]", base);
+    return buffer;
+}
+
+/* Helper: Memory home of a value: its stack slot, or [name] for a
+ * global (arrays: the address of element 0) */
+static const char* home_location(CodeGenerator* gen, const char* name) {
+    static char buffers[4][128];
+    static int next = 0;
+
+    FrameSlot* slot = frame_slot(gen->frame, name);
+    if (slot) return frame_address(gen, slot->offset);
+
+    char* buffer = buffers[next];
+    next = (next + 1) % 4;
+    snprintf(buffer, sizeof(buffers[0]), "[%s]", name);
+    return buffer;
+}
+
+/* Get the location of an operand: a literal, a register or its home */
+const char* get_location(CodeGenerator* gen, const char* name) {
+    if (is_number(name)) return name;
+    int reg = allocated_register(gen->alloc, name);
+    if (reg >= 0) return x86_register_names[reg];
+    return home_location(gen, name);
+}
+
+/* Helper: Symbol of a name as the current function sees it */
+static Symbol* lookup_visible(CodeGenerator* gen, const char* name) {
+    if (!gen->symtab) return NULL;
+    return lookup_symbol_in_scope(gen->symtab, name, gen->frame ? gen->frame->function : "global");
+}
+
+/* Helper: Is an operand held in a register? */
+static int in_register(CodeGenerator* gen, const char* name) {
+    return allocated_register(gen->alloc, name) >= 0;
+}
+
+/* Helper: reg = operand (nothing if it is already there) */
+static void gen_load(CodeGenerator* gen, const char* reg, const char* operand) {
+    const char* location = get_location(gen, operand);
+    if (strcmp(location, reg) != 0) mir_emit(gen->mir, "    mov %s, %s\n", reg, location);
+}
+
+/* Helper: result = reg (nothing if it is already there) */
+static void gen_store(CodeGenerator* gen, const char* result, const char* reg) {
+    const char* location = get_location(gen, result);
+    if (strcmp(location, reg) != 0) mir_emit(gen->mir, "    mov %s, %s\n", location, reg);
+}
+
+/* Helper: Store the split registers a call clobbers to their homes */
+static void gen_save_split(CodeGenerator* gen) {
+    LiveInterval* split[16];
+    int count = split_at_call(gen->alloc, gen->position, split);
+    for (int s = 0; s < count; s++) {
+        mir_emit(gen->mir, "    mov %s, %s     ; Save across call\n",
+                home_location(gen, split[s]->name), x86_register_names[split[s]->reg]);
+    }
+}
+
+/* Helper: Reload the split registers after a call */
+static void gen_restore_split(CodeGenerator* gen) {
+    LiveInterval* split[16];
+    int count = split_at_call(gen->alloc, gen->position, split);
+    for (int s = 0; s < count; s++) {
+        mir_emit(gen->mir, "    mov %s, %s     ; Restore after call\n",
+                x86_register_names[split[s]->reg], home_location(gen, split[s]->name));
+    }
+}
+
+/* Helper: Does a constant fit in a sign-extended 32-bit immediate? */
+static int fits_imm32(long long value) {
+    return value >= -2147483648LL && value <= 2147483647LL;
+}
+
+/* Helper: Source operand of an ALU instruction: the operand's location,
+ * or 'scratch' loaded with a literal too wide for a 32-bit immediate
+ * (only mov takes a 64-bit one) */
+static const char* source_operand(CodeGenerator* gen, const char* operand, const char* scratch) {
+    if (is_number(operand) && !fits_imm32(atoll(operand))) {
+        mir_emit(gen->mir, "    mov %s, %s      ; 64-bit immediate\n", scratch, operand);
+        return scratch;
+    }
+    return get_location(gen, operand);
+}
+
+/* Helper: Append "+ c" or "- c" to an address expression */
+static void append_displacement(char* address, size_t size, long long c) {
+    size_t used = strlen(address);
+    if (c < 0) snprintf(address + used, size - used, " - %lld", -c);
+    else if (c > 0) snprintf(address + used, size - used, " + %lld", c);
+}
+
+/* One move of a parallel assignment (all sources read before any
+ * destination is written) */
+typedef struct {
+    char dst[128];              /* Register or memory */
+    char src[128];              /* Register, memory or literal */
+    int done;                   /* Already emitted */
+} Move;
+
+/* Helper: Is a location a register (not memory, not a literal)? */
+static int is_register_location(const char* location) {
+    return location[0] != '[' && !is_number(location);
+}
+
+/* Helper: Does a pending move other than 'self' read 'location'? */
+static int read_by_pending(Move* moves, int count, int self, const char* location) {
+    for (int m = 0; m < count; m++) {
+        if (m != self && !moves[m].done && strcmp(moves[m].src, location) == 0) return 1;
+    }
+    return 0;
+}
+
+/* Helper: Emit a parallel assignment. Memory destinations go first
+ * (every register still holds its source), then register-to-register
+ * moves in an order that reads each register before overwriting it,
+ * breaking cycles through rax, and finally the loads from memory and
+ * literals. */
+static void gen_parallel_moves(CodeGenerator* gen, Move* moves, int count) {
+    for (int m = 0; m < count; m++) {
+        moves[m].done = strcmp(moves[m].dst, moves[m].src) == 0;
+        if (moves[m].done || is_register_location(moves[m].dst)) continue;
+        if (moves[m].src[0] == '[' || (is_number(moves[m].src) && !fits_imm32(atoll(moves[m].src)))) {
+            mir_emit(gen->mir, "    mov rax, %s\n", moves[m].src);
+            mir_emit(gen->mir, "    mov %s, rax\n", moves[m].dst);
+        } else {
+            mir_emit(gen->mir, "    mov %s%s, %s\n", is_number(moves[m].src) ? "qword " : "",
+                    moves[m].dst, moves[m].src);
+        }
+        moves[m].done = 1;
+    }
+
+    for (;;) {
+        int progress = 0;
+        int blocked = -1;
+        for (int m = 0; m < count; m++) {
+            if (moves[m].done || !is_register_location(moves[m].src)) continue;
+            if (read_by_pending(moves, count, m, moves[m].dst)) {
+                blocked = m;
+                continue;
+            }
+            mir_emit(gen->mir, "    mov %s, %s\n", moves[m].dst, moves[m].src);
+            moves[m].done = 1;
+            progress = 1;
+        }
+        if (progress) continue;
+        if (blocked < 0) break;
+
+        /* Every pending register move is part of a cycle */
+        mir_emit(gen->mir, "    mov rax, %s\n", moves[blocked].dst);
+        for (int m = 0; m < count; m++) {
+            if (!moves[m].done && strcmp(moves[m].src, moves[blocked].dst) == 0) strcpy(moves[m].src, "rax");
+        }
+    }
+
+    for (int m = 0; m < count; m++) {
+        if (!moves[m].done) mir_emit(gen->mir, "    mov %s, %s\n", moves[m].dst, moves[m].src);
+    }
+}
+
+/* Helper: Move the first 'count' arguments into the argument registers */
+static void gen_register_arguments(CodeGenerator* gen, const char** args, int count) {
+    Move moves[X86_REG_ARGS];
+    for (int a = 0; a < count; a++) {
+        snprintf(moves[a].dst, sizeof(moves[a].dst), "%s", x86_arg_registers[a]);
+        snprintf(moves[a].src, sizeof(moves[a].src), "%s", get_location(gen, args[a]));
+    }
+    gen_parallel_moves(gen, moves, count);
+}
+
+/* Helper: Push one stack argument */
+static void gen_push_argument(CodeGenerator* gen, const char* arg) {
+    const char* location = get_location(gen, arg);
+    if (is_number(arg) && !fits_imm32(atoll(arg))) {
+        mir_emit(gen->mir, "    mov rax, %s\n", location);
+        mir_emit(gen->mir, "    push rax\n");
+    } else if (is_register_location(location)) {
+        mir_emit(gen->mir, "    push %s\n", location);
+    } else {
+        mir_emit(gen->mir, "    push qword %s\n", location);
+    }
+}
+
+/* Helper: Remember the operand of a param until its call */
+static void push_argument(CodeGenerator* gen, const char* arg) {
+    if (gen->num_args >= gen->args_capacity) {
+        gen->args_capacity = gen->args_capacity ? gen->args_capacity * 2 : 16;
+        gen->args = (const char**)safe_realloc(gen->args, gen->args_capacity * sizeof(const char*),
+                                               "code generator");
+    }
+    gen->args[gen->num_args++] = arg;
+}
+
+/* Helper: Take the operands of the last 'count' params, in argument order */
+static const char** pop_arguments(CodeGenerator* gen, int* count) {
+    if (*count > gen->num_args) *count = gen->num_args;
+    gen->num_args -= *count;
+    return gen->args + gen->num_args;
+}
+
+/* Helper: Restore the callee-saved registers and leave the frame */
+static void gen_function_exit(CodeGenerator* gen) {
+    RegisterAllocation* alloc = gen->alloc;
+    for (int r = 0; alloc && r < alloc->num_callee_saved_used; r++) {
+        mir_emit(gen->mir, "    mov %s, %s\n", x86_register_names[alloc->callee_saved_used[r]],
+                frame_address(gen, saved_register_offset(gen->frame, r)));
+    }
+    if (gen->frame->leaf) {
+        if (gen->frame->sp_adjust > 0) {
+            mir_emit(gen->mir, "    add rsp, %d       ; Leaf epilogue\n", gen->frame->sp_adjust);
+        }
+        return;
+    }
+    mir_emit(gen->mir, "    mov rsp, rbp      ; Function epilogue\n");
+    mir_emit(gen->mir, "    pop rbp\n");
+}
+
+/* Helper: Jump to a check failure routine with the source line, and
+ * place the label that passing checks jump to */
+static void gen_check_failure(CodeGenerator* gen, const char* routine, int line, int ok_label) {
+    mir_emit(gen->mir, "    mov rdi, %d        ; Source line\n", line);
+    mir_emit(gen->mir, "    jmp %s\n", routine);
+    mir_emit(gen->mir, "check_ok_%d:\n", ok_label);
+}
+
+/* Helper: Trap unless the index (or byte offset) in register 'index' is
+ * within the array */
+static void gen_bounds_check(CodeGenerator* gen, TACInstruction* inst, const char* array, int offset,
+                             const char* index) {
+    Symbol* sym = lookup_visible(gen, array);
+    if (!(inst->checks & CHECK_BOUNDS) || !sym || !sym->is_array) return;
+
+    /* Unsigned compare: negative indexes look huge */
+    int label = check_label_count++;
+    long long last = (long long)(sym->array_size - 1) * (offset ? 8 : 1);
+    mir_emit(gen->mir, "    cmp %s, %lld      ; Bounds check (--checked)\n", index, last);
+    mir_emit(gen->mir, "    jbe check_ok_%d\n", label);
+    gen_check_failure(gen, "__check_bounds_failed", inst->line, label);
+}
+
+/* Helper: Trap if the divisor in rcx is zero */
+static void gen_divisor_check(CodeGenerator* gen, TACInstruction* inst) {
+    if (!(inst->checks & CHECK_DIVISOR)) return;
+
+    int label = check_label_count++;
+    mir_emit(gen->mir, "    test rcx, rcx     ; Divide-by-zero check (--checked)\n");
+    mir_emit(gen->mir, "    jnz check_ok_%d\n", label);
+    gen_check_failure(gen, "__check_divide_failed", inst->line, label);
+}
+
+/* Helper: Jump taken when 'op1 relop op2' (just compared) is false */
+static const char* jump_unless(const char* relop) {
+    if (strcmp(relop, "<") == 0) return "jge";
+    if (strcmp(relop, "<=") == 0) return "jg";
+    if (strcmp(relop, ">") == 0) return "jle";
+    if (strcmp(relop, ">=") == 0) return "jl";
+    if (strcmp(relop, "==") == 0) return "jne";
+    return "je";
+}
+
+/* Helper: Check hoisted in front of a loop: if the loop runs, its bound
+ * (TAC_CHECK_BOUNDS) must fit the array or its divisor (TAC_CHECK_DIVISOR)
+ * must not be zero */
+static void gen_loop_check(CodeGenerator* gen, TACInstruction* inst) {
+    int label = check_label_count++;
+
+    mir_emit(gen->mir, "    ; loop check: %s (if %s %s %s)\n",
+            inst->result, inst->op1, inst->label, inst->op2);
+    gen_load(gen, "rax", inst->op1);
+    gen_load(gen, "rcx", inst->op2);
+    mir_emit(gen->mir, "    cmp rax, rcx\n");
+    mir_emit(gen->mir, "    %s check_ok_%d    ; Loop does not run\n",
+            jump_unless(inst->label), label);
+
+    if (inst->opcode == TAC_CHECK_BOUNDS) {
+        Symbol* sym = lookup_visible(gen, inst->result);
+        int size = sym ? sym->array_size : 0;
+        int highest = strcmp(inst->label, "<") == 0 ? size : size - 1;
+        mir_emit(gen->mir, "    cmp rcx, %d       ; Highest bound that fits %s\n",
+                highest, inst->result);
+        mir_emit(gen->mir, "    jle check_ok_%d\n", label);
+        gen_check_failure(gen, "__check_bounds_failed", inst->line, label);
+    } else {
+        gen_load(gen, "rax", inst->result);
+        mir_emit(gen->mir, "    test rax, rax\n");
+        mir_emit(gen->mir, "    jnz check_ok_%d\n", label);
+        gen_check_failure(gen, "__check_divide_failed", inst->line, label);
+    }
+    mir_emit(gen->mir, "\n");
+}
+
+/* Helper: rax = rax * c using shifts, adds and lea where possible */
+static void gen_multiply_by_constant(CodeGenerator* gen, long long c) {
+    MirProgram* out = gen->mir;
+    MulPlan plan = plan_multiply(c, 64);
+
+    switch (plan.kind) {
+        case MUL_BY_ZERO:
+            mir_emit(out, "    xor eax, eax      ; x * 0\n");
+            return;
+        case MUL_BY_SHIFT:
+            if (plan.shift > 0) mir_emit(out, "    shl rax, %d\n", plan.shift);
+            break;
+        case MUL_BY_SHIFT_ADD:
+            if (plan.shift <= 3) {
+                mir_emit(out, "    lea rax, [rax+rax*%d]\n", 1 << plan.shift);
+            } else {
+                mir_emit(out, "    mov rcx, rax\n");
+                mir_emit(out, "    shl rax, %d\n", plan.shift);
+                mir_emit(out, "    add rax, rcx\n");
+            }
+            break;
+        case MUL_BY_SHIFT_SUB:
+            mir_emit(out, "    mov rcx, rax\n");
+            mir_emit(out, "    shl rax, %d\n", plan.shift);
+            mir_emit(out, "    sub rax, rcx\n");
+            break;
+        case MUL_BY_MULTIPLY:
+            if (fits_imm32(c)) {
+                mir_emit(out, "    imul rax, rax, %lld\n", c);
+            } else {
+                mir_emit(out, "    mov rcx, %lld\n", c);
+                mir_emit(out, "    imul rax, rcx\n");
+            }
+            break;
+    }
+    if (plan.negate) mir_emit(out, "    neg rax\n");
+}
+
+/* Helper: rax = dividend / d or dividend % d (d constant, dividend a
+ * location), rounding toward zero like idiv */
+static void gen_divide_by_constant(CodeGenerator* gen, const char* dividend, long long d, int want_mod) {
+    MirProgram* out = gen->mir;
+    int k = power_of_two_shift(d, 64);
+    DivPlan plan;
+
+    if (k > 0) {
+        /* Bias negative dividends by 2^k - 1 so the shift rounds toward zero */
+        mir_emit(out, "    mov rax, %s\n", dividend);
+        mir_emit(out, "    mov rdx, rax\n");
+        mir_emit(out, "    sar rdx, 63\n");
+        mir_emit(out, "    shr rdx, %d\n", 64 - k);
+        mir_emit(out, "    add rax, rdx\n");
+        if (!want_mod) {
+            mir_emit(out, "    sar rax, %d\n", k);
+            if (d < 0) mir_emit(out, "    neg rax\n");
+        } else {
+            if (k <= 31) {
+                mir_emit(out, "    and rax, %lld\n", -(1LL << k));
+            } else {
+                mir_emit(out, "    mov rcx, %lld\n", -(1LL << k));
+                mir_emit(out, "    and rax, rcx\n");
+            }
+            mir_emit(out, "    mov rdx, %s\n", dividend);
+            mir_emit(out, "    sub rdx, rax\n");
+            mir_emit(out, "    mov rax, rdx\n");
+        }
+        return;
+    }
+
+    if (!plan_divide(d, 64, &plan)) {
+        /* 0, +-1 or out of range: keep the divide instruction */
+        mir_emit(out, "    mov rax, %s\n", dividend);
+        mir_emit(out, "    cqo              ; Sign-extend rax to rdx:rax\n");
+        mir_emit(out, "    mov rcx, %lld\n", d);
+        mir_emit(out, "    idiv rcx          ; Signed divide rdx:rax by rcx\n");
+        if (want_mod) mir_emit(out, "    mov rax, rdx\n");
+        return;
+    }
+
+    /* Quotient = high half of magic * n, corrected and shifted */
+    mir_emit(out, "    mov rcx, %s\n", dividend);
+    mir_emit(out, "    mov rax, %lld     ; Magic number for / %lld\n", plan.magic, d);
+    mir_emit(out, "    imul rcx          ; rdx = high 64 bits of magic * n\n");
+    if (plan.add_dividend) mir_emit(out, "    add rdx, rcx\n");
+    if (plan.sub_dividend) mir_emit(out, "    sub rdx, rcx\n");
+    if (plan.shift > 0) mir_emit(out, "    sar rdx, %d\n", plan.shift);
+    mir_emit(out, "    mov rax, rdx\n");
+    mir_emit(out, "    shr rax, 63       ; Add 1 if the quotient is negative\n");
+    mir_emit(out, "    add rax, rdx\n");
+    if (want_mod) {
+        /* Remainder = n - q * d */
+        if (fits_imm32(d)) {
+            mir_emit(out, "    imul rax, rax, %lld\n", d);
+        } else {
+            mir_emit(out, "    mov rdx, %lld\n", d);
+            mir_emit(out, "    imul rax, rdx\n");
+        }
+        mir_emit(out, "    sub rcx, rax\n");
+        mir_emit(out, "    mov rax, rcx\n");
+    }
+}
+
+/* Helper: result = op1 <op> op2 for add, sub and imul, computed in the
+ * result's register when it has one */
+static void gen_binary(CodeGenerator* gen, TACInstruction* inst, const char* mnemonic, int commutative) {
+    const char* op1 = inst->op1;
+    const char* op2 = inst->op2;
+
+    /* a = b + a: add b into a's register instead */
+    if (commutative && in_register(gen, inst->result) && strcmp(op1, op2) != 0 &&
+        strcmp(get_location(gen, op2), get_location(gen, inst->result)) == 0) {
+        op1 = inst->op2;
+        op2 = inst->op1;
+    }
+
+    const char* reg = "rax";
+    if (in_register(gen, inst->result) &&
+        (strcmp(op1, op2) == 0 || strcmp(get_location(gen, op2), get_location(gen, inst->result)) != 0)) {
+        reg = get_location(gen, inst->result);
+    }
+
+    gen_load(gen, reg, op1);
+    mir_emit(gen->mir, "    %s %s, %s\n", mnemonic, reg, source_operand(gen, op2, "rcx"));
+    gen_store(gen, inst->result, reg);
+    mir_emit(gen->mir, "\n");
+}
+
+/* Helper: result = op1 / op2 or op1 % op2 */
+static void gen_division(CodeGenerator* gen, TACInstruction* inst, int want_mod) {
+    if (is_number(inst->op2)) {
+        if (inst->checks & CHECK_DIVISOR) {
+            mir_emit(gen->mir, "    xor ecx, ecx      ; Constant zero divisor\n");
+            gen_divisor_check(gen, inst);
+        }
+        gen_divide_by_constant(gen, get_location(gen, inst->op1), atoll(inst->op2), want_mod);
+        gen_store(gen, inst->result, "rax");
+        mir_emit(gen->mir, "\n");
+        return;
+    }
+
+    gen_load(gen, "rax", inst->op1);
+    mir_emit(gen->mir, "    cqo              ; Sign-extend rax to rdx:rax\n");
+    gen_load(gen, "rcx", inst->op2);
+    gen_divisor_check(gen, inst);
+    mir_emit(gen->mir, "    idiv rcx          ; Signed divide rdx:rax by rcx\n");
+    if (want_mod) {
+        mir_emit(gen->mir, "    ; Remainder is in rdx\n");
+        gen_store(gen, inst->result, "rdx");
+    } else {
+        gen_store(gen, inst->result, "rax");
+    }
+    mir_emit(gen->mir, "\n");
+}
+
+/* Helper: Memory operand of an array element at index_reg * scale +
+ * displacement bytes (index_reg NULL: constant index). Local arrays are
+ * addressed from rbp (rsp in a leaf) and globals from their label; in
+ * PIE code a global indexed by a register is addressed from 'pie_base',
+ * which holds its rip-relative address (rip-relative operands take no
+ * index). */
+static const char* array_operand(CodeGenerator* gen, const char* array, const char* index_reg, int scale,
+                                 long long displacement, const char* pie_base) {
+    static char buffers[2][192];
+    static int next = 0;
+
+    char* buffer = buffers[next];
+    next = (next + 1) % 2;
+    char scaled[48] = "";
+    if (index_reg && scale > 1) snprintf(scaled, sizeof(scaled), " + %s*%d", index_reg, scale);
+    else if (index_reg) snprintf(scaled, sizeof(scaled), " + %s", index_reg);
+
+    FrameSlot* slot = frame_slot(gen->frame, array);
+    if (slot) {
+        long long offset = slot->offset + displacement;
+        if (gen->frame->leaf) offset = stack_pointer_offset(gen->frame, (int)offset);
+        snprintf(buffer, sizeof(buffers[0]), "[%s%s", gen->frame->leaf ? "rsp" : "rbp", scaled);
+        append_displacement(buffer, sizeof(buffers[0]), offset);
+    } else if (gen->pie && index_reg) {
+        snprintf(buffer, sizeof(buffers[0]), "[%s%s", pie_base, scaled);
+        append_displacement(buffer, sizeof(buffers[0]), displacement);
+    } else {
+        snprintf(buffer, sizeof(buffers[0]), "[%s%s", array, scaled);
+        append_displacement(buffer, sizeof(buffers[0]), displacement);
+    }
+    strncat(buffer, "]", sizeof(buffers[0]) - strlen(buffer) - 1);
+    return buffer;
+}
+
+/* Helper: Does addressing a global array by a register need its address
+ * in a register first (PIE code)? */
+static int needs_array_base(CodeGenerator* gen, const char* array) {
+    return gen->pie && !frame_slot(gen->frame, array);
+}
+
+/* Helper: Memory operand of an array element for the templates: the
+ * scaled index ('scale' is 8 for element indexes, 1 for the byte offsets
+ * the optimizer keeps) or a constant index folded into the displacement.
+ * An index not already in a register is loaded into rax, and r11 holds
+ * the base of a global array in PIE code. */
+static const char* element_address(CodeGenerator* gen, TACInstruction* inst, const char* array,
+                                   const char* index, int scale) {
+    if (is_number(index)) {
+        if (inst->checks & CHECK_BOUNDS) {
+            mir_emit(gen->mir, "    mov rax, %s\n", index);
+            gen_bounds_check(gen, inst, array, scale == 1, "rax");
+        }
+        return array_operand(gen, array, NULL, scale, atoll(index) * scale, NULL);
+    }
+
+    const char* index_reg = "rax";
+    if (in_register(gen, index)) index_reg = get_location(gen, index);
+    else gen_load(gen, "rax", index);
+    gen_bounds_check(gen, inst, array, scale == 1, index_reg);
+    if (needs_array_base(gen, array)) {
+        mir_emit(gen->mir, "    lea r11, [%s]      ; Array base (rip-relative)\n", array);
+    }
+    return array_operand(gen, array, index_reg, scale, 0, "r11");
+}
+
+/* Helper: Store a value operand to an array element */
+static void gen_store_element(CodeGenerator* gen, const char* address, const char* value) {
+    if (in_register(gen, value)) {
+        mir_emit(gen->mir, "    mov %s, %s ; Store in array\n\n", address, get_location(gen, value));
+        return;
+    }
+    if (is_number(value) && fits_imm32(atoll(value))) {
+        mir_emit(gen->mir, "    mov qword %s, %s ; Store in array\n\n", address, value);
+        return;
+    }
+    mir_emit(gen->mir, "    mov rcx, %s      ; Get value to store\n", get_location(gen, value));
+    mir_emit(gen->mir, "    mov %s, rcx ; Store in array\n\n", address);
 }
 
 /* Generate code for a single TAC instruction */
@@ -97,167 +1032,259 @@ void gen_tac_instruction(CodeGenerator* gen, TACInstruction* inst) {
     switch (inst->opcode) {
         case TAC_LOAD_CONST:
             /* Load constant into variable: result = constant */
-            fprintf(gen->output_file, "    ; %s = %s\n", inst->result, inst->op1);
-            fprintf(gen->output_file, "    mov rax, %s\n", inst->op1);
-            fprintf(gen->output_file, "    mov [%s], rax\n\n", inst->result);
+            mir_emit(gen->mir, "    ; %s = %s\n", inst->result, inst->op1);
+            if (in_register(gen, inst->result)) {
+                mir_emit(gen->mir, "    mov %s, %s\n\n", get_location(gen, inst->result), inst->op1);
+                break;
+            }
+            mir_emit(gen->mir, "    mov rax, %s\n", inst->op1);
+            mir_emit(gen->mir, "    mov %s, rax\n\n", get_location(gen, inst->result));
             break;
 
         case TAC_ASSIGN:
             /* Assignment: result = op1 */
-            fprintf(gen->output_file, "    ; %s = %s\n", inst->result, inst->op1);
-            fprintf(gen->output_file, "    mov rax, [%s]\n", inst->op1);
-            fprintf(gen->output_file, "    mov [%s], rax\n\n", inst->result);
+            mir_emit(gen->mir, "    ; %s = %s\n", inst->result, inst->op1);
+            if (in_register(gen, inst->result)) {
+                gen_load(gen, get_location(gen, inst->result), inst->op1);
+            } else if (in_register(gen, inst->op1)) {
+                gen_store(gen, inst->result, get_location(gen, inst->op1));
+            } else {
+                gen_load(gen, "rax", inst->op1);
+                gen_store(gen, inst->result, "rax");
+            }
+            mir_emit(gen->mir, "\n");
             break;
 
         case TAC_ADD:
             /* Addition: result = op1 + op2 */
-            fprintf(gen->output_file, "    ; %s = %s + %s\n",
+            mir_emit(gen->mir, "    ; %s = %s + %s\n",
                     inst->result, inst->op1, inst->op2);
-            fprintf(gen->output_file, "    mov rax, [%s]\n", inst->op1);
-            fprintf(gen->output_file, "    add rax, [%s]\n", inst->op2);
-            fprintf(gen->output_file, "    mov [%s], rax\n\n", inst->result);
+            gen_binary(gen, inst, "add", 1);
             break;
 
         case TAC_SUB:
             /* Subtraction: result = op1 - op2 */
-            fprintf(gen->output_file, "    ; %s = %s - %s\n",
+            mir_emit(gen->mir, "    ; %s = %s - %s\n",
                     inst->result, inst->op1, inst->op2);
-            fprintf(gen->output_file, "    mov rax, [%s]\n", inst->op1);
-            fprintf(gen->output_file, "    sub rax, [%s]\n", inst->op2);
-            fprintf(gen->output_file, "    mov [%s], rax\n\n", inst->result);
+            gen_binary(gen, inst, "sub", 0);
             break;
 
         case TAC_MUL:
             /* Multiplication: result = op1 * op2 */
-            fprintf(gen->output_file, "    ; %s = %s * %s\n",
+            mir_emit(gen->mir, "    ; %s = %s * %s\n",
                     inst->result, inst->op1, inst->op2);
-            fprintf(gen->output_file, "    mov rax, [%s]\n", inst->op1);
-            fprintf(gen->output_file, "    imul rax, [%s]\n", inst->op2);
-            fprintf(gen->output_file, "    mov [%s], rax\n\n", inst->result);
+            if (is_number(inst->op2)) {
+                gen_load(gen, "rax", inst->op1);
+                gen_multiply_by_constant(gen, atoll(inst->op2));
+                gen_store(gen, inst->result, "rax");
+                mir_emit(gen->mir, "\n");
+            } else {
+                gen_binary(gen, inst, "imul", 1);
+            }
             break;
 
         case TAC_DIV:
             /* Division: result = op1 / op2 */
-            fprintf(gen->output_file, "    ; %s = %s / %s\n",
+            mir_emit(gen->mir, "    ; %s = %s / %s\n",
                     inst->result, inst->op1, inst->op2);
-            fprintf(gen->output_file, "    mov rax, [%s]\n", inst->op1);
-            fprintf(gen->output_file, "    cqo              ; Sign-extend rax to rdx:rax\n");
-            fprintf(gen->output_file, "    mov rbx, [%s]\n", inst->op2);
-            fprintf(gen->output_file, "    idiv rbx          ; Signed divide rdx:rax by rbx\n");
-            fprintf(gen->output_file, "    mov [%s], rax\n\n", inst->result);
+            gen_division(gen, inst, 0);
             break;
 
         case TAC_MOD:
             /* Modulo: result = op1 % op2 */
-            fprintf(gen->output_file, "    ; %s = %s %% %s\n",
+            mir_emit(gen->mir, "    ; %s = %s %% %s\n",
                     inst->result, inst->op1, inst->op2);
-            fprintf(gen->output_file, "    mov rax, [%s]\n", inst->op1);
-            fprintf(gen->output_file, "    cqo              ; Sign-extend rax to rdx:rax\n");
-            fprintf(gen->output_file, "    mov rbx, [%s]\n", inst->op2);
-            fprintf(gen->output_file, "    idiv rbx          ; Signed divide rdx:rax by rbx\n");
-            fprintf(gen->output_file, "    mov [%s], rdx    ; Remainder is in rdx\n\n", inst->result);
+            gen_division(gen, inst, 1);
             break;
 
         case TAC_PRINT:
-            /* Print: print(op1) */
-            fprintf(gen->output_file, "    ; print(%s)\n", inst->op1);
-            fprintf(gen->output_file, "    mov rdi, fmt_int  ; Format string\n");
-            fprintf(gen->output_file, "    mov rsi, [%s]     ; Value to print\n", inst->op1);
-            fprintf(gen->output_file, "    xor rax, rax      ; No vector registers used\n");
-            fprintf(gen->output_file, "    call printf\n\n");
+            /* Print: print(op1); printf clobbers the caller-saved registers */
+            mir_emit(gen->mir, "    ; print(%s)\n", inst->op1);
+            gen_save_split(gen);
+            mir_emit(gen->mir, "    mov rsi, %s     ; Value to print\n", get_location(gen, inst->op1));
+            gen_label_address(gen, "rdi", "fmt_int", "Format string");
+            mir_emit(gen->mir, "    xor rax, rax      ; No vector registers used\n");
+            mir_emit(gen->mir, "    call %s\n", library_function(gen, "printf"));
+            gen_restore_split(gen);
+            mir_emit(gen->mir, "\n");
             break;
 
         case TAC_LABEL:
             /* Label: label: */
-            fprintf(gen->output_file, "%s:\n", inst->label);
+            mir_emit(gen->mir, "%s:\n", inst->label);
             break;
 
         case TAC_GOTO:
             /* Unconditional jump: goto label */
-            fprintf(gen->output_file, "    ; goto %s\n", inst->label);
-            fprintf(gen->output_file, "    jmp %s\n\n", inst->label);
+            mir_emit(gen->mir, "    ; goto %s\n", inst->label);
+            mir_emit(gen->mir, "    jmp %s\n\n", inst->label);
             break;
 
         case TAC_RELOP:
             /* Relational operation: result = op1 relop op2 */
-            fprintf(gen->output_file, "    ; %s = %s %s %s\n",
+            mir_emit(gen->mir, "    ; %s = %s %s %s\n",
                     inst->result, inst->op1, inst->label, inst->op2);
-            fprintf(gen->output_file, "    mov rax, [%s]\n", inst->op1);
-            fprintf(gen->output_file, "    cmp rax, [%s]\n", inst->op2);
+            if (in_register(gen, inst->op1)) {
+                const char* right = source_operand(gen, inst->op2, "rcx");
+                mir_emit(gen->mir, "    cmp %s, %s\n", get_location(gen, inst->op1), right);
+            } else {
+                gen_load(gen, "rax", inst->op1);
+                mir_emit(gen->mir, "    cmp rax, %s\n", source_operand(gen, inst->op2, "rcx"));
+            }
 
             /* Set result based on comparison (using setcc instructions) */
             if (strcmp(inst->label, "<") == 0) {
-                fprintf(gen->output_file, "    setl al       ; Set if less\n");
+                mir_emit(gen->mir, "    setl al       ; Set if less\n");
             } else if (strcmp(inst->label, ">") == 0) {
-                fprintf(gen->output_file, "    setg al       ; Set if greater\n");
+                mir_emit(gen->mir, "    setg al       ; Set if greater\n");
             } else if (strcmp(inst->label, "<=") == 0) {
-                fprintf(gen->output_file, "    setle al      ; Set if less or equal\n");
+                mir_emit(gen->mir, "    setle al      ; Set if less or equal\n");
             } else if (strcmp(inst->label, ">=") == 0) {
-                fprintf(gen->output_file, "    setge al      ; Set if greater or equal\n");
+                mir_emit(gen->mir, "    setge al      ; Set if greater or equal\n");
             } else if (strcmp(inst->label, "==") == 0) {
-                fprintf(gen->output_file, "    sete al       ; Set if equal\n");
+                mir_emit(gen->mir, "    sete al       ; Set if equal\n");
             } else if (strcmp(inst->label, "!=") == 0) {
-                fprintf(gen->output_file, "    setne al      ; Set if not equal\n");
+                mir_emit(gen->mir, "    setne al      ; Set if not equal\n");
             }
 
-            fprintf(gen->output_file, "    movzx rax, al     ; Zero-extend to 64-bit\n");
-            fprintf(gen->output_file, "    mov [%s], rax\n\n", inst->result);
+            mir_emit(gen->mir, "    movzx rax, al     ; Zero-extend to 64-bit\n");
+            gen_store(gen, inst->result, "rax");
+            mir_emit(gen->mir, "\n");
             break;
 
         case TAC_IF_FALSE:
             /* Conditional jump: if_false op1 goto label */
-            fprintf(gen->output_file, "    ; if_false %s goto %s\n",
+            mir_emit(gen->mir, "    ; if_false %s goto %s\n",
                     inst->op1, inst->label);
-            fprintf(gen->output_file, "    mov rax, [%s]\n", inst->op1);
-            fprintf(gen->output_file, "    cmp rax, 0\n");
-            fprintf(gen->output_file, "    je %s         ; Jump if zero (false)\n\n",
+            if (in_register(gen, inst->op1)) {
+                const char* reg = get_location(gen, inst->op1);
+                mir_emit(gen->mir, "    test %s, %s\n", reg, reg);
+            } else {
+                gen_load(gen, "rax", inst->op1);
+                mir_emit(gen->mir, "    cmp rax, 0\n");
+            }
+            mir_emit(gen->mir, "    je %s         ; Jump if zero (false)\n\n",
                     inst->label);
             break;
 
-        case TAC_ARRAY_LOAD:
+        case TAC_ARRAY_LOAD: {
             /* Array load: result = array[index] */
-            fprintf(gen->output_file, "    ; %s = %s[%s]\n",
+            mir_emit(gen->mir, "    ; %s = %s[%s]\n",
                     inst->result, inst->op1, inst->op2);
-            fprintf(gen->output_file, "    mov rax, [%s]     ; Get index\n", inst->op2);
-            fprintf(gen->output_file, "    imul rax, 8        ; Multiply by element size (8 bytes)\n");
-            fprintf(gen->output_file, "    lea rbx, [%s]      ; Get array base address\n", inst->op1);
-            fprintf(gen->output_file, "    add rbx, rax       ; Add offset\n");
-            fprintf(gen->output_file, "    mov rax, [rbx]     ; Load array element\n");
-            fprintf(gen->output_file, "    mov [%s], rax      ; Store in result\n\n", inst->result);
+            const char* address = element_address(gen, inst, inst->op1, inst->op2, 8);
+            const char* reg = in_register(gen, inst->result) ? get_location(gen, inst->result) : "rax";
+            mir_emit(gen->mir, "    mov %s, %s ; Load array element\n", reg, address);
+            gen_store(gen, inst->result, reg);
+            mir_emit(gen->mir, "\n");
             break;
+        }
 
         case TAC_ARRAY_STORE:
             /* Array store: array[index] = value */
-            fprintf(gen->output_file, "    ; %s[%s] = %s\n",
+            mir_emit(gen->mir, "    ; %s[%s] = %s\n",
+                    inst->result, inst->op1, inst->op2);
+            gen_store_element(gen, element_address(gen, inst, inst->result, inst->op1, 8), inst->op2);
+            break;
+
+        case TAC_ARRAY_LOAD_OFFSET: {
+            /* Array load at a byte offset kept by the optimizer */
+            mir_emit(gen->mir, "    ; %s = %s[byte %s]\n",
+                    inst->result, inst->op1, inst->op2);
+            const char* address = element_address(gen, inst, inst->op1, inst->op2, 1);
+            const char* reg = in_register(gen, inst->result) ? get_location(gen, inst->result) : "rax";
+            mir_emit(gen->mir, "    mov %s, %s ; Load array element\n", reg, address);
+            gen_store(gen, inst->result, reg);
+            mir_emit(gen->mir, "\n");
+            break;
+        }
+
+        case TAC_ARRAY_STORE_OFFSET:
+            /* Array store at a byte offset kept by the optimizer */
+            mir_emit(gen->mir, "    ; %s[byte %s] = %s\n",
                     inst->result, inst->op1, inst->op2);
-            fprintf(gen->output_file, "    mov rax, [%s]     ; Get index\n", inst->op1);
-            fprintf(gen->output_file, "    imul rax, 8        ; Multiply by element size (8 bytes)\n");
-            fprintf(gen->output_file, "    lea rbx, [%s]      ; Get array base address\n", inst->result);
-            fprintf(gen->output_file, "    add rbx, rax       ; Add offset\n");
-            fprintf(gen->output_file, "    mov rax, [%s]      ; Get value to store\n", inst->op2);
-            fprintf(gen->output_file, "    mov [rbx], rax     ; Store in array\n\n");
+            gen_store_element(gen, element_address(gen, inst, inst->result, inst->op1, 1), inst->op2);
+            break;
+
+        case TAC_CHECK_BOUNDS:
+        case TAC_CHECK_DIVISOR:
+            /* Runtime check hoisted in front of a loop (--checked) */
+            gen_loop_check(gen, inst);
             break;
 
-        case TAC_FUNCTION_LABEL:
+        case TAC_FUNCTION_LABEL: {
             /* Function label: function_name: */
-            fprintf(gen->output_file, "\n; Function: %s\n", inst->label);
-            fprintf(gen->output_file, "%s:\n", inst->label);
-            fprintf(gen->output_file, "    ; Function prologue\n");
-            fprintf(gen->output_file, "    push rbp\n");
-            fprintf(gen->output_file, "    mov rbp, rsp\n");
-            fprintf(gen->output_file, "    sub rsp, 64       ; Reserve space for local variables\n\n");
+            mir_emit(gen->mir, "\n; Function: %s\n", inst->label);
+            mir_emit(gen->mir, "%s:\n", inst->label);
+            if (gen->frame->leaf) {
+                /* Leaf: no rbp frame; a frame too big for the red zone
+                 * still moves rsp */
+                mir_emit(gen->mir, "    ; Leaf function: no frame pointer\n");
+                if (gen->frame->sp_adjust > 0) {
+                    mir_emit(gen->mir, "    sub rsp, %d       ; Frame: saved registers, locals and temporaries\n",
+                            gen->frame->sp_adjust);
+                }
+            } else {
+                mir_emit(gen->mir, "    ; Function prologue\n");
+                mir_emit(gen->mir, "    push rbp\n");
+                mir_emit(gen->mir, "    mov rbp, rsp\n");
+                if (gen->frame->size > 0) {
+                    mir_emit(gen->mir, "    sub rsp, %d       ; Frame: saved registers, locals and temporaries\n",
+                            gen->frame->size);
+                }
+            }
+
+            /* Callee-saved registers go in the first slots of the frame */
+            RegisterAllocation* alloc = gen->alloc;
+            for (int r = 0; alloc && r < alloc->num_callee_saved_used; r++) {
+                mir_emit(gen->mir, "    mov %s, %s\n", frame_address(gen, saved_register_offset(gen->frame, r)),
+                        x86_register_names[alloc->callee_saved_used[r]]);
+            }
+
+            /* Register arguments go straight to the register or frame slot
+             * the body uses */
+            Symbol* owner = gen->symtab ? lookup_symbol(gen->symtab, inst->label) : NULL;
+            int num_params = owner && owner->kind == SYMBOL_FUNCTION ? owner->param_count : 0;
+            Move moves[X86_REG_ARGS];
+            int num_moves = 0;
+            for (int p = 0; p < num_params && p < X86_REG_ARGS; p++) {
+                const char* name = owner->param_names[p];
+                int reg = allocated_register(alloc, name);
+                if (reg >= 0) {
+                    int id = lookup_name_id(alloc->names, name);
+                    if (!alloc->intervals[alloc->interval_of[id]].entry_load) continue;
+                } else if (!frame_slot(gen->frame, name)) {
+                    continue;
+                }
+                snprintf(moves[num_moves].dst, sizeof(moves[0].dst), "%s", get_location(gen, name));
+                snprintf(moves[num_moves].src, sizeof(moves[0].src), "%s", x86_arg_registers[p]);
+                num_moves++;
+            }
+            gen_parallel_moves(gen, moves, num_moves);
+
+            /* Stack arguments live in registers from here on */
+            for (int v = 0; alloc && v < alloc->num_intervals; v++) {
+                LiveInterval* interval = &alloc->intervals[v];
+                FrameSlot* slot = frame_slot(gen->frame, interval->name);
+                if (interval->entry_load && interval->reg >= 0 && slot && slot->is_param) {
+                    mir_emit(gen->mir, "    mov %s, %s   ; Parameter %s\n",
+                            x86_register_names[interval->reg], home_location(gen, interval->name),
+                            interval->name);
+                }
+            }
+            mir_emit(gen->mir, "\n");
             break;
+        }
 
         case TAC_PARAM:
             /* Parameter passing: param value
              * System V AMD64 calling convention:
              * First 6 integer args in: rdi, rsi, rdx, rcx, r8, r9
              * Additional args pushed on stack in reverse order
-             * For simplicity, we'll push all params on stack
+             * Nothing moves yet: the call passes all its arguments at once,
+             * after the params of nested calls have been consumed
              */
-            fprintf(gen->output_file, "    ; param %s\n", inst->op1);
-            fprintf(gen->output_file, "    mov rax, [%s]\n", inst->op1);
-            fprintf(gen->output_file, "    push rax\n\n");
+            mir_emit(gen->mir, "    ; param %s\n", inst->op1);
+            push_argument(gen, inst->op1);
             break;
 
         case TAC_CALL:
@@ -266,69 +1293,852 @@ void gen_tac_instruction(CodeGenerator* gen, TACInstruction* inst) {
              * inst->label = function name
              * inst->op1 = number of arguments
              */
-            fprintf(gen->output_file, "    ; %s = call %s, %s args\n",
+            mir_emit(gen->mir, "    ; %s = call %s, %s args\n",
                     inst->result, inst->label, inst->op1);
+            gen_save_split(gen);
 
-            /* Align stack to 16 bytes (required by System V AMD64) */
-            fprintf(gen->output_file, "    and rsp, -16      ; Align stack to 16 bytes\n");
+            /* Stack arguments are pushed last to first. The frame keeps rsp
+             * 16-byte aligned (required by System V AMD64), so only an odd
+             * number of them needs a pad word above them. */
+            int arg_count = atoi(inst->op1);
+            const char** args = pop_arguments(gen, &arg_count);
+            int on_stack = arg_count > X86_REG_ARGS ? arg_count - X86_REG_ARGS : 0;
+            int pad = on_stack % 2 != 0 ? 8 : 0;
+            if (pad) mir_emit(gen->mir, "    sub rsp, 8        ; Align stack to 16 bytes\n");
+            for (int a = arg_count - 1; a >= X86_REG_ARGS; a--) gen_push_argument(gen, args[a]);
+            gen_register_arguments(gen, args, arg_count - on_stack);
 
             /* Call the function */
-            fprintf(gen->output_file, "    call %s\n", inst->label);
+            mir_emit(gen->mir, "    call %s\n", inst->label);
 
-            /* Clean up stack (pop parameters) */
-            int arg_count = atoi(inst->op1);
-            if (arg_count > 0) {
-                fprintf(gen->output_file, "    add rsp, %d       ; Clean up %d args from stack\n",
-                        arg_count * 8, arg_count);
+            /* Clean up stack (pop stack arguments) */
+            if (on_stack > 0) {
+                mir_emit(gen->mir, "    add rsp, %d       ; Clean up %d args from stack\n",
+                        on_stack * 8 + pad, on_stack);
             }
+            gen_restore_split(gen);
 
             /* Store return value (in rax) to result */
-            fprintf(gen->output_file, "    mov [%s], rax     ; Store return value\n\n",
-                    inst->result);
+            mir_emit(gen->mir, "    ; Store return value\n");
+            gen_store(gen, inst->result, "rax");
+            mir_emit(gen->mir, "\n");
             break;
 
         case TAC_RETURN:
             /* Return statement: return value */
-            fprintf(gen->output_file, "    ; return %s\n", inst->op1);
-            fprintf(gen->output_file, "    mov rax, [%s]     ; Load return value\n", inst->op1);
-            fprintf(gen->output_file, "    mov rsp, rbp      ; Function epilogue\n");
-            fprintf(gen->output_file, "    pop rbp\n");
-            fprintf(gen->output_file, "    ret\n\n");
+            mir_emit(gen->mir, "    ; return %s\n", inst->op1);
+            gen_load(gen, "rax", inst->op1);
+            gen_function_exit(gen);
+            mir_emit(gen->mir, "    ret\n\n");
             break;
 
         case TAC_RETURN_VOID:
             /* Return from void function */
-            fprintf(gen->output_file, "    ; return (void)\n");
-            fprintf(gen->output_file, "    mov rsp, rbp      ; Function epilogue\n");
-            fprintf(gen->output_file, "    pop rbp\n");
-            fprintf(gen->output_file, "    ret\n\n");
+            mir_emit(gen->mir, "    ; return (void)\n");
+            gen_function_exit(gen);
+            mir_emit(gen->mir, "    ret\n\n");
             break;
 
         default:
-            fprintf(gen->output_file, "    ; Unknown TAC instruction\n\n");
+            mir_emit(gen->mir, "    ; Unknown TAC instruction\n\n");
             break;
     }
 }
 
+/* ============================================================ */
+/* INSTRUCTION SELECTION (tree patterns, see isel.h)             */
+/* ============================================================ */
+
+/* Nonterminals of the x86-64 grammar. stmt is the goal; reg is a
+ * register the tree may overwrite; r is any register (also the home of a
+ * value kept in one); mem is the memory home of a value; imm is a
+ * literal that fits in a sign-extended 32-bit immediate; addr is an
+ * address expression lea can compute in one instruction. */
+enum { NT_STMT, NT_REG, NT_R, NT_MEM, NT_IMM, NT_ADDR, X86_NUM_NONTERMS };
+static const char* const x86_nonterms[X86_NUM_NONTERMS] = { "stmt", "reg", "r", "mem", "imm", "addr" };
+
+/* Helper: Element size lea can scale an index by */
+static int is_index_scale(long long c) {
+    return c == 2 || c == 4 || c == 8;
+}
+
+/* Helper: Multiplier lea computes from one register: x + x*2/4/8 or x*2/4/8 */
+static int is_lea_multiplier(long long c) {
+    return c == 2 || c == 3 || c == 4 || c == 5 || c == 8 || c == 9;
+}
+
+/* Rule predicates: 'node' is where the pattern matched */
+static int p_in_register(IselNode* node, void* context) {
+    return in_register((CodeGenerator*)context, node->name);
+}
+
+static int p_in_memory(IselNode* node, void* context) {
+    return !in_register((CodeGenerator*)context, node->name);
+}
+
+static int p_imm32(IselNode* node, void* context) {
+    return fits_imm32(node->value);
+}
+
+static int p_negated_imm32(IselNode* node, void* context) {
+    return fits_imm32(-node->kids[1]->value);
+}
+
+static int p_scaled_right(IselNode* node, void* context) {
+    return is_index_scale(node->kids[1]->kids[1]->value);
+}
+
+static int p_scaled_left(IselNode* node, void* context) {
+    return is_index_scale(node->kids[0]->kids[1]->value);
+}
+
+static int p_scaled_inner(IselNode* node, void* context) {
+    return is_index_scale(node->kids[0]->kids[1]->kids[1]->value);
+}
+
+static int p_lea_multiplier(IselNode* node, void* context) {
+    return is_lea_multiplier(node->kids[1]->value);
+}
+
+static int p_power_of_two(IselNode* node, void* context) {
+    return node->kids[1]->value > 0 && power_of_two_shift(node->kids[1]->value, 64) > 0;
+}
+
+static int p_zero_right(IselNode* node, void* context) {
+    return node->kids[1]->value == 0;
+}
+
+static int p_zero_left(IselNode* node, void* context) {
+    return node->kids[0]->value == 0;
+}
+
+static int p_branch_on_zero(IselNode* node, void* context) {
+    return node->kids[0]->kids[1]->value == 0;
+}
+
+/* ELEMENT(...): array element addressed straight from its label or
+ * frame slot, or (PIE globals) from a register loaded with its address */
+static int p_element_direct(IselNode* node, void* context) {
+    return !needs_array_base((CodeGenerator*)context, node->name);
+}
+
+static int p_element_based(IselNode* node, void* context) {
+    return needs_array_base((CodeGenerator*)context, node->name);
+}
+
+/* Helper: Does index 'c' of an element fold into a displacement? */
+static int element_displacement_fits(CodeGenerator* gen, IselNode* element, long long c) {
+    FrameSlot* slot = frame_slot(gen->frame, element->name);
+    if (!fits_imm32(c)) return 0;
+    return fits_imm32(c * element->value + (slot ? slot->offset : 0));
+}
+
+static int p_element_constant(IselNode* node, void* context) {
+    return element_displacement_fits((CodeGenerator*)context, node, node->kids[0]->value);
+}
+
+static int p_element_direct_add(IselNode* node, void* context) {
+    return p_element_direct(node, context) &&
+           element_displacement_fits((CodeGenerator*)context, node, node->kids[0]->kids[1]->value);
+}
+
+static int p_element_direct_sub(IselNode* node, void* context) {
+    return p_element_direct(node, context) &&
+           element_displacement_fits((CodeGenerator*)context, node, -node->kids[0]->kids[1]->value);
+}
+
+static int p_element_based_add(IselNode* node, void* context) {
+    return p_element_based(node, context) &&
+           element_displacement_fits((CodeGenerator*)context, node, node->kids[0]->kids[1]->value);
+}
+
+static int p_element_based_sub(IselNode* node, void* context) {
+    return p_element_based(node, context) &&
+           element_displacement_fits((CodeGenerator*)context, node, -node->kids[0]->kids[1]->value);
+}
+
+/* SET(x, v op y) with v where x goes (x itself, or a value dying in x's
+ * register): the destination is updated in place */
+static int p_updates_dst(IselNode* node, void* context) {
+    CodeGenerator* gen = (CodeGenerator*)context;
+    char dst[128];
+    snprintf(dst, sizeof(dst), "%s", get_location(gen, node->name));
+    return strcmp(get_location(gen, node->kids[0]->kids[0]->name), dst) == 0;
+}
+
+/* ... and may take a memory source (the destination is a register) */
+static int p_updates_dst_register(IselNode* node, void* context) {
+    return p_updates_dst(node, context) && in_register((CodeGenerator*)context, node->name);
+}
+
+/* The x86-64 grammar. Costs count instructions; on equal cost the rule
+ * listed first wins. */
+enum {
+    X86_R_VALUE, X86_MEM_VALUE, X86_IMM_CONST, X86_R_REG,
+    X86_REG_R, X86_REG_MEM, X86_REG_CONST, X86_REG_ADDR,
+    X86_ADDR_ADD, X86_ADDR_ADD_IMM, X86_ADDR_SUB_IMM, X86_ADDR_INDEX, X86_ADDR_INDEX_LEFT,
+    X86_ADDR_ADD_ADD_IMM, X86_ADDR_INDEX_ADD_IMM, X86_ADDR_INDEX_IMM, X86_ADDR_MULTIPLY,
+    X86_MEM_ELEMENT, X86_MEM_ELEMENT_ADD, X86_MEM_ELEMENT_SUB, X86_MEM_ELEMENT_CONST,
+    X86_MEM_ELEMENT_BASED, X86_MEM_ELEMENT_BASED_ADD, X86_MEM_ELEMENT_BASED_SUB,
+    X86_REG_ADD_IMM, X86_REG_ADD, X86_REG_ADD_MEM, X86_REG_ADD_SWAP, X86_REG_ADD_MEM_SWAP,
+    X86_REG_NEG, X86_REG_SUB_IMM, X86_REG_SUB, X86_REG_SUB_MEM,
+    X86_REG_SHL, X86_REG_MUL_IMM, X86_REG_MUL_MEM_IMM, X86_REG_MUL, X86_REG_MUL_MEM,
+    X86_REG_MUL_SWAP, X86_REG_MUL_MEM_SWAP,
+    X86_REG_TEST, X86_REG_CMP_IMM, X86_REG_CMP, X86_REG_CMP_MEM, X86_REG_CMP_MEM_IMM, X86_REG_CMP_MEM_R,
+    X86_SET, X86_SET_R, X86_SET_IMM,
+    X86_SET_ADD_IMM, X86_SET_ADD, X86_SET_ADD_MEM, X86_SET_SUB_IMM, X86_SET_SUB, X86_SET_SUB_MEM,
+    X86_SET_MUL, X86_SET_MUL_MEM, X86_STORE, X86_STORE_IMM,
+    X86_IF_FALSE, X86_IF_FALSE_MEM,
+    X86_BRANCH_TEST, X86_BRANCH_CMP_IMM, X86_BRANCH_CMP, X86_BRANCH_CMP_MEM,
+    X86_BRANCH_CMP_MEM_IMM, X86_BRANCH_CMP_MEM_R,
+    X86_NUM_RULES
+};
+
+static const IselRule x86_rules[X86_NUM_RULES] = {
+    /* Leaves and chain rules */
+    [X86_R_VALUE]          = { "r",    "VALUE",                   0, p_in_register },
+    [X86_MEM_VALUE]        = { "mem",  "VALUE",                   0, p_in_memory },
+    [X86_IMM_CONST]        = { "imm",  "CONST",                   0, p_imm32 },
+    [X86_R_REG]            = { "r",    "reg",                     0, NULL },
+    [X86_REG_R]            = { "reg",  "r",                       1, NULL },      /* mov reg, r */
+    [X86_REG_MEM]          = { "reg",  "mem",                     1, NULL },      /* mov reg, [m] */
+    [X86_REG_CONST]        = { "reg",  "CONST",                   1, NULL },      /* mov reg, c */
+    [X86_REG_ADDR]         = { "reg",  "addr",                    1, NULL },      /* lea reg, [addr] */
+
+    /* Address arithmetic: base + index*scale + displacement */
+    [X86_ADDR_ADD]         = { "addr", "ADD(r,r)",                0, NULL },
+    [X86_ADDR_ADD_IMM]     = { "addr", "ADD(r,imm)",              0, NULL },
+    [X86_ADDR_SUB_IMM]     = { "addr", "SUB(r,imm)",              0, p_negated_imm32 },
+    [X86_ADDR_INDEX]       = { "addr", "ADD(r,MUL(r,CONST))",     0, p_scaled_right },
+    [X86_ADDR_INDEX_LEFT]  = { "addr", "ADD(MUL(r,CONST),r)",     0, p_scaled_left },
+    [X86_ADDR_ADD_ADD_IMM] = { "addr", "ADD(ADD(r,r),imm)",       0, NULL },
+    [X86_ADDR_INDEX_ADD_IMM] = { "addr", "ADD(ADD(r,MUL(r,CONST)),imm)", 0, p_scaled_inner },
+    [X86_ADDR_INDEX_IMM]   = { "addr", "ADD(MUL(r,CONST),imm)",   0, p_scaled_left },
+    [X86_ADDR_MULTIPLY]    = { "addr", "MUL(r,CONST)",            0, p_lea_multiplier },
+
+    /* Array elements: [base + index*8 + displacement], with a constant
+     * index or an index +/- constant folded into the displacement. PIE
+     * code first loads a global array's address (rip-relative operands
+     * take no index register). */
+    [X86_MEM_ELEMENT]      = { "mem",  "ELEMENT(r)",              0, p_element_direct },
+    [X86_MEM_ELEMENT_ADD]  = { "mem",  "ELEMENT(ADD(r,imm))",     0, p_element_direct_add },
+    [X86_MEM_ELEMENT_SUB]  = { "mem",  "ELEMENT(SUB(r,imm))",     0, p_element_direct_sub },
+    [X86_MEM_ELEMENT_CONST] = { "mem", "ELEMENT(CONST)",          0, p_element_constant },
+    [X86_MEM_ELEMENT_BASED] = { "mem", "ELEMENT(r)",              1, p_element_based },     /* lea base, [a] */
+    [X86_MEM_ELEMENT_BASED_ADD] = { "mem", "ELEMENT(ADD(r,imm))", 1, p_element_based_add },
+    [X86_MEM_ELEMENT_BASED_SUB] = { "mem", "ELEMENT(SUB(r,imm))", 1, p_element_based_sub },
+
+    /* Two-address arithmetic: the reg operand is overwritten */
+    [X86_REG_ADD_IMM]      = { "reg",  "ADD(reg,imm)",            1, NULL },
+    [X86_REG_ADD]          = { "reg",  "ADD(reg,r)",              1, NULL },
+    [X86_REG_ADD_MEM]      = { "reg",  "ADD(reg,mem)",            1, NULL },
+    [X86_REG_ADD_SWAP]     = { "reg",  "ADD(r,reg)",              1, NULL },
+    [X86_REG_ADD_MEM_SWAP] = { "reg",  "ADD(mem,reg)",            1, NULL },
+    [X86_REG_NEG]          = { "reg",  "SUB(CONST,reg)",          1, p_zero_left },
+    [X86_REG_SUB_IMM]      = { "reg",  "SUB(reg,imm)",            1, NULL },
+    [X86_REG_SUB]          = { "reg",  "SUB(reg,r)",              1, NULL },
+    [X86_REG_SUB_MEM]      = { "reg",  "SUB(reg,mem)",            1, NULL },
+    [X86_REG_SHL]          = { "reg",  "MUL(reg,CONST)",          1, p_power_of_two },
+    [X86_REG_MUL_IMM]      = { "reg",  "MUL(r,imm)",              1, NULL },      /* imul reg, r, c */
+    [X86_REG_MUL_MEM_IMM]  = { "reg",  "MUL(mem,imm)",            1, NULL },
+    [X86_REG_MUL]          = { "reg",  "MUL(reg,r)",              1, NULL },
+    [X86_REG_MUL_MEM]      = { "reg",  "MUL(reg,mem)",            1, NULL },
+    [X86_REG_MUL_SWAP]     = { "reg",  "MUL(r,reg)",              1, NULL },
+    [X86_REG_MUL_MEM_SWAP] = { "reg",  "MUL(mem,reg)",            1, NULL },
+
+    /* Compares: cmp/test, setcc, movzx */
+    [X86_REG_TEST]         = { "reg",  "RELOP(r,CONST)",          3, p_zero_right },
+    [X86_REG_CMP_IMM]      = { "reg",  "RELOP(r,imm)",            3, NULL },
+    [X86_REG_CMP]          = { "reg",  "RELOP(r,r)",              3, NULL },
+    [X86_REG_CMP_MEM]      = { "reg",  "RELOP(r,mem)",            3, NULL },
+    [X86_REG_CMP_MEM_IMM]  = { "reg",  "RELOP(mem,imm)",          3, NULL },
+    [X86_REG_CMP_MEM_R]    = { "reg",  "RELOP(mem,r)",            3, NULL },
+
+    /* Roots */
+    [X86_SET]              = { "stmt", "SET(reg)",                1, NULL },      /* 0 when built in place */
+    [X86_SET_R]            = { "stmt", "SET(r)",                  1, NULL },
+    [X86_SET_IMM]          = { "stmt", "SET(imm)",                1, NULL },
+    [X86_SET_ADD_IMM]      = { "stmt", "SET(ADD(VALUE,imm))",     1, p_updates_dst },
+    [X86_SET_ADD]          = { "stmt", "SET(ADD(VALUE,r))",       1, p_updates_dst },
+    [X86_SET_ADD_MEM]      = { "stmt", "SET(ADD(VALUE,mem))",     1, p_updates_dst_register },
+    [X86_SET_SUB_IMM]      = { "stmt", "SET(SUB(VALUE,imm))",     1, p_updates_dst },
+    [X86_SET_SUB]          = { "stmt", "SET(SUB(VALUE,r))",       1, p_updates_dst },
+    [X86_SET_SUB_MEM]      = { "stmt", "SET(SUB(VALUE,mem))",     1, p_updates_dst_register },
+    [X86_SET_MUL]          = { "stmt", "SET(MUL(VALUE,r))",       1, p_updates_dst_register },
+    [X86_SET_MUL_MEM]      = { "stmt", "SET(MUL(VALUE,mem))",     1, p_updates_dst_register },
+    [X86_STORE]            = { "stmt", "STORE(mem,r)",            1, NULL },
+    [X86_STORE_IMM]        = { "stmt", "STORE(mem,imm)",          1, NULL },
+    [X86_IF_FALSE]         = { "stmt", "IF_FALSE(r)",             2, NULL },      /* test r, r; je */
+    [X86_IF_FALSE_MEM]     = { "stmt", "IF_FALSE(mem)",           2, NULL },      /* cmp [m], 0; je */
+
+    /* Compare and branch: the flags of a compare only a branch reads go
+     * straight to the jump, "cmp r, c; jge L" */
+    [X86_BRANCH_TEST]      = { "stmt", "IF_FALSE(RELOP(r,CONST))", 2, p_branch_on_zero },
+    [X86_BRANCH_CMP_IMM]   = { "stmt", "IF_FALSE(RELOP(r,imm))",  2, NULL },
+    [X86_BRANCH_CMP]       = { "stmt", "IF_FALSE(RELOP(r,r))",    2, NULL },
+    [X86_BRANCH_CMP_MEM]   = { "stmt", "IF_FALSE(RELOP(r,mem))",  2, NULL },
+    [X86_BRANCH_CMP_MEM_IMM] = { "stmt", "IF_FALSE(RELOP(mem,imm))", 2, NULL },
+    [X86_BRANCH_CMP_MEM_R] = { "stmt", "IF_FALSE(RELOP(mem,r))",  2, NULL },
+};
+
+/* Scratch registers trees are evaluated in (never handed out by the
+ * register allocator) */
+#define X86_NUM_SCRATCH 4
+static const char* const x86_scratch[X86_NUM_SCRATCH] = { "rax", "rcx", "rdx", "r11" };
+
+/* State of the reducer for one tree */
+typedef struct {
+    CodeGenerator* gen;
+    int busy;                   /* Scratch registers holding values (mask) */
+} Tiler;
+
+/* Helper: Low byte of a 64-bit register (setcc operand) */
+static const char* low_byte(const char* reg) {
+    static const char* const names[][2] = {
+        { "rax", "al" }, { "rbx", "bl" }, { "rcx", "cl" }, { "rdx", "dl" },
+        { "rsi", "sil" }, { "rdi", "dil" }, { "r8", "r8b" }, { "r9", "r9b" },
+        { "r10", "r10b" }, { "r11", "r11b" }, { "r12", "r12b" }, { "r13", "r13b" },
+        { "r14", "r14b" }, { "r15", "r15b" }
+    };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (strcmp(names[i][0], reg) == 0) return names[i][1];
+    }
+    return "al";
+}
+
+/* Helper: setcc suffix of a comparison */
+static const char* condition_code(const char* relop) {
+    if (strcmp(relop, "<") == 0) return "l";
+    if (strcmp(relop, ">") == 0) return "g";
+    if (strcmp(relop, "<=") == 0) return "le";
+    if (strcmp(relop, ">=") == 0) return "ge";
+    if (strcmp(relop, "==") == 0) return "e";
+    return "ne";
+}
+
+/* Helper: Size prefix an instruction needs when neither operand is a
+ * register ("add qword [x], 1") */
+static const char* operand_size(const char* dst, const char* src) {
+    return dst[0] == '[' && is_number(src) ? "qword " : "";
+}
+
+/* Helper: Register for a result: the one the caller wants, or a free
+ * scratch register */
+static const char* tiler_register(Tiler* t, const char* want, int* held) {
+    if (want) {
+        *held = 0;
+        return want;
+    }
+    for (int s = 0; s < X86_NUM_SCRATCH; s++) {
+        if (!(t->busy & (1 << s))) {
+            t->busy |= 1 << s;
+            *held = 1 << s;
+            return x86_scratch[s];
+        }
+    }
+    fprintf(stderr, "Fatal Error: instruction selection ran out of scratch registers\n");
+    exit(1);
+}
+
+/* Helper: Address expression of index * c for a lea multiplier */
+static void format_multiply(char* address, size_t size, const char* index, long long c) {
+    if (c == 2) snprintf(address, size, "%s + %s", index, index);
+    else if (c % 2 == 1) snprintf(address, size, "%s + %s*%lld", index, index, c - 1);
+    else snprintf(address, size, "%s*%lld", index, c);
+}
+
+/* Helper: Memory operand of ELEMENT 'node' indexed by register 'index'
+ * plus 'c' elements; a global array in PIE code gets its address in a
+ * scratch register, added to *held */
+static const char* gen_element_operand(Tiler* t, IselNode* node, const char* index, long long c, int* held) {
+    const char* base = NULL;
+    if (needs_array_base(t->gen, node->name)) {
+        int base_held;
+        base = tiler_register(t, NULL, &base_held);
+        *held |= base_held;
+        mir_emit(t->gen->mir, "    lea %s, [%s]      ; Array base (rip-relative)\n", base, node->name);
+    }
+    return array_operand(t->gen, node->name, index, (int)node->value, c * node->value, base);
+}
+
+/* Helper: Emit the rule chosen for deriving 'nonterm' at 'node', after
+ * its operands; leaves the result's location in node->location. 'want'
+ * is the register a reg result should be built in (NULL: any scratch). */
+static void reduce_tree(Tiler* t, IselNode* node, int nonterm, const char* want) {
+    MirProgram* out = t->gen->mir;
+    int rule = node->rule[nonterm];
+    IselNode* kids[ISEL_MAX_KIDS];
+    int nonterms[ISEL_MAX_KIDS];
+    int count = isel_rule_kids(t->gen->grammar, rule, node, kids, nonterms);
+
+    /* Operands needing more registers first (Sethi-Ullman); the first
+     * reg operand is built where the result goes */
+    char loc[ISEL_MAX_KIDS][ISEL_LOCATION_SIZE];
+    int held[ISEL_MAX_KIDS];
+    int done[ISEL_MAX_KIDS] = { 0 };
+    int reg_kid = -1;
+    for (int k = 0; k < count; k++) {
+        if (nonterms[k] == NT_REG && reg_kid < 0) reg_kid = k;
+    }
+    for (int n = 0; n < count; n++) {
+        int k = -1;
+        for (int j = 0; j < count; j++) {
+            if (!done[j] && (k < 0 || kids[j]->need > kids[k]->need)) k = j;
+        }
+        done[k] = 1;
+        reduce_tree(t, kids[k], nonterms[k], k == reg_kid ? want : NULL);
+        snprintf(loc[k], sizeof(loc[k]), "%s", kids[k]->location);
+        held[k] = kids[k]->held;
+    }
+
+    /* Room for two operands, a scale and a displacement */
+    char result[2 * ISEL_LOCATION_SIZE + 48];
+    int result_held = 0;
+    const char* dst = NULL;
+    int other = reg_kid == 0 ? 1 : 0;
+
+    switch (rule) {
+        case X86_R_VALUE:
+        case X86_MEM_VALUE:
+            snprintf(result, sizeof(result), "%s", get_location(t->gen, node->name));
+            break;
+
+        case X86_IMM_CONST:
+            snprintf(result, sizeof(result), "%lld", node->value);
+            break;
+
+        case X86_R_REG:
+            snprintf(result, sizeof(result), "%s", loc[0]);
+            result_held = held[0];
+            break;
+
+        case X86_REG_R:
+        case X86_REG_MEM:
+            t->busy &= ~held[0];
+            dst = tiler_register(t, want, &result_held);
+            if (strcmp(dst, loc[0]) != 0) mir_emit(out, "    mov %s, %s\n", dst, loc[0]);
+            snprintf(result, sizeof(result), "%s", dst);
+            break;
+
+        case X86_REG_CONST:
+            dst = tiler_register(t, want, &result_held);
+            mir_emit(out, "    mov %s, %lld\n", dst, node->value);
+            snprintf(result, sizeof(result), "%s", dst);
+            break;
+
+        case X86_REG_ADDR:
+            t->busy &= ~held[0];
+            dst = tiler_register(t, want, &result_held);
+            mir_emit(out, "    lea %s, [%s]\n", dst, loc[0]);
+            snprintf(result, sizeof(result), "%s", dst);
+            break;
+
+        /* Address expressions hold their registers until the lea */
+        case X86_ADDR_ADD:
+            snprintf(result, sizeof(result), "%s + %s", loc[0], loc[1]);
+            result_held = held[0] | held[1];
+            break;
+        case X86_ADDR_ADD_IMM:
+            snprintf(result, sizeof(result), "%s", loc[0]);
+            append_displacement(result, sizeof(result), node->kids[1]->value);
+            result_held = held[0];
+            break;
+        case X86_ADDR_SUB_IMM:
+            snprintf(result, sizeof(result), "%s", loc[0]);
+            append_displacement(result, sizeof(result), -node->kids[1]->value);
+            result_held = held[0];
+            break;
+        case X86_ADDR_INDEX:
+            snprintf(result, sizeof(result), "%s + %s*%lld", loc[0], loc[1], node->kids[1]->kids[1]->value);
+            result_held = held[0] | held[1];
+            break;
+        case X86_ADDR_INDEX_LEFT:
+            snprintf(result, sizeof(result), "%s + %s*%lld", loc[1], loc[0], node->kids[0]->kids[1]->value);
+            result_held = held[0] | held[1];
+            break;
+        case X86_ADDR_ADD_ADD_IMM:
+            snprintf(result, sizeof(result), "%s + %s", loc[0], loc[1]);
+            append_displacement(result, sizeof(result), node->kids[1]->value);
+            result_held = held[0] | held[1];
+            break;
+        case X86_ADDR_INDEX_ADD_IMM:
+            snprintf(result, sizeof(result), "%s + %s*%lld", loc[0], loc[1], node->kids[0]->kids[1]->kids[1]->value);
+            append_displacement(result, sizeof(result), node->kids[1]->value);
+            result_held = held[0] | held[1];
+            break;
+        case X86_ADDR_INDEX_IMM:
+            snprintf(result, sizeof(result), "%s*%lld", loc[0], node->kids[0]->kids[1]->value);
+            append_displacement(result, sizeof(result), node->kids[1]->value);
+            result_held = held[0];
+            break;
+        case X86_ADDR_MULTIPLY:
+            format_multiply(result, sizeof(result), loc[0], node->kids[1]->value);
+            result_held = held[0];
+            break;
+
+        /* Array elements hold their index (and base) registers until
+         * the memory operand is used */
+        case X86_MEM_ELEMENT:
+        case X86_MEM_ELEMENT_BASED:
+            snprintf(result, sizeof(result), "%s", gen_element_operand(t, node, loc[0], 0, &held[0]));
+            result_held = held[0];
+            break;
+        case X86_MEM_ELEMENT_ADD:
+        case X86_MEM_ELEMENT_BASED_ADD:
+            snprintf(result, sizeof(result), "%s",
+                     gen_element_operand(t, node, loc[0], node->kids[0]->kids[1]->value, &held[0]));
+            result_held = held[0];
+            break;
+        case X86_MEM_ELEMENT_SUB:
+        case X86_MEM_ELEMENT_BASED_SUB:
+            snprintf(result, sizeof(result), "%s",
+                     gen_element_operand(t, node, loc[0], -node->kids[0]->kids[1]->value, &held[0]));
+            result_held = held[0];
+            break;
+        case X86_MEM_ELEMENT_CONST:
+            snprintf(result, sizeof(result), "%s",
+                     array_operand(t->gen, node->name, NULL, 1, node->kids[0]->value * node->value, NULL));
+            break;
+
+        /* reg op= operand */
+        case X86_REG_ADD_IMM: case X86_REG_ADD: case X86_REG_ADD_MEM:
+        case X86_REG_ADD_SWAP: case X86_REG_ADD_MEM_SWAP:
+        case X86_REG_SUB_IMM: case X86_REG_SUB: case X86_REG_SUB_MEM:
+        case X86_REG_MUL: case X86_REG_MUL_MEM: case X86_REG_MUL_SWAP: case X86_REG_MUL_MEM_SWAP:
+            mir_emit(out, "    %s %s, %s\n",
+                    node->op == ISEL_ADD ? "add" : node->op == ISEL_SUB ? "sub" : "imul",
+                    loc[reg_kid], loc[other]);
+            t->busy &= ~held[other];
+            snprintf(result, sizeof(result), "%s", loc[reg_kid]);
+            result_held = held[reg_kid];
+            break;
+
+        case X86_REG_NEG:
+            mir_emit(out, "    neg %s\n", loc[0]);
+            snprintf(result, sizeof(result), "%s", loc[0]);
+            result_held = held[0];
+            break;
+
+        case X86_REG_SHL:
+            mir_emit(out, "    shl %s, %d\n", loc[0], power_of_two_shift(node->kids[1]->value, 64));
+            snprintf(result, sizeof(result), "%s", loc[0]);
+            result_held = held[0];
+            break;
+
+        case X86_REG_MUL_IMM:
+        case X86_REG_MUL_MEM_IMM:
+            t->busy &= ~(held[0] | held[1]);
+            dst = tiler_register(t, want, &result_held);
+            mir_emit(out, "    imul %s, %s, %s\n", dst, loc[0], loc[1]);
+            snprintf(result, sizeof(result), "%s", dst);
+            break;
+
+        /* Compare, then materialize the flag as 0 or 1 */
+        case X86_REG_TEST: case X86_REG_CMP_IMM: case X86_REG_CMP: case X86_REG_CMP_MEM:
+        case X86_REG_CMP_MEM_IMM: case X86_REG_CMP_MEM_R:
+            if (rule == X86_REG_TEST) mir_emit(out, "    test %s, %s\n", loc[0], loc[0]);
+            else mir_emit(out, "    cmp %s%s, %s\n", operand_size(loc[0], loc[1]), loc[0], loc[1]);
+            t->busy &= ~(held[0] | (count > 1 ? held[1] : 0));
+            dst = tiler_register(t, want, &result_held);
+            mir_emit(out, "    set%s %s\n", condition_code(node->name), low_byte(dst));
+            mir_emit(out, "    movzx %s, %s\n", dst, low_byte(dst));
+            snprintf(result, sizeof(result), "%s", dst);
+            break;
+
+        /* Roots */
+        case X86_SET:
+        case X86_SET_R:
+        case X86_SET_IMM:
+            dst = get_location(t->gen, node->name);
+            if (strcmp(dst, loc[0]) != 0) mir_emit(out, "    mov %s%s, %s\n", operand_size(dst, loc[0]), dst, loc[0]);
+            result[0] = '\0';
+            break;
+
+        case X86_SET_ADD_IMM: case X86_SET_ADD: case X86_SET_ADD_MEM:
+        case X86_SET_SUB_IMM: case X86_SET_SUB: case X86_SET_SUB_MEM:
+        case X86_SET_MUL: case X86_SET_MUL_MEM:
+            dst = get_location(t->gen, node->name);
+            mir_emit(out, "    %s %s%s, %s\n",
+                    node->kids[0]->op == ISEL_ADD ? "add" : node->kids[0]->op == ISEL_SUB ? "sub" : "imul",
+                    operand_size(dst, loc[0]), dst, loc[0]);
+            result[0] = '\0';
+            break;
+
+        case X86_STORE:
+        case X86_STORE_IMM:
+            mir_emit(out, "    mov %s%s, %s\n", operand_size(loc[0], loc[1]), loc[0], loc[1]);
+            result[0] = '\0';
+            break;
+
+        case X86_IF_FALSE:
+            mir_emit(out, "    test %s, %s\n", loc[0], loc[0]);
+            mir_emit(out, "    je %s         ; Jump if zero (false)\n", node->name);
+            result[0] = '\0';
+            break;
+
+        case X86_IF_FALSE_MEM:
+            mir_emit(out, "    cmp qword %s, 0\n", loc[0]);
+            mir_emit(out, "    je %s         ; Jump if zero (false)\n", node->name);
+            result[0] = '\0';
+            break;
+
+        case X86_BRANCH_TEST: case X86_BRANCH_CMP_IMM: case X86_BRANCH_CMP: case X86_BRANCH_CMP_MEM:
+        case X86_BRANCH_CMP_MEM_IMM: case X86_BRANCH_CMP_MEM_R:
+            if (rule == X86_BRANCH_TEST) mir_emit(out, "    test %s, %s\n", loc[0], loc[0]);
+            else mir_emit(out, "    cmp %s%s, %s\n", operand_size(loc[0], loc[1]), loc[0], loc[1]);
+            mir_emit(out, "    %s %s         ; Jump unless %s\n",
+                    jump_unless(node->kids[0]->name), node->name, node->kids[0]->name);
+            result[0] = '\0';
+            break;
+
+        default:
+            fprintf(stderr, "Fatal Error: instruction selection rule %d has no emitter\n", rule);
+            exit(1);
+    }
+
+    /* A cut location would be a different operand */
+    size_t length = strlen(result);
+    if (length >= sizeof(node->location)) {
+        fprintf(stderr, "Fatal Error: operand '%s' is too long for instruction selection\n", result);
+        exit(1);
+    }
+    memcpy(node->location, result, length + 1);
+    node->held = result_held;
+}
+
+/* Helper: Does a tree read a value from 'location'? */
+static int tree_reads(CodeGenerator* gen, IselNode* node, const char* location) {
+    if (!node) return 0;
+    if (node->op == ISEL_VALUE) return strcmp(get_location(gen, node->name), location) == 0;
+    return tree_reads(gen, node->kids[0], location) || tree_reads(gen, node->kids[1], location);
+}
+
+/* Helper: Emit the cheapest cover of an expression tree */
+static void gen_tree(CodeGenerator* gen, IselNode* root) {
+    char text[256];
+    format_isel_tree(root, text, sizeof(text));
+    mir_emit(gen->mir, "    ; %s\n", text);
+
+    /* x = y + x: the operand living where x goes moves left, where the
+     * update-in-place patterns look for it */
+    IselNode* value = root->kids[0];
+    if (root->op == ISEL_SET && (value->op == ISEL_ADD || value->op == ISEL_MUL) &&
+        value->kids[1]->op == ISEL_VALUE && !tree_reads(gen, value->kids[0], get_location(gen, root->name)) &&
+        tree_reads(gen, value->kids[1], get_location(gen, root->name))) {
+        IselNode* swap = value->kids[0];
+        value->kids[0] = value->kids[1];
+        value->kids[1] = swap;
+    }
+    if (label_isel_tree(gen->grammar, root, gen, &gen->isel_stats) < 0) {
+        fprintf(stderr, "Fatal Error: no instruction pattern covers '%s'\n", text);
+        exit(1);
+    }
+
+    /* A destination register the tree does not read can hold the
+     * partial results, which saves the final move */
+    const char* want = NULL;
+    if (root->op == ISEL_SET && in_register(gen, root->name)) {
+        const char* dst = get_location(gen, root->name);
+        if (!tree_reads(gen, root->kids[0], dst)) want = dst;
+    }
+
+    Tiler tiler = { gen, 0 };
+    reduce_tree(&tiler, root, NT_STMT, want);
+    mir_emit(gen->mir, "\n");
+}
+
+/* Helper: Can control run past the end of a function? An int function
+ * without a final return then returns 0. */
+static int falls_through(TACInstruction* last) {
+    if (!last) return 0;
+    return last->opcode != TAC_RETURN && last->opcode != TAC_RETURN_VOID &&
+           last->opcode != TAC_GOTO && last->opcode != TAC_FUNCTION_LABEL;
+}
+
+/* A param waiting for its call */
+typedef struct {
+    TACInstruction* param;      /* The param */
+    TACInstruction* prev;       /* Instruction before it */
+    int stale;                  /* Its operand may change before the call */
+} PendingParam;
+
+/* Helper: Arguments are read at the call rather than at their param, so
+ * a param whose operand changes in between (redefined, or a global a
+ * nested call may assign) passes a copy taken at the param instead */
+static void snapshot_arguments(CodeGenerator* gen, TACCode* tac) {
+    PendingParam* pending = NULL;
+    int top = 0;
+    int capacity = 0;
+    const char* function = "global";
+    TACInstruction* prev = NULL;
+
+    for (TACInstruction* inst = tac->head; inst; prev = inst, inst = inst->next) {
+        if (inst->opcode == TAC_FUNCTION_LABEL) {
+            function = inst->label;
+            top = 0;
+            continue;
+        }
+        if (inst->opcode == TAC_PARAM && inst->op1) {
+            if (top >= capacity) {
+                capacity = capacity ? capacity * 2 : 16;
+                pending = (PendingParam*)safe_realloc(pending, capacity * sizeof(PendingParam), "code generator");
+            }
+            pending[top].param = inst;
+            pending[top].prev = prev;
+            pending[top].stale = 0;
+            top++;
+            continue;
+        }
+
+        /* Params below the ones this call consumes wait across it */
+        int consumed = 0;
+        if (inst->opcode == TAC_CALL) {
+            consumed = atoi(inst->op1);
+            if (consumed > top) consumed = top;
+        }
+        const char* def = tac_def(inst);
+        for (int k = 0; k < top - consumed; k++) {
+            const char* arg = pending[k].param->op1;
+            if (def && strcmp(def, arg) == 0) pending[k].stale = 1;
+            if (inst->opcode == TAC_CALL && !is_number(arg) && !is_temp_name(arg)) {
+                Symbol* symbol = gen->symtab ? lookup_symbol_in_scope(gen->symtab, arg, function) : NULL;
+                if (!symbol || strcmp(symbol->scope, "global") == 0) pending[k].stale = 1;
+            }
+        }
+
+        for (; consumed > 0; consumed--) {
+            PendingParam* arg = &pending[--top];
+            if (!arg->stale || !arg->prev) continue;
+            char* copy = new_temp();
+            insert_tac_after(tac, arg->prev, create_tac_instruction(TAC_ASSIGN, copy, arg->param->op1, NULL, NULL));
+            free(arg->param->op1);
+            arg->param->op1 = copy;
+        }
+    }
+    free(pending);
+}
+
+/* Helper: Mark the entries of the functions and check routines in the
+ * encoded object (STT_FUNC symbols, and the functions of the perf map) */
+static void mark_functions(CodeGenerator* gen, TACCode* tac) {
+    for (TACInstruction* inst = tac->head; inst; inst = inst->next) {
+        if (inst->opcode == TAC_FUNCTION_LABEL) elf_function_symbol(gen->elf, inst->label);
+    }
+    for (int r = 0; gen->checked && r < 2; r++) elf_function_symbol(gen->elf, check_routines[r][0]);
+}
+
 /* Generate assembly code from TAC */
 void generate_assembly(CodeGenerator* gen, TACCode* tac) {
     printf("\n=============== CODE GENERATION STARTED ===================\n\n");
 
     /* Generate prologue */
     gen_prologue(gen);
+    snapshot_arguments(gen, tac);
+    if (gen->isel && !gen->grammar) {
+        gen->grammar = create_isel_grammar(x86_rules, X86_NUM_RULES, x86_nonterms, X86_NUM_NONTERMS);
+    }
 
     /* Generate code for each TAC instruction */
     TACInstruction* inst = tac->head;
+    TACInstruction* last = NULL;
     while (inst) {
-        gen_tac_instruction(gen, inst);
+        if (inst->opcode == TAC_FUNCTION_LABEL) {
+            if (falls_through(last)) {
+                mir_emit(gen->mir, "    ; End of function\n");
+                mir_emit(gen->mir, "    xor eax, eax\n");
+                gen_function_exit(gen);
+                mir_emit(gen->mir, "    ret\n");
+            }
+
+            /* Allocate the registers and lay out the frame of the next function */
+            free_register_allocation(gen->alloc);
+            free_frame_layout(gen->frame);
+            gen->alloc = NULL;
+            if (gen->regalloc) {
+                gen->alloc = allocate_registers(tac, inst, gen->symtab, &x86_registers,
+                                                     &gen->regalloc_stats);
+            }
+            RegisterAllocation* live = gen->alloc ? gen->alloc
+                                                  : compute_live_intervals(tac, inst, gen->symtab, &x86_registers);
+            gen->frame = build_frame_layout(inst, gen->symtab, live, &x86_frame, &gen->frame_stats);
+            if (live != gen->alloc) free_register_allocation(live);
+            free_isel_forest(gen->forest);
+            gen->forest = gen->isel ? build_isel_forest(inst, &gen->isel_stats) : NULL;
+            gen->position = 0;
+            gen->num_args = 0;
+        }
+
+        /* Tail call without stack arguments: load the argument registers,
+         * leave our frame and jump, so the callee returns straight to our
+         * caller */
+        if (inst->opcode == TAC_CALL && is_tail_call(inst) && atoi(inst->op1) <= X86_REG_ARGS) {
+            int arg_count = atoi(inst->op1);
+            const char** args = pop_arguments(gen, &arg_count);
+            mir_emit(gen->mir, "    ; tail call %s\n", inst->label);
+            gen_register_arguments(gen, args, arg_count);
+            gen_function_exit(gen);
+            mir_emit(gen->mir, "    jmp %s\n\n", inst->label);
+            last = inst->next;
+            inst = inst->next->next;
+            gen->position += 2;
+            continue;
+        }
+
+        /* Instructions folded into a tree are emitted with its root */
+        if (gen->forest && gen->forest->roots[gen->position]) {
+            gen_tree(gen, gen->forest->roots[gen->position]);
+        } else if (!gen->forest || !gen->forest->folded[gen->position]) {
+            gen_tac_instruction(gen, inst);
+        }
+        last = inst;
         inst = inst->next;
+        gen->position++;
     }
+    if (falls_through(last)) {
+        mir_emit(gen->mir, "    ; End of function\n");
+        mir_emit(gen->mir, "    xor eax, eax\n");
+        gen_function_exit(gen);
+        mir_emit(gen->mir, "    ret\n");
+    }
+    free_register_allocation(gen->alloc);
+    free_frame_layout(gen->frame);
+    free_isel_forest(gen->forest);
+    gen->alloc = NULL;
+    gen->frame = NULL;
+    gen->forest = NULL;
 
     /* Generate epilogue */
     gen_epilogue(gen);
+    build_mir_blocks(gen->mir);
+    if (gen->peephole) optimize_mir(gen->mir, &gen->peephole_stats);
+
+    /* Write the assembly, or encode the machine code into an object
+     * (written with --obj, run with --run) */
+    if (gen->object || gen->run) {
+        gen->elf = create_elf_object();
+        if (!encode_x86_object(gen->mir, gen->elf, &gen->encode_stats)) exit(1);
+        mark_functions(gen, tac);
+    }
+    if (gen->object || !gen->run) {
+        FILE* output_file = fopen(gen->output_filename, gen->object ? "wb" : "w");
+        if (!output_file) {
+            fprintf(stderr, "Fatal Error: Cannot open output file '%s'\n", gen->output_filename);
+            exit(1);
+        }
+        if (gen->object) write_elf_object(gen->elf, output_file);
+        else print_mir(gen->mir, output_file);
+        fclose(output_file);
+        printf(gen->object ? "Object file generated successfully\n" : "Assembly code generated successfully\n");
+        printf("Output file: %s\n", gen->output_filename);
+    } else {
+        printf("Machine code generated successfully (run in process)\n");
+    }
 
-    printf("Assembly code generated successfully\n");
-    printf("Output file: output.asm\n");
+    if (gen->regalloc) print_regalloc_stats(&gen->regalloc_stats);
+    print_frame_stats(&gen->frame_stats);
+    if (gen->isel) print_isel_stats(&gen->isel_stats);
+    if (gen->peephole) print_asmopt_stats(&gen->peephole_stats, gen->verbose);
+    if (gen->elf) print_x86_encode_stats(gen->elf, &gen->encode_stats);
 
     printf("\n=============== CODE GENERATION COMPLETE ==================\n\n");
 }
@@ -336,9 +2146,14 @@ void generate_assembly(CodeGenerator* gen, TACCode* tac) {
 /* Close and cleanup code generator */
 void close_code_generator(CodeGenerator* gen) {
     if (gen) {
-        if (gen->output_file) {
-            fclose(gen->output_file);
-        }
+        free(gen->output_filename);
+        free_elf_object(gen->elf);
+        free_mir(gen->mir);
+        free_register_allocation(gen->alloc);
+        free_frame_layout(gen->frame);
+        free_isel_forest(gen->forest);
+        free_isel_grammar(gen->grammar);
+        free(gen->args);
         free(gen);
     }
 }
@@ -3,7 +3,9 @@
  * CST-405 Compiler Project
  *
  * This file defines the code generation phase which translates
- * Three-Address Code (TAC) into target assembly code (x86-64).
+ * Three-Address Code (TAC) into target assembly code (x86-64), or
+ * encodes it straight into an ELF64 object file (--obj, see x86enc.h)
+ * or into machine code run in process (--run, see jit.h).
  */
 
 #ifndef CODEGEN_H
@@ -14,12 +16,40 @@
 #include <string.h>
 #include "ircode.h"
 #include "symtable.h"
+#include "regalloc.h"
+#include "frame.h"
+#include "isel.h"
+#include "mir.h"
+#include "asmopt.h"
+#include "x86enc.h"
 
 /* Assembly code output structure */
 typedef struct {
-    FILE* output_file;          /* File to write assembly code to */
-    int stack_offset;           /* Current stack frame offset */
+    char* output_filename;      /* File written at the end: the assembly, or the object (--obj) */
+    int object;                 /* Write an ELF64 object file instead of assembly (--obj) */
+    int run;                    /* Keep the machine code to run in process, write no file (--run) */
+    ElfObject* elf;             /* Machine code encoded for --obj and --run */
+    MirProgram* mir;            /* Machine IR of the output, printed at the end */
     SymbolTable* symtab;        /* Symbol table for variable locations */
+    int checked;                /* Emit the runtime checks planned for --checked */
+    int regalloc;               /* Keep values in registers (0: --no-regalloc) */
+    int pie;                    /* Position-independent code: rip-relative globals (--pie) */
+    RegisterAllocation* alloc;  /* Registers of the current function */
+    int position;               /* Index of the instruction in its function */
+    RegAllocStats regalloc_stats; /* Allocator statistics */
+    FrameLayout* frame;         /* Stack frame of the current function */
+    FrameStats frame_stats;     /* Frame layout statistics */
+    int isel;                   /* Cover expression trees with patterns (0: --no-isel) */
+    IselGrammar* grammar;       /* Instruction patterns of the target */
+    IselForest* forest;         /* Expression trees of the current function */
+    IselStats isel_stats;       /* Instruction selection statistics */
+    const char** args;          /* Operands of the params not yet passed to their call */
+    int num_args;               /* Number of them */
+    int args_capacity;          /* Allocated size of args */
+    int peephole;               /* Run the peephole pass on the output (0: --no-peephole) */
+    int verbose;                /* List the hits of every peephole rule */
+    AsmOptStats peephole_stats; /* Peephole statistics */
+    X86EncodeStats encode_stats; /* Encoder statistics (--obj) */
 } CodeGenerator;
 
 /* CODE GENERATION FUNCTIONS */
@@ -39,7 +69,8 @@ void gen_epilogue(CodeGenerator* gen);
 /* Generate code for a single TAC instruction */
 void gen_tac_instruction(CodeGenerator* gen, TACInstruction* inst);
 
-/* Get memory location for a variable/temporary */
+/* Get the location of an operand: a literal, a register, a stack slot
+ * [rbp +- offset] or [name] for a global */
 const char* get_location(CodeGenerator* gen, const char* name);
 
 /* Close and cleanup code generator */
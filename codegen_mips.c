@@ -3,15 +3,252 @@
  * CST-405 Compiler Project
  *
  * This file implements code generation from Three-Address Code (TAC)
- * to MIPS assembly language for QtSpim or MARS simulator.
+ * to MIPS assembly language for QtSpim or MARS simulator. Globals live
+ * in .data; parameters, locals and temporaries live in the function's
+ * $fp frame unless the register allocator keeps them in a register.
+ * Leaf functions neither save $ra nor set up $fp: their frame, if any,
+ * is addressed from $sp. A compare only the next branch reads becomes a
+ * compare-and-branch (the tree builder of isel.h finds them).
  */
 
+#include <ctype.h>
 #include "codegen_mips.h"
+#include "strength.h"
 
-/* Register mapping for temporaries */
-static const char* temp_registers[] = {
+/* Registers the allocator hands out: $s registers for values live
+ * across calls, $t registers for short-lived ones. $t0-$t3 stay free as
+ * scratch registers for the instruction sequences below. Print is a
+ * syscall, which leaves every $t register alone. */
+static const char* const mips_register_names[] = {
+    "$s0", "$s1", "$s2", "$s3", "$s4", "$s5", "$s6", "$s7",     /* Callee-saved */
+    "$t4", "$t5", "$t6", "$t7", "$t8", "$t9"                    /* Caller-saved */
+};
+static const int mips_callee_saved[] = { 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0 };
+static const RegisterFile mips_registers = { mips_register_names, mips_callee_saved, 14, 0, NULL, 0 };
+
+/* Frames: 4-byte words, $ra and the caller's $fp just below $fp, the
+ * arguments (all pushed in order) right above it, and 8-byte aligned
+ * frames. There is no red zone: a leaf frame still moves $sp. */
+static const FrameTarget mips_frame = { 4, 8, 0, 8, 0, 1, 0, 0, 0 };
+
+/* ============================================================
+ * MACHINE IR TARGET
+ * ============================================================ */
+
+/* Register numbers of the machine IR: the 32 general registers, then HI
+ * and LO */
+static const char* const mips_mir_names[34] = {
+    "$zero", "$at", "$v0", "$v1", "$a0", "$a1", "$a2", "$a3",
     "$t0", "$t1", "$t2", "$t3", "$t4", "$t5", "$t6", "$t7",
-    "$t8", "$t9"
+    "$s0", "$s1", "$s2", "$s3", "$s4", "$s5", "$s6", "$s7",
+    "$t8", "$t9", "$k0", "$k1", "$gp", "$sp", "$fp", "$ra",
+    "hi", "lo"
+};
+
+#define MIPS_BIT(r) (1ULL << (r))
+#define MIPS_HILO (MIPS_BIT(32) | MIPS_BIT(33))
+#define MIPS_ARGS (0xfULL << 4)                     /* $a0-$a3 */
+#define MIPS_SAVED (0xffULL << 16)                  /* $s0-$s7 */
+#define MIPS_POINTERS (MIPS_BIT(28) | MIPS_BIT(29) | MIPS_BIT(30))     /* $gp, $sp, $fp */
+/* A call clobbers every register a callee need not keep, a return reads
+ * the results and the registers the caller keeps */
+#define MIPS_CALL_DEFS (MIPS_BIT(1) | MIPS_BIT(2) | MIPS_BIT(3) | MIPS_ARGS | (0xffULL << 8) | \
+                        MIPS_BIT(24) | MIPS_BIT(25) | MIPS_BIT(31) | MIPS_HILO)
+#define MIPS_RETURN_USES (MIPS_BIT(2) | MIPS_BIT(3) | MIPS_SAVED | MIPS_POINTERS | MIPS_BIT(31))
+#define MIPS_ALU3(name) { name, 3, MIR_CLASS_ALU, "duu", 0, 0, 0 }
+#define MIPS_BRANCH2(name) { name, 3, MIR_CLASS_BRANCH, "uul", 0, 0, 0 }
+#define MIPS_BRANCH1(name) { name, 2, MIR_CLASS_BRANCH, "ul", 0, 0, 0 }
+
+/* The instructions the generator emits; upper case roles are memory
+ * operands ("-8($fp)", "arr($t0)", "x") */
+static const MirOpcode mips_opcodes[] = {
+    { "move",  2, MIR_CLASS_COPY,   "du", 0, 0, 0 },
+    { "li",    2, MIR_CLASS_COPY,   "du", 0, 0, 0 },
+    { "lw",    2, MIR_CLASS_COPY,   "dU", 0, 0, 0 },
+    { "sw",    2, MIR_CLASS_COPY,   "uD", 0, 0, 0 },
+    { "la",    2, MIR_CLASS_ALU,    "dA", 0, 0, 0 },
+    { "lui",   2, MIR_CLASS_ALU,    "du", 0, 0, 0 },
+    { "neg",   2, MIR_CLASS_ALU,    "du", 0, 0, 0 },
+    { "negu",  2, MIR_CLASS_ALU,    "du", 0, 0, 0 },
+    { "not",   2, MIR_CLASS_ALU,    "du", 0, 0, 0 },
+    { "abs",   2, MIR_CLASS_ALU,    "du", 0, 0, 0 },
+    { "mfhi",  1, MIR_CLASS_ALU,    "d", MIPS_BIT(32), 0, 0 },
+    { "mflo",  1, MIR_CLASS_ALU,    "d", MIPS_BIT(33), 0, 0 },
+    { "mult",  2, MIR_CLASS_ALU,    "uu", 0, MIPS_HILO, 0 },
+    { "multu", 2, MIR_CLASS_ALU,    "uu", 0, MIPS_HILO, 0 },
+    { "div",   2, MIR_CLASS_ALU,    "uu", 0, MIPS_HILO, 0 },
+    { "divu",  2, MIR_CLASS_ALU,    "uu", 0, MIPS_HILO, 0 },
+    { "mul",   3, MIR_CLASS_ALU,    "duu", 0, MIPS_HILO, 0 },
+    { "div",   3, MIR_CLASS_ALU,    "duu", 0, MIPS_HILO, 0 },
+    { "divu",  3, MIR_CLASS_ALU,    "duu", 0, MIPS_HILO, 0 },
+    { "rem",   3, MIR_CLASS_ALU,    "duu", 0, MIPS_HILO, 0 },
+    { "remu",  3, MIR_CLASS_ALU,    "duu", 0, MIPS_HILO, 0 },
+    MIPS_ALU3("add"), MIPS_ALU3("addu"), MIPS_ALU3("addi"), MIPS_ALU3("addiu"),
+    MIPS_ALU3("sub"), MIPS_ALU3("subu"), MIPS_ALU3("and"), MIPS_ALU3("andi"),
+    MIPS_ALU3("or"), MIPS_ALU3("ori"), MIPS_ALU3("xor"), MIPS_ALU3("xori"), MIPS_ALU3("nor"),
+    MIPS_ALU3("slt"), MIPS_ALU3("slti"), MIPS_ALU3("sltu"), MIPS_ALU3("sltiu"),
+    MIPS_ALU3("sll"), MIPS_ALU3("srl"), MIPS_ALU3("sra"), MIPS_ALU3("sllv"), MIPS_ALU3("srlv"),
+    MIPS_ALU3("srav"), MIPS_ALU3("seq"), MIPS_ALU3("sne"), MIPS_ALU3("sge"), MIPS_ALU3("sgt"),
+    MIPS_ALU3("sle"),
+    MIPS_BRANCH2("beq"), MIPS_BRANCH2("bne"), MIPS_BRANCH2("blt"), MIPS_BRANCH2("ble"),
+    MIPS_BRANCH2("bgt"), MIPS_BRANCH2("bge"), MIPS_BRANCH2("bltu"), MIPS_BRANCH2("bleu"),
+    MIPS_BRANCH2("bgtu"), MIPS_BRANCH2("bgeu"),
+    MIPS_BRANCH1("beqz"), MIPS_BRANCH1("bnez"), MIPS_BRANCH1("bltz"), MIPS_BRANCH1("blez"),
+    MIPS_BRANCH1("bgtz"), MIPS_BRANCH1("bgez"),
+    { "b",     1, MIR_CLASS_JUMP,   "l", 0, 0, 0 },
+    { "j",     1, MIR_CLASS_JUMP,   "l", 0, 0, 0 },
+    { "jal",   1, MIR_CLASS_CALL,   "l", MIPS_ARGS | MIPS_POINTERS, MIPS_CALL_DEFS, MIR_MEMORY },
+    { "jr",    1, MIR_CLASS_RETURN, "u", MIPS_RETURN_USES, 0, 0 },
+    { "syscall", 0, MIR_CLASS_ALU,  "", MIPS_BIT(2) | MIPS_ARGS, MIPS_BIT(2), MIR_MEMORY },
+    { "nop",   0, MIR_CLASS_ALU,    "", 0, 0, 0 }
+};
+
+/* Helper: Number of a register name (MIR_NO_REG if none) */
+static int mips_mir_register(const char* text, size_t length) {
+    for (int r = 0; r < 32; r++) {
+        if (strlen(mips_mir_names[r]) == length && !strncmp(text, mips_mir_names[r], length)) return r;
+    }
+    return MIR_NO_REG;
+}
+
+/* Helper: Is the text a decimal integer literal? */
+static int mips_mir_integer(const char* text, long long* value) {
+    char* end;
+    if (!isdigit((unsigned char)text[text[0] == '-']) || strlen(text) > 20) return 0;
+    *value = strtoll(text, &end, 10);
+    return *end == '\0';
+}
+
+/* Helper: Is the text a label? */
+static int mips_mir_label(const char* text, size_t length) {
+    if (length == 0 || length >= MIR_NAME_SIZE || !(isalpha((unsigned char)text[0]) || text[0] == '_')) return 0;
+    for (size_t i = 0; i < length; i++) {
+        if (!isalnum((unsigned char)text[i]) && text[i] != '_' && text[i] != '.') return 0;
+    }
+    return 1;
+}
+
+/* Read an operand: "$t0", "-4", a label, or for the memory roles
+ * "8($fp)", "x", "x+8", "arr($t0)" */
+static int mips_parse_operand(const char* text, char role, MirOperand* operand) {
+    operand->reg = MIR_NO_REG;
+    operand->index = MIR_NO_REG;
+    if (isupper((unsigned char)role)) {
+        const char* open = strchr(text, '(');
+        size_t head = open ? (size_t)(open - text) : strlen(text);
+        const char* sign = NULL;
+        operand->kind = MIR_OP_MEM;
+        if (open) {
+            const char* close = strchr(open, ')');
+            if (!close || close[1] != '\0') return 0;
+            operand->reg = mips_mir_register(open + 1, close - open - 1);
+            if (operand->reg == MIR_NO_REG) return 0;
+        }
+        for (size_t i = 1; i < head; i++) {
+            if (text[i] == '+' || text[i] == '-') sign = text + i;
+        }
+        if (head > 0 && (isdigit((unsigned char)text[0]) || text[0] == '-')) {
+            char number[24];
+            if (head >= sizeof(number)) return 0;
+            memcpy(number, text, head);
+            number[head] = '\0';
+            return mips_mir_integer(number, &operand->value);
+        }
+        size_t name = sign ? (size_t)(sign - text) : head;
+        if (head > 0 && !mips_mir_label(text, name)) return 0;
+        memcpy(operand->symbol, text, name);
+        operand->symbol[name] = '\0';
+        if (sign) {
+            char number[24];
+            if (head - name >= sizeof(number)) return 0;
+            memcpy(number, sign, head - name);
+            number[head - name] = '\0';
+            if (number[0] == '+') number[0] = '0';
+            if (!mips_mir_integer(number, &operand->value)) return 0;
+        }
+        return head > 0 || open;
+    }
+
+    operand->reg = mips_mir_register(text, strlen(text));
+    if (operand->reg != MIR_NO_REG) {
+        operand->kind = MIR_OP_REG;
+        return role != 'l';
+    }
+    if (mips_mir_integer(text, &operand->value)) {
+        operand->kind = MIR_OP_IMM;
+        return role == 'u';
+    }
+    if (role != 'l' || !mips_mir_label(text, strlen(text))) return 0;
+    operand->kind = MIR_OP_SYMBOL;
+    snprintf(operand->symbol, sizeof(operand->symbol), "%s", text);
+    return 1;
+}
+
+/* Print an operand */
+static void mips_format_operand(const MirOperand* operand, char* text, size_t size) {
+    switch (operand->kind) {
+        case MIR_OP_REG:
+            snprintf(text, size, "%s", mips_mir_names[operand->reg]);
+            break;
+        case MIR_OP_IMM:
+            snprintf(text, size, "%lld", operand->value);
+            break;
+        case MIR_OP_MEM: {
+            int n;
+            if (operand->symbol[0] == '\0') {
+                n = snprintf(text, size, "%lld", operand->value);
+            } else if (operand->value != 0) {
+                n = snprintf(text, size, "%s%+lld", operand->symbol, operand->value);
+            } else {
+                n = snprintf(text, size, "%s", operand->symbol);
+            }
+            if (operand->reg != MIR_NO_REG) snprintf(text + n, size - n, "(%s)", mips_mir_names[operand->reg]);
+            break;
+        }
+        case MIR_OP_SYMBOL:
+            snprintf(text, size, "%s", operand->symbol);
+            break;
+        default:
+            text[0] = '\0';
+            break;
+    }
+}
+
+/* Build "dest = source" with move, li, lw or sw */
+static int mips_mir_copy(const MirTarget* target, MirInstr* instr, const MirOperand* dest, const MirOperand* source) {
+    MirOperand operands[2] = { *dest, *source };
+    if (dest->kind == MIR_OP_MEM) {
+        if (source->kind != MIR_OP_REG) return 0;
+        operands[0] = *source;
+        operands[1] = *dest;
+        return mir_set(target, instr, "sw", 2, operands);
+    }
+    if (dest->kind != MIR_OP_REG) return 0;
+    switch (source->kind) {
+        case MIR_OP_REG: return mir_set(target, instr, "move", 2, operands);
+        case MIR_OP_IMM: return mir_set(target, instr, "li", 2, operands);
+        case MIR_OP_MEM: return mir_set(target, instr, "lw", 2, operands);
+        default: return 0;
+    }
+}
+
+/* Is the line a section switch? */
+static int mips_mir_section(const char* line) {
+    char word[16];
+    if (sscanf(line, " %15s", word) != 1) return -1;
+    if (!strcmp(word, ".text")) return 1;
+    if (!strcmp(word, ".data")) return 0;
+    return -1;
+}
+
+/* MIPS as the machine IR sees it (memory operands fold into no
+ * instruction but loads and stores) */
+static const MirTarget mips_mir = {
+    "MIPS", '#', 4, mips_opcodes, (int)(sizeof(mips_opcodes) / sizeof(mips_opcodes[0])),
+    MIPS_BIT(29) | MIPS_BIT(30),                /* Frames: $sp, $fp */
+    MIPS_BIT(0) | MIPS_BIT(26) | MIPS_BIT(27) | MIPS_POINTERS | MIPS_BIT(31) | MIPS_HILO,
+    0,
+    mips_mir_section, mips_parse_operand, mips_format_operand, mips_mir_copy, NULL
 };
 
 /* Create a new MIPS code generator instance */
@@ -28,25 +265,46 @@ MIPSCodeGenerator* create_mips_code_generator(const char* output_filename, Symbo
         free(gen);
         exit(1);
     }
+    gen->mir = create_mir(&mips_mir);
 
     gen->stack_offset = 0;
     gen->symtab = symtab;
-    gen->next_register = 0;
+    gen->checked = 0;
+    gen->regalloc = 1;
+    gen->alloc = NULL;
+    gen->position = 0;
+    gen->frame = NULL;
+    gen->stored[0] = '\0';
+    gen->pending[0] = '\0';
+    gen->loads_removed = 0;
+    gen->forest = NULL;
+    gen->compare = NULL;
+    gen->branches_fused = 0;
+    memset(&gen->regalloc_stats, 0, sizeof(RegAllocStats));
+    memset(&gen->frame_stats, 0, sizeof(FrameStats));
+    gen->peephole = 1;
+    gen->verbose = 0;
+    memset(&gen->peephole_stats, 0, sizeof(AsmOptStats));
 
     return gen;
 }
 
 /* Generate the MIPS prologue (program initialization) */
 void gen_mips_prologue(MIPSCodeGenerator* gen) {
-    fprintf(gen->output_file, "# CST-405 Compiler - Generated MIPS Assembly Code\n");
-    fprintf(gen->output_file, "# Target: MIPS (QtSpim/MARS)\n");
-    fprintf(gen->output_file, "# Date: %s\n\n", __DATE__);
+    mir_emit(gen->mir, "# CST-405 Compiler - Generated MIPS Assembly Code\n");
+    mir_emit(gen->mir, "# Target: MIPS (QtSpim/MARS)\n");
+    mir_emit(gen->mir, "# Date: %s\n\n", __DATE__);
 
-    fprintf(gen->output_file, ".data\n");
-    fprintf(gen->output_file, "    # Data section for variables\n");
-    fprintf(gen->output_file, "    newline: .asciiz \"\\n\"\n");
+    mir_emit(gen->mir, ".data\n");
+    mir_emit(gen->mir, "    # Data section for variables\n");
+    mir_emit(gen->mir, "    newline: .asciiz \"\\n\"\n");
+    if (gen->checked) {
+        mir_emit(gen->mir, "    check_bounds_msg: .asciiz \"Runtime error: array index out of bounds at line \"\n");
+        mir_emit(gen->mir, "    check_divide_msg: .asciiz \"Runtime error: division by zero at line \"\n");
+    }
 
-    /* Allocate space for all variables in the symbol table */
+    /* Allocate space for the global variables in the symbol table;
+     * parameters, locals and temporaries live in stack frames */
     if (gen->symtab) {
         for (int i = 0; i < gen->symtab->size; i++) {
             Symbol* sym = gen->symtab->table[i];
@@ -55,11 +313,11 @@ void gen_mips_prologue(MIPSCodeGenerator* gen) {
                 if (sym->kind == SYMBOL_VARIABLE && strcmp(sym->scope, "global") == 0) {
                     if (sym->is_array) {
                         /* Arrays need space for multiple words */
-                        fprintf(gen->output_file, "    %s: .space %d    # Array: %s[%d]\n",
+                        mir_emit(gen->mir, "    %s: .space %d    # Array: %s[%d]\n",
                                 sym->name, sym->array_size * 4, sym->name, sym->array_size);
                     } else {
                         /* Regular variables need 1 word (4 bytes) */
-                        fprintf(gen->output_file, "    %s: .word 0    # Variable: %s\n",
+                        mir_emit(gen->mir, "    %s: .word 0    # Variable: %s\n",
                                 sym->name, sym->name);
                     }
                 }
@@ -68,227 +326,685 @@ void gen_mips_prologue(MIPSCodeGenerator* gen) {
         }
     }
 
-    /* Allocate space for temporaries */
-    fprintf(gen->output_file, "\n    # Temporary variables\n");
-    for (int i = 0; i < 100; i++) {
-        fprintf(gen->output_file, "    t%d: .word 0\n", i);
-    }
-
-    fprintf(gen->output_file, "\n.text\n");
-    fprintf(gen->output_file, ".globl main\n\n");
+    mir_emit(gen->mir, "\n.text\n");
+    mir_emit(gen->mir, ".globl main\n");
 
-    fprintf(gen->output_file, "main:\n");
-    fprintf(gen->output_file, "    # Function prologue\n");
-    fprintf(gen->output_file, "    # (MIPS doesn't require explicit frame setup for main)\n\n");
+    /* Every statement lives in a function: the program starts at the
+     * 'main' function of the TAC */
 }
 
 /* Generate the MIPS epilogue (program termination) */
 void gen_mips_epilogue(MIPSCodeGenerator* gen) {
-    fprintf(gen->output_file, "\n    # Program exit\n");
-    fprintf(gen->output_file, "    li $v0, 10        # syscall: exit\n");
-    fprintf(gen->output_file, "    syscall\n");
+    mir_emit(gen->mir, "\n    # Program exit\n");
+    mir_emit(gen->mir, "    li $v0, 10        # syscall: exit\n");
+    mir_emit(gen->mir, "    syscall\n");
+
+    if (!gen->checked) return;
+
+    /* Runtime check failures: print the source line (in $a1) and exit(1) */
+    const char* routines[2][2] = {
+        { "__check_bounds_failed", "check_bounds_msg" },
+        { "__check_divide_failed", "check_divide_msg" }
+    };
+    for (int r = 0; r < 2; r++) {
+        mir_emit(gen->mir, "\n%s:\n", routines[r][0]);
+        mir_emit(gen->mir, "    la $a0, %s\n", routines[r][1]);
+        mir_emit(gen->mir, "    li $v0, 4         # syscall: print_string\n");
+        mir_emit(gen->mir, "    syscall\n");
+        mir_emit(gen->mir, "    move $a0, $a1     # source line\n");
+        mir_emit(gen->mir, "    li $v0, 1         # syscall: print_int\n");
+        mir_emit(gen->mir, "    syscall\n");
+        mir_emit(gen->mir, "    la $a0, newline\n");
+        mir_emit(gen->mir, "    li $v0, 4         # syscall: print_string\n");
+        mir_emit(gen->mir, "    syscall\n");
+        mir_emit(gen->mir, "    li $a0, 1\n");
+        mir_emit(gen->mir, "    li $v0, 17        # syscall: exit2\n");
+        mir_emit(gen->mir, "    syscall\n");
+    }
 }
 
-/* Get register for a temporary or variable */
+/* Labels placed after the runtime checks */
+static int check_label_count = 0;
+
+/* Get the register holding a temporary or variable */
 const char* get_mips_register(MIPSCodeGenerator* gen, const char* name) {
-    /* For simplicity, use $t0-$t9 in rotation */
-    static char reg[8];
+    int reg = allocated_register(gen->alloc, name);
+    return reg >= 0 ? mips_register_names[reg] : NULL;
+}
+
+/* Helper: Address of a frame offset: from $fp, or from $sp in a leaf */
+static const char* mips_frame_address(MIPSCodeGenerator* gen, int offset) {
+    static char buffers[4][80];
+    static int next = 0;
+
+    char* buffer = buffers[next];
+    next = (next + 1) % 4;
+    if (gen->frame->leaf) snprintf(buffer, sizeof(buffers[0]), "%d($sp)", stack_pointer_offset(gen->frame, offset));
+    else snprintf(buffer, sizeof(buffers[0]), "%d($fp)", offset);
+    return buffer;
+}
+
+/* Helper: Memory home of a value: its stack slot or its .data word */
+static const char* mips_home(MIPSCodeGenerator* gen, const char* name) {
+    FrameSlot* slot = frame_slot(gen->frame, name);
+    return slot ? mips_frame_address(gen, slot->offset) : name;
+}
+
+/* Helper: Symbol of a name as the current function sees it */
+static Symbol* mips_lookup_visible(MIPSCodeGenerator* gen, const char* name) {
+    if (!gen->symtab) return NULL;
+    return lookup_symbol_in_scope(gen->symtab, name, gen->frame ? gen->frame->function : "global");
+}
+
+/* Helper: Does a literal fit the 16-bit signed immediate of addi/slti? */
+static int fits_imm16(long long value) {
+    return value >= -32768 && value <= 32767;
+}
+
+/* Helper: reg = literal. Values li cannot load in one instruction take
+ * lui + ori; MIPS words are 32 bits, so a wider literal (folded by the
+ * optimizer) keeps its low word, as the arithmetic would have. */
+static void gen_mips_load_immediate(MIPSCodeGenerator* gen, const char* reg, long long value) {
+    unsigned int word = (unsigned int)(unsigned long long)value;
+    if (fits_imm16((int)word) || word <= 0xffff) {
+        mir_emit(gen->mir, "    li %s, %d\n", reg, (int)word);
+        return;
+    }
+    mir_emit(gen->mir, "    lui %s, %u    # %d\n", reg, word >> 16, (int)word);
+    if (word & 0xffff) mir_emit(gen->mir, "    ori %s, %s, %u\n", reg, reg, word & 0xffff);
+}
+
+/* Helper: Register holding an operand: its own register, or 'scratch'
+ * after loading it. A value the previous instruction just stored from
+ * $t0 is not loaded again. */
+static const char* mips_operand(MIPSCodeGenerator* gen, const char* scratch, const char* operand) {
+    int reuse = gen->pending[0] != '\0' && strcmp(scratch, "$t0") == 0;
+    char pending[64];
+    strcpy(pending, gen->pending);
+    gen->pending[0] = '\0';
+
+    if (is_number(operand)) {
+        gen_mips_load_immediate(gen, scratch, atoll(operand));
+        return scratch;
+    }
+    const char* reg = get_mips_register(gen, operand);
+    if (reg) return reg;
+
+    const char* home = mips_home(gen, operand);
+    if (reuse && strcmp(home, pending) == 0) {
+        gen->loads_removed++;
+        return scratch;
+    }
+    mir_emit(gen->mir, "    lw %s, %s\n", scratch, home);
+    return scratch;
+}
+
+/* Helper: Load an operand into a given register */
+static void mips_load_into(MIPSCodeGenerator* gen, const char* reg, const char* operand) {
+    const char* from = mips_operand(gen, reg, operand);
+    if (strcmp(from, reg) != 0) mir_emit(gen->mir, "    move %s, %s\n", reg, from);
+}
+
+/* Helper: Register to compute a result in: its own register or 'scratch' */
+static const char* mips_result(MIPSCodeGenerator* gen, const char* scratch, const char* result) {
+    const char* reg = get_mips_register(gen, result);
+    return reg ? reg : scratch;
+}
 
-    /* Check if it's a temporary variable (t0, t1, etc.) */
-    if (name && name[0] == 't' && isdigit(name[1])) {
-        int temp_num = atoi(&name[1]);
-        snprintf(reg, sizeof(reg), "$t%d", temp_num % 10);
-        return reg;
+/* Helper: Store a result computed in 'reg' to its register or home */
+static void mips_store(MIPSCodeGenerator* gen, const char* result, const char* reg) {
+    const char* own = get_mips_register(gen, result);
+    if (own) {
+        if (strcmp(own, reg) != 0) mir_emit(gen->mir, "    move %s, %s\n", own, reg);
+        return;
     }
 
-    /* For other variables, use $t0 as working register */
-    return "$t0";
+    const char* home = mips_home(gen, result);
+    mir_emit(gen->mir, "    sw %s, %s\n", reg, home);
+    if (strcmp(reg, "$t0") == 0) snprintf(gen->stored, sizeof(gen->stored), "%s", home);
+}
+
+/* Helper: Store the split registers a call clobbers to their slots */
+static void gen_mips_save_split(MIPSCodeGenerator* gen) {
+    LiveInterval* split[16];
+    int count = split_at_call(gen->alloc, gen->position, split);
+    for (int s = 0; s < count; s++) {
+        mir_emit(gen->mir, "    sw %s, %s    # save across call\n",
+                mips_register_names[split[s]->reg], mips_home(gen, split[s]->name));
+    }
+}
+
+/* Helper: Reload the split registers after a call */
+static void gen_mips_restore_split(MIPSCodeGenerator* gen) {
+    LiveInterval* split[16];
+    int count = split_at_call(gen->alloc, gen->position, split);
+    for (int s = 0; s < count; s++) {
+        mir_emit(gen->mir, "    lw %s, %s    # restore after call\n",
+                mips_register_names[split[s]->reg], mips_home(gen, split[s]->name));
+    }
+}
+
+/* Helper: Restore the saved $s registers, $ra and $fp and pop the frame */
+static void gen_mips_function_exit(MIPSCodeGenerator* gen) {
+    RegisterAllocation* alloc = gen->alloc;
+    for (int r = 0; alloc && r < alloc->num_callee_saved_used; r++) {
+        mir_emit(gen->mir, "    lw %s, %s\n", mips_register_names[alloc->callee_saved_used[r]],
+                mips_frame_address(gen, saved_register_offset(gen->frame, r)));
+    }
+    if (gen->frame->leaf) {
+        if (gen->frame->sp_adjust > 0) mir_emit(gen->mir, "    addiu $sp, $sp, %d\n", gen->frame->sp_adjust);
+        return;
+    }
+    mir_emit(gen->mir, "    lw $ra, -4($fp)\n");
+    mir_emit(gen->mir, "    move $sp, $fp\n");
+    mir_emit(gen->mir, "    lw $fp, -8($fp)\n");
+}
+
+/* Helper: Jump to a check failure routine with the source line, and
+ * place the label that passing checks branch to */
+static void gen_mips_check_failure(MIPSCodeGenerator* gen, const char* routine, int line, int ok_label) {
+    mir_emit(gen->mir, "    li $a1, %d        # source line\n", line);
+    mir_emit(gen->mir, "    j %s\n", routine);
+    mir_emit(gen->mir, "check_ok_%d:\n", ok_label);
+}
+
+/* Helper: Trap unless the index (or byte offset) in 'reg' is within the array */
+static void gen_mips_bounds_check(MIPSCodeGenerator* gen, TACInstruction* inst, const char* array,
+                                  int offset, const char* reg) {
+    Symbol* sym = mips_lookup_visible(gen, array);
+    if (!(inst->checks & CHECK_BOUNDS) || !sym || !sym->is_array) return;
+
+    /* Unsigned compare: negative indexes look huge */
+    int label = check_label_count++;
+    mir_emit(gen->mir, "    li $t3, %d        # bounds check (--checked)\n",
+            (sym->array_size - 1) * (offset ? 4 : 1));
+    mir_emit(gen->mir, "    bleu %s, $t3, check_ok_%d\n", reg, label);
+    gen_mips_check_failure(gen, "__check_bounds_failed", inst->line, label);
+}
+
+/* Helper: Address operand of an array element for lw/sw. A constant
+ * index folds into the displacement ("arr+12", "-28($fp)"); otherwise
+ * the scaled index (or byte offset) is added to the frame pointer for a
+ * local array, or indexes the label ("arr($t0)") for a global one. */
+static const char* mips_element_address(MIPSCodeGenerator* gen, TACInstruction* inst, const char* array,
+                                        const char* index, int offset) {
+    static char buffer[128];
+    FrameSlot* slot = frame_slot(gen->frame, array);
+    int scale = offset ? 1 : 4;
+
+    if (is_number(index)) {
+        if (inst->checks & CHECK_BOUNDS) {
+            mir_emit(gen->mir, "    li $t0, %s\n", index);
+            gen_mips_bounds_check(gen, inst, array, offset, "$t0");
+        }
+        long long displacement = atoll(index) * scale;
+        if (slot) return mips_frame_address(gen, (int)(slot->offset + displacement));
+        if (displacement == 0) return array;
+        snprintf(buffer, sizeof(buffer), "%s%+lld", array, displacement);
+        return buffer;
+    }
+
+    const char* reg = mips_operand(gen, "$t0", index);
+    gen_mips_bounds_check(gen, inst, array, offset, reg);
+    if (!offset) {
+        mir_emit(gen->mir, "    sll $t0, %s, 2  # multiply by 4 (word size)\n", reg);
+        reg = "$t0";
+    }
+    if (!slot) {
+        snprintf(buffer, sizeof(buffer), "%s(%s)", array, reg);
+        return buffer;
+    }
+    if (gen->frame->leaf) {
+        mir_emit(gen->mir, "    addu $t0, %s, $sp\n", reg);
+        snprintf(buffer, sizeof(buffer), "%d($t0)", stack_pointer_offset(gen->frame, slot->offset));
+    } else {
+        mir_emit(gen->mir, "    addu $t0, %s, $fp\n", reg);
+        snprintf(buffer, sizeof(buffer), "%d($t0)", slot->offset);
+    }
+    return buffer;
+}
+
+/* Helper: Trap if the divisor in 'reg' is zero */
+static void gen_mips_divisor_check(MIPSCodeGenerator* gen, TACInstruction* inst, const char* reg) {
+    if (!(inst->checks & CHECK_DIVISOR)) return;
+
+    int label = check_label_count++;
+    mir_emit(gen->mir, "    bnez %s, check_ok_%d  # divide-by-zero check (--checked)\n", reg, label);
+    gen_mips_check_failure(gen, "__check_divide_failed", inst->line, label);
+}
+
+/* Helper: Branch taken when 'op1 relop op2' is false */
+static const char* mips_branch_unless(const char* relop) {
+    if (strcmp(relop, "<") == 0) return "bge";
+    if (strcmp(relop, "<=") == 0) return "bgt";
+    if (strcmp(relop, ">") == 0) return "ble";
+    if (strcmp(relop, ">=") == 0) return "blt";
+    if (strcmp(relop, "==") == 0) return "bne";
+    return "beq";
+}
+
+/* Helper: Branch to 'label' unless 'op1 relop op2' of 'compare' holds.
+ * Against zero the branch compares with $zero itself; otherwise the
+ * bge/blt/... forms expand to slt and beq/bne. */
+static void gen_mips_compare_branch(MIPSCodeGenerator* gen, TACInstruction* compare, const char* label) {
+    mir_emit(gen->mir, "    # if_false %s %s %s goto %s\n", compare->op1, compare->label, compare->op2, label);
+    const char* left = mips_operand(gen, "$t0", compare->op1);
+    if (strcmp(compare->op2, "0") == 0) {
+        const char* relop = compare->label;
+        const char* branch = strcmp(relop, "<") == 0 ? "bgez" : strcmp(relop, "<=") == 0 ? "bgtz" :
+                             strcmp(relop, ">") == 0 ? "blez" : strcmp(relop, ">=") == 0 ? "bltz" :
+                             strcmp(relop, "==") == 0 ? "bnez" : "beqz";
+        mir_emit(gen->mir, "    %s %s, %s\n", branch, left, label);
+        return;
+    }
+    int literal = is_number(compare->op2) && fits_imm16(atoll(compare->op2));
+    const char* right = literal ? compare->op2 : mips_operand(gen, "$t1", compare->op2);
+    mir_emit(gen->mir, "    %s %s, %s, %s\n", mips_branch_unless(compare->label), left, right, label);
+}
+
+/* Helper: Check hoisted in front of a loop: if the loop runs, its bound
+ * (TAC_CHECK_BOUNDS) must fit the array or its divisor (TAC_CHECK_DIVISOR)
+ * must not be zero */
+static void gen_mips_loop_check(MIPSCodeGenerator* gen, TACInstruction* inst) {
+    int label = check_label_count++;
+
+    mir_emit(gen->mir, "    # loop check: %s (if %s %s %s)\n",
+            inst->result, inst->op1, inst->label, inst->op2);
+    const char* first = mips_operand(gen, "$t0", inst->op1);
+    const char* bound = mips_operand(gen, "$t1", inst->op2);
+    mir_emit(gen->mir, "    %s %s, %s, check_ok_%d  # loop does not run\n",
+            mips_branch_unless(inst->label), first, bound, label);
+
+    if (inst->opcode == TAC_CHECK_BOUNDS) {
+        Symbol* sym = mips_lookup_visible(gen, inst->result);
+        int size = sym ? sym->array_size : 0;
+        int highest = strcmp(inst->label, "<") == 0 ? size : size - 1;
+        mir_emit(gen->mir, "    ble %s, %d, check_ok_%d  # highest bound that fits %s\n",
+                bound, highest, label, inst->result);
+    } else {
+        const char* divisor = mips_operand(gen, "$t1", inst->result);
+        mir_emit(gen->mir, "    bnez %s, check_ok_%d\n", divisor, label);
+    }
+    gen_mips_check_failure(gen, inst->opcode == TAC_CHECK_BOUNDS ?
+                           "__check_bounds_failed" : "__check_divide_failed",
+                           inst->line, label);
+}
+
+/* Helper: $t0 = $t0 * c using shifts and adds where possible */
+static void gen_mips_multiply_by_constant(MIPSCodeGenerator* gen, long long c) {
+    MirProgram* out = gen->mir;
+    MulPlan plan = plan_multiply(c, 32);
+
+    switch (plan.kind) {
+        case MUL_BY_ZERO:
+            mir_emit(out, "    li $t0, 0\n");
+            return;
+        case MUL_BY_SHIFT:
+            if (plan.shift > 0) mir_emit(out, "    sll $t0, $t0, %d\n", plan.shift);
+            break;
+        case MUL_BY_SHIFT_ADD:
+            mir_emit(out, "    sll $t1, $t0, %d\n", plan.shift);
+            mir_emit(out, "    addu $t0, $t1, $t0\n");
+            break;
+        case MUL_BY_SHIFT_SUB:
+            mir_emit(out, "    sll $t1, $t0, %d\n", plan.shift);
+            mir_emit(out, "    subu $t0, $t1, $t0\n");
+            break;
+        case MUL_BY_MULTIPLY:
+            gen_mips_load_immediate(gen, "$t1", c);
+            mir_emit(out, "    mul $t0, $t0, $t1\n");
+            break;
+    }
+    if (plan.negate) mir_emit(out, "    subu $t0, $zero, $t0\n");
+}
+
+/* Helper: $t0 = $t0 / d or $t0 % d (d constant), rounding toward zero like div */
+static void gen_mips_divide_by_constant(MIPSCodeGenerator* gen, long long d, int want_mod) {
+    MirProgram* out = gen->mir;
+    int k = power_of_two_shift(d, 32);
+    DivPlan plan;
+
+    if (k > 0) {
+        /* Bias negative dividends by 2^k - 1 so the shift rounds toward zero */
+        mir_emit(out, "    sra $t1, $t0, 31\n");
+        mir_emit(out, "    srl $t1, $t1, %d\n", 32 - k);
+        mir_emit(out, "    addu $t1, $t0, $t1\n");
+        if (!want_mod) {
+            mir_emit(out, "    sra $t0, $t1, %d\n", k);
+            if (d < 0) mir_emit(out, "    subu $t0, $zero, $t0\n");
+        } else {
+            mir_emit(out, "    li $t2, %lld\n", -(1LL << k));
+            mir_emit(out, "    and $t1, $t1, $t2\n");
+            mir_emit(out, "    subu $t0, $t0, $t1\n");
+        }
+        return;
+    }
+
+    if (!plan_divide(d, 32, &plan)) {
+        /* 0, +-1 or out of range: keep the divide instruction */
+        gen_mips_load_immediate(gen, "$t1", d);
+        mir_emit(out, "    div $t0, $t1\n");
+        mir_emit(out, "    %s $t0\n", want_mod ? "mfhi" : "mflo");
+        return;
+    }
+
+    /* Quotient = high word of magic * n, corrected and shifted */
+    mir_emit(out, "    li $t1, %lld        # magic number for / %lld\n", plan.magic, d);
+    mir_emit(out, "    mult $t0, $t1\n");
+    mir_emit(out, "    mfhi $t2\n");
+    if (plan.add_dividend) mir_emit(out, "    addu $t2, $t2, $t0\n");
+    if (plan.sub_dividend) mir_emit(out, "    subu $t2, $t2, $t0\n");
+    if (plan.shift > 0) mir_emit(out, "    sra $t2, $t2, %d\n", plan.shift);
+    mir_emit(out, "    srl $t3, $t2, 31\n");
+    mir_emit(out, "    addu $t2, $t2, $t3\n");
+    if (want_mod) {
+        /* Remainder = n - q * d */
+        gen_mips_load_immediate(gen, "$t1", d);
+        mir_emit(out, "    mul $t3, $t2, $t1\n");
+        mir_emit(out, "    subu $t0, $t0, $t3\n");
+    } else {
+        mir_emit(out, "    move $t0, $t2\n");
+    }
+}
+
+
+/* Helper: result = op1 <op> op2 for the three-register instructions.
+ * 'immediate' is the form taking a 16-bit literal op2 instead ("addi",
+ * "slti"; NULL: none); a subtraction adds the negated literal. */
+static void gen_mips_binary(MIPSCodeGenerator* gen, TACInstruction* inst, const char* mnemonic,
+                            const char* immediate) {
+    const char* op1 = inst->op1;
+    const char* op2 = inst->op2;
+    int subtract = strcmp(mnemonic, "sub") == 0;
+    if (immediate && strcmp(mnemonic, "add") == 0 && is_number(op1) && !is_number(op2)) {
+        op1 = inst->op2;
+        op2 = inst->op1;
+    }
+    if (immediate && is_number(op2) && fits_imm16(subtract ? -atoll(op2) : atoll(op2))) {
+        const char* left = mips_operand(gen, "$t0", op1);
+        const char* dest = mips_result(gen, "$t0", inst->result);
+        mir_emit(gen->mir, "    %s %s, %s, %lld\n", immediate, dest, left,
+                subtract ? -atoll(op2) : atoll(op2));
+        mips_store(gen, inst->result, dest);
+        return;
+    }
+
+    const char* left = mips_operand(gen, "$t0", op1);
+    const char* right = mips_operand(gen, "$t1", op2);
+    const char* dest = mips_result(gen, "$t0", inst->result);
+    mir_emit(gen->mir, "    %s %s, %s, %s\n", mnemonic, dest, left, right);
+    mips_store(gen, inst->result, dest);
+}
+
+/* Helper: result = op1 / op2 or op1 % op2 */
+static void gen_mips_division(MIPSCodeGenerator* gen, TACInstruction* inst, int want_mod) {
+    if (is_number(inst->op2)) {
+        mips_load_into(gen, "$t0", inst->op1);
+        if (inst->checks & CHECK_DIVISOR) {
+            mir_emit(gen->mir, "    li $t1, 0         # constant zero divisor\n");
+            gen_mips_divisor_check(gen, inst, "$t1");
+        }
+        gen_mips_divide_by_constant(gen, atoll(inst->op2), want_mod);
+        mips_store(gen, inst->result, "$t0");
+        return;
+    }
+
+    const char* dividend = mips_operand(gen, "$t0", inst->op1);
+    const char* divisor = mips_operand(gen, "$t1", inst->op2);
+    gen_mips_divisor_check(gen, inst, divisor);
+    mir_emit(gen->mir, "    div %s, %s\n", dividend, divisor);
+    const char* dest = mips_result(gen, "$t0", inst->result);
+    mir_emit(gen->mir, "    %s %s\n", want_mod ? "mfhi" : "mflo", dest);
+    mips_store(gen, inst->result, dest);
 }
 
 /* Generate code for a single MIPS TAC instruction */
 void gen_mips_instruction(MIPSCodeGenerator* gen, TACInstruction* inst) {
+    /* Only the first operand of this instruction may reuse what the
+     * previous one left in $t0 */
+    strcpy(gen->pending, gen->stored);
+    gen->stored[0] = '\0';
+
     switch (inst->opcode) {
-        case TAC_LOAD_CONST:
+        case TAC_LOAD_CONST: {
             /* Load constant into variable: result = constant */
-            fprintf(gen->output_file, "    # %s = %s\n", inst->result, inst->op1);
-            fprintf(gen->output_file, "    li $t0, %s\n", inst->op1);
-            fprintf(gen->output_file, "    sw $t0, %s\n", inst->result);
+            mir_emit(gen->mir, "    # %s = %s\n", inst->result, inst->op1);
+            const char* dest = mips_result(gen, "$t0", inst->result);
+            gen_mips_load_immediate(gen, dest, atoll(inst->op1));
+            mips_store(gen, inst->result, dest);
             break;
+        }
 
         case TAC_ASSIGN:
             /* Assignment: result = op1 */
-            fprintf(gen->output_file, "    # %s = %s\n", inst->result, inst->op1);
-            fprintf(gen->output_file, "    lw $t0, %s\n", inst->op1);
-            fprintf(gen->output_file, "    sw $t0, %s\n", inst->result);
+            mir_emit(gen->mir, "    # %s = %s\n", inst->result, inst->op1);
+            mips_store(gen, inst->result, mips_operand(gen, "$t0", inst->op1));
             break;
 
         case TAC_ADD:
             /* Addition: result = op1 + op2 */
-            fprintf(gen->output_file, "    # %s = %s + %s\n", inst->result, inst->op1, inst->op2);
-            fprintf(gen->output_file, "    lw $t0, %s\n", inst->op1);
-            fprintf(gen->output_file, "    lw $t1, %s\n", inst->op2);
-            fprintf(gen->output_file, "    add $t0, $t0, $t1\n");
-            fprintf(gen->output_file, "    sw $t0, %s\n", inst->result);
+            mir_emit(gen->mir, "    # %s = %s + %s\n", inst->result, inst->op1, inst->op2);
+            gen_mips_binary(gen, inst, "add", "addi");
             break;
 
         case TAC_SUB:
             /* Subtraction: result = op1 - op2 */
-            fprintf(gen->output_file, "    # %s = %s - %s\n", inst->result, inst->op1, inst->op2);
-            fprintf(gen->output_file, "    lw $t0, %s\n", inst->op1);
-            fprintf(gen->output_file, "    lw $t1, %s\n", inst->op2);
-            fprintf(gen->output_file, "    sub $t0, $t0, $t1\n");
-            fprintf(gen->output_file, "    sw $t0, %s\n", inst->result);
+            mir_emit(gen->mir, "    # %s = %s - %s\n", inst->result, inst->op1, inst->op2);
+            gen_mips_binary(gen, inst, "sub", "addi");
             break;
 
         case TAC_MUL:
             /* Multiplication: result = op1 * op2 */
-            fprintf(gen->output_file, "    # %s = %s * %s\n", inst->result, inst->op1, inst->op2);
-            fprintf(gen->output_file, "    lw $t0, %s\n", inst->op1);
-            fprintf(gen->output_file, "    lw $t1, %s\n", inst->op2);
-            fprintf(gen->output_file, "    mul $t0, $t0, $t1\n");
-            fprintf(gen->output_file, "    sw $t0, %s\n", inst->result);
+            mir_emit(gen->mir, "    # %s = %s * %s\n", inst->result, inst->op1, inst->op2);
+            if (is_number(inst->op2)) {
+                mips_load_into(gen, "$t0", inst->op1);
+                gen_mips_multiply_by_constant(gen, atoll(inst->op2));
+                mips_store(gen, inst->result, "$t0");
+                break;
+            }
+            gen_mips_binary(gen, inst, "mul", NULL);
             break;
 
         case TAC_DIV:
             /* Division: result = op1 / op2 */
-            fprintf(gen->output_file, "    # %s = %s / %s\n", inst->result, inst->op1, inst->op2);
-            fprintf(gen->output_file, "    lw $t0, %s\n", inst->op1);
-            fprintf(gen->output_file, "    lw $t1, %s\n", inst->op2);
-            fprintf(gen->output_file, "    div $t0, $t1\n");
-            fprintf(gen->output_file, "    mflo $t0\n");
-            fprintf(gen->output_file, "    sw $t0, %s\n", inst->result);
+            mir_emit(gen->mir, "    # %s = %s / %s\n", inst->result, inst->op1, inst->op2);
+            gen_mips_division(gen, inst, 0);
             break;
 
         case TAC_MOD:
             /* Modulo: result = op1 % op2 */
-            fprintf(gen->output_file, "    # %s = %s %% %s\n", inst->result, inst->op1, inst->op2);
-            fprintf(gen->output_file, "    lw $t0, %s\n", inst->op1);
-            fprintf(gen->output_file, "    lw $t1, %s\n", inst->op2);
-            fprintf(gen->output_file, "    div $t0, $t1\n");
-            fprintf(gen->output_file, "    mfhi $t0\n");
-            fprintf(gen->output_file, "    sw $t0, %s\n", inst->result);
+            mir_emit(gen->mir, "    # %s = %s %% %s\n", inst->result, inst->op1, inst->op2);
+            gen_mips_division(gen, inst, 1);
             break;
 
         case TAC_PRINT:
             /* Print statement: print(op1) */
-            fprintf(gen->output_file, "    # print(%s)\n", inst->op1);
-            fprintf(gen->output_file, "    lw $a0, %s\n", inst->op1);
-            fprintf(gen->output_file, "    li $v0, 1        # syscall: print_int\n");
-            fprintf(gen->output_file, "    syscall\n");
-            fprintf(gen->output_file, "    la $a0, newline\n");
-            fprintf(gen->output_file, "    li $v0, 4        # syscall: print_string\n");
-            fprintf(gen->output_file, "    syscall\n");
+            mir_emit(gen->mir, "    # print(%s)\n", inst->op1);
+            mips_load_into(gen, "$a0", inst->op1);
+            mir_emit(gen->mir, "    li $v0, 1        # syscall: print_int\n");
+            mir_emit(gen->mir, "    syscall\n");
+            mir_emit(gen->mir, "    la $a0, newline\n");
+            mir_emit(gen->mir, "    li $v0, 4        # syscall: print_string\n");
+            mir_emit(gen->mir, "    syscall\n");
             break;
 
         case TAC_LABEL:
             /* Label definition */
-            fprintf(gen->output_file, "%s:\n", inst->label);
+            mir_emit(gen->mir, "%s:\n", inst->label);
             break;
 
         case TAC_GOTO:
             /* Unconditional jump */
-            fprintf(gen->output_file, "    j %s\n", inst->label);
+            mir_emit(gen->mir, "    j %s\n", inst->label);
             break;
 
         case TAC_IF_FALSE:
             /* Conditional jump: if op1 == 0 goto label */
-            fprintf(gen->output_file, "    # if_false %s goto %s\n", inst->op1, inst->label);
-            fprintf(gen->output_file, "    lw $t0, %s\n", inst->op1);
-            fprintf(gen->output_file, "    beqz $t0, %s\n", inst->label);
+            if (gen->compare) {
+                gen_mips_compare_branch(gen, gen->compare, inst->label);
+                gen->compare = NULL;
+                gen->branches_fused++;
+                break;
+            }
+            mir_emit(gen->mir, "    # if_false %s goto %s\n", inst->op1, inst->label);
+            mir_emit(gen->mir, "    beqz %s, %s\n",
+                    mips_operand(gen, "$t0", inst->op1), inst->label);
             break;
 
         case TAC_RELOP:
-            /* Relational operation: result = op1 relop op2 */
-            fprintf(gen->output_file, "    # %s = %s %s %s\n",
+            /* Relational operation: result = op1 relop op2. Folded into
+             * the next instruction's tree, it is only that branch's
+             * condition: the branch compares instead, and $t0 is left as
+             * the previous instruction stored it. */
+            if (gen->forest && gen->forest->folded[gen->position] && inst->next->opcode == TAC_IF_FALSE) {
+                gen->compare = inst;
+                strcpy(gen->stored, gen->pending);
+                break;
+            }
+            mir_emit(gen->mir, "    # %s = %s %s %s\n",
                     inst->result, inst->op1, inst->label, inst->op2);
-            fprintf(gen->output_file, "    lw $t0, %s\n", inst->op1);
-            fprintf(gen->output_file, "    lw $t1, %s\n", inst->op2);
 
             /* Determine which relational operator */
             if (strcmp(inst->label, "<") == 0) {
-                fprintf(gen->output_file, "    slt $t0, $t0, $t1\n");
+                gen_mips_binary(gen, inst, "slt", "slti");
             } else if (strcmp(inst->label, ">") == 0) {
-                fprintf(gen->output_file, "    sgt $t0, $t0, $t1\n");
+                gen_mips_binary(gen, inst, "sgt", NULL);
             } else if (strcmp(inst->label, "<=") == 0) {
-                fprintf(gen->output_file, "    sle $t0, $t0, $t1\n");
+                gen_mips_binary(gen, inst, "sle", NULL);
             } else if (strcmp(inst->label, ">=") == 0) {
-                fprintf(gen->output_file, "    sge $t0, $t0, $t1\n");
+                gen_mips_binary(gen, inst, "sge", NULL);
             } else if (strcmp(inst->label, "==") == 0) {
-                fprintf(gen->output_file, "    seq $t0, $t0, $t1\n");
+                gen_mips_binary(gen, inst, "seq", NULL);
             } else if (strcmp(inst->label, "!=") == 0) {
-                fprintf(gen->output_file, "    sne $t0, $t0, $t1\n");
+                gen_mips_binary(gen, inst, "sne", NULL);
             }
-
-            fprintf(gen->output_file, "    sw $t0, %s\n", inst->result);
             break;
 
         case TAC_ARRAY_LOAD:
-            /* Array load: result = array[index] */
-            fprintf(gen->output_file, "    # %s = %s[%s]\n", inst->result, inst->op1, inst->op2);
-            fprintf(gen->output_file, "    lw $t0, %s       # load index\n", inst->op2);
-            fprintf(gen->output_file, "    sll $t0, $t0, 2  # multiply by 4 (word size)\n");
-            fprintf(gen->output_file, "    la $t1, %s       # load array base\n", inst->op1);
-            fprintf(gen->output_file, "    add $t0, $t0, $t1\n");
-            fprintf(gen->output_file, "    lw $t0, 0($t0)\n");
-            fprintf(gen->output_file, "    sw $t0, %s\n", inst->result);
+        case TAC_ARRAY_LOAD_OFFSET: {
+            /* Array load: result = array[index], or at a byte offset kept
+             * by the optimizer */
+            int offset = inst->opcode == TAC_ARRAY_LOAD_OFFSET;
+            mir_emit(gen->mir, "    # %s = %s[%s%s]\n", inst->result, inst->op1, offset ? "byte " : "", inst->op2);
+            const char* address = mips_element_address(gen, inst, inst->op1, inst->op2, offset);
+            const char* dest = mips_result(gen, "$t0", inst->result);
+            mir_emit(gen->mir, "    lw %s, %s\n", dest, address);
+            mips_store(gen, inst->result, dest);
             break;
+        }
 
         case TAC_ARRAY_STORE:
+        case TAC_ARRAY_STORE_OFFSET: {
             /* Array store: array[index] = value */
-            fprintf(gen->output_file, "    # %s[%s] = %s\n", inst->result, inst->op1, inst->op2);
-            fprintf(gen->output_file, "    lw $t0, %s       # load index\n", inst->op1);
-            fprintf(gen->output_file, "    sll $t0, $t0, 2  # multiply by 4\n");
-            fprintf(gen->output_file, "    la $t1, %s       # load array base\n", inst->result);
-            fprintf(gen->output_file, "    add $t0, $t0, $t1\n");
-            fprintf(gen->output_file, "    lw $t2, %s       # load value\n", inst->op2);
-            fprintf(gen->output_file, "    sw $t2, 0($t0)\n");
+            int offset = inst->opcode == TAC_ARRAY_STORE_OFFSET;
+            mir_emit(gen->mir, "    # %s[%s%s] = %s\n", inst->result, offset ? "byte " : "", inst->op1, inst->op2);
+            const char* address = mips_element_address(gen, inst, inst->result, inst->op1, offset);
+            mir_emit(gen->mir, "    sw %s, %s\n", mips_operand(gen, "$t2", inst->op2), address);
             break;
+        }
 
-        case TAC_FUNCTION_LABEL:
-            /* Function label */
-            fprintf(gen->output_file, "\n%s:\n", inst->label);
-            fprintf(gen->output_file, "    # Function: %s\n", inst->label);
+        case TAC_CHECK_BOUNDS:
+        case TAC_CHECK_DIVISOR:
+            /* Runtime check hoisted in front of a loop (--checked) */
+            gen_mips_loop_check(gen, inst);
             break;
 
-        case TAC_PARAM:
+        case TAC_FUNCTION_LABEL: {
+            /* Function label, then a frame for $ra, the caller's $fp, the
+             * $s registers in use, the locals and the temporaries (a leaf
+             * keeps $ra and $fp, and only moves $sp if it needs memory) */
+            RegisterAllocation* alloc = gen->alloc;
+            int saved = alloc ? alloc->num_callee_saved_used : 0;
+            int frame_size = gen->frame->size + mips_frame.reserved;
+
+            mir_emit(gen->mir, "\n%s:\n", inst->label);
+            mir_emit(gen->mir, "    # Function: %s\n", inst->label);
+            if (!gen->frame->leaf) {
+                mir_emit(gen->mir, "    addiu $sp, $sp, -%d\n", frame_size);
+                mir_emit(gen->mir, "    sw $ra, %d($sp)\n", frame_size - 4);
+                mir_emit(gen->mir, "    sw $fp, %d($sp)\n", frame_size - 8);
+                mir_emit(gen->mir, "    addiu $fp, $sp, %d\n", frame_size);
+            } else if (gen->frame->sp_adjust > 0) {
+                mir_emit(gen->mir, "    addiu $sp, $sp, -%d   # leaf frame\n", gen->frame->sp_adjust);
+            }
+            for (int r = 0; r < saved; r++) {
+                mir_emit(gen->mir, "    sw %s, %s\n", mips_register_names[alloc->callee_saved_used[r]],
+                        mips_frame_address(gen, saved_register_offset(gen->frame, r)));
+            }
+
+            /* Parameters live in registers from here on */
+            for (int v = 0; alloc && v < alloc->num_intervals; v++) {
+                LiveInterval* interval = &alloc->intervals[v];
+                if (interval->entry_load && interval->reg >= 0) {
+                    mir_emit(gen->mir, "    lw %s, %s       # parameter %s\n",
+                            mips_register_names[interval->reg], mips_home(gen, interval->name),
+                            interval->name);
+                }
+            }
+            break;
+        }
+
+        case TAC_PARAM: {
             /* Function parameter (push to stack) */
-            fprintf(gen->output_file, "    # param %s\n", inst->op1);
-            fprintf(gen->output_file, "    lw $t0, %s\n", inst->op1);
-            fprintf(gen->output_file, "    addi $sp, $sp, -4\n");
-            fprintf(gen->output_file, "    sw $t0, 0($sp)\n");
+            mir_emit(gen->mir, "    # param %s\n", inst->op1);
+            const char* value = mips_operand(gen, "$t0", inst->op1);
+            mir_emit(gen->mir, "    addi $sp, $sp, -4\n");
+            mir_emit(gen->mir, "    sw %s, 0($sp)\n", value);
             break;
+        }
 
         case TAC_CALL:
-            /* Function call */
-            fprintf(gen->output_file, "    # call %s\n", inst->label);
-            fprintf(gen->output_file, "    jal %s\n", inst->label);
+            /* Function call: the $t registers in use are saved around it */
+            mir_emit(gen->mir, "    # call %s\n", inst->label);
+            gen_mips_save_split(gen);
+            mir_emit(gen->mir, "    jal %s\n", inst->label);
             /* Pop parameters */
             int param_count = atoi(inst->op1);
-            fprintf(gen->output_file, "    addi $sp, $sp, %d    # pop parameters\n",
+            mir_emit(gen->mir, "    addi $sp, $sp, %d    # pop parameters\n",
                     param_count * 4);
-            fprintf(gen->output_file, "    sw $v0, %s       # save return value\n", inst->result);
+            gen_mips_restore_split(gen);
+            mips_store(gen, inst->result, "$v0");
             break;
 
         case TAC_RETURN:
             /* Return with value */
-            fprintf(gen->output_file, "    # return %s\n", inst->op1);
-            fprintf(gen->output_file, "    lw $v0, %s\n", inst->op1);
-            fprintf(gen->output_file, "    jr $ra\n");
+            mir_emit(gen->mir, "    # return %s\n", inst->op1);
+            mips_load_into(gen, "$v0", inst->op1);
+            gen_mips_function_exit(gen);
+            mir_emit(gen->mir, "    jr $ra\n");
             break;
 
         case TAC_RETURN_VOID:
             /* Return without value */
-            fprintf(gen->output_file, "    # return (void)\n");
-            fprintf(gen->output_file, "    jr $ra\n");
+            mir_emit(gen->mir, "    # return (void)\n");
+            gen_mips_function_exit(gen);
+            mir_emit(gen->mir, "    jr $ra\n");
             break;
 
         default:
-            fprintf(gen->output_file, "    # Unknown opcode: %s\n",
+            mir_emit(gen->mir, "    # Unknown opcode: %s\n",
                     opcode_to_string(inst->opcode));
             break;
     }
 }
 
+/* Helper: Can control run past the end of a function? An int function
+ * without a final return then returns 0. */
+static int mips_falls_through(TACInstruction* last) {
+    if (!last) return 0;
+    return last->opcode != TAC_RETURN && last->opcode != TAC_RETURN_VOID &&
+           last->opcode != TAC_GOTO && last->opcode != TAC_FUNCTION_LABEL;
+}
+
+/* Helper: Return 0 from a function that falls off its end */
+static void gen_mips_implicit_return(MIPSCodeGenerator* gen, TACInstruction* last) {
+    if (!mips_falls_through(last)) return;
+    mir_emit(gen->mir, "    # end of function\n");
+    mir_emit(gen->mir, "    li $v0, 0\n");
+    gen_mips_function_exit(gen);
+    mir_emit(gen->mir, "    jr $ra\n");
+}
+
 /* Generate MIPS assembly from TAC */
 void generate_mips_assembly(MIPSCodeGenerator* gen, TACCode* tac) {
     printf("[CODEGEN] Generating MIPS assembly code...\n");
@@ -297,15 +1013,66 @@ void generate_mips_assembly(MIPSCodeGenerator* gen, TACCode* tac) {
 
     /* Generate code for each TAC instruction */
     TACInstruction* inst = tac->head;
+    TACInstruction* last = NULL;
     while (inst) {
+        if (inst->opcode == TAC_FUNCTION_LABEL) {
+            gen_mips_implicit_return(gen, last);
+
+            /* Allocate the registers and lay out the frame of the next function */
+            free_register_allocation(gen->alloc);
+            free_frame_layout(gen->frame);
+            gen->alloc = NULL;
+            if (gen->regalloc) {
+                gen->alloc = allocate_registers(tac, inst, gen->symtab, &mips_registers,
+                                                &gen->regalloc_stats);
+            }
+            RegisterAllocation* live = gen->alloc ? gen->alloc
+                                                  : compute_live_intervals(tac, inst, gen->symtab, &mips_registers);
+            gen->frame = build_frame_layout(inst, gen->symtab, live, &mips_frame, &gen->frame_stats);
+            if (live != gen->alloc) free_register_allocation(live);
+            free_isel_forest(gen->forest);
+            gen->forest = build_isel_forest(inst, NULL);
+            gen->position = 0;
+        }
+
+        /* Tail call without stack arguments: pop our frame and jump, so
+         * the callee returns straight to our caller */
+        if (inst->opcode == TAC_CALL && is_tail_call(inst) && atoi(inst->op1) == 0) {
+            mir_emit(gen->mir, "    # tail call %s\n", inst->label);
+            gen_mips_function_exit(gen);
+            mir_emit(gen->mir, "    j %s\n", inst->label);
+            gen->stored[0] = '\0';
+            last = inst->next;
+            inst = inst->next->next;
+            gen->position += 2;
+            continue;
+        }
         gen_mips_instruction(gen, inst);
+        last = inst;
         inst = inst->next;
+        gen->position++;
     }
+    gen_mips_implicit_return(gen, last);
+    free_register_allocation(gen->alloc);
+    free_frame_layout(gen->frame);
+    free_isel_forest(gen->forest);
+    gen->alloc = NULL;
+    gen->frame = NULL;
+    gen->forest = NULL;
 
     gen_mips_epilogue(gen);
+    build_mir_blocks(gen->mir);
+    if (gen->peephole) optimize_mir(gen->mir, &gen->peephole_stats);
+    print_mir(gen->mir, gen->output_file);
 
     printf("[CODEGEN] MIPS assembly generation complete\n");
     printf("[CODEGEN] Total instructions: %d\n", tac->instruction_count);
+    printf("[CODEGEN] Reloads of just-stored values removed: %d\n", gen->loads_removed);
+    printf("[CODEGEN] Compares fused into branches: %d\n", gen->branches_fused);
+
+    if (gen->regalloc) print_regalloc_stats(&gen->regalloc_stats);
+    print_frame_stats(&gen->frame_stats);
+    if (gen->peephole) print_asmopt_stats(&gen->peephole_stats, gen->verbose);
 }
 
 /* Close and cleanup MIPS code generator */
@@ -313,5 +1080,9 @@ void close_mips_code_generator(MIPSCodeGenerator* gen) {
     if (gen->output_file) {
         fclose(gen->output_file);
     }
+    free_mir(gen->mir);
+    free_register_allocation(gen->alloc);
+    free_frame_layout(gen->frame);
+    free_isel_forest(gen->forest);
     free(gen);
 }
@@ -14,13 +14,34 @@
 #include <string.h>
 #include "ircode.h"
 #include "symtable.h"
+#include "regalloc.h"
+#include "frame.h"
+#include "isel.h"
+#include "mir.h"
+#include "asmopt.h"
 
 /* MIPS Assembly code output structure */
 typedef struct {
     FILE* output_file;          /* File to write assembly code to */
+    MirProgram* mir;            /* Machine IR of the output, printed at the end */
     int stack_offset;           /* Current stack frame offset */
     SymbolTable* symtab;        /* Symbol table for variable locations */
-    int next_register;          /* Next available temporary register */
+    int checked;                /* Emit the runtime checks planned for --checked */
+    int regalloc;               /* Keep values in registers (0: --no-regalloc) */
+    RegisterAllocation* alloc;  /* Registers of the current function */
+    int position;               /* Index of the instruction in its function */
+    FrameLayout* frame;         /* Stack frame of the current function */
+    char stored[64];            /* Home the last instruction stored $t0 to ("" if none) */
+    char pending[64];           /* ... as seen by the current instruction */
+    int loads_removed;          /* Reloads of a value just stored, removed */
+    IselForest* forest;         /* Trees of the current function (compares that only feed a branch) */
+    TACInstruction* compare;    /* Compare left for the branch that follows */
+    int branches_fused;         /* Compares fused into their branch */
+    RegAllocStats regalloc_stats; /* Allocator statistics */
+    FrameStats frame_stats;     /* Frame layout statistics */
+    int peephole;               /* Run the peephole pass on the output (0: --no-peephole) */
+    int verbose;                /* List the hits of every peephole rule */
+    AsmOptStats peephole_stats; /* Peephole statistics */
 } MIPSCodeGenerator;
 
 /* CODE GENERATION FUNCTIONS */
@@ -40,7 +61,7 @@ void gen_mips_epilogue(MIPSCodeGenerator* gen);
 /* Generate code for a single TAC instruction */
 void gen_mips_instruction(MIPSCodeGenerator* gen, TACInstruction* inst);
 
-/* Get register for a variable/temporary */
+/* Get the register holding a variable/temporary (NULL if it lives in memory) */
 const char* get_mips_register(MIPSCodeGenerator* gen, const char* name);
 
 /* Close and cleanup MIPS code generator */
@@ -23,9 +23,14 @@
 #include "ircode.h"
 #include "optimizer.h"
 #include "codegen.h"
+#include "jit.h"
 #include "codegen_mips.h"
 #include "diagnostics.h"
 #include "security.h"
+#include "loop_opt.h"
+#include "inliner.h"
+#include "passes.h"
+#include "checks.h"
 
 /* External declarations from parser */
 extern int yyparse();
@@ -53,6 +58,20 @@ int main(int argc, char* argv[]) {
         fprintf(stderr, "  --log <file>    Write diagnostics to log file\n");
         fprintf(stderr, "  --no-warnings   Suppress warning messages\n");
         fprintf(stderr, "  --Werror        Treat warnings as errors\n");
+        fprintf(stderr, "  -O0 .. -O3, -Os Optimization level (default -O2; -O0 skips optimization)\n");
+        fprintf(stderr, "  --passes=<list> Run this pass pipeline instead, e.g. fold,fixpoint(sccp,dce)\n");
+        fprintf(stderr, "  --unroll <n>    Loop unrolling factor (default 4, 1 = full unrolling only, 0 = off)\n");
+        fprintf(stderr, "  --no-inline     Disable function inlining\n");
+        fprintf(stderr, "  --checked       Trap on out-of-bounds indexes and division by zero at run time\n");
+        fprintf(stderr, "  --no-regalloc   Keep every value in memory (no register allocation, default at -O0)\n");
+        fprintf(stderr, "  --regalloc      Allocate registers even at -O0\n");
+        fprintf(stderr, "  --pie           Position-independent x86-64 code (rip-relative globals, PLT calls)\n");
+        fprintf(stderr, "  --no-isel       Translate each TAC instruction on its own (x86-64, no tree patterns, default at -O0)\n");
+        fprintf(stderr, "  --isel          Select instructions by tree patterns even at -O0\n");
+        fprintf(stderr, "  --no-peephole   Write the assembly as emitted (no peephole pass over it, default at -O0)\n");
+        fprintf(stderr, "  --peephole      Run the peephole pass even at -O0\n");
+        fprintf(stderr, "  --obj           Write an ELF64 object file (output.o) instead of x86-64 assembly\n");
+        fprintf(stderr, "  --run           Run the x86-64 code in process right after compiling (no files, no linker)\n");
         fprintf(stderr, "\nExample: %s program.src --verbose --mips\n", argv[0]);
         return 1;
     }
@@ -64,6 +83,18 @@ int main(int argc, char* argv[]) {
     int show_warnings = 1;
     const char* log_file = NULL;
     const char* output_filename = "output.asm";
+    OptLevel opt_level = OPT_LEVEL_O2;
+    const char* pass_pipeline = NULL;
+    int unroll_factor = -1;
+    int no_inline = 0;
+    int checked = 0;
+    int regalloc = -1;                  /* -1: follow the optimization level */
+    int isel = -1;                      /* -1: follow the optimization level */
+    int pie = 0;
+    int peephole = -1;                  /* -1: follow the optimization level */
+    int object = 0;
+    int run = 0;
+    int exit_status = 0;
 
     /* Parse command line flags */
     for (int i = 2; i < argc; i++) {
@@ -78,9 +109,68 @@ int main(int argc, char* argv[]) {
             show_warnings = 0;
         } else if (strcmp(argv[i], "--log") == 0 && i + 1 < argc) {
             log_file = argv[++i];
+        } else if (parse_optimization_level(argv[i], &opt_level)) {
+            /* -O0 .. -O3, -Os */
+        } else if (strncmp(argv[i], "--passes=", 9) == 0) {
+            pass_pipeline = argv[i] + 9;
+        } else if (strcmp(argv[i], "--unroll") == 0 && i + 1 < argc) {
+            unroll_factor = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--no-inline") == 0) {
+            no_inline = 1;
+        } else if (strcmp(argv[i], "--checked") == 0) {
+            checked = 1;
+        } else if (strcmp(argv[i], "--regalloc") == 0) {
+            regalloc = 1;
+        } else if (strcmp(argv[i], "--no-regalloc") == 0) {
+            regalloc = 0;
+        } else if (strcmp(argv[i], "--isel") == 0) {
+            isel = 1;
+        } else if (strcmp(argv[i], "--no-isel") == 0) {
+            isel = 0;
+        } else if (strcmp(argv[i], "--pie") == 0) {
+            pie = 1;
+        } else if (strcmp(argv[i], "--peephole") == 0) {
+            peephole = 1;
+        } else if (strcmp(argv[i], "--no-peephole") == 0) {
+            peephole = 0;
+        } else if (strcmp(argv[i], "--obj") == 0) {
+            object = 1;
+        } else if (strcmp(argv[i], "--run") == 0) {
+            run = 1;
         }
     }
 
+    /* --obj replaces the x86-64 assembly; MIPS output is always assembly.
+     * --run maps the code anywhere in memory, so it needs --pie code */
+    if (use_mips) {
+        object = 0;
+        run = 0;
+    } else {
+        if (object) output_filename = "output.o";
+        if (run) pie = 1;
+    }
+
+    /* The level sets the pipeline and limits; explicit options override it.
+     * -O0 also keeps every value in memory, uses the templates and
+     * writes the assembly as emitted */
+    set_optimization_level(opt_level);
+    if (regalloc < 0) regalloc = opt_level != OPT_LEVEL_O0;
+    if (isel < 0) isel = opt_level != OPT_LEVEL_O0;
+    if (peephole < 0) peephole = opt_level != OPT_LEVEL_O0;
+    if (pass_pipeline && !set_pass_pipeline(pass_pipeline)) {
+        return 1;
+    }
+    if (unroll_factor >= 0) {
+        UnrollOptions unroll = get_unroll_options();
+        unroll.factor = unroll_factor;
+        set_unroll_options(&unroll);
+    }
+    if (no_inline) {
+        InlineOptions inlining = get_inline_options();
+        inlining.growth_budget = 0;
+        set_inline_options(&inlining);
+    }
+
     /* Initialize diagnostics system */
     init_diagnostics(verbose, warnings_as_errors);
     diag_config.show_warnings = show_warnings;
@@ -98,8 +188,9 @@ int main(int argc, char* argv[]) {
 
     yyin = input_file;
     printf("Input file: %s\n", input_filename);
-    printf("Output file: %s\n", output_filename);
-    printf("Target: %s\n\n", use_mips ? "MIPS (QtSpim/MARS)" : "x86-64 (NASM)");
+    printf("Output file: %s\n", run && !object ? "(none, run in process)" : output_filename);
+    printf("Target: %s\n\n", use_mips ? "MIPS (QtSpim/MARS)" : run ? "x86-64 (in-process JIT)"
+                              : object ? "x86-64 (ELF64 object)" : "x86-64 (NASM)");
 
     /* ===================================================================
      * PHASE 1 & 2: LEXICAL AND SYNTAX ANALYSIS
@@ -195,15 +286,35 @@ int main(int argc, char* argv[]) {
         printf("[OK] Intermediate code saved to: output.ir\n\n");
     }
 
+    /* Address arithmetic produced by the optimizer is in target bytes */
+    tac->element_size = use_mips ? 4 : 8;
+    tac->symbols = global_symtab;
+
+    /* ===================================================================
+     * PHASE 4.5: SECURITY ANALYSIS
+     * Check for unsafe constructs and security vulnerabilities using the
+     * value ranges of the unoptimized TAC (folding would hide x / 0)
+     * ================================================================ */
+    print_phase_separator("PHASE 4.5: SECURITY ANALYSIS");
+
+    SecurityCheckResults* security_results = analyze_security(ast_root, global_symtab, tac);
+    print_security_report(security_results);
+
     /* ===================================================================
      * PHASE 5: CODE OPTIMIZATION
      * Optimize the intermediate representation
      * ================================================================ */
     print_phase_separator("PHASE 5: CODE OPTIMIZATION");
 
-    OptimizationStats opt_stats;
-    optimize_tac(tac, &opt_stats);
-    print_optimization_stats(&opt_stats);
+    /* An empty pipeline (-O0) skips the phase entirely */
+    if (get_pass_pipeline()[0] != '\0') {
+        OptimizationStats opt_stats;
+        optimize_tac(tac, &opt_stats);
+        print_optimization_stats(&opt_stats);
+        print_pass_report();
+    } else {
+        printf("[OPTIMIZER] Optimization disabled (-O0)\n\n");
+    }
 
     /* Print optimized TAC */
     if (verbose) {
@@ -212,13 +323,17 @@ int main(int argc, char* argv[]) {
     }
 
     /* ===================================================================
-     * PHASE 5.5: SECURITY ANALYSIS
-     * Check for unsafe constructs and security vulnerabilities
+     * PHASE 5.5: RUNTIME CHECK PLANNING (--checked)
+     * Keep the checks the value ranges cannot prove and hoist the ones
+     * counted loops allow in front of the loop
      * ================================================================ */
-    print_phase_separator("PHASE 5.5: SECURITY ANALYSIS");
+    if (checked) {
+        print_phase_separator("PHASE 5.5: RUNTIME CHECK PLANNING");
 
-    SecurityCheckResults* security_results = analyze_security(ast_root, global_symtab);
-    print_security_report(security_results);
+        CheckStats check_stats;
+        plan_runtime_checks(tac, &check_stats);
+        print_check_stats(&check_stats);
+    }
 
     /* ===================================================================
      * PHASE 6: CODE GENERATION
@@ -229,12 +344,39 @@ int main(int argc, char* argv[]) {
     if (use_mips) {
         /* Generate MIPS assembly */
         MIPSCodeGenerator* mips_gen = create_mips_code_generator(output_filename, global_symtab);
+        mips_gen->checked = checked;
+        mips_gen->regalloc = regalloc;
+        mips_gen->peephole = peephole;
+        mips_gen->verbose = verbose;
         generate_mips_assembly(mips_gen, tac);
         close_mips_code_generator(mips_gen);
     } else {
         /* Generate x86-64 assembly */
         CodeGenerator* codegen = create_code_generator(output_filename, global_symtab);
+        codegen->checked = checked;
+        codegen->regalloc = regalloc;
+        codegen->isel = isel;
+        codegen->pie = pie;
+        codegen->peephole = peephole;
+        codegen->verbose = verbose;
+        codegen->object = object;
+        codegen->run = run;
         generate_assembly(codegen, tac);
+
+        /* ===============================================================
+         * PHASE 7: JIT EXECUTION (--run)
+         * Load the machine code into this process and call main
+         * ============================================================ */
+        if (run) {
+            JitStats jit_stats;
+            print_phase_separator("PHASE 7: JIT EXECUTION");
+            if (!run_jit(codegen->elf, &jit_stats)) {
+                close_code_generator(codegen);
+                return 1;
+            }
+            print_jit_stats(&jit_stats);
+            exit_status = jit_stats.exit_status;
+        }
         close_code_generator(codegen);
     }
 
@@ -244,16 +386,24 @@ int main(int argc, char* argv[]) {
     print_summary(1);
 
     printf("[OK] Compilation successful!\n");
-    printf("[OK] Assembly code written to: %s\n\n", output_filename);
-
+    if (run) {
+        printf("[OK] Program run in process: main returned %d\n\n", exit_status);
+    }
     if (use_mips) {
+        printf("[OK] Assembly code written to: %s\n\n", output_filename);
         printf("To run on QtSpim or MARS:\n");
         printf("  1. Open %s in QtSpim or MARS simulator\n", output_filename);
         printf("  2. Assemble and run the program\n\n");
-    } else {
+    } else if (object) {
+        printf("[OK] Object file written to: %s\n\n", output_filename);
+        printf("To link (on Linux):\n");
+        printf(pie ? "  gcc %s -o program\n" : "  gcc %s -o program -no-pie\n", output_filename);
+        printf("  ./program\n\n");
+    } else if (!run) {
+        printf("[OK] Assembly code written to: %s\n\n", output_filename);
         printf("To assemble and link (on Linux):\n");
         printf("  nasm -f elf64 %s -o output.o\n", output_filename);
-        printf("  gcc output.o -o program -no-pie\n");
+        printf(pie ? "  gcc output.o -o program\n" : "  gcc output.o -o program -no-pie\n");
         printf("  ./program\n\n");
     }
 
@@ -270,7 +420,7 @@ int main(int argc, char* argv[]) {
     free_security_results(security_results);
     close_diagnostics();
 
-    return 0;
+    return exit_status;
 }
 
 /* Print the compiler banner */
@@ -0,0 +1,300 @@
+/*
+ * ELFOBJ.C - ELF64 Object File Writer Implementation
+ * CST-405 Compiler Project
+ *
+ * This file implements the ELF64 object file writer. The file is laid
+ * out as the ELF header, the contents of .text and .data, the
+ * relocations, the symbol and string tables, and the section headers.
+ * Every field is written byte by byte in little-endian order, so the
+ * writer does not depend on the host's structure layout or byte order.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "elfobj.h"
+#include "diagnostics.h"
+
+/* Section header indexes */
+enum {
+    SH_NULL, SH_TEXT, SH_DATA, SH_BSS, SH_RELA_TEXT, SH_SYMTAB, SH_STRTAB, SH_SHSTRTAB, SH_NOTE_STACK,
+    SH_COUNT
+};
+
+/* Names of the sections, in .shstrtab order */
+static const char* const section_names[SH_COUNT] = {
+    "", ".text", ".data", ".bss", ".rela.text", ".symtab", ".strtab", ".shstrtab", ".note.GNU-stack"
+};
+
+#define ELF_HEADER_SIZE 64
+#define SECTION_HEADER_SIZE 64
+#define SYMBOL_SIZE 24
+#define RELA_SIZE 24
+
+/* Symbol bindings and types */
+#define STB_LOCAL 0
+#define STB_GLOBAL 1
+#define STT_NOTYPE 0
+#define STT_FUNC 2
+#define STT_SECTION 3
+
+/* Create an empty object */
+ElfObject* create_elf_object(void) {
+    return (ElfObject*)safe_calloc(1, sizeof(ElfObject), "object file");
+}
+
+/* Append bytes to a section (.bss: only its size grows) */
+void elf_append(ElfObject* object, ElfSection section, const void* bytes, size_t count) {
+    if (section != ELF_BSS) {
+        if (object->size[section] + count > object->capacity[section]) {
+            size_t capacity = object->capacity[section] ? object->capacity[section] : 4096;
+            while (capacity < object->size[section] + count) capacity *= 2;
+            object->data[section] = (unsigned char*)safe_realloc(object->data[section], capacity, "object file");
+            object->capacity[section] = capacity;
+        }
+        if (bytes) memcpy(object->data[section] + object->size[section], bytes, count);
+        else memset(object->data[section] + object->size[section], 0, count);
+    }
+    object->size[section] += count;
+}
+
+/* Symbol called 'name', added as undefined if it is new */
+int elf_symbol(ElfObject* object, const char* name) {
+    for (int i = 0; i < object->num_symbols; i++) {
+        if (!strcmp(object->symbols[i].name, name)) return i;
+    }
+    if (object->num_symbols == object->symbols_capacity) {
+        object->symbols_capacity = object->symbols_capacity ? object->symbols_capacity * 2 : 64;
+        object->symbols = (ElfSymbol*)safe_realloc(object->symbols, object->symbols_capacity * sizeof(ElfSymbol),
+                                                   "object file");
+    }
+    ElfSymbol* symbol = &object->symbols[object->num_symbols];
+    memset(symbol, 0, sizeof(ElfSymbol));
+    symbol->name = safe_strdup(name, "object file");
+    symbol->section = -1;
+    return object->num_symbols++;
+}
+
+/* Define a symbol at the end of a section (0 if it is already defined) */
+int elf_define_symbol(ElfObject* object, const char* name, ElfSection section) {
+    int index = elf_symbol(object, name);           /* May move the symbols */
+    ElfSymbol* symbol = &object->symbols[index];
+    if (symbol->section >= 0) return 0;
+    symbol->section = section;
+    symbol->value = object->size[section];
+    return 1;
+}
+
+/* Declare a symbol global */
+void elf_global_symbol(ElfObject* object, const char* name) {
+    int index = elf_symbol(object, name);
+    object->symbols[index].global = 1;
+}
+
+/* Declare a symbol the entry of a function */
+void elf_function_symbol(ElfObject* object, const char* name) {
+    int index = elf_symbol(object, name);
+    object->symbols[index].function = 1;
+}
+
+/* Record a relocation of a place in .text */
+void elf_add_relocation(ElfObject* object, uint64_t offset, int symbol, uint32_t type, int64_t addend) {
+    if (object->num_relocations == object->relocations_capacity) {
+        object->relocations_capacity = object->relocations_capacity ? object->relocations_capacity * 2 : 64;
+        object->relocations = (ElfRelocation*)safe_realloc(object->relocations,
+                                                           object->relocations_capacity * sizeof(ElfRelocation),
+                                                           "object file");
+    }
+    ElfRelocation* relocation = &object->relocations[object->num_relocations++];
+    relocation->offset = offset;
+    relocation->symbol = symbol;
+    relocation->type = type;
+    relocation->addend = addend;
+}
+
+/* ============================================================
+ * WRITING
+ * ============================================================ */
+
+/* Helper: Write an unsigned little-endian field of 'size' bytes */
+static void put(FILE* out, uint64_t value, int size) {
+    for (int i = 0; i < size; i++) {
+        fputc((int)(value & 0xff), out);
+        value >>= 8;
+    }
+}
+
+/* Helper: Pad the file with zeros up to 'offset' */
+static void pad_to(FILE* out, size_t* position, size_t offset) {
+    while (*position < offset) {
+        fputc(0, out);
+        (*position)++;
+    }
+}
+
+/* Helper: Round up to a multiple of 'alignment' */
+static size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+/* Helper: Is the symbol local to the object? */
+static int is_local(const ElfSymbol* symbol) {
+    return symbol->section >= 0 && !symbol->global;
+}
+
+/* Helper: Write one section header */
+static void put_section_header(FILE* out, uint32_t name, uint32_t type, uint64_t flags, uint64_t offset,
+                               uint64_t size, uint32_t link, uint32_t info, uint64_t align, uint64_t entsize) {
+    put(out, name, 4);
+    put(out, type, 4);
+    put(out, flags, 8);
+    put(out, 0, 8);                             /* Address: none until linked */
+    put(out, offset, 8);
+    put(out, size, 8);
+    put(out, link, 4);
+    put(out, info, 4);
+    put(out, align, 8);
+    put(out, entsize, 8);
+}
+
+/* Write the object file */
+void write_elf_object(ElfObject* object, FILE* out) {
+    /* Symbol table order: null, the three section symbols, the locals,
+     * then the globals (the linker wants every local first) */
+    int* index = (int*)safe_malloc((object->num_symbols + 1) * sizeof(int), "object file");
+    int* order = (int*)safe_malloc((object->num_symbols + 1) * sizeof(int), "object file");
+    int count = 4;
+    int first_global = count;
+    size_t strtab_size = 1;
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < object->num_symbols; i++) {
+            if (is_local(&object->symbols[i]) != (pass == 0)) continue;
+            index[i] = count;
+            order[count - 4] = i;
+            count++;
+            strtab_size += strlen(object->symbols[i].name) + 1;
+        }
+        if (pass == 0) first_global = count;
+    }
+
+    /* Layout */
+    size_t shstrtab_size = 1;
+    uint32_t name_offsets[SH_COUNT];
+    name_offsets[0] = 0;
+    for (int s = 1; s < SH_COUNT; s++) {
+        name_offsets[s] = (uint32_t)shstrtab_size;
+        shstrtab_size += strlen(section_names[s]) + 1;
+    }
+    size_t text_offset = align_up(ELF_HEADER_SIZE, 16);
+    size_t data_offset = align_up(text_offset + object->size[ELF_TEXT], 8);
+    size_t rela_offset = align_up(data_offset + object->size[ELF_DATA], 8);
+    size_t symtab_offset = rela_offset + (size_t)object->num_relocations * RELA_SIZE;
+    size_t strtab_offset = symtab_offset + (size_t)count * SYMBOL_SIZE;
+    size_t shstrtab_offset = strtab_offset + strtab_size;
+    size_t headers_offset = align_up(shstrtab_offset + shstrtab_size, 8);
+    size_t position = 0;
+
+    /* ELF header */
+    static const unsigned char ident[16] = { 0x7f, 'E', 'L', 'F', 2, 1, 1, 0 };  /* 64-bit, little-endian */
+    fwrite(ident, 1, sizeof(ident), out);
+    put(out, 1, 2);                             /* ET_REL */
+    put(out, 62, 2);                            /* EM_X86_64 */
+    put(out, 1, 4);                             /* EV_CURRENT */
+    put(out, 0, 8);                             /* Entry */
+    put(out, 0, 8);                             /* Program headers: none */
+    put(out, headers_offset, 8);
+    put(out, 0, 4);                             /* Flags */
+    put(out, ELF_HEADER_SIZE, 2);
+    put(out, 0, 2);
+    put(out, 0, 2);
+    put(out, SECTION_HEADER_SIZE, 2);
+    put(out, SH_COUNT, 2);
+    put(out, SH_SHSTRTAB, 2);
+    position = ELF_HEADER_SIZE;
+
+    /* Contents */
+    pad_to(out, &position, text_offset);
+    fwrite(object->data[ELF_TEXT], 1, object->size[ELF_TEXT], out);
+    position += object->size[ELF_TEXT];
+    pad_to(out, &position, data_offset);
+    fwrite(object->data[ELF_DATA], 1, object->size[ELF_DATA], out);
+    position += object->size[ELF_DATA];
+    pad_to(out, &position, rela_offset);
+
+    /* Relocations: against its section for a local label */
+    for (int r = 0; r < object->num_relocations; r++) {
+        const ElfRelocation* relocation = &object->relocations[r];
+        const ElfSymbol* symbol = &object->symbols[relocation->symbol];
+        uint64_t target = index[relocation->symbol];
+        int64_t addend = relocation->addend;
+        if (is_local(symbol)) {
+            target = 1 + symbol->section;
+            addend += (int64_t)symbol->value;
+        }
+        put(out, relocation->offset, 8);
+        put(out, (target << 32) | relocation->type, 8);
+        put(out, (uint64_t)addend, 8);
+    }
+    position = symtab_offset;
+
+    /* Symbols */
+    put(out, 0, SYMBOL_SIZE);
+    for (int s = 0; s < 3; s++) {
+        put(out, 0, 4);
+        put(out, STT_SECTION | (STB_LOCAL << 4), 1);
+        put(out, 0, 1);
+        put(out, SH_TEXT + s, 2);
+        put(out, 0, 8);
+        put(out, 0, 8);
+    }
+    uint32_t name = 1;
+    for (int k = 4; k < count; k++) {
+        const ElfSymbol* symbol = &object->symbols[order[k - 4]];
+        int type = symbol->function && symbol->section >= 0 ? STT_FUNC : STT_NOTYPE;
+        put(out, name, 4);
+        put(out, type | ((is_local(symbol) ? STB_LOCAL : STB_GLOBAL) << 4), 1);
+        put(out, 0, 1);
+        put(out, symbol->section >= 0 ? SH_TEXT + symbol->section : 0, 2);
+        put(out, symbol->value, 8);
+        put(out, 0, 8);
+        name += (uint32_t)strlen(symbol->name) + 1;
+    }
+    position = strtab_offset;
+
+    /* Names */
+    fputc(0, out);
+    for (int k = 4; k < count; k++) {
+        const char* text = object->symbols[order[k - 4]].name;
+        fwrite(text, 1, strlen(text) + 1, out);
+    }
+    fputc(0, out);
+    for (int s = 1; s < SH_COUNT; s++) fwrite(section_names[s], 1, strlen(section_names[s]) + 1, out);
+    position = shstrtab_offset + shstrtab_size;
+    pad_to(out, &position, headers_offset);
+
+    /* Section headers */
+    put(out, 0, SECTION_HEADER_SIZE);
+    put_section_header(out, name_offsets[SH_TEXT], 1, 0x6, text_offset, object->size[ELF_TEXT], 0, 0, 16, 0);
+    put_section_header(out, name_offsets[SH_DATA], 1, 0x3, data_offset, object->size[ELF_DATA], 0, 0, 8, 0);
+    put_section_header(out, name_offsets[SH_BSS], 8, 0x3, data_offset + object->size[ELF_DATA],
+                       object->size[ELF_BSS], 0, 0, 8, 0);
+    put_section_header(out, name_offsets[SH_RELA_TEXT], 4, 0x40, rela_offset,
+                       (uint64_t)object->num_relocations * RELA_SIZE, SH_SYMTAB, SH_TEXT, 8, RELA_SIZE);
+    put_section_header(out, name_offsets[SH_SYMTAB], 2, 0, symtab_offset, (uint64_t)count * SYMBOL_SIZE,
+                       SH_STRTAB, first_global, 8, SYMBOL_SIZE);
+    put_section_header(out, name_offsets[SH_STRTAB], 3, 0, strtab_offset, strtab_size, 0, 0, 1, 0);
+    put_section_header(out, name_offsets[SH_SHSTRTAB], 3, 0, shstrtab_offset, shstrtab_size, 0, 0, 1, 0);
+    put_section_header(out, name_offsets[SH_NOTE_STACK], 1, 0, headers_offset, 0, 0, 0, 1, 0);
+
+    free(index);
+    free(order);
+}
+
+/* Free the object */
+void free_elf_object(ElfObject* object) {
+    if (!object) return;
+    for (int s = 0; s < ELF_NUM_SECTIONS; s++) free(object->data[s]);
+    for (int i = 0; i < object->num_symbols; i++) free(object->symbols[i].name);
+    free(object->symbols);
+    free(object->relocations);
+    free(object);
+}
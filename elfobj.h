@@ -0,0 +1,99 @@
+/*
+ * ELFOBJ.H - ELF64 Object File Writer Header
+ * CST-405 Compiler Project
+ *
+ * This file defines the relocatable ELF64 object file the x86-64 back
+ * end can write instead of assembly text (--obj), for the system linker
+ * to link like the output of an assembler:
+ * - Sections: .text (code), .data (initialized data), .bss (zeroed
+ *   data, a size only) and an empty .note.GNU-stack (no executable stack)
+ * - Symbols: every label, local unless declared global; names used but
+ *   not defined (printf, exit) are undefined globals the linker resolves
+ * - Relocations (.rela.text): the places in the code that hold the
+ *   address of a symbol, or its distance from the code, only the linker
+ *   knows. A relocation against a local label is written against its
+ *   section, with the label's offset in the addend
+ * The writer knows nothing about instructions: the encoder (x86enc.h)
+ * appends bytes, defines labels and records relocations. The JIT
+ * (jit.h) loads the same object into memory instead of writing it.
+ */
+
+#ifndef ELFOBJ_H
+#define ELFOBJ_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/* Sections with contents the encoder fills */
+typedef enum {
+    ELF_TEXT,
+    ELF_DATA,
+    ELF_BSS,
+    ELF_NUM_SECTIONS
+} ElfSection;
+
+/* x86-64 relocation types (System V AMD64 psABI) */
+#define R_X86_64_64 1               /* Absolute 64-bit address */
+#define R_X86_64_PC32 2             /* 32-bit distance from the place */
+#define R_X86_64_PLT32 4            /* 32-bit distance to the function (or its PLT entry) */
+#define R_X86_64_32S 11             /* Absolute address sign-extended from 32 bits */
+
+/* Symbol */
+typedef struct {
+    char* name;
+    int section;                    /* Section it is defined in (-1 if undefined) */
+    uint64_t value;                 /* Offset in its section */
+    int global;                     /* Declared global (or undefined: always global) */
+    int function;                   /* Entry of a function (STT_FUNC) */
+} ElfSymbol;
+
+/* Relocation of a place in .text */
+typedef struct {
+    uint64_t offset;                /* Place in .text */
+    int symbol;                     /* Symbol it refers to */
+    uint32_t type;                  /* R_X86_64_* */
+    int64_t addend;
+} ElfRelocation;
+
+/* Object file being built */
+typedef struct {
+    unsigned char* data[ELF_NUM_SECTIONS];  /* Contents (none for .bss) */
+    size_t size[ELF_NUM_SECTIONS];
+    size_t capacity[ELF_NUM_SECTIONS];
+    ElfSymbol* symbols;
+    int num_symbols;
+    int symbols_capacity;
+    ElfRelocation* relocations;
+    int num_relocations;
+    int relocations_capacity;
+} ElfObject;
+
+/* Create an empty object */
+ElfObject* create_elf_object(void);
+
+/* Append bytes to a section (.bss: only its size grows) */
+void elf_append(ElfObject* object, ElfSection section, const void* bytes, size_t count);
+
+/* Symbol called 'name', added as undefined if it is new */
+int elf_symbol(ElfObject* object, const char* name);
+
+/* Define a symbol at the end of a section (0 if it is already defined) */
+int elf_define_symbol(ElfObject* object, const char* name, ElfSection section);
+
+/* Declare a symbol global */
+void elf_global_symbol(ElfObject* object, const char* name);
+
+/* Declare a symbol the entry of a function */
+void elf_function_symbol(ElfObject* object, const char* name);
+
+/* Record a relocation of a place in .text */
+void elf_add_relocation(ElfObject* object, uint64_t offset, int symbol, uint32_t type, int64_t addend);
+
+/* Write the object file */
+void write_elf_object(ElfObject* object, FILE* out);
+
+/* Free the object */
+void free_elf_object(ElfObject* object);
+
+#endif /* ELFOBJ_H */
@@ -0,0 +1,247 @@
+/*
+ * FRAME.C - Stack Frame Layout Implementation
+ * CST-405 Compiler Project
+ *
+ * This file assigns every value of a function its home: the argument
+ * slot of a parameter, or a slot of the function's own frame for locals,
+ * local arrays and temporaries that are not kept in a register. Each
+ * activation gets its own copy, so recursive functions work and the
+ * values a function touches sit next to each other on the stack.
+ *
+ * Temporaries share slots: two temporaries whose live intervals do not
+ * overlap get the same slot (a greedy coloring of the interference
+ * between intervals), so the temporary area is as large as the most
+ * temporaries live in memory at once rather than one word per name.
+ */
+
+#include "frame.h"
+#include "diagnostics.h"
+
+/* Helper: Round a byte count up to a multiple of 'alignment' */
+static int align_up(int bytes, int alignment) {
+    return (bytes + alignment - 1) / alignment * alignment;
+}
+
+/* Helper: Does a value need a memory home (no register for the whole
+ * function, or a register split around calls)? */
+static int needs_home(RegisterAllocation* alloc, const char* name) {
+    if (!alloc) return 1;
+    int id = lookup_name_id(alloc->names, name);
+    if (id < 0 || alloc->interval_of[id] < 0) return 1;
+    LiveInterval* interval = &alloc->intervals[alloc->interval_of[id]];
+    return interval->reg < 0 || interval->split;
+}
+
+/* Helper: Live interval of a value (NULL: none, live from the function entry) */
+static LiveInterval* interval_of(RegisterAllocation* alloc, const char* name) {
+    if (!alloc) return NULL;
+    int id = lookup_name_id(alloc->names, name);
+    return id >= 0 && alloc->interval_of[id] >= 0 ? &alloc->intervals[alloc->interval_of[id]] : NULL;
+}
+
+/* Helper: Do two intervals interfere? An interval ending where an
+ * instruction reads is taken to last through the write of that
+ * instruction too, so a result never shares the slot of its operands. */
+static int interferes(LiveInterval* a, LiveInterval* b) {
+    return a->start <= (b->end | 1) && b->start <= (a->end | 1);
+}
+
+/* Temporaries sharing one frame slot */
+typedef struct {
+    int offset;                 /* Frame pointer offset of the slot */
+    LiveInterval** members;     /* Intervals of the temporaries in it */
+    int count;
+    int capacity;
+} SharedSlot;
+
+/* Helper: Offset of a shared slot no temporary in it interferes with
+ * 'interval', or 0 when there is none */
+static int find_shared_slot(SharedSlot* shared, int num_shared, LiveInterval* interval) {
+    for (int k = 0; k < num_shared; k++) {
+        int free_slot = 1;
+        for (int m = 0; m < shared[k].count && free_slot; m++) {
+            if (interferes(shared[k].members[m], interval)) free_slot = 0;
+        }
+        if (!free_slot) continue;
+        if (shared[k].count >= shared[k].capacity) {
+            shared[k].capacity *= 2;
+            shared[k].members = (LiveInterval**)safe_realloc(shared[k].members,
+                                                             shared[k].capacity * sizeof(LiveInterval*),
+                                                             "frame layout");
+        }
+        shared[k].members[shared[k].count++] = interval;
+        return shared[k].offset;
+    }
+    return 0;
+}
+
+/* Helper: Add a home for a value (once); slots are indexed by name id */
+static void add_slot(FrameLayout* frame, int* capacity, const char* name, int words, int is_param,
+                     int offset) {
+    if (frame_slot(frame, name)) return;
+    if (frame->num_slots >= *capacity) {
+        *capacity *= 2;
+        frame->slots = (FrameSlot*)safe_realloc(frame->slots, *capacity * sizeof(FrameSlot), "frame layout");
+    }
+    int id = intern_name(frame->names, name);
+    FrameSlot* slot = &frame->slots[frame->num_slots++];
+    slot->name = frame->names->names[id];
+    slot->offset = offset;
+    slot->words = words;
+    slot->is_param = is_param;
+}
+
+/* Helper: Number of elements of an array owned by the function, 0 for a
+ * scalar, -1 for a global (which keeps its label) */
+static int local_words(SymbolTable* symtab, const char* function, const char* name, int is_array) {
+    if (is_temp_name(name)) return 0;
+    Symbol* symbol = symtab ? lookup_symbol_in_scope(symtab, name, function) : NULL;
+    if (symbol && strcmp(symbol->scope, "global") == 0) return -1;
+    if (!symbol && is_array && symtab) symbol = lookup_symbol(symtab, name);
+    return is_array && symbol ? symbol->array_size : 0;
+}
+
+/* Does the function call nothing? */
+int is_leaf_function(TACInstruction* start, const FrameTarget* target) {
+    for (TACInstruction* inst = start->next; inst && inst->opcode != TAC_FUNCTION_LABEL; inst = inst->next) {
+        if (inst->opcode == TAC_CALL || inst->opcode == TAC_PARAM) return 0;
+        if (inst->opcode == TAC_PRINT && target->print_is_call) return 0;
+    }
+    return 1;
+}
+
+/* Lay out the frame of one function */
+FrameLayout* build_frame_layout(TACInstruction* start, SymbolTable* symtab, RegisterAllocation* alloc,
+                                const FrameTarget* target, FrameStats* stats) {
+    FrameLayout* frame = (FrameLayout*)safe_calloc(1, sizeof(FrameLayout), "frame layout");
+    int capacity = 16;
+    int word = target->word_size;
+    frame->function = start->opcode == TAC_FUNCTION_LABEL ? start->label : "global";
+    frame->slots = (FrameSlot*)safe_malloc(capacity * sizeof(FrameSlot), "frame layout");
+    frame->names = create_name_table(capacity);
+    frame->word_size = word;
+    frame->leaf = is_leaf_function(start, target);
+    int reserved = frame->leaf ? 0 : target->reserved;
+    int args_offset = frame->leaf ? target->leaf_args_offset : target->args_offset;
+
+    /* Stack arguments stay where the caller put them; register arguments
+     * get a frame slot like locals when they need memory */
+    Symbol* owner = symtab ? lookup_symbol(symtab, frame->function) : NULL;
+    int num_params = owner && owner->kind == SYMBOL_FUNCTION ? owner->param_count : 0;
+    int on_stack = num_params - target->reg_args;
+    for (int p = target->reg_args; p < num_params; p++) {
+        int k = p - target->reg_args;
+        int index = target->last_arg_nearest ? on_stack - 1 - k : k;
+        add_slot(frame, &capacity, owner->param_names[p], 1, 1, args_offset + word * index);
+    }
+
+    /* Callee-saved registers sit right below the reserved area */
+    int used = reserved;
+    frame->saved_offset = -(used + word);
+    if (alloc) used += word * alloc->num_callee_saved_used;
+
+    /* Scalars in first-use order, then arrays; a temporary takes a slot
+     * it can share before a new one */
+    SharedSlot* shared = NULL;
+    int num_shared = 0;
+    int shared_capacity = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        for (TACInstruction* inst = start->next; inst && inst->opcode != TAC_FUNCTION_LABEL;
+             inst = inst->next) {
+            const char* names[5];
+            int count = tac_uses(inst, names);
+            const char* def = tac_def(inst);
+            if (def) names[count++] = def;
+            int first_array = count;
+            if (tac_array(inst)) names[count++] = tac_array(inst);
+
+            for (int n = 0; n < count; n++) {
+                int is_array = n >= first_array;
+                if (is_array != pass || is_number(names[n]) || frame_slot(frame, names[n])) continue;
+
+                int words = local_words(symtab, frame->function, names[n], is_array);
+                if (words < 0 || (!is_array && !needs_home(alloc, names[n]))) continue;
+                if (words < 1) words = 1;
+
+                LiveInterval* interval = is_temp_name(names[n]) ? interval_of(alloc, names[n]) : NULL;
+                int offset = interval ? find_shared_slot(shared, num_shared, interval) : 0;
+                if (offset != 0) {
+                    add_slot(frame, &capacity, names[n], 1, 0, offset);
+                    if (stats) stats->shared++;
+                    continue;
+                }
+
+                used += word * words;
+                add_slot(frame, &capacity, names[n], words, 0, -used);
+                if (interval) {
+                    if (num_shared >= shared_capacity) {
+                        shared_capacity = shared_capacity ? shared_capacity * 2 : 8;
+                        shared = (SharedSlot*)safe_realloc(shared, shared_capacity * sizeof(SharedSlot),
+                                                           "frame layout");
+                    }
+                    SharedSlot* slot = &shared[num_shared++];
+                    slot->offset = -used;
+                    slot->capacity = 4;
+                    slot->count = 1;
+                    slot->members = (LiveInterval**)safe_malloc(slot->capacity * sizeof(LiveInterval*),
+                                                                "frame layout");
+                    slot->members[0] = interval;
+                }
+
+                if (stats && is_array) stats->array_words += words;
+                else if (stats) stats->slots++;
+            }
+        }
+    }
+
+    for (int k = 0; k < num_shared; k++) free(shared[k].members);
+    free(shared);
+
+    frame->size = align_up(used, target->alignment) - reserved;
+    if (frame->leaf && frame->size > target->red_zone) frame->sp_adjust = frame->size;
+    if (stats) {
+        stats->functions++;
+        stats->leaves += frame->leaf;
+        stats->no_adjust += frame->leaf && frame->sp_adjust == 0;
+        stats->bytes += frame->size + reserved;
+    }
+    return frame;
+}
+
+/* Home of a value in the frame */
+FrameSlot* frame_slot(FrameLayout* frame, const char* name) {
+    if (!frame || !name) return NULL;
+    int id = lookup_name_id(frame->names, name);
+    return id >= 0 ? &frame->slots[id] : NULL;
+}
+
+/* Offset of a frame offset from the current stack pointer */
+int stack_pointer_offset(FrameLayout* frame, int offset) {
+    return frame->sp_adjust + offset;
+}
+
+/* Frame pointer offset where callee-saved register k is saved */
+int saved_register_offset(FrameLayout* frame, int k) {
+    return frame->saved_offset - frame->word_size * k;
+}
+
+/* Print the frame statistics */
+void print_frame_stats(FrameStats* stats) {
+    printf("\n================ STACK FRAME STATISTICS ==================\n\n");
+    printf("Frames laid out:           %d\n", stats->functions);
+    printf("  Leaf (no frame pointer): %d\n", stats->leaves);
+    printf("  Stack pointer untouched: %d\n", stats->no_adjust);
+    printf("  Scalar slots:            %d\n", stats->slots);
+    printf("  Temporaries sharing one: %d\n", stats->shared);
+    printf("  Local array words:       %d\n", stats->array_words);
+    printf("  Total frame bytes:       %d\n", stats->bytes);
+    printf("\n==========================================================\n\n");
+}
+
+/* Free a frame layout */
+void free_frame_layout(FrameLayout* frame) {
+    if (!frame) return;
+    free_name_table(frame->names);
+    free(frame->slots);
+    free(frame);
+}
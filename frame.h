@@ -0,0 +1,116 @@
+/*
+ * FRAME.H - Stack Frame Layout Header
+ * CST-405 Compiler Project
+ *
+ * This file defines the stack frame layout the back ends build for each
+ * function right after register allocation. Only globals keep a label:
+ * every value that belongs to a function lives in its frame, at a fixed
+ * offset from the frame pointer (rbp on x86-64, $fp on MIPS):
+ *
+ *        | stack arguments   |  frame pointer + args_offset and up
+ *        | return address... |  (target specific)
+ *   fp ->+-------------------+
+ *        | reserved          |  saved $ra/$fp (MIPS)
+ *        | saved registers   |  callee-saved registers in use
+ *        | scalars           |  register arguments, locals and temporaries,
+ *        |                   |  in first-use order
+ *        | arrays            |  local arrays, element 0 at the lowest address
+ *   sp ->+-------------------+  size rounded up to the target alignment
+ *
+ * Values the register allocator keeps in a register for the whole
+ * function get no slot at all, and temporaries whose live intervals do
+ * not overlap share one, so the frame is only as large as the values
+ * that need memory at the same time. Scalars come before arrays so the hottest
+ * slots sit closest to the frame pointer (short displacements).
+ *
+ * Leaf functions (no calls) set up no frame pointer and save no return
+ * address: offsets are taken from the stack pointer at entry, the
+ * reserved area is empty, and a frame that fits in the target's red zone
+ * (the bytes below the stack pointer a leaf may use) does not even move
+ * the stack pointer.
+ */
+
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ircode.h"
+#include "cfg.h"
+#include "symtable.h"
+#include "regalloc.h"
+
+/* Frame conventions of a target */
+typedef struct {
+    int word_size;              /* Bytes per scalar and array element */
+    int reserved;               /* Bytes just below the frame pointer the prologue uses */
+    int args_offset;            /* Frame pointer offset of the nearest stack argument */
+    int alignment;              /* The reserved area plus the frame is a multiple of this */
+    int reg_args;               /* Leading arguments passed in registers */
+    int last_arg_nearest;       /* Stack arguments pushed in order (else the first is nearest) */
+    int leaf_args_offset;       /* Leaf: offset of the nearest stack argument from the entry stack pointer */
+    int red_zone;               /* Leaf: bytes below the stack pointer usable without moving it */
+    int print_is_call;          /* print calls into the C library (a function using it is no leaf) */
+} FrameTarget;
+
+/* Memory home of one value of the function */
+typedef struct {
+    char* name;                 /* Parameter, local variable, array or temporary */
+    int offset;                 /* Offset from the frame pointer (array: element 0) */
+    int words;                  /* 1, or the number of array elements */
+    int is_param;               /* Argument slot in the caller's frame */
+} FrameSlot;
+
+/* Frame layout of one function */
+typedef struct {
+    const char* function;       /* Function name */
+    FrameSlot* slots;           /* Homes of the function's values */
+    int num_slots;              /* Number of homes */
+    NameTable* names;           /* Per name id: the slot with that index */
+    int saved_offset;           /* Offset of the first callee-saved register slot */
+    int size;                   /* Bytes allocated below the reserved area */
+    int word_size;              /* Bytes per word on the target */
+    int leaf;                   /* No calls: no frame pointer, offsets from the entry stack pointer */
+    int sp_adjust;              /* Leaf: bytes the stack pointer moves down (0: red zone) */
+} FrameLayout;
+
+/* Frame statistics (summed over functions) */
+typedef struct {
+    int functions;              /* Frames laid out */
+    int leaves;                 /* ... of leaf functions (no frame pointer) */
+    int no_adjust;              /* ... that never move the stack pointer (red zone) */
+    int slots;                  /* Scalar slots */
+    int shared;                 /* Temporaries given a slot another temporary uses */
+    int array_words;            /* Words of local arrays */
+    int bytes;                  /* Frame bytes, alignment included */
+} FrameStats;
+
+/* FRAME LAYOUT FUNCTIONS */
+
+/* Lay out the frame of the function starting at 'start' (its FUNCTION
+ * label). 'alloc' (may be NULL) tells which values stay in registers,
+ * which callee-saved registers the prologue saves and where temporaries
+ * are live (temporaries without an interval get a slot of their own). */
+FrameLayout* build_frame_layout(TACInstruction* start, SymbolTable* symtab, RegisterAllocation* alloc,
+                                const FrameTarget* target, FrameStats* stats);
+
+/* Does the function starting at 'start' call nothing? */
+int is_leaf_function(TACInstruction* start, const FrameTarget* target);
+
+/* Offset of a frame offset from the current stack pointer (leaf frames) */
+int stack_pointer_offset(FrameLayout* frame, int offset);
+
+/* Home of a value in the frame (NULL: a global, addressed by its label) */
+FrameSlot* frame_slot(FrameLayout* frame, const char* name);
+
+/* Frame pointer offset where callee-saved register k is saved */
+int saved_register_offset(FrameLayout* frame, int k);
+
+/* Print the frame statistics */
+void print_frame_stats(FrameStats* stats);
+
+/* Free a frame layout */
+void free_frame_layout(FrameLayout* frame);
+
+#endif /* FRAME_H */
@@ -0,0 +1,393 @@
+/*
+ * INLINER.C - Function Inliner Implementation
+ * CST-405 Compiler Project
+ *
+ * This file implements the TAC-level function inliner. A call
+ *   param a1 ... param an; t = call f, n
+ * becomes
+ *   p1 = a1 ... pn = an; <body of f>; Lend:
+ * where the parameters of f are renamed to the temporaries p1..pn, every
+ * temporary, local variable and label of the body gets a new name, and
+ * each return stores its value into t and jumps to Lend.
+ *
+ * Functions are visited callees first, so a body is copied after its
+ * own calls were inlined. Recursive functions are never inlined.
+ */
+
+#include "inliner.h"
+#include "cfg.h"
+#include "diagnostics.h"
+
+/* Inlining limits and the number of instructions inlining has added */
+static InlineOptions inline_options = { 24, 24, 24, 400 };
+static int inline_growth = 0;
+
+/* Set the inlining limits */
+void set_inline_options(const InlineOptions* options) {
+    inline_options = *options;
+}
+
+/* Get the inlining limits */
+InlineOptions get_inline_options(void) {
+    return inline_options;
+}
+
+/* One function of the program */
+typedef struct {
+    TACInstruction* start;   /* FUNCTION label (or the head of the code) */
+    const char* name;        /* Function name (NULL for code before the first function) */
+    Symbol* symbol;          /* Symbol table entry */
+    int num_calls;           /* Call sites calling it */
+    int recursive;           /* Can it reach itself through calls? */
+    int visited;             /* Visit state of the callees-first walk */
+} FunctionInfo;
+
+/* Call graph: calls[f * num_functions + g] is set if f calls g */
+typedef struct {
+    FunctionInfo* functions;
+    int num_functions;
+    char* calls;
+} CallGraph;
+
+/* Helper: Find a function by name (-1 if it is not defined) */
+static int find_function(CallGraph* graph, const char* name) {
+    for (int f = 0; f < graph->num_functions; f++) {
+        if (graph->functions[f].name && strcmp(graph->functions[f].name, name) == 0) return f;
+    }
+    return -1;
+}
+
+/* Helper: Build the call graph of the program */
+static void build_call_graph(TACCode* code, CallGraph* graph) {
+    int count = code->head && code->head->opcode != TAC_FUNCTION_LABEL ? 1 : 0;
+    for (TACInstruction* inst = code->head; inst; inst = inst->next) {
+        if (inst->opcode == TAC_FUNCTION_LABEL) count++;
+    }
+
+    graph->functions = (FunctionInfo*)safe_calloc(count + 1, sizeof(FunctionInfo), "inliner");
+    graph->calls = (char*)safe_calloc(count * count + 1, 1, "inliner");
+    graph->num_functions = 0;
+
+    for (TACInstruction* inst = code->head; inst; inst = inst->next) {
+        if (inst == code->head || inst->opcode == TAC_FUNCTION_LABEL) {
+            FunctionInfo* info = &graph->functions[graph->num_functions++];
+            info->start = inst;
+            if (inst->opcode == TAC_FUNCTION_LABEL) {
+                info->name = inst->label;
+                info->symbol = lookup_symbol(code->symbols, inst->label);
+            }
+        }
+    }
+
+    int caller = -1;
+    for (TACInstruction* inst = code->head; inst; inst = inst->next) {
+        if (inst == code->head || inst->opcode == TAC_FUNCTION_LABEL) caller++;
+        if (inst->opcode != TAC_CALL) continue;
+
+        int callee = find_function(graph, inst->label);
+        if (callee < 0) continue;
+        graph->functions[callee].num_calls++;
+        graph->calls[caller * graph->num_functions + callee] = 1;
+    }
+
+    /* A function is recursive if it can reach itself */
+    char* reached = (char*)safe_malloc(graph->num_functions + 1, "inliner");
+    int* worklist = (int*)safe_malloc((graph->num_functions + 1) * sizeof(int), "inliner");
+    for (int f = 0; f < graph->num_functions; f++) {
+        int top = 0;
+        memset(reached, 0, graph->num_functions);
+        worklist[top++] = f;
+        while (top > 0 && !graph->functions[f].recursive) {
+            int g = worklist[--top];
+            for (int h = 0; h < graph->num_functions; h++) {
+                if (!graph->calls[g * graph->num_functions + h]) continue;
+                if (h == f) graph->functions[f].recursive = 1;
+                if (!reached[h]) {
+                    reached[h] = 1;
+                    worklist[top++] = h;
+                }
+            }
+        }
+    }
+    free(reached);
+    free(worklist);
+}
+
+/* Helper: List functions so that callees come before their callers
+ * (as far as recursion allows) */
+static void callees_first(CallGraph* graph, int f, int* order, int* count) {
+    FunctionInfo* info = &graph->functions[f];
+    if (info->visited) return;
+    info->visited = 1;
+
+    for (int g = 0; g < graph->num_functions; g++) {
+        if (graph->calls[f * graph->num_functions + g]) callees_first(graph, g, order, count);
+    }
+    order[(*count)++] = f;
+}
+
+/* Renaming of the temporaries, locals and labels of one inlined copy */
+typedef struct {
+    NameTable* from;
+    char** to;
+    int capacity;
+    SymbolTable* symbols;    /* To tell the callee's locals from globals */
+} Renamer;
+
+/* Helper: New name of a temporary or label, made on first use */
+static const char* renamed(Renamer* renamer, const char* name, int is_label) {
+    int id = intern_name(renamer->from, name);
+    if (id >= renamer->capacity) {
+        int old_capacity = renamer->capacity;
+        renamer->capacity = (id + 1) * 2;
+        renamer->to = (char**)safe_realloc(renamer->to, renamer->capacity * sizeof(char*), "inliner");
+        for (int k = old_capacity; k < renamer->capacity; k++) renamer->to[k] = NULL;
+    }
+    if (!renamer->to[id]) renamer->to[id] = is_label ? new_label() : new_temp();
+    return renamer->to[id];
+}
+
+/* Helper: Is a name a scalar local of a function (it lives in the
+ * function's frame, so a copy of the body needs its own)? */
+static int is_local_scalar(SymbolTable* symbols, const char* function, const char* name) {
+    Symbol* symbol = symbols ? lookup_symbol_in_scope(symbols, name, function) : NULL;
+    return symbol && !symbol->is_array && strcmp(symbol->scope, function) == 0;
+}
+
+/* Helper: Operand of the copy: parameters, temporaries and locals are renamed */
+static const char* copy_operand(Renamer* renamer, Symbol* callee, char** param_temps,
+                                const char* operand) {
+    if (!operand || is_number(operand)) return operand;
+    for (int p = 0; p < callee->param_count; p++) {
+        if (strcmp(operand, callee->param_names[p]) == 0) return param_temps[p];
+    }
+    if (is_temp_name(operand) || is_local_scalar(renamer->symbols, callee->name, operand)) {
+        return renamed(renamer, operand, 0);
+    }
+    return operand;
+}
+
+/* Helper: Number of instructions in a function body */
+static int function_size(TACInstruction* start) {
+    int size = 0;
+    for (TACInstruction* inst = start->next; inst && inst->opcode != TAC_FUNCTION_LABEL;
+         inst = inst->next) {
+        size++;
+    }
+    return size;
+}
+
+/* Helper: Can the body of a function be copied? Parameters must be
+ * plain scalars (never used as an array) and arrays must not be local
+ * (they live in the callee's frame). */
+static int is_inlinable(FunctionInfo* info, SymbolTable* symbols) {
+    if (!info->name || !info->symbol || info->symbol->kind != SYMBOL_FUNCTION) return 0;
+    if (info->recursive || strcmp(info->name, "main") == 0) return 0;
+
+    for (TACInstruction* inst = info->start->next; inst && inst->opcode != TAC_FUNCTION_LABEL;
+         inst = inst->next) {
+        const char* array = tac_array(inst);
+        if (!array) continue;
+        Symbol* symbol = lookup_symbol_in_scope(symbols, array, info->name);
+        if (symbol && strcmp(symbol->scope, info->name) == 0) return 0;
+        for (int p = 0; p < info->symbol->param_count; p++) {
+            if (strcmp(array, info->symbol->param_names[p]) == 0) return 0;
+        }
+    }
+    return 1;
+}
+
+/* Helper: Does the caller have a local of the name of a global the
+ * callee uses? The copy would then read and write the local. */
+static int shadows_callee_global(FunctionInfo* callee, const char* caller, SymbolTable* symbols) {
+    if (!caller) return 0;
+    for (TACInstruction* inst = callee->start->next; inst && inst->opcode != TAC_FUNCTION_LABEL;
+         inst = inst->next) {
+        const char* operands[3] = { inst->result, inst->op1, inst->op2 };
+        for (int k = 0; k < 3; k++) {
+            const char* name = operands[k];
+            if (!name || is_number(name) || is_temp_name(name)) continue;
+            Symbol* used = lookup_symbol_in_scope(symbols, name, callee->name);
+            if (!used || strcmp(used->scope, "global") != 0) continue;
+            Symbol* seen = lookup_symbol_in_scope(symbols, name, caller);
+            if (seen && strcmp(seen->scope, "global") != 0) return 1;
+        }
+    }
+    return 0;
+}
+
+/* Helper: Replace one call with a copy of the callee body. Returns the
+ * change in instruction count, or -1 if the call was left alone. */
+static int inline_call(TACCode* code, TACInstruction* caller_start, TACInstruction* call,
+                       FunctionInfo* callee) {
+    Symbol* symbol = callee->symbol;
+    int num_args = atoi(call->op1);
+    if (num_args != symbol->param_count) return -1;
+
+    /* Find the params of this call: those not consumed by an earlier call */
+    TACInstruction** params = (TACInstruction**)safe_malloc(
+        (code->instruction_count + 1) * sizeof(TACInstruction*), "inliner");
+    int num_params = 0;
+    TACInstruction* prev = NULL;
+    for (TACInstruction* inst = caller_start; inst != call; inst = inst->next) {
+        if (inst->opcode == TAC_PARAM) params[num_params++] = inst;
+        if (inst->opcode == TAC_CALL) {
+            num_params -= atoi(inst->op1);
+            if (num_params < 0) num_params = 0;
+        }
+        prev = inst;
+    }
+    if (num_params < num_args) {
+        free(params);
+        return -1;
+    }
+
+    /* Arguments are copied into the parameter temporaries */
+    char** param_temps = (char**)safe_malloc((num_args + 1) * sizeof(char*), "inliner");
+    for (int p = 0; p < num_args; p++) {
+        TACInstruction* param = params[num_params - num_args + p];
+        param_temps[p] = new_temp();
+        param->opcode = TAC_ASSIGN;
+        param->result = strdup(param_temps[p]);
+    }
+    free(params);
+
+    /* Copy the body after the call, then drop the call */
+    Renamer renamer;
+    renamer.from = create_name_table(32);
+    renamer.to = NULL;
+    renamer.capacity = 0;
+    renamer.symbols = code->symbols;
+
+    char* end_label = new_label();
+    TACInstruction* pos = call;
+    int added = 0;
+
+    for (TACInstruction* inst = callee->start->next; inst && inst->opcode != TAC_FUNCTION_LABEL;
+         inst = inst->next) {
+        int is_last = !inst->next || inst->next->opcode == TAC_FUNCTION_LABEL;
+        TACInstruction* copy;
+
+        if (inst->opcode == TAC_RETURN || inst->opcode == TAC_RETURN_VOID) {
+            if (inst->opcode == TAC_RETURN && call->result) {
+                copy = create_tac_instruction(TAC_ASSIGN, call->result,
+                                              copy_operand(&renamer, symbol, param_temps, inst->op1),
+                                              NULL, NULL);
+                insert_tac_after(code, pos, copy);
+                pos = copy;
+                added++;
+            }
+            if (is_last) continue;
+            copy = create_tac_instruction(TAC_GOTO, NULL, NULL, NULL, end_label);
+        } else {
+            const char* label = inst->label;
+            if (inst->opcode == TAC_LABEL || inst->opcode == TAC_GOTO || inst->opcode == TAC_IF_FALSE) {
+                label = renamed(&renamer, inst->label, 1);
+            }
+            copy = create_tac_instruction(inst->opcode,
+                                          copy_operand(&renamer, symbol, param_temps, inst->result),
+                                          copy_operand(&renamer, symbol, param_temps, inst->op1),
+                                          copy_operand(&renamer, symbol, param_temps, inst->op2),
+                                          label);
+            copy->line = inst->line;
+        }
+        insert_tac_after(code, pos, copy);
+        pos = copy;
+        added++;
+    }
+    insert_tac_after(code, pos, create_tac_instruction(TAC_LABEL, NULL, NULL, NULL, end_label));
+
+    if (prev) prev->next = call->next;
+    else code->head = call->next;
+    free_tac_instruction(call);
+    code->instruction_count--;
+
+    for (int k = 0; k < renamer.capacity; k++) free(renamer.to[k]);
+    free(renamer.to);
+    free_name_table(renamer.from);
+    for (int p = 0; p < num_args; p++) free(param_temps[p]);
+    free(param_temps);
+    free(end_label);
+    return added;
+}
+
+/* Helper: Loop depth of every call in a function */
+static int collect_call_sites(TACInstruction* start, TACInstruction** calls, int* depths) {
+    LoopForest* forest;
+    CFG* cfg = get_function_loops(start, &forest);
+    int count = 0;
+
+    for (int b = 0; b < cfg->num_blocks; b++) {
+        BasicBlock* blk = &cfg->blocks[b];
+        int loop = forest->innermost[b];
+        for (int i = blk->start; i < blk->start + blk->count; i++) {
+            if (cfg->insts[i]->opcode != TAC_CALL) continue;
+            calls[count] = cfg->insts[i];
+            depths[count++] = loop >= 0 ? forest->loops[loop].depth : 0;
+        }
+    }
+
+    release_analyses(cfg, forest, NULL);
+    return count;
+}
+
+/* Inline calls to small, non-recursive functions */
+int inline_functions(TACCode* code) {
+    if (!code->symbols || !code->head) return 0;
+
+    CallGraph graph;
+    build_call_graph(code, &graph);
+
+    int* order = (int*)safe_malloc((graph.num_functions + 1) * sizeof(int), "inliner");
+    int num_ordered = 0;
+    for (int f = 0; f < graph.num_functions; f++) callees_first(&graph, f, order, &num_ordered);
+
+    int inlined = 0;
+
+    for (int k = 0; k < num_ordered; k++) {
+        FunctionInfo* caller = &graph.functions[order[k]];
+        TACInstruction** calls = (TACInstruction**)safe_malloc(
+            (code->instruction_count + 1) * sizeof(TACInstruction*), "inliner");
+        int* depths = (int*)safe_malloc((code->instruction_count + 1) * sizeof(int), "inliner");
+        int num_calls = collect_call_sites(caller->start, calls, depths);
+        int inlined_here = 0;
+
+        for (int c = 0; c < num_calls; c++) {
+            int f = find_function(&graph, calls[c]->label);
+            if (f < 0 || f == order[k] || !is_inlinable(&graph.functions[f], code->symbols)) continue;
+            if (shadows_callee_global(&graph.functions[f], caller->name, code->symbols)) {
+                debug_print("Inliner: Not inlining %s (%s shadows one of its globals)",
+                            graph.functions[f].name, caller->name);
+                continue;
+            }
+
+            FunctionInfo* callee = &graph.functions[f];
+            int size = function_size(callee->start);
+            int limit = inline_options.max_callee_size + depths[c] * inline_options.loop_size_bonus +
+                        (callee->num_calls == 1 ? inline_options.single_call_bonus : 0);
+            if (size > limit || inline_growth + size > inline_options.growth_budget) {
+                debug_print("Inliner: Not inlining %s (%d instructions, limit %d)",
+                            callee->name, size, limit);
+                continue;
+            }
+
+            int added = inline_call(code, caller->start, calls[c], callee);
+            if (added < 0) continue;
+
+            inline_growth += added;
+            inlined++;
+            inlined_here++;
+            printf("[OPTIMIZER] Inlining: Inlined call to %s in %s (%d instructions, loop depth %d)\n",
+                   callee->name, caller->name ? caller->name : "global code", added, depths[c]);
+        }
+
+        if (inlined_here > 0) invalidate_function_analyses(caller->start);
+        free(calls);
+        free(depths);
+    }
+
+    free(order);
+    free(graph.functions);
+    free(graph.calls);
+    return inlined;
+}
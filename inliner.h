@@ -0,0 +1,38 @@
+/*
+ * INLINER.H - Function Inliner Header
+ * CST-405 Compiler Project
+ *
+ * This file defines the TAC-level function inliner, which replaces
+ * calls to small functions with a copy of the callee body. Parameters
+ * and the return value become temporaries and the labels of each copy
+ * are renamed, so the optimizer can fold the body into the caller.
+ */
+
+#ifndef INLINER_H
+#define INLINER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ircode.h"
+
+/* Inlining limits */
+typedef struct {
+    int max_callee_size;     /* Largest callee (in TAC instructions) inlined at any call site */
+    int loop_size_bonus;     /* Extra callee size allowed per loop around the call site */
+    int single_call_bonus;   /* Extra callee size allowed when it is the callee's only call */
+    int growth_budget;       /* Most instructions inlining may add to the program */
+} InlineOptions;
+
+/* INLINING FUNCTIONS */
+
+/* Inline calls to small, non-recursive functions. Needs code->symbols
+ * for the parameter names. Returns the number of call sites inlined. */
+int inline_functions(TACCode* code);
+
+/* Get/set the inlining limits (defaults: 24-instruction callees, +24 per
+ * enclosing loop, +24 for a single call site, 400 added instructions) */
+InlineOptions get_inline_options(void);
+void set_inline_options(const InlineOptions* options);
+
+#endif /* INLINER_H */
@@ -8,10 +8,15 @@
  */
 
 #include "ircode.h"
+#include <ctype.h>
 
-/* Global counters for generating unique names */
+/* Global counters for generating unique names (temporaries: unique per function) */
 int temp_count = 0;
 int label_count = 0;
+static int temp_high = 0;     /* Most temporaries any function has used so far */
+
+/* Source line of the statement being translated (0 outside generation) */
+static int current_line = 0;
 
 /* Create a new empty TAC code list */
 TACCode* create_tac_code() {
@@ -23,10 +28,14 @@ TACCode* create_tac_code() {
     code->head = NULL;
     code->tail = NULL;
     code->instruction_count = 0;
+    code->element_size = 8;     /* x86-64 quadwords unless the driver says otherwise */
+    code->symbols = NULL;
     return code;
 }
 
-/* Generate a new temporary variable name: t0, t1, t2, ... */
+/* Generate a new temporary variable name: t0, t1, t2, ...
+ * Numbering restarts at each function, so temporary names are unique
+ * within their function only */
 char* new_temp() {
     char* temp = (char*)malloc(20);
     snprintf(temp, 20, "t%d", temp_count++);
@@ -57,6 +66,8 @@ TACInstruction* create_tac_instruction(TACOpcode opcode,
     inst->op1 = op1 ? strdup(op1) : NULL;
     inst->op2 = op2 ? strdup(op2) : NULL;
     inst->label = label ? strdup(label) : NULL;
+    inst->line = current_line;
+    inst->checks = 0;
     inst->next = NULL;
 
     return inst;
@@ -79,19 +90,14 @@ void append_tac(TACCode* code, TACInstruction* inst) {
 /* Generate TAC for an expression - returns name of result variable/temp */
 char* gen_expression(ASTNode* node, TACCode* code) {
     if (!node) return NULL;
+    if (node->line_number > 0) current_line = node->line_number;
 
     switch (node->type) {
         case NODE_NUMBER: {
-            /* Integer literal: create temp and load constant */
-            char* temp = new_temp();
+            /* Integer literal: an immediate operand of its user, no temp */
             char num_str[20];
             snprintf(num_str, 20, "%d", node->data.num_value);
-
-            TACInstruction* inst = create_tac_instruction(TAC_LOAD_CONST,
-                                                          temp, num_str,
-                                                          NULL, NULL);
-            append_tac(code, inst);
-            return temp;
+            return strdup(num_str);
         }
 
         case NODE_IDENTIFIER: {
@@ -216,16 +222,33 @@ char* gen_expression(ASTNode* node, TACCode* code) {
 void gen_statement(ASTNode* node, TACCode* code) {
     if (!node) return;
 
+    /* Instructions after a nested statement belong to this one again */
+    int saved_line = current_line;
+    if (node->line_number > 0) current_line = node->line_number;
+
     switch (node->type) {
         case NODE_DECLARATION:
             /* Declarations don't generate code - handled by symbol table */
             break;
 
         case NODE_ASSIGNMENT: {
-            /* Assignment: var = expr */
+            if (node->data.assignment.index) {
+                /* Array element assignment: arr[index] = expr */
+                char* index = gen_expression(node->data.assignment.index, code);
+                char* value = gen_expression(node->data.assignment.expr, code);
+
+                /* TAC_ARRAY_STORE: array[index] = value (result, op1, op2) */
+                TACInstruction* store = create_tac_instruction(TAC_ARRAY_STORE,
+                                                               node->data.assignment.var_name,
+                                                               index, value, NULL);
+                append_tac(code, store);
+                break;
+            }
+
+            /* Assignment: var = expr (var = constant for a literal) */
             char* expr_result = gen_expression(node->data.assignment.expr, code);
 
-            TACInstruction* inst = create_tac_instruction(TAC_ASSIGN,
+            TACInstruction* inst = create_tac_instruction(is_number(expr_result) ? TAC_LOAD_CONST : TAC_ASSIGN,
                                                           node->data.assignment.var_name,
                                                           expr_result,
                                                           NULL, NULL);
@@ -489,6 +512,10 @@ void gen_statement(ASTNode* node, TACCode* code) {
 
             char* func_name = node->data.function.func_name;
 
+            /* Temporaries are numbered per function */
+            if (temp_count > temp_high) temp_high = temp_count;
+            temp_count = 0;
+
             /* Generate function label */
             TACInstruction* func_label = create_tac_instruction(TAC_FUNCTION_LABEL,
                                                                 NULL, NULL,
@@ -595,6 +622,8 @@ void gen_statement(ASTNode* node, TACCode* code) {
         default:
             break;
     }
+
+    current_line = saved_line;
 }
 
 /* Generate TAC for the entire program */
@@ -605,6 +634,7 @@ TACCode* generate_tac(ASTNode* root) {
 
     /* Reset counters for each compilation */
     temp_count = 0;
+    temp_high = 0;
     label_count = 0;
 
     if (root && root->type == NODE_PROGRAM) {
@@ -622,6 +652,10 @@ TACCode* generate_tac(ASTNode* root) {
         }
     }
 
+    /* Temporaries the optimizer adds later are new in every function */
+    if (temp_count < temp_high) temp_count = temp_high;
+
+    current_line = 0;
     printf("Generated %d TAC instructions\n", code->instruction_count);
     printf("\n=========== INTERMEDIATE CODE GENERATION COMPLETE =========\n");
 
@@ -650,10 +684,164 @@ const char* opcode_to_string(TACOpcode opcode) {
         case TAC_CALL:        return "CALL";
         case TAC_RETURN:      return "RETURN";
         case TAC_RETURN_VOID: return "RETURN_VOID";
+        case TAC_ARRAY_LOAD_OFFSET:  return "ARRAY_LOAD_OFFSET";
+        case TAC_ARRAY_STORE_OFFSET: return "ARRAY_STORE_OFFSET";
+        case TAC_CHECK_BOUNDS:  return "CHECK_BOUNDS";
+        case TAC_CHECK_DIVISOR: return "CHECK_DIVISOR";
         default:             return "UNKNOWN";
     }
 }
 
+/* Check if an operand string represents an integer literal */
+int is_number(const char* str) {
+    if (!str || *str == '\0') return 0;
+
+    /* Handle negative numbers */
+    if (*str == '-') str++;
+    if (*str == '\0') return 0;
+
+    /* Check if all remaining characters are digits */
+    while (*str) {
+        if (!isdigit((unsigned char)*str)) return 0;
+        str++;
+    }
+    return 1;
+}
+
+/* Check if a name is a compiler temporary: 't' followed by digits */
+int is_temp_name(const char* name) {
+    if (!name || name[0] != 't' || name[1] == '\0') return 0;
+    for (const char* p = name + 1; *p; p++) {
+        if (!isdigit((unsigned char)*p)) return 0;
+    }
+    return 1;
+}
+
+/* Get the scalar variable written by an instruction */
+const char* tac_def(TACInstruction* inst) {
+    switch (inst->opcode) {
+        case TAC_ADD:
+        case TAC_SUB:
+        case TAC_MUL:
+        case TAC_DIV:
+        case TAC_MOD:
+        case TAC_ASSIGN:
+        case TAC_LOAD_CONST:
+        case TAC_RELOP:
+        case TAC_ARRAY_LOAD:
+        case TAC_ARRAY_LOAD_OFFSET:
+        case TAC_CALL:
+            return inst->result;
+        default:
+            return NULL;
+    }
+}
+
+/* Collect the scalar variables read by an instruction */
+int tac_uses(TACInstruction* inst, const char* uses[3]) {
+    const char* candidates[3] = { NULL, NULL, NULL };
+
+    switch (inst->opcode) {
+        case TAC_ADD:
+        case TAC_SUB:
+        case TAC_MUL:
+        case TAC_DIV:
+        case TAC_MOD:
+        case TAC_RELOP:
+        case TAC_ARRAY_STORE:
+        case TAC_ARRAY_STORE_OFFSET:
+            /* Binary forms read op1 and op2 (ARRAY_STORE: index, value) */
+            candidates[0] = inst->op1;
+            candidates[1] = inst->op2;
+            break;
+        case TAC_ASSIGN:
+        case TAC_PRINT:
+        case TAC_PARAM:
+        case TAC_RETURN:
+        case TAC_IF_FALSE:
+            candidates[0] = inst->op1;
+            break;
+        case TAC_ARRAY_LOAD:
+        case TAC_ARRAY_LOAD_OFFSET:
+            /* op1 is the array itself, op2 the index */
+            candidates[0] = inst->op2;
+            break;
+        case TAC_CHECK_BOUNDS:
+            /* The guard compares op1 with op2; result is the array */
+            candidates[0] = inst->op1;
+            candidates[1] = inst->op2;
+            break;
+        case TAC_CHECK_DIVISOR:
+            candidates[0] = inst->op1;
+            candidates[1] = inst->op2;
+            candidates[2] = inst->result;
+            break;
+        default:
+            break;
+    }
+
+    int count = 0;
+    for (int i = 0; i < 3; i++) {
+        if (candidates[i] && !is_number(candidates[i])) {
+            uses[count++] = candidates[i];
+        }
+    }
+    return count;
+}
+
+/* Get the array accessed by an array instruction */
+const char* tac_array(TACInstruction* inst) {
+    if (inst->opcode == TAC_ARRAY_LOAD || inst->opcode == TAC_ARRAY_LOAD_OFFSET) {
+        return inst->op1;
+    }
+    if (inst->opcode == TAC_ARRAY_STORE || inst->opcode == TAC_ARRAY_STORE_OFFSET) {
+        return inst->result;
+    }
+    return NULL;
+}
+
+/* Mirror a relational operator (a op b is b mirror(op) a) */
+const char* mirror_relop(const char* op) {
+    if (strcmp(op, "<") == 0) return ">";
+    if (strcmp(op, ">") == 0) return "<";
+    if (strcmp(op, "<=") == 0) return ">=";
+    if (strcmp(op, ">=") == 0) return "<=";
+    return op;
+}
+
+/* Check if a call is directly followed by a return of its result */
+int is_tail_call(TACInstruction* call) {
+    TACInstruction* next = call->next;
+    if (call->opcode != TAC_CALL || !next) return 0;
+    if (next->opcode == TAC_RETURN_VOID) return 1;
+    return next->opcode == TAC_RETURN && call->result && strcmp(next->op1, call->result) == 0;
+}
+
+/* Insert an instruction after 'pos' (or at the head of the list) */
+void insert_tac_after(TACCode* code, TACInstruction* pos, TACInstruction* inst) {
+    if (!pos) {
+        inst->next = code->head;
+        code->head = inst;
+        if (!code->tail) code->tail = inst;
+    } else {
+        inst->next = pos->next;
+        pos->next = inst;
+        if (code->tail == pos) code->tail = inst;
+        if (!inst->line) inst->line = pos->line;
+    }
+    code->instruction_count++;
+}
+
+/* Free a single (already unlinked) instruction */
+void free_tac_instruction(TACInstruction* inst) {
+    if (!inst) return;
+    free(inst->result);
+    free(inst->op1);
+    free(inst->op2);
+    free(inst->label);
+    free(inst);
+}
+
 /* Print the TAC code in a readable format */
 void print_tac(TACCode* code) {
     printf("\n=============== THREE-ADDRESS CODE (TAC) ==================\n\n");
@@ -721,6 +909,26 @@ void print_tac(TACCode* code) {
                        current->result, current->op1, current->op2);
                 break;
 
+            case TAC_ARRAY_LOAD_OFFSET:
+                printf(" %-10s %-10s %-10s (load at byte offset)\n",
+                       current->result, current->op1, current->op2);
+                break;
+
+            case TAC_ARRAY_STORE_OFFSET:
+                printf(" %-10s %-10s %-10s (store at byte offset)\n",
+                       current->result, current->op1, current->op2);
+                break;
+
+            case TAC_CHECK_BOUNDS:
+                printf(" %-10s %-10s %-10s (bounds check if %s)\n",
+                       current->result, current->op1, current->op2, current->label);
+                break;
+
+            case TAC_CHECK_DIVISOR:
+                printf(" %-10s %-10s %-10s (divisor check if %s)\n",
+                       current->result, current->op1, current->op2, current->label);
+                break;
+
             case TAC_FUNCTION_LABEL:
                 printf(" %-10s %-10s %-10s %-10s\n",
                        "-", "-", "-", current->label);
@@ -9,6 +9,8 @@
  * Three-Address Code Format:
  *   result = operand1 op operand2
  *   Each instruction has at most 3 addresses (result, op1, op2)
+ *   An operand is a variable, a temporary or an integer literal
+ *   (immediate): "x = x + 1" is the single instruction ADD t1, x, 1
  */
 
 #ifndef IRCODE_H
@@ -40,9 +42,18 @@ typedef enum {
     TAC_PARAM,         /* param value */
     TAC_CALL,          /* result = call function_name, num_args */
     TAC_RETURN,        /* return value */
-    TAC_RETURN_VOID    /* return (no value) */
+    TAC_RETURN_VOID,   /* return (no value) */
+    TAC_ARRAY_LOAD_OFFSET, /* result = array at byte offset op2 (result, arr, offset) */
+    TAC_ARRAY_STORE_OFFSET, /* array at byte offset op1 = op2 (arr, offset, value) */
+    TAC_CHECK_BOUNDS,  /* Loop check: if op1 label op2, trap unless every index
+                        * below (<) or up to (<=) op2 fits array 'result' */
+    TAC_CHECK_DIVISOR  /* Loop check: if op1 label op2, trap if divisor 'result' is 0 */
 } TACOpcode;
 
+/* Runtime checks an instruction needs in --checked mode (TACInstruction.checks) */
+#define CHECK_BOUNDS   1   /* Array index within the array */
+#define CHECK_DIVISOR  2   /* Divisor is not zero */
+
 /* Three-Address Code Instruction */
 typedef struct TACInstruction {
     TACOpcode opcode;                /* Operation type */
@@ -50,6 +61,8 @@ typedef struct TACInstruction {
     char* op1;                       /* First operand */
     char* op2;                       /* Second operand (if needed) */
     char* label;                     /* Label (for jumps and labels) */
+    int line;                        /* Source line (0 if unknown) */
+    int checks;                      /* Runtime checks to emit (CHECK_* flags) */
     struct TACInstruction* next;     /* Next instruction in sequence */
 } TACInstruction;
 
@@ -58,6 +71,8 @@ typedef struct {
     TACInstruction* head;            /* First instruction */
     TACInstruction* tail;            /* Last instruction (for efficient append) */
     int instruction_count;           /* Number of instructions */
+    int element_size;                /* Bytes per array element on the target */
+    SymbolTable* symbols;            /* Program symbols (function parameters), may be NULL */
 } TACCode;
 
 /* Temporary variable and label generation */
@@ -69,7 +84,9 @@ extern int label_count;              /* Counter for labels */
 /* Create a new TAC code list */
 TACCode* create_tac_code();
 
-/* Generate a new temporary variable name (t0, t1, t2, ...) */
+/* Generate a new temporary variable name (t0, t1, t2, ...). Names are
+ * unique within a function: generation restarts the numbering at each
+ * function, and temporaries made later continue past the largest one. */
 char* new_temp();
 
 /* Generate a new label name (L0, L1, L2, ...) */
@@ -104,4 +121,36 @@ void free_tac(TACCode* code);
 /* Get string representation of opcode (for debugging) */
 const char* opcode_to_string(TACOpcode opcode);
 
+/* TAC UTILITY FUNCTIONS (used by the optimizer and code generators) */
+
+/* Check if an operand is an integer literal */
+int is_number(const char* str);
+
+/* Check if an operand is a compiler temporary (t0, t1, ...) */
+int is_temp_name(const char* name);
+
+/* Get the scalar variable written by an instruction (NULL if none) */
+const char* tac_def(TACInstruction* inst);
+
+/* Collect the scalar variables read by an instruction (literals excluded)
+ * Returns the number of entries stored in uses (at most 3) */
+int tac_uses(TACInstruction* inst, const char* uses[3]);
+
+/* Get the array accessed by an ARRAY_LOAD/ARRAY_STORE (NULL otherwise) */
+const char* tac_array(TACInstruction* inst);
+
+/* Mirror a relational operator: 'a op b' is 'b mirror_relop(op) a' */
+const char* mirror_relop(const char* op);
+
+/* Check if a CALL is a tail call: directly followed by a return of its
+ * result (or by a void return) */
+int is_tail_call(TACInstruction* call);
+
+/* Insert an instruction after 'pos' (at the head if pos is NULL); an
+ * instruction without a source line takes the line of 'pos' */
+void insert_tac_after(TACCode* code, TACInstruction* pos, TACInstruction* inst);
+
+/* Free a single instruction (it must already be unlinked) */
+void free_tac_instruction(TACInstruction* inst);
+
 #endif /* IRCODE_H */
@@ -0,0 +1,494 @@
+/*
+ * ISEL.C - Tree Pattern Instruction Selection Implementation
+ * CST-405 Compiler Project
+ *
+ * This file rebuilds expression trees from the TAC of a function and
+ * labels them with the cheapest cover of a target grammar. The labeler
+ * is the bottom-up dynamic program of BURS code generators (lburg,
+ * Fraser and Hanson): each node records, per nonterminal, the cheapest
+ * rule deriving it, with chain rules ("reg: mem") closed over until
+ * nothing improves. Emitting the instructions is left to the target.
+ */
+
+#include "isel.h"
+#include "cfg.h"
+#include "diagnostics.h"
+
+#define ISEL_INFINITE 1000000
+
+/* Operator names used in patterns, indexed by IselOp */
+static const char* const op_names[ISEL_NUM_OPS] = {
+    "CONST", "VALUE", "ADD", "SUB", "MUL", "RELOP", "ELEMENT", "SET", "STORE", "IF_FALSE"
+};
+
+/* ============================================================ */
+/* TREE BUILDING                                                 */
+/* ============================================================ */
+
+/* State of the tree builder for one function */
+typedef struct {
+    TACInstruction** insts;     /* Instructions of the function */
+    NameTable* names;           /* Names of the function */
+    int* defs;                  /* Per name id: definitions */
+    int* uses;                  /* Per name id: uses */
+    IselForest* forest;         /* Forest being built */
+    int first;                  /* First instruction of the tree being built */
+} TreeBuilder;
+
+/* Helper: New tree node */
+static IselNode* new_node(IselOp op, const char* name, IselNode* left, IselNode* right) {
+    IselNode* node = (IselNode*)safe_calloc(1, sizeof(IselNode), "instruction selection");
+    node->op = op;
+    node->name = name;
+    node->kids[0] = left;
+    node->kids[1] = right;
+
+    /* Sethi-Ullman: a left leaf needs a register, a right leaf can be an
+     * operand of the instruction */
+    if (left && right) {
+        int l = left->kids[0] ? left->need : 1;
+        int r = right->need;
+        node->need = l == r ? l + 1 : (l > r ? l : r);
+    } else if (left) {
+        node->need = left->kids[0] ? left->need : 1;
+    }
+    return node;
+}
+
+/* Helper: Free a tree */
+static void free_tree(IselNode* node) {
+    if (!node) return;
+    free_tree(node->kids[0]);
+    free_tree(node->kids[1]);
+    free(node);
+}
+
+/* Helper: Does an instruction compute a value a tree can hold? Array
+ * accesses with a runtime bounds check keep their template. */
+static int is_tree_value(TACInstruction* inst) {
+    switch (inst->opcode) {
+        case TAC_LOAD_CONST: case TAC_ASSIGN: case TAC_ADD: case TAC_SUB: case TAC_MUL: case TAC_RELOP:
+            return 1;
+        case TAC_ARRAY_LOAD: case TAC_ARRAY_LOAD_OFFSET:
+            return !(inst->checks & CHECK_BOUNDS);
+        default:
+            return 0;
+    }
+}
+
+/* Helper: Is an instruction an array store a tree can root? */
+static int is_tree_store(TACInstruction* inst) {
+    return (inst->opcode == TAC_ARRAY_STORE || inst->opcode == TAC_ARRAY_STORE_OFFSET) &&
+           !(inst->checks & CHECK_BOUNDS);
+}
+
+/* Helper: Can 'name' be folded into its user, defined by 'inst'? */
+static int can_fold(TreeBuilder* b, TACInstruction* inst, const char* name) {
+    if (!is_tree_value(inst) || !inst->result || strcmp(inst->result, name) != 0) return 0;
+    if (!is_temp_name(name)) return 0;
+    int id = lookup_name_id(b->names, name);
+    return id >= 0 && b->defs[id] == 1 && b->uses[id] == 1;
+}
+
+static IselNode* build_expression(TreeBuilder* b, TACInstruction* inst);
+static IselNode* build_operand(TreeBuilder* b, const char* name);
+
+/* Helper: Tree of an array element: array[index], with the index scaled
+ * by the element size (8), or a byte offset (scale 1) */
+static IselNode* build_element(TreeBuilder* b, const char* array, const char* index, int scale) {
+    IselNode* element = new_node(ISEL_ELEMENT, array, build_operand(b, index), NULL);
+    element->value = scale;
+    return element;
+}
+
+/* Helper: Tree of an operand: the expression of the temporary defined
+ * right before the tree, or a leaf */
+static IselNode* build_operand(TreeBuilder* b, const char* name) {
+    if (is_number(name)) {
+        IselNode* node = new_node(ISEL_CONST, NULL, NULL, NULL);
+        node->value = atoll(name);
+        return node;
+    }
+
+    int j = b->first - 1;
+    if (j >= 1 && can_fold(b, b->insts[j], name)) {
+        int saved = b->first;
+        b->first = j;
+        b->forest->folded[j] = 1;
+        IselNode* node = build_expression(b, b->insts[j]);
+        if (node->need < ISEL_MAX_NEED) return node;
+
+        /* Too many registers: the temporary stays */
+        free_tree(node);
+        for (int k = j; k < saved; k++) b->forest->folded[k] = 0;
+        b->first = saved;
+    }
+    return new_node(ISEL_VALUE, name, NULL, NULL);
+}
+
+/* Helper: Tree of the value an instruction computes. Operands are built
+ * right to left: the right one was computed last. */
+static IselNode* build_expression(TreeBuilder* b, TACInstruction* inst) {
+    IselOp op;
+    switch (inst->opcode) {
+        case TAC_LOAD_CONST:
+        case TAC_ASSIGN:
+            return build_operand(b, inst->op1);
+        case TAC_ADD: op = ISEL_ADD; break;
+        case TAC_SUB: op = ISEL_SUB; break;
+        case TAC_MUL: op = ISEL_MUL; break;
+        case TAC_ARRAY_LOAD:
+            return build_element(b, inst->op1, inst->op2, 8);
+        case TAC_ARRAY_LOAD_OFFSET:
+            return build_element(b, inst->op1, inst->op2, 1);
+        default: op = ISEL_RELOP; break;
+    }
+
+    IselNode* right = build_operand(b, inst->op2);
+    IselNode* left = build_operand(b, inst->op1);
+    const char* name = op == ISEL_RELOP ? inst->label : NULL;
+
+    /* Constants go on the right, where instructions take immediates */
+    if (left->op == ISEL_CONST && right->op != ISEL_CONST && op != ISEL_SUB) {
+        IselNode* swap = left;
+        left = right;
+        right = swap;
+        if (op == ISEL_RELOP) name = mirror_relop(name);
+    }
+    return new_node(op, name, left, right);
+}
+
+/* Helper: Count the definitions and uses of each name in the function */
+static void count_names(TreeBuilder* b, int num_insts) {
+    int capacity = 64;
+    b->defs = (int*)safe_calloc(capacity, sizeof(int), "instruction selection");
+    b->uses = (int*)safe_calloc(capacity, sizeof(int), "instruction selection");
+    for (int i = 1; i < num_insts; i++) {
+        const char* names[4];
+        int count = tac_uses(b->insts[i], names);
+        const char* def = tac_def(b->insts[i]);
+        if (def) names[count++] = def;
+
+        for (int n = 0; n < count; n++) {
+            int id = intern_name(b->names, names[n]);
+            if (id >= capacity) {
+                int old = capacity;
+                while (id >= capacity) capacity *= 2;
+                b->defs = (int*)safe_realloc(b->defs, capacity * sizeof(int), "instruction selection");
+                b->uses = (int*)safe_realloc(b->uses, capacity * sizeof(int), "instruction selection");
+                memset(b->defs + old, 0, (capacity - old) * sizeof(int));
+                memset(b->uses + old, 0, (capacity - old) * sizeof(int));
+            }
+            if (def && n == count - 1) b->defs[id]++;
+            else b->uses[id]++;
+        }
+    }
+}
+
+/* Build the trees of a function */
+IselForest* build_isel_forest(TACInstruction* start, IselStats* stats) {
+    int num_insts = 1;
+    for (TACInstruction* inst = start->next; inst && inst->opcode != TAC_FUNCTION_LABEL; inst = inst->next) {
+        num_insts++;
+    }
+
+    TreeBuilder b;
+    b.insts = (TACInstruction**)safe_malloc(num_insts * sizeof(TACInstruction*), "instruction selection");
+    b.insts[0] = start;
+    for (int i = 1; i < num_insts; i++) b.insts[i] = b.insts[i - 1]->next;
+    b.names = create_name_table(num_insts);
+    count_names(&b, num_insts);
+
+    IselForest* forest = (IselForest*)safe_calloc(1, sizeof(IselForest), "instruction selection");
+    forest->num_insts = num_insts;
+    forest->roots = (IselNode**)safe_calloc(num_insts, sizeof(IselNode*), "instruction selection");
+    forest->folded = (char*)safe_calloc(num_insts, 1, "instruction selection");
+    b.forest = forest;
+
+    /* Last instruction first, so each tree swallows the temporaries
+     * computed right before it */
+    for (int i = num_insts - 1; i >= 1; i--) {
+        TACInstruction* inst = b.insts[i];
+        if (!is_tree_value(inst) && !is_tree_store(inst) && inst->opcode != TAC_IF_FALSE) continue;
+
+        b.first = i;
+        IselNode* root;
+        if (is_tree_store(inst)) {
+            /* The value was computed after the index */
+            IselNode* value = build_operand(&b, inst->op2);
+            int scale = inst->opcode == TAC_ARRAY_STORE ? 8 : 1;
+            root = new_node(ISEL_STORE, NULL, build_element(&b, inst->result, inst->op1, scale), value);
+        } else if (inst->opcode == TAC_IF_FALSE) {
+            root = new_node(ISEL_IF_FALSE, inst->label, build_operand(&b, inst->op1), NULL);
+        } else {
+            root = new_node(ISEL_SET, inst->result, build_expression(&b, inst), NULL);
+        }
+        forest->roots[i] = root;
+        if (stats) {
+            stats->trees++;
+            stats->folded += i - b.first;
+        }
+        i = b.first;
+    }
+
+    free(b.insts);
+    free(b.defs);
+    free(b.uses);
+    free_name_table(b.names);
+    return forest;
+}
+
+/* ============================================================ */
+/* GRAMMAR                                                       */
+/* ============================================================ */
+
+/* Helper: Report a malformed rule and stop */
+static void grammar_error(const IselRule* rule, const char* message) {
+    fprintf(stderr, "Fatal Error: instruction selection rule '%s: %s': %s\n", rule->lhs, rule->pattern, message);
+    exit(1);
+}
+
+/* Helper: Index of a nonterminal name (-1: none) */
+static int find_nonterm(IselGrammar* grammar, const char* name, int length) {
+    for (int n = 0; n < grammar->num_nonterms; n++) {
+        if ((int)strlen(grammar->nonterms[n]) == length && strncmp(grammar->nonterms[n], name, length) == 0) {
+            return n;
+        }
+    }
+    return -1;
+}
+
+/* Helper: Parse a pattern starting at *text, advancing past it */
+static IselPattern* parse_pattern(IselGrammar* grammar, const IselRule* rule, const char** text) {
+    const char* start = *text;
+    while (**text == '_' || (**text >= 'A' && **text <= 'Z') || (**text >= 'a' && **text <= 'z')) (*text)++;
+    int length = (int)(*text - start);
+    if (length == 0) grammar_error(rule, "name expected");
+
+    IselPattern* pattern = (IselPattern*)safe_calloc(1, sizeof(IselPattern), "instruction selection");
+    pattern->op = -1;
+    for (int op = 0; op < ISEL_NUM_OPS; op++) {
+        if ((int)strlen(op_names[op]) == length && strncmp(op_names[op], start, length) == 0) pattern->op = op;
+    }
+    if (pattern->op < 0) {
+        pattern->nonterm = find_nonterm(grammar, start, length);
+        if (pattern->nonterm < 0) grammar_error(rule, "unknown nonterminal");
+        return pattern;
+    }
+
+    if (**text != '(') return pattern;
+    for (int k = 0; k < 2; k++) {
+        (*text)++;
+        pattern->kids[k] = parse_pattern(grammar, rule, text);
+        if (**text == ')') break;
+        if (**text != ',') grammar_error(rule, "',' or ')' expected");
+    }
+    if (**text != ')') grammar_error(rule, "')' expected");
+    (*text)++;
+    return pattern;
+}
+
+/* Helper: Free a parsed pattern */
+static void free_pattern(IselPattern* pattern) {
+    if (!pattern) return;
+    free_pattern(pattern->kids[0]);
+    free_pattern(pattern->kids[1]);
+    free(pattern);
+}
+
+/* Parse a target grammar */
+IselGrammar* create_isel_grammar(const IselRule* rules, int num_rules, const char* const* nonterms,
+                                 int num_nonterms) {
+    IselGrammar* grammar = (IselGrammar*)safe_calloc(1, sizeof(IselGrammar), "instruction selection");
+    grammar->rules = rules;
+    grammar->num_rules = num_rules;
+    grammar->nonterms = nonterms;
+    grammar->num_nonterms = num_nonterms;
+    grammar->patterns = (IselPattern**)safe_malloc(num_rules * sizeof(IselPattern*), "instruction selection");
+    grammar->lhs = (int*)safe_malloc(num_rules * sizeof(int), "instruction selection");
+
+    for (int r = 0; r < num_rules; r++) {
+        const char* text = rules[r].pattern;
+        grammar->lhs[r] = find_nonterm(grammar, rules[r].lhs, (int)strlen(rules[r].lhs));
+        if (grammar->lhs[r] < 0) grammar_error(&rules[r], "unknown nonterminal");
+        grammar->patterns[r] = parse_pattern(grammar, &rules[r], &text);
+        if (*text != '\0') grammar_error(&rules[r], "trailing text");
+    }
+    return grammar;
+}
+
+/* Free a grammar */
+void free_isel_grammar(IselGrammar* grammar) {
+    if (!grammar) return;
+    for (int r = 0; r < grammar->num_rules; r++) free_pattern(grammar->patterns[r]);
+    free(grammar->patterns);
+    free(grammar->lhs);
+    free(grammar);
+}
+
+/* ============================================================ */
+/* LABELING                                                      */
+/* ============================================================ */
+
+/* Helper: Cost of the nonterminal leaves of a pattern matched at a node
+ * (ISEL_INFINITE: no match) */
+static int match_cost(IselPattern* pattern, IselNode* node) {
+    if (!node) return ISEL_INFINITE;
+    if (pattern->op < 0) return node->cost[pattern->nonterm];
+    if ((int)node->op != pattern->op) return ISEL_INFINITE;
+
+    int cost = 0;
+    for (int k = 0; k < 2; k++) {
+        if (!pattern->kids[k]) continue;
+        cost += match_cost(pattern->kids[k], node->kids[k]);
+        if (cost >= ISEL_INFINITE) return ISEL_INFINITE;
+    }
+    return cost;
+}
+
+/* Helper: Record a derivation if it is the cheapest so far */
+static int record(IselGrammar* grammar, IselNode* node, int rule, int cost) {
+    int nonterm = grammar->lhs[rule];
+    if (cost >= node->cost[nonterm]) return 0;
+    node->cost[nonterm] = cost;
+    node->rule[nonterm] = rule;
+    return 1;
+}
+
+/* Helper: Label a node after its kids */
+static void label_node(IselGrammar* grammar, IselNode* node, void* context) {
+    for (int k = 0; k < 2; k++) {
+        if (node->kids[k]) label_node(grammar, node->kids[k], context);
+    }
+    for (int n = 0; n < ISEL_MAX_NONTERMS; n++) {
+        node->cost[n] = ISEL_INFINITE;
+        node->rule[n] = -1;
+    }
+
+    /* Rules whose pattern starts with the node's operator */
+    for (int r = 0; r < grammar->num_rules; r++) {
+        IselPattern* pattern = grammar->patterns[r];
+        if (pattern->op != (int)node->op) continue;
+        int cost = match_cost(pattern, node);
+        if (cost >= ISEL_INFINITE) continue;
+        if (grammar->rules[r].applies && !grammar->rules[r].applies(node, context)) continue;
+        record(grammar, node, r, cost + grammar->rules[r].cost);
+    }
+
+    /* Chain rules, until no derivation gets cheaper */
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int r = 0; r < grammar->num_rules; r++) {
+            IselPattern* pattern = grammar->patterns[r];
+            if (pattern->op >= 0 || node->cost[pattern->nonterm] >= ISEL_INFINITE) continue;
+            if (grammar->rules[r].applies && !grammar->rules[r].applies(node, context)) continue;
+            changed |= record(grammar, node, r, node->cost[pattern->nonterm] + grammar->rules[r].cost);
+        }
+    }
+}
+
+/* Find the cheapest cover of a tree */
+int label_isel_tree(IselGrammar* grammar, IselNode* root, void* context, IselStats* stats) {
+    label_node(grammar, root, context);
+    if (root->cost[0] >= ISEL_INFINITE) return -1;
+    if (stats) stats->cost += root->cost[0];
+    return root->cost[0];
+}
+
+/* Helper: Collect the nodes under the nonterminal leaves of a pattern */
+static void collect_kids(IselPattern* pattern, IselNode* node, IselNode** kids, int* nonterms, int* count) {
+    if (pattern->op < 0) {
+        if (*count < ISEL_MAX_KIDS) {
+            kids[*count] = node;
+            nonterms[*count] = pattern->nonterm;
+            (*count)++;
+        }
+        return;
+    }
+    for (int k = 0; k < 2; k++) {
+        if (pattern->kids[k]) collect_kids(pattern->kids[k], node->kids[k], kids, nonterms, count);
+    }
+}
+
+/* Nodes matched by the nonterminal leaves of a rule */
+int isel_rule_kids(IselGrammar* grammar, int rule, IselNode* node, IselNode** kids, int* nonterms) {
+    int count = 0;
+    collect_kids(grammar->patterns[rule], node, kids, nonterms, &count);
+    return count;
+}
+
+/* ============================================================ */
+/* OUTPUT                                                        */
+/* ============================================================ */
+
+/* Helper: Append the text of an expression */
+static void format_expression(IselNode* node, char* buffer, size_t size, int nested) {
+    size_t used = strlen(buffer);
+    if (used >= size - 1) return;
+    switch (node->op) {
+        case ISEL_CONST:
+            snprintf(buffer + used, size - used, "%lld", node->value);
+            return;
+        case ISEL_VALUE:
+            snprintf(buffer + used, size - used, "%s", node->name);
+            return;
+        case ISEL_ELEMENT:
+            /* Byte offsets print as "a[@t4]" */
+            snprintf(buffer + used, size - used, "%s[%s", node->name, node->value == 1 ? "@" : "");
+            format_expression(node->kids[0], buffer, size, 0);
+            strncat(buffer, "]", size - strlen(buffer) - 1);
+            return;
+        default:
+            break;
+    }
+
+    const char* op = node->op == ISEL_ADD ? "+" : node->op == ISEL_SUB ? "-" :
+                     node->op == ISEL_MUL ? "*" : node->name;
+    if (nested) strncat(buffer, "(", size - strlen(buffer) - 1);
+    format_expression(node->kids[0], buffer, size, 1);
+    used = strlen(buffer);
+    if (used < size - 1) snprintf(buffer + used, size - used, " %s ", op);
+    format_expression(node->kids[1], buffer, size, 1);
+    if (nested) strncat(buffer, ")", size - strlen(buffer) - 1);
+}
+
+/* Write a tree as source-like text */
+void format_isel_tree(IselNode* node, char* buffer, size_t size) {
+    if (size == 0) return;
+    buffer[0] = '\0';
+    if (node->op == ISEL_IF_FALSE) {
+        snprintf(buffer, size, "if_false ");
+    } else if (node->op == ISEL_SET) {
+        snprintf(buffer, size, "%s = ", node->name);
+    } else if (node->op == ISEL_STORE) {
+        format_expression(node->kids[0], buffer, size, 0);
+        strncat(buffer, " = ", size - strlen(buffer) - 1);
+        format_expression(node->kids[1], buffer, size, 0);
+        return;
+    }
+
+    format_expression(node->kids[0] ? node->kids[0] : node, buffer, size, 0);
+    if (node->op == ISEL_IF_FALSE) {
+        size_t used = strlen(buffer);
+        if (used < size - 1) snprintf(buffer + used, size - used, " goto %s", node->name);
+    }
+}
+
+/* Print the instruction selection statistics */
+void print_isel_stats(IselStats* stats) {
+    printf("\n============ INSTRUCTION SELECTION STATISTICS ============\n\n");
+    printf("Expression trees covered:  %d\n", stats->trees);
+    printf("TAC instructions folded:   %d\n", stats->folded);
+    printf("Instructions selected:     %d\n", stats->cost);
+    printf("\n==========================================================\n\n");
+}
+
+/* Free a forest and its trees */
+void free_isel_forest(IselForest* forest) {
+    if (!forest) return;
+    for (int i = 0; i < forest->num_insts; i++) free_tree(forest->roots[i]);
+    free(forest->roots);
+    free(forest->folded);
+    free(forest);
+}
@@ -0,0 +1,142 @@
+/*
+ * ISEL.H - Tree Pattern Instruction Selection Header
+ * CST-405 Compiler Project
+ *
+ * This file defines the instruction selector the x86-64 back end runs on
+ * each function after register allocation. Instead of translating every
+ * TAC instruction through a fixed template, it rebuilds the expression
+ * trees the front end flattened and covers each tree with the cheapest
+ * set of target patterns (bottom-up rewrite system, BURS, as in lburg):
+ * - Trees are built per function from runs of TAC instructions: a
+ *   temporary defined once, used once and defined by the instruction
+ *   right before its user's run is folded into its user, so
+ *   "t1 = 4; t2 = i * t1; t3 = a + t2; x = t3" becomes
+ *   SET(x, ADD(a, MUL(i, 4)))
+ * - Roots are SET (an assignment, arithmetic, compare or array load that
+ *   defines a value), STORE (an array store) and IF_FALSE; any other
+ *   instruction, and array accesses with a runtime bounds check, stay
+ *   templates. Array elements are ELEMENT nodes over their index tree, so
+ *   a target can fold the index arithmetic into its addressing modes
+ *   ("a[i + 1]" is one memory operand)
+ * - The target describes its instructions as a grammar: rules like
+ *   "reg: ADD(reg,imm)" with a cost (instructions emitted) and an
+ *   optional predicate on the operands (fits in an immediate, lives in
+ *   a register, ...). The labeler finds the cheapest rule per node and
+ *   nonterminal by dynamic programming; the target's reducer then walks
+ *   the chosen rules and emits the instructions
+ * Folded temporaries never exist at run time: only the tree's result is
+ * stored.
+ */
+
+#ifndef ISEL_H
+#define ISEL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ircode.h"
+
+/* Tree operators */
+typedef enum {
+    ISEL_CONST,                 /* Literal */
+    ISEL_VALUE,                 /* Variable or temporary that is not folded */
+    ISEL_ADD,
+    ISEL_SUB,
+    ISEL_MUL,
+    ISEL_RELOP,                 /* Comparison (0 or 1); name: the operator */
+    ISEL_ELEMENT,               /* Array element name[kid]; value: bytes per index unit (8, or 1 for offsets) */
+    ISEL_SET,                   /* Root: name = kid */
+    ISEL_STORE,                 /* Root: element kid 0 = kid 1 */
+    ISEL_IF_FALSE,              /* Root: if kid == 0 goto name */
+    ISEL_NUM_OPS
+} IselOp;
+
+#define ISEL_MAX_NONTERMS 8     /* Nonterminals of a target grammar */
+#define ISEL_MAX_KIDS 4         /* Nonterminal leaves of a rule pattern */
+#define ISEL_MAX_NEED 3         /* Registers a tree may need (Sethi-Ullman) */
+#define ISEL_LOCATION_SIZE 128  /* Longest location the reducer leaves, with its NUL */
+
+/* Node of an expression tree */
+typedef struct IselNode {
+    IselOp op;
+    const char* name;           /* VALUE: operand; RELOP: operator; ELEMENT: array; SET: destination;
+                                 * IF_FALSE: label */
+    long long value;            /* CONST: the literal; ELEMENT: scale */
+    struct IselNode* kids[2];   /* Operands (NULL for leaves) */
+    int need;                   /* Registers needed to evaluate the node */
+    int cost[ISEL_MAX_NONTERMS];  /* Per nonterminal: cheapest cover */
+    int rule[ISEL_MAX_NONTERMS];  /* Per nonterminal: rule of that cover (-1: none) */
+    char location[ISEL_LOCATION_SIZE];  /* Reducer: where the value was left */
+    int held;                   /* Reducer: scratch registers the value keeps busy */
+} IselNode;
+
+/* Rule of a target grammar: "lhs: pattern". A pattern is an operator
+ * applied to sub-patterns, "ADD(reg,MUL(r,CONST))", or a lone
+ * nonterminal for a chain rule ("reg: mem"). */
+typedef struct {
+    const char* lhs;            /* Nonterminal the rule produces */
+    const char* pattern;        /* Tree pattern */
+    int cost;                   /* Instructions the rule emits */
+    int (*applies)(IselNode* node, void* context);  /* Extra condition (NULL: always) */
+} IselRule;
+
+/* Parsed pattern */
+typedef struct IselPattern {
+    int op;                     /* Operator, or -1 for a nonterminal leaf */
+    int nonterm;                /* Nonterminal of a leaf */
+    struct IselPattern* kids[2];
+} IselPattern;
+
+/* Target grammar, parsed once */
+typedef struct {
+    const IselRule* rules;      /* Rules in order of preference on equal cost */
+    int num_rules;
+    const char* const* nonterms;  /* Nonterminal names; the first is the goal */
+    int num_nonterms;
+    IselPattern** patterns;     /* Per rule: parsed pattern */
+    int* lhs;                   /* Per rule: nonterminal index */
+} IselGrammar;
+
+/* Trees of one function, indexed by instruction (FUNCTION label = 0) */
+typedef struct {
+    IselNode** roots;           /* Per instruction: tree rooted there (NULL: none) */
+    char* folded;               /* Per instruction: folded into a later tree */
+    int num_insts;              /* Instructions in the function */
+} IselForest;
+
+/* Instruction selection statistics (summed over functions) */
+typedef struct {
+    int trees;                  /* Trees covered by patterns */
+    int folded;                 /* TAC instructions folded into a tree */
+    int cost;                   /* Instructions the chosen covers cost */
+} IselStats;
+
+/* INSTRUCTION SELECTION FUNCTIONS */
+
+/* Parse a target grammar (exits on a malformed pattern) */
+IselGrammar* create_isel_grammar(const IselRule* rules, int num_rules, const char* const* nonterms,
+                                 int num_nonterms);
+
+/* Build the trees of the function starting at 'start' (its FUNCTION label) */
+IselForest* build_isel_forest(TACInstruction* start, IselStats* stats);
+
+/* Find the cheapest cover of a tree; returns its cost (-1: no cover) */
+int label_isel_tree(IselGrammar* grammar, IselNode* root, void* context, IselStats* stats);
+
+/* Nodes matched by the nonterminal leaves of rule 'rule' at 'node', left
+ * to right, with their nonterminals; returns how many */
+int isel_rule_kids(IselGrammar* grammar, int rule, IselNode* node, IselNode** kids, int* nonterms);
+
+/* Write a tree as source-like text ("x = a + i * 4") */
+void format_isel_tree(IselNode* node, char* buffer, size_t size);
+
+/* Print the instruction selection statistics */
+void print_isel_stats(IselStats* stats);
+
+/* Free a forest and its trees */
+void free_isel_forest(IselForest* forest);
+
+/* Free a grammar */
+void free_isel_grammar(IselGrammar* grammar);
+
+#endif /* ISEL_H */
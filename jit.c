@@ -0,0 +1,228 @@
+/*
+ * JIT.C - In-Process Execution Implementation
+ * CST-405 Compiler Project
+ *
+ * This file implements the in-process loader and runner. The mapping
+ * is laid out as the code, the stubs of the library functions (an
+ * indirect jump through the address stored after it), then on the next
+ * page .data and .bss. Relocations are resolved like the linker would:
+ * a local label to its place in the mapping, a library function to its
+ * stub. Platforms without mmap (Windows) report that --run is not
+ * available.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "jit.h"
+#include "diagnostics.h"
+
+#ifndef _WIN32
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define STUB_SIZE 16                /* jmp [rip + 0]; dq address; padding */
+
+/* Start of main, and the time of its first print (-1 before it) */
+static double jit_started;
+static double jit_first_output;
+
+/* Helper: Milliseconds on a monotonic clock */
+static double now_ms(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000.0 + time.tv_nsec / 1000000.0;
+}
+
+/* printf as the program calls it: a format and one integer */
+static int jit_print(const char* format, long long value) {
+    if (jit_first_output < 0) jit_first_output = now_ms() - jit_started;
+    return printf(format, (int)value);
+}
+
+/* Library functions the program may call, bound in process */
+static const struct {
+    const char* name;
+    uint64_t address;
+} jit_library[] = {
+    { "printf", (uint64_t)(uintptr_t)jit_print },
+    { "exit", (uint64_t)(uintptr_t)exit }
+};
+
+/* Helper: Round up to a multiple of 'alignment' */
+static size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+/* Helper: Address of a library function (0 if it is not bound) */
+static uint64_t library_address(const char* name) {
+    for (size_t i = 0; i < sizeof(jit_library) / sizeof(jit_library[0]); i++) {
+        if (!strcmp(jit_library[i].name, name)) return jit_library[i].address;
+    }
+    return 0;
+}
+
+/* Helper: Write /tmp/perf-<pid>.map: every function, then every stub */
+static void write_perf_map(ElfObject* object, unsigned char* text, const uint64_t* addresses, size_t stubs_at) {
+    char filename[64];
+    snprintf(filename, sizeof(filename), "/tmp/perf-%d.map", (int)getpid());
+    FILE* map = fopen(filename, "w");
+    if (!map) return;
+    for (int i = 0; i < object->num_symbols; i++) {
+        const ElfSymbol* symbol = &object->symbols[i];
+        if (!symbol->function || symbol->section != ELF_TEXT) continue;
+        size_t end = stubs_at;              /* The next function, or the end of the code */
+        for (int k = 0; k < object->num_symbols; k++) {
+            const ElfSymbol* other = &object->symbols[k];
+            if (other->function && other->section == ELF_TEXT && other->value > symbol->value &&
+                other->value < end) {
+                end = other->value;
+            }
+        }
+        fprintf(map, "%llx %llx %s\n", (unsigned long long)(uintptr_t)(text + symbol->value),
+                (unsigned long long)(end - symbol->value), symbol->name);
+    }
+    for (int i = 0; i < object->num_symbols; i++) {
+        if (object->symbols[i].section >= 0) continue;
+        fprintf(map, "%llx %x %s@jit\n", (unsigned long long)addresses[i], STUB_SIZE, object->symbols[i].name);
+    }
+    fclose(map);
+}
+
+/* Load the object into executable memory and run its main */
+int run_jit(ElfObject* object, JitStats* stats) {
+    double begin = now_ms();
+    memset(stats, 0, sizeof(JitStats));
+    stats->first_output_ms = -1;
+
+    /* One stub per library function the program calls */
+    int num_stubs = 0;
+    for (int i = 0; i < object->num_symbols; i++) {
+        if (object->symbols[i].section >= 0) continue;
+        if (!library_address(object->symbols[i].name)) {
+            fprintf(stderr, "Fatal Error: --run has no in-process definition of '%s'\n", object->symbols[i].name);
+            return 0;
+        }
+        num_stubs++;
+    }
+
+    /* Layout: code and stubs, then the data from the next page on */
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t stubs_at = align_up(object->size[ELF_TEXT], STUB_SIZE);
+    size_t code_size = stubs_at + (size_t)num_stubs * STUB_SIZE;
+    size_t code_pages = align_up(code_size ? code_size : 1, page);
+    size_t bss_at = align_up(object->size[ELF_DATA], 8);
+    size_t data_size = bss_at + object->size[ELF_BSS];
+    size_t total = code_pages + align_up(data_size, page);
+    unsigned char* text = (unsigned char*)mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                                               -1, 0);
+    if (text == MAP_FAILED) {
+        fprintf(stderr, "Fatal Error: --run could not map %zu bytes\n", total);
+        return 0;
+    }
+    unsigned char* bases[ELF_NUM_SECTIONS] = { text, text + code_pages, text + code_pages + bss_at };
+    memcpy(text, object->data[ELF_TEXT], object->size[ELF_TEXT]);
+    if (object->size[ELF_DATA]) memcpy(bases[ELF_DATA], object->data[ELF_DATA], object->size[ELF_DATA]);
+
+    /* Addresses of the symbols; a library function's is its stub's */
+    uint64_t* addresses = (uint64_t*)safe_calloc(object->num_symbols + 1, sizeof(uint64_t), "JIT");
+    size_t stub = stubs_at;
+    for (int i = 0; i < object->num_symbols; i++) {
+        const ElfSymbol* symbol = &object->symbols[i];
+        if (symbol->section >= 0) {
+            addresses[i] = (uint64_t)(uintptr_t)(bases[symbol->section] + symbol->value);
+            continue;
+        }
+        uint64_t target = library_address(symbol->name);
+        static const unsigned char jump[6] = { 0xff, 0x25, 0, 0, 0, 0 };    /* jmp [rip + 0] */
+        memcpy(text + stub, jump, sizeof(jump));
+        memcpy(text + stub + sizeof(jump), &target, sizeof(target));
+        addresses[i] = (uint64_t)(uintptr_t)(text + stub);
+        stub += STUB_SIZE;
+        stats->stubs++;
+    }
+
+    /* Relocations */
+    int ok = 1;
+    for (int r = 0; r < object->num_relocations && ok; r++) {
+        const ElfRelocation* relocation = &object->relocations[r];
+        unsigned char* place = text + relocation->offset;
+        int64_t value = (int64_t)(addresses[relocation->symbol] + relocation->addend);
+        if (relocation->type == R_X86_64_PC32 || relocation->type == R_X86_64_PLT32) {
+            value -= (int64_t)(uintptr_t)place;
+        }
+        if (relocation->type == R_X86_64_64) {
+            memcpy(place, &value, 8);
+        } else if (value >= INT32_MIN && value <= INT32_MAX) {
+            int32_t field = (int32_t)value;
+            memcpy(place, &field, 4);
+        } else {
+            fprintf(stderr, "Fatal Error: --run cannot place '%s' in a 32-bit field (absolute addresses need "
+                    "code linked below 2 GB)\n", object->symbols[relocation->symbol].name);
+            ok = 0;
+        }
+        stats->relocations++;
+    }
+
+    /* W^X: the code stops being writable before it can run */
+    int entry = -1;
+    for (int i = 0; i < object->num_symbols; i++) {
+        if (!strcmp(object->symbols[i].name, "main") && object->symbols[i].section == ELF_TEXT) entry = i;
+    }
+    if (ok && entry < 0) {
+        fprintf(stderr, "Fatal Error: --run found no 'main'\n");
+        ok = 0;
+    }
+    if (ok && mprotect(text, code_pages, PROT_READ | PROT_EXEC) != 0) {
+        fprintf(stderr, "Fatal Error: --run could not make the code executable\n");
+        ok = 0;
+    }
+    if (ok) {
+        write_perf_map(object, text, addresses, stubs_at);
+        stats->code_bytes = code_size;
+        stats->data_bytes = data_size;
+        stats->load_ms = now_ms() - begin;
+
+        int (*program_main)(void) = (int (*)(void))(uintptr_t)addresses[entry];
+        fflush(stdout);                     /* The compiler's report survives a trap */
+        jit_first_output = -1;
+        jit_started = now_ms();
+        stats->exit_status = program_main();
+        fflush(stdout);
+        stats->run_ms = now_ms() - jit_started;
+        stats->first_output_ms = jit_first_output;
+    }
+
+    munmap(text, total);
+    free(addresses);
+    return ok;
+}
+
+#else
+
+/* Load the object into executable memory and run its main */
+int run_jit(ElfObject* object, JitStats* stats) {
+    (void)object;
+    memset(stats, 0, sizeof(JitStats));
+    fprintf(stderr, "Fatal Error: --run needs mmap, which this platform does not have\n");
+    return 0;
+}
+
+#endif
+
+/* Print the statistics */
+void print_jit_stats(JitStats* stats) {
+    printf("\n================== JIT EXECUTION STATISTICS ===============\n\n");
+    printf("Code bytes (with stubs):   %zu\n", stats->code_bytes);
+    printf("Data bytes (.data, .bss):  %zu\n", stats->data_bytes);
+    printf("Relocations applied:       %d\n", stats->relocations);
+    printf("Library stubs:             %d\n", stats->stubs);
+    printf("Load time:                 %.3f ms\n", stats->load_ms);
+    if (stats->first_output_ms >= 0) {
+        printf("Time to first output:      %.3f ms\n", stats->first_output_ms);
+    }
+    printf("Run time:                  %.3f ms\n", stats->run_ms);
+    printf("Exit status:               %d\n", stats->exit_status);
+    printf("\n==========================================================\n\n");
+}
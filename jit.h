@@ -0,0 +1,49 @@
+/*
+ * JIT.H - In-Process Execution Header
+ * CST-405 Compiler Project
+ *
+ * This file defines the loader that runs a compiled program inside the
+ * compiler (--run) instead of writing a file for an assembler and a
+ * linker. It takes the object the x86-64 encoder built (x86enc.h):
+ * - Memory: one mapping holds the code, followed by the data and .bss.
+ *   The code is written while the mapping is read-write and only then
+ *   made read-execute, so no page is ever writable and executable
+ * - Linking: the relocations are applied in place. printf is bound to
+ *   an in-process print routine and exit to the C library's, each
+ *   reached through a stub next to the code, so a call needs no PLT and
+ *   no library within 2 GB
+ * - Profiling: /tmp/perf-<pid>.map lists the address, size and name of
+ *   every function, for perf to symbolize samples in JIT code
+ * - Running: main is called at once; the time to the first print and
+ *   the exit status are reported
+ * The code must be position-independent (--pie code): a mapping can be
+ * anywhere, so absolute 32-bit addresses are rejected. The program runs
+ * in the compiler's process, so a trap in it (division by zero) ends
+ * the compiler too.
+ */
+
+#ifndef JIT_H
+#define JIT_H
+
+#include "elfobj.h"
+
+/* JIT statistics */
+typedef struct {
+    size_t code_bytes;          /* Code, with the stubs */
+    size_t data_bytes;          /* .data and .bss */
+    int relocations;            /* Relocations applied */
+    int stubs;                  /* Library functions bound in process */
+    double load_ms;             /* Mapping, relocating and protecting */
+    double first_output_ms;     /* From the call of main to its first print (-1 if none) */
+    double run_ms;              /* Time in main */
+    int exit_status;            /* Value main returned */
+} JitStats;
+
+/* Load the object into executable memory and run its main (0 if it
+ * cannot be loaded) */
+int run_jit(ElfObject* object, JitStats* stats);
+
+/* Print the statistics */
+void print_jit_stats(JitStats* stats);
+
+#endif /* JIT_H */
@@ -0,0 +1,1148 @@
+/*
+ * LOOP_OPT.C - Loop Optimizations Implementation
+ * CST-405 Compiler Project
+ *
+ * This file implements the optimizations that work on the natural loops
+ * of each function. Loops are found on the CFG (back edges to a block
+ * that dominates their source) and every loop is given a preheader, the
+ * block that runs once before the loop is entered.
+ */
+
+#include "loop_opt.h"
+#include "cfg.h"
+#include "diagnostics.h"
+
+/* Facts about the variables of one function, seen from one loop */
+typedef struct {
+    NameTable* names;
+    int* function_defs;      /* Per name: definitions in the whole function */
+    int* loop_defs;          /* Per name: definitions (and array stores) in the loop */
+    int* def_index;          /* Per name: instruction index of its last definition */
+    char* is_temp;           /* Per name: compiler temporary? */
+    char* nonzero_const;     /* Per name: temporary always holding a non-zero constant */
+    char* hoisted;           /* Per name: defined by a hoisted instruction */
+    int loop_has_call;       /* Does the loop contain a call? */
+} LoopFacts;
+
+/* Helper: Collect the variable facts of a function for one loop */
+static void collect_loop_facts(CFG* cfg, Loop* loop, LoopFacts* facts) {
+    facts->names = create_name_table(cfg->num_insts * 2);
+    intern_cfg_names(facts->names, cfg);
+
+    int num_names = facts->names->count + 1;
+    facts->function_defs = (int*)safe_calloc(num_names, sizeof(int), "loop facts");
+    facts->loop_defs = (int*)safe_calloc(num_names, sizeof(int), "loop facts");
+    facts->def_index = (int*)safe_malloc(num_names * sizeof(int), "loop facts");
+    facts->is_temp = (char*)safe_calloc(num_names, 1, "loop facts");
+    facts->nonzero_const = (char*)safe_calloc(num_names, 1, "loop facts");
+    facts->hoisted = (char*)safe_calloc(num_names, 1, "loop facts");
+    facts->loop_has_call = 0;
+
+    for (int id = 0; id < facts->names->count; id++) {
+        facts->is_temp[id] = is_temp_name(facts->names->names[id]);
+        facts->def_index[id] = -1;
+    }
+
+    for (int b = 0; b < cfg->num_blocks; b++) {
+        BasicBlock* blk = &cfg->blocks[b];
+        for (int i = blk->start; i < blk->start + blk->count; i++) {
+            TACInstruction* inst = cfg->insts[i];
+            const char* def = tac_def(inst);
+            if (inst->opcode == TAC_ARRAY_STORE || inst->opcode == TAC_ARRAY_STORE_OFFSET) {
+                def = inst->result;
+            }
+            if (!def) continue;
+
+            int id = lookup_name_id(facts->names, def);
+            facts->function_defs[id]++;
+            facts->def_index[id] = i;
+            if (loop->in_loop[b]) facts->loop_defs[id]++;
+            if (inst->opcode == TAC_LOAD_CONST && atoi(inst->op1) != 0) facts->nonzero_const[id] = 1;
+        }
+        if (loop->in_loop[b]) {
+            for (int i = blk->start; i < blk->start + blk->count; i++) {
+                if (cfg->insts[i]->opcode == TAC_CALL) facts->loop_has_call = 1;
+            }
+        }
+    }
+}
+
+/* Helper: Free loop facts */
+static void free_loop_facts(LoopFacts* facts) {
+    free(facts->function_defs);
+    free(facts->loop_defs);
+    free(facts->def_index);
+    free(facts->is_temp);
+    free(facts->nonzero_const);
+    free(facts->hoisted);
+    free_name_table(facts->names);
+}
+
+/* Helper: Is an operand unchanged by every iteration of the loop? */
+static int is_invariant_operand(LoopFacts* facts, const char* operand) {
+    if (is_number(operand)) return 1;
+
+    int id = lookup_name_id(facts->names, operand);
+    if (facts->hoisted[id]) return 1;
+    if (facts->loop_defs[id] > 0) return 0;
+
+    /* A call in the loop may write any global variable */
+    return facts->is_temp[id] || !facts->loop_has_call;
+}
+
+/* Helper: Can this instruction be moved to the preheader? Only
+ * computations that cannot trap are moved, since the loop body might
+ * never have run them. */
+static int is_hoistable(LoopFacts* facts, TACInstruction* inst) {
+    const char* def = tac_def(inst);
+    if (!def || !is_temp_name(def)) return 0;
+    if (facts->function_defs[lookup_name_id(facts->names, def)] != 1) return 0;
+
+    switch (inst->opcode) {
+        case TAC_LOAD_CONST:
+            return 1;
+
+        case TAC_ASSIGN:
+            return is_invariant_operand(facts, inst->op1);
+
+        case TAC_DIV:
+        case TAC_MOD:
+            if (is_number(inst->op2)) {
+                if (atoi(inst->op2) == 0) return 0;
+            } else if (!facts->nonzero_const[lookup_name_id(facts->names, inst->op2)]) {
+                return 0;
+            }
+            /* Fall through */
+        case TAC_ADD:
+        case TAC_SUB:
+        case TAC_MUL:
+        case TAC_RELOP:
+            return is_invariant_operand(facts, inst->op1) &&
+                   is_invariant_operand(facts, inst->op2);
+
+        case TAC_ARRAY_LOAD:
+        case TAC_ARRAY_LOAD_OFFSET: {
+            int array = lookup_name_id(facts->names, inst->op1);
+            return facts->loop_defs[array] == 0 && !facts->loop_has_call &&
+                   is_invariant_operand(facts, inst->op2);
+        }
+
+        default:
+            return 0;
+    }
+}
+
+/* Helper: Hoist the invariant instructions of one loop into its preheader */
+static int hoist_loop_invariants(TACCode* code, CFG* cfg, LoopForest* forest, int l) {
+    Loop* loop = &forest->loops[l];
+    if (loop->preheader < 0) return 0;
+
+    LoopFacts facts;
+    collect_loop_facts(cfg, loop, &facts);
+    char* hoist = (char*)safe_calloc(cfg->num_insts + 1, 1, "LICM");
+    int hoisted = 0;
+
+    /* Repeat so that values computed from hoisted values follow them out */
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int i = 0; i < loop->num_blocks; i++) {
+            BasicBlock* blk = &cfg->blocks[loop->blocks[i]];
+            for (int j = blk->start; j < blk->start + blk->count; j++) {
+                TACInstruction* inst = cfg->insts[j];
+                if (hoist[j] || !is_hoistable(&facts, inst)) continue;
+
+                hoist[j] = 1;
+                facts.hoisted[lookup_name_id(facts.names, tac_def(inst))] = 1;
+                hoisted++;
+                changed = 1;
+            }
+        }
+    }
+
+    if (hoisted > 0) {
+        /* New order: the hoisted instructions go at the end of the
+         * preheader, ahead of any jump that ends it */
+        TACInstruction** order = (TACInstruction**)safe_malloc(cfg->num_insts * sizeof(TACInstruction*),
+                                                               "LICM");
+        BasicBlock* pre = &cfg->blocks[loop->preheader];
+        int insert_at = pre->start + pre->count;
+        if (block_last(cfg, loop->preheader)->opcode == TAC_GOTO) insert_at--;
+
+        int count = 0;
+        for (int j = 0; j < cfg->num_insts; j++) {
+            if (j == insert_at) {
+                for (int k = 0; k < cfg->num_insts; k++) {
+                    if (hoist[k]) order[count++] = cfg->insts[k];
+                }
+            }
+            if (!hoist[j]) order[count++] = cfg->insts[j];
+        }
+        relink_function(code, cfg, order, count);
+        free(order);
+
+        TACInstruction* header = block_first(cfg, loop->header);
+        printf("[OPTIMIZER] LICM: Hoisted %d instruction(s) out of loop %s (depth %d)\n",
+               hoisted, header->opcode == TAC_LABEL ? header->label : "?", loop->depth);
+    }
+
+    free(hoist);
+    free_loop_facts(&facts);
+    return hoisted;
+}
+
+/* Helper: Drop the analyses of a function the pass just changed and
+ * compute its CFG, dominators and loops again */
+static CFG* reanalyze_loops(TACInstruction* start, CFG* cfg, LoopForest** forest) {
+    release_analyses(cfg, *forest, NULL);
+    invalidate_function_analyses(start);
+    return get_function_loops(start, forest);
+}
+
+/* Loop-invariant code motion driver: process each function */
+int loop_invariant_code_motion(TACCode* code) {
+    int total = 0;
+    TACInstruction* start = code->head;
+
+    while (start) {
+        LoopForest* forest;
+        CFG* cfg = get_function_loops(start, &forest);
+
+        if (forest->num_loops > 0 && insert_preheaders(code, cfg, forest) > 0) {
+            cfg = reanalyze_loops(start, cfg, &forest);
+        }
+
+        /* Inner loops first, so their invariants can keep moving outwards.
+         * Moving instructions keeps the block structure, so the loop
+         * numbering stays valid when the CFG is rebuilt. */
+        for (int l = 0; l < forest->num_loops; l++) {
+            int hoisted = hoist_loop_invariants(code, cfg, forest, l);
+            if (hoisted > 0) {
+                total += hoisted;
+                cfg = reanalyze_loops(start, cfg, &forest);
+            }
+        }
+
+        start = cfg->end;
+        release_analyses(cfg, forest, NULL);
+    }
+
+    return total;
+}
+
+/* Basic induction variable: changed once per iteration, either by 'v = t'
+ * where t = v + step is computed in the same block, or by 'v = v + step' */
+typedef struct {
+    int var;                 /* Name id of the variable */
+    int step;                /* Constant added each iteration */
+    int increment;           /* Instruction index of 't = v + step' */
+    int update;              /* Instruction index of the assignment to v */
+} BasicIV;
+
+/* Derived induction variable: the byte offset (v + offset) * element size,
+ * kept in a temporary that is bumped whenever v is */
+typedef struct {
+    int iv;                  /* Basic induction variable it follows */
+    int offset;              /* Constant added to the basic variable */
+    char* pointer;           /* Temporary holding the byte offset */
+} DerivedIV;
+
+/* Helper: Get the compile-time value of an operand (literal or a
+ * temporary loaded once with a constant) */
+static int constant_operand(CFG* cfg, LoopFacts* facts, const char* operand, int* value) {
+    if (is_number(operand)) {
+        *value = atoi(operand);
+        return 1;
+    }
+    int id = lookup_name_id(facts->names, operand);
+    if (!facts->is_temp[id] || facts->function_defs[id] != 1) return 0;
+
+    TACInstruction* def = cfg->insts[facts->def_index[id]];
+    if (def->opcode != TAC_LOAD_CONST) return 0;
+    *value = atoi(def->op1);
+    return 1;
+}
+
+/* Helper: Block containing an instruction index */
+static int block_of(CFG* cfg, int index) {
+    for (int b = 0; b < cfg->num_blocks; b++) {
+        if (index >= cfg->blocks[b].start && index < cfg->blocks[b].start + cfg->blocks[b].count) {
+            return b;
+        }
+    }
+    return -1;
+}
+
+/* Helper: Match 'x = v + c', 'x = c + v' or 'x = v - c'; returns the name id
+ * of v and stores the signed constant */
+static int match_linear(CFG* cfg, LoopFacts* facts, TACInstruction* inst, int* constant) {
+    int c;
+    if (inst->opcode == TAC_ADD) {
+        if (!is_number(inst->op1) && constant_operand(cfg, facts, inst->op2, &c)) {
+            *constant = c;
+            return lookup_name_id(facts->names, inst->op1);
+        }
+        if (!is_number(inst->op2) && constant_operand(cfg, facts, inst->op1, &c)) {
+            *constant = c;
+            return lookup_name_id(facts->names, inst->op2);
+        }
+    } else if (inst->opcode == TAC_SUB) {
+        if (!is_number(inst->op1) && constant_operand(cfg, facts, inst->op2, &c)) {
+            *constant = -c;
+            return lookup_name_id(facts->names, inst->op1);
+        }
+    }
+    return -1;
+}
+
+/* Helper: Find the basic induction variables of a loop */
+static int find_basic_ivs(CFG* cfg, Loop* loop, LoopFacts* facts, BasicIV* ivs) {
+    int count = 0;
+
+    /* A call could change a variable behind the loop's back */
+    if (facts->loop_has_call) return 0;
+
+    for (int i = 0; i < loop->num_blocks; i++) {
+        BasicBlock* blk = &cfg->blocks[loop->blocks[i]];
+        for (int j = blk->start; j < blk->start + blk->count; j++) {
+            TACInstruction* update = cfg->insts[j];
+            int step;
+
+            /* Self-update: v = v + step (offsets made by the strength reduction) */
+            if ((update->opcode == TAC_ADD || update->opcode == TAC_SUB) &&
+                match_linear(cfg, facts, update, &step) == lookup_name_id(facts->names, update->result) &&
+                step != 0 && facts->loop_defs[lookup_name_id(facts->names, update->result)] == 1) {
+                ivs[count].var = lookup_name_id(facts->names, update->result);
+                ivs[count].step = step;
+                ivs[count].increment = j;
+                ivs[count].update = j;
+                count++;
+                continue;
+            }
+
+            if (update->opcode != TAC_ASSIGN || is_temp_name(update->result) ||
+                is_number(update->op1) || !is_temp_name(update->op1)) {
+                continue;
+            }
+
+            int var = lookup_name_id(facts->names, update->result);
+            int temp = lookup_name_id(facts->names, update->op1);
+            if (facts->loop_defs[var] != 1 || facts->function_defs[temp] != 1) continue;
+
+            int k = facts->def_index[temp];
+            if (k < blk->start || k >= j) continue;
+            if (match_linear(cfg, facts, cfg->insts[k], &step) != var || step == 0) continue;
+
+            ivs[count].var = var;
+            ivs[count].step = step;
+            ivs[count].increment = k;
+            ivs[count].update = j;
+            count++;
+        }
+    }
+    return count;
+}
+
+/* Helper: Express an array index at instruction j as (basic IV + offset).
+ * Returns the IV number or -1. */
+static int index_as_iv(CFG* cfg, LoopFacts* facts, BasicIV* ivs, int num_ivs,
+                       const char* index, int j, int* offset) {
+    if (is_number(index)) return -1;
+    int id = lookup_name_id(facts->names, index);
+
+    for (int x = 0; x < num_ivs; x++) {
+        if (ivs[x].var == id) {
+            *offset = 0;
+            return x;
+        }
+    }
+
+    /* A temporary v + c computed earlier in the same block, with no
+     * update of v in between */
+    if (!facts->is_temp[id] || facts->function_defs[id] != 1) return -1;
+    int d = facts->def_index[id];
+    if (d >= j || block_of(cfg, d) != block_of(cfg, j)) return -1;
+
+    int c;
+    int var = match_linear(cfg, facts, cfg->insts[d], &c);
+    for (int x = 0; x < num_ivs; x++) {
+        if (ivs[x].var == var && !(ivs[x].update > d && ivs[x].update < j)) {
+            *offset = c;
+            return x;
+        }
+    }
+    return -1;
+}
+
+/* Helper: Check that a variable is not read after leaving the loop before
+ * it is assigned again */
+static int is_dead_after_loop(CFG* cfg, Loop* loop, const char* var) {
+    TACInstruction* entry = cfg->insts[0];
+    int in_main = entry->opcode == TAC_FUNCTION_LABEL && strcmp(entry->label, "main") == 0;
+    char* visited = (char*)safe_calloc(cfg->num_blocks, 1, "IV strength reduction");
+    int* worklist = (int*)safe_malloc((cfg->num_blocks + 1) * sizeof(int), "IV strength reduction");
+    int count = 0;
+    int dead = 1;
+
+    for (int i = 0; i < loop->num_blocks; i++) {
+        BasicBlock* blk = &cfg->blocks[loop->blocks[i]];
+        for (int s = 0; s < blk->num_succs; s++) {
+            int succ = blk->succs[s];
+            if (!loop->in_loop[succ] && !visited[succ]) {
+                visited[succ] = 1;
+                worklist[count++] = succ;
+            }
+        }
+    }
+
+    while (count > 0 && dead) {
+        BasicBlock* blk = &cfg->blocks[worklist[--count]];
+        int killed = 0;
+
+        for (int j = blk->start; j < blk->start + blk->count && !killed && dead; j++) {
+            TACInstruction* inst = cfg->insts[j];
+            const char* uses[3];
+            int n = tac_uses(inst, uses);
+            for (int u = 0; u < n; u++) {
+                if (strcmp(uses[u], var) == 0) dead = 0;
+            }
+
+            /* Globals stay visible to callees and to the caller */
+            if (inst->opcode == TAC_CALL) dead = 0;
+            if ((inst->opcode == TAC_RETURN || inst->opcode == TAC_RETURN_VOID) && !in_main) dead = 0;
+
+            const char* def = tac_def(inst);
+            if (def && strcmp(def, var) == 0) killed = 1;
+            if (inst->opcode == TAC_RETURN || inst->opcode == TAC_RETURN_VOID) killed = 1;
+        }
+
+        if (!killed && dead) {
+            if (blk->num_succs == 0) dead = 0;   /* Falls off the end of the function */
+            for (int s = 0; s < blk->num_succs; s++) {
+                if (!visited[blk->succs[s]]) {
+                    visited[blk->succs[s]] = 1;
+                    worklist[count++] = blk->succs[s];
+                }
+            }
+        }
+    }
+
+    free(visited);
+    free(worklist);
+    return dead;
+}
+
+/* Helper: Append a new instruction to a pending list */
+static void add_pending(TACInstruction** list, int* count, TACInstruction* inst) {
+    list[(*count)++] = inst;
+}
+
+/* Helper: Strength-reduce the array accesses of one loop */
+static int reduce_loop_ivs(TACCode* code, CFG* cfg, LoopForest* forest, int l) {
+    Loop* loop = &forest->loops[l];
+    if (loop->preheader < 0) return 0;
+
+    LoopFacts facts;
+    collect_loop_facts(cfg, loop, &facts);
+
+    BasicIV* ivs = (BasicIV*)safe_malloc((cfg->num_insts + 1) * sizeof(BasicIV), "IV strength reduction");
+    int num_ivs = find_basic_ivs(cfg, loop, &facts, ivs);
+    if (num_ivs == 0) {
+        free(ivs);
+        free_loop_facts(&facts);
+        return 0;
+    }
+
+    int size = code->element_size;
+    char text[32];
+    TACInstruction* header = block_first(cfg, loop->header);
+    const char* loop_name = header->opcode == TAC_LABEL ? header->label : "?";
+
+    DerivedIV* derived = (DerivedIV*)safe_malloc((cfg->num_insts + 1) * sizeof(DerivedIV),
+                                                 "IV strength reduction");
+    int num_derived = 0;
+    TACInstruction** preheader_code = (TACInstruction**)safe_malloc((cfg->num_insts * 4 + 8) *
+                                                                    sizeof(TACInstruction*),
+                                                                    "IV strength reduction");
+    int num_preheader = 0;
+    char* size_temp = NULL;
+    int rewritten = 0;
+
+    /* Rewrite every access whose index follows a basic IV */
+    for (int i = 0; i < loop->num_blocks; i++) {
+        BasicBlock* blk = &cfg->blocks[loop->blocks[i]];
+        for (int j = blk->start; j < blk->start + blk->count; j++) {
+            TACInstruction* inst = cfg->insts[j];
+            const char* index;
+            if (inst->opcode == TAC_ARRAY_LOAD) index = inst->op2;
+            else if (inst->opcode == TAC_ARRAY_STORE) index = inst->op1;
+            else continue;
+
+            int offset;
+            int x = index_as_iv(cfg, &facts, ivs, num_ivs, index, j, &offset);
+            if (x < 0) continue;
+
+            int d;
+            for (d = 0; d < num_derived; d++) {
+                if (derived[d].iv == x && derived[d].offset == offset) break;
+            }
+            if (d == num_derived) {
+                /* Preheader: pointer = (v + offset) * size */
+                const char* var = facts.names->names[ivs[x].var];
+                derived[d].iv = x;
+                derived[d].offset = offset;
+                derived[d].pointer = new_temp();
+
+                if (!size_temp) {
+                    size_temp = new_temp();
+                    snprintf(text, sizeof(text), "%d", size);
+                    add_pending(preheader_code, &num_preheader,
+                                create_tac_instruction(TAC_LOAD_CONST, size_temp, text, NULL, NULL));
+                }
+                if (offset != 0) {
+                    char* offset_temp = new_temp();
+                    char* base_temp = new_temp();
+                    snprintf(text, sizeof(text), "%d", offset);
+                    add_pending(preheader_code, &num_preheader,
+                                create_tac_instruction(TAC_LOAD_CONST, offset_temp, text, NULL, NULL));
+                    add_pending(preheader_code, &num_preheader,
+                                create_tac_instruction(TAC_ADD, base_temp, var, offset_temp, NULL));
+                    add_pending(preheader_code, &num_preheader,
+                                create_tac_instruction(TAC_MUL, derived[d].pointer, base_temp, size_temp, NULL));
+                    free(offset_temp);
+                    free(base_temp);
+                } else {
+                    add_pending(preheader_code, &num_preheader,
+                                create_tac_instruction(TAC_MUL, derived[d].pointer, var, size_temp, NULL));
+                }
+                num_derived++;
+            }
+
+            printf("[OPTIMIZER] IV strength reduction: %s[%s] in loop %s uses byte offset %s (%+d per iteration)\n",
+                   tac_array(inst), index, loop_name, derived[d].pointer, ivs[x].step * size);
+
+            if (inst->opcode == TAC_ARRAY_LOAD) {
+                inst->opcode = TAC_ARRAY_LOAD_OFFSET;
+                free(inst->op2);
+                inst->op2 = strdup(derived[d].pointer);
+            } else {
+                inst->opcode = TAC_ARRAY_STORE_OFFSET;
+                free(inst->op1);
+                inst->op1 = strdup(derived[d].pointer);
+            }
+            rewritten++;
+        }
+    }
+
+    if (rewritten == 0) {
+        free(ivs);
+        free(derived);
+        free(preheader_code);
+        free_loop_facts(&facts);
+        return 0;
+    }
+
+    /* Per IV: the step in bytes and the pointer bumps after its update */
+    TACInstruction*** bumps = (TACInstruction***)safe_calloc(num_ivs, sizeof(TACInstruction**),
+                                                             "IV strength reduction");
+    int* num_bumps = (int*)safe_calloc(num_ivs, sizeof(int), "IV strength reduction");
+    for (int x = 0; x < num_ivs; x++) {
+        char* step_temp = NULL;
+        bumps[x] = (TACInstruction**)safe_malloc((num_derived + 1) * sizeof(TACInstruction*),
+                                                 "IV strength reduction");
+        for (int d = 0; d < num_derived; d++) {
+            if (derived[d].iv != x) continue;
+            if (!step_temp) {
+                step_temp = new_temp();
+                snprintf(text, sizeof(text), "%d", ivs[x].step * size);
+                add_pending(preheader_code, &num_preheader,
+                            create_tac_instruction(TAC_LOAD_CONST, step_temp, text, NULL, NULL));
+            }
+            bumps[x][num_bumps[x]++] = create_tac_instruction(TAC_ADD, derived[d].pointer,
+                                                              derived[d].pointer, step_temp, NULL);
+        }
+        free(step_temp);
+    }
+
+    /* Temporaries that now have no readers */
+    int* use_counts = (int*)safe_calloc(facts.names->count + 1, sizeof(int), "IV strength reduction");
+    for (int j = 0; j < cfg->num_insts; j++) {
+        const char* uses[3];
+        int n = tac_uses(cfg->insts[j], uses);
+        for (int u = 0; u < n; u++) {
+            int id = lookup_name_id(facts.names, uses[u]);
+            if (id >= 0) use_counts[id]++;      /* New offset temporaries are not interned */
+        }
+    }
+
+    /* Replace an IV that is only used to step itself and to test the loop
+     * exit: the test then compares the byte offset against bound * size */
+    char* dead = (char*)safe_calloc(cfg->num_insts + 1, 1, "IV strength reduction");
+    int* compares = (int*)safe_malloc((cfg->num_insts + 1) * sizeof(int), "IV strength reduction");
+    int* index_defs = (int*)safe_malloc((cfg->num_insts + 1) * sizeof(int), "IV strength reduction");
+    int eliminated = 0;
+
+    for (int x = 0; x < num_ivs; x++) {
+        /* Any offset of the IV can take over the exit test: v < n is
+         * (v + c) * size < (n + c) * size. Prefer c == 0. */
+        int base = -1;
+        for (int d = 0; d < num_derived; d++) {
+            if (derived[d].iv == x && (base < 0 || derived[d].offset == 0)) base = d;
+        }
+        if (base < 0) continue;
+        int base_offset = derived[base].offset;
+
+        int var = ivs[x].var;
+        int stepped = lookup_name_id(facts.names, cfg->insts[ivs[x].update]->op1);
+        int update_block = block_of(cfg, ivs[x].update);
+        int num_compares = 0;
+        int num_index_defs = 0;
+        int ok = 1;
+
+        for (int i = 0; i < loop->num_blocks && ok; i++) {
+            BasicBlock* blk = &cfg->blocks[loop->blocks[i]];
+            for (int j = blk->start; j < blk->start + blk->count && ok; j++) {
+                TACInstruction* inst = cfg->insts[j];
+                const char* uses[3];
+                int n = tac_uses(inst, uses);
+                int c;
+
+                if (j == ivs[x].increment || j == ivs[x].update) continue;
+
+                for (int u = 0; u < n && ok; u++) {
+                    int id = lookup_name_id(facts.names, uses[u]);
+                    if (id != var && id != stepped) continue;
+
+                    /* After the update the stepped temporary equals v */
+                    int current = id == var ||
+                                  (j > ivs[x].update && loop->blocks[i] == update_block);
+
+                    if (inst->opcode == TAC_RELOP && current && n == 1) {
+                        /* v compared with a literal bound */
+                        compares[num_compares++] = j;
+                    } else if (inst->opcode == TAC_RELOP && current && n == 2 &&
+                               strcmp(uses[0], uses[1]) != 0 &&
+                               is_invariant_operand(&facts, uses[1 - u])) {
+                        compares[num_compares++] = j;
+                        break;
+                    } else if (id == var && is_temp_name(inst->result) &&
+                               match_linear(cfg, &facts, inst, &c) == var &&
+                               use_counts[lookup_name_id(facts.names, inst->result)] == 0) {
+                        /* Index arithmetic the rewrite left without readers */
+                        index_defs[num_index_defs++] = j;
+                    } else {
+                        ok = 0;
+                    }
+                }
+            }
+        }
+
+        if (!ok || !is_dead_after_loop(cfg, loop, facts.names->names[var])) continue;
+
+        const char* pointer = derived[base].pointer;
+        for (int k = 0; k < num_compares; k++) {
+            TACInstruction* inst = cfg->insts[compares[k]];
+            int iv_id = lookup_name_id(facts.names, inst->op1);
+            int iv_is_op1 = !is_number(inst->op1) && (iv_id == var || iv_id == stepped);
+            char** iv_operand = iv_is_op1 ? &inst->op1 : &inst->op2;
+            char** bound = iv_is_op1 ? &inst->op2 : &inst->op1;
+            char* scaled = new_temp();
+            int c;
+
+            if (constant_operand(cfg, &facts, *bound, &c)) {
+                snprintf(text, sizeof(text), "%d", (c + base_offset) * size);
+                add_pending(preheader_code, &num_preheader,
+                            create_tac_instruction(TAC_LOAD_CONST, scaled, text, NULL, NULL));
+            } else if (base_offset != 0) {
+                char* offset_temp = new_temp();
+                char* shifted = new_temp();
+                snprintf(text, sizeof(text), "%d", base_offset);
+                add_pending(preheader_code, &num_preheader,
+                            create_tac_instruction(TAC_LOAD_CONST, offset_temp, text, NULL, NULL));
+                add_pending(preheader_code, &num_preheader,
+                            create_tac_instruction(TAC_ADD, shifted, *bound, offset_temp, NULL));
+                add_pending(preheader_code, &num_preheader,
+                            create_tac_instruction(TAC_MUL, scaled, shifted, size_temp, NULL));
+                free(offset_temp);
+                free(shifted);
+            } else {
+                add_pending(preheader_code, &num_preheader,
+                            create_tac_instruction(TAC_MUL, scaled, *bound, size_temp, NULL));
+            }
+
+            free(*iv_operand);
+            *iv_operand = strdup(pointer);
+            free(*bound);
+            *bound = scaled;
+        }
+
+        for (int k = 0; k < num_index_defs; k++) dead[index_defs[k]] = 1;
+        dead[ivs[x].increment] = 1;
+        dead[ivs[x].update] = 1;
+        eliminated++;
+        printf("[OPTIMIZER] IV strength reduction: Replaced induction variable %s in loop %s by %s\n",
+               facts.names->names[var], loop_name, pointer);
+    }
+
+    /* New order: preheader code at the end of the preheader (ahead of a
+     * final jump), pointer bumps right after each IV update */
+    BasicBlock* pre = &cfg->blocks[loop->preheader];
+    int insert_at = pre->start + pre->count;
+    if (block_last(cfg, loop->preheader)->opcode == TAC_GOTO) insert_at--;
+
+    int capacity = cfg->num_insts + num_preheader + num_derived + 1;
+    TACInstruction** order = (TACInstruction**)safe_malloc(capacity * sizeof(TACInstruction*),
+                                                           "IV strength reduction");
+    int count = 0;
+    for (int j = 0; j < cfg->num_insts; j++) {
+        if (j == insert_at) {
+            for (int k = 0; k < num_preheader; k++) order[count++] = preheader_code[k];
+        }
+        if (!dead[j]) order[count++] = cfg->insts[j];
+        for (int x = 0; x < num_ivs; x++) {
+            if (ivs[x].update != j) continue;
+            for (int k = 0; k < num_bumps[x]; k++) order[count++] = bumps[x][k];
+        }
+    }
+    relink_function(code, cfg, order, count);
+    code->instruction_count += count - cfg->num_insts;
+
+    for (int j = 0; j < cfg->num_insts; j++) {
+        if (dead[j]) free_tac_instruction(cfg->insts[j]);
+    }
+
+    for (int x = 0; x < num_ivs; x++) free(bumps[x]);
+    for (int d = 0; d < num_derived; d++) free(derived[d].pointer);
+    free(order);
+    free(compares);
+    free(index_defs);
+    free(use_counts);
+    free(dead);
+    free(bumps);
+    free(num_bumps);
+    free(size_temp);
+    free(ivs);
+    free(derived);
+    free(preheader_code);
+    free_loop_facts(&facts);
+    return rewritten + eliminated;
+}
+
+/* Induction-variable strength reduction driver: process each function */
+int strength_reduce_induction_variables(TACCode* code) {
+    int total = 0;
+    TACInstruction* start = code->head;
+
+    while (start) {
+        LoopForest* forest;
+        CFG* cfg = get_function_loops(start, &forest);
+
+        if (forest->num_loops > 0 && insert_preheaders(code, cfg, forest) > 0) {
+            cfg = reanalyze_loops(start, cfg, &forest);
+        }
+
+        for (int l = 0; l < forest->num_loops; l++) {
+            int reduced = reduce_loop_ivs(code, cfg, forest, l);
+            if (reduced > 0) {
+                total += reduced;
+                cfg = reanalyze_loops(start, cfg, &forest);
+            }
+        }
+
+        start = cfg->end;
+        release_analyses(cfg, forest, NULL);
+    }
+
+    return total;
+}
+
+/* Loop unrolling settings, the headers of loops already unrolled (the
+ * remainder loop of a partial unroll must not be unrolled again) and the
+ * number of instructions unrolling has added to the program so far */
+static UnrollOptions unroll_options = { 4, 16, 64, 256 };
+static NameTable* unrolled_headers = NULL;
+static int unroll_growth = 0;
+
+/* Set the loop unrolling options */
+void set_unroll_options(const UnrollOptions* options) {
+    unroll_options = *options;
+}
+
+/* Get the loop unrolling options */
+UnrollOptions get_unroll_options(void) {
+    return unroll_options;
+}
+
+/* Counted loop in the shape produced for while/for statements:
+ *   Lh: <pure setup> r = iv op bound; if_false r goto exit; <body> goto Lh */
+typedef struct {
+    int first;               /* Index of the header label */
+    int relop;               /* Index of the exit test */
+    int last;                /* Index of the closing goto */
+    int iv;                  /* Basic IV tested by the exit test */
+    const char* bound;       /* Loop-invariant operand of the exit test */
+    const char* op;          /* Exit test operator with the IV on the left */
+} CountedLoop;
+
+/* Helper: Evaluate 'left op right' */
+static int relop_holds(const char* op, long long left, long long right) {
+    if (strcmp(op, "<") == 0) return left < right;
+    if (strcmp(op, ">") == 0) return left > right;
+    if (strcmp(op, "<=") == 0) return left <= right;
+    if (strcmp(op, ">=") == 0) return left >= right;
+    if (strcmp(op, "==") == 0) return left == right;
+    return left != right;
+}
+
+/* Helper: Recognize a counted, innermost, top-tested loop */
+static int match_counted_loop(CFG* cfg, LoopForest* forest, int l, LoopFacts* facts,
+                              BasicIV* ivs, int num_ivs, CountedLoop* counted) {
+    Loop* loop = &forest->loops[l];
+    int header = loop->header;
+    int latch = header + loop->num_blocks - 1;
+
+    for (int other = 0; other < forest->num_loops; other++) {
+        if (forest->loops[other].parent == l) return 0;          /* Not innermost */
+    }
+    if (loop->num_back_edges != 1 || loop->preheader < 0) return 0;
+
+    /* Blocks must be contiguous, entered at the header, left only by its test */
+    for (int i = 0; i < loop->num_blocks; i++) {
+        int b = loop->blocks[i];
+        if (b != header + i) return 0;
+        for (int s = 0; s < cfg->blocks[b].num_succs; s++) {
+            if (!loop->in_loop[cfg->blocks[b].succs[s]] && b != header) return 0;
+        }
+    }
+
+    BasicBlock* hblk = &cfg->blocks[header];
+    BasicBlock* lblk = &cfg->blocks[latch];
+    counted->first = hblk->start;
+    counted->last = lblk->start + lblk->count - 1;
+    counted->relop = hblk->start + hblk->count - 2;
+
+    TACInstruction* label = cfg->insts[counted->first];
+    TACInstruction* test = cfg->insts[counted->relop];
+    TACInstruction* branch = cfg->insts[counted->relop + 1];
+    TACInstruction* back = cfg->insts[counted->last];
+    if (label->opcode != TAC_LABEL || back->opcode != TAC_GOTO ||
+        strcmp(back->label, label->label) != 0) {
+        return 0;
+    }
+    if (counted->relop <= counted->first || test->opcode != TAC_RELOP ||
+        branch->opcode != TAC_IF_FALSE || strcmp(branch->op1, test->result) != 0 ||
+        !is_temp_name(test->result)) {
+        return 0;
+    }
+
+    /* Setup before the test is copied into every iteration, so it must be pure */
+    for (int j = counted->first + 1; j < counted->relop; j++) {
+        TACInstruction* inst = cfg->insts[j];
+        const char* def = tac_def(inst);
+        if (!def || !is_temp_name(def) || inst->opcode == TAC_CALL) return 0;
+    }
+
+    /* The test compares a basic IV with a loop-invariant bound */
+    counted->iv = -1;
+    for (int x = 0; x < num_ivs; x++) {
+        const char* name = facts->names->names[ivs[x].var];
+        if (!dominates(cfg, block_of(cfg, ivs[x].update), latch)) continue;  /* Steps every iteration */
+        if (strcmp(test->op1, name) == 0 && is_invariant_operand(facts, test->op2)) {
+            counted->bound = test->op2;
+            counted->op = test->label;
+        } else if (strcmp(test->op2, name) == 0 && is_invariant_operand(facts, test->op1)) {
+            counted->bound = test->op1;
+            counted->op = mirror_relop(test->label);
+        } else {
+            continue;
+        }
+        counted->iv = x;
+        break;
+    }
+    if (counted->iv < 0) return 0;
+
+    /* Temporaries set once in the loop are renamed in every copy, so none
+     * of them may be read after the loop */
+    for (int j = 0; j < cfg->num_insts; j++) {
+        if (j >= counted->first && j <= counted->last) continue;
+        const char* uses[3];
+        int n = tac_uses(cfg->insts[j], uses);
+        for (int u = 0; u < n; u++) {
+            int id = lookup_name_id(facts->names, uses[u]);
+            int d = facts->def_index[id];
+            if (facts->is_temp[id] && facts->function_defs[id] == 1 &&
+                d >= counted->first && d <= counted->last) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/* Helper: Find the constant a variable holds when the loop is entered:
+ * its last definition on the straight-line path into the preheader */
+static int value_on_entry(CFG* cfg, int preheader, const char* var, long long* value) {
+    int b = preheader;
+    int steps = 0;
+
+    while (b >= 0 && steps++ < cfg->num_blocks) {
+        BasicBlock* blk = &cfg->blocks[b];
+        for (int j = blk->start + blk->count - 1; j >= blk->start; j--) {
+            TACInstruction* inst = cfg->insts[j];
+            if (inst->opcode == TAC_CALL) return 0;
+            const char* def = tac_def(inst);
+            if (def && strcmp(def, var) == 0) {
+                if (inst->opcode != TAC_LOAD_CONST) return 0;
+                *value = atoll(inst->op1);
+                return 1;
+            }
+        }
+        b = blk->num_preds == 1 ? blk->preds[0] : -1;
+    }
+    return 0;
+}
+
+/* Renaming of the temporaries and labels defined in one copy of a loop */
+typedef struct {
+    char** from;
+    char** to;
+    int count;
+} RenameMap;
+
+/* Helper: Give every label and every temporary set once defined in
+ * [first, last] a new name. Temporaries set more than once (offsets made
+ * by the strength reduction) carry values between iterations and keep
+ * their names. */
+static void build_rename_map(CFG* cfg, LoopFacts* facts, int first, int last, RenameMap* map) {
+    map->from = (char**)safe_malloc((last - first + 2) * sizeof(char*), "loop unrolling");
+    map->to = (char**)safe_malloc((last - first + 2) * sizeof(char*), "loop unrolling");
+    map->count = 0;
+
+    for (int j = first; j <= last; j++) {
+        TACInstruction* inst = cfg->insts[j];
+        const char* def = tac_def(inst);
+        char* name = NULL;
+        const char* old = NULL;
+
+        if (def && is_temp_name(def) && facts->function_defs[lookup_name_id(facts->names, def)] == 1) {
+            old = def;
+            name = new_temp();
+        } else if (inst->opcode == TAC_LABEL) {
+            old = inst->label;
+            name = new_label();
+        }
+        if (!old) continue;
+
+        int k;
+        for (k = 0; k < map->count; k++) {
+            if (strcmp(map->from[k], old) == 0) break;
+        }
+        if (k < map->count) {
+            free(name);
+            continue;
+        }
+        map->from[map->count] = (char*)old;
+        map->to[map->count++] = name;
+    }
+}
+
+/* Helper: Renamed form of an operand (unchanged if not in the map) */
+static const char* rename_operand(RenameMap* map, const char* name) {
+    if (!name) return NULL;
+    for (int k = 0; k < map->count; k++) {
+        if (strcmp(map->from[k], name) == 0) return map->to[k];
+    }
+    return name;
+}
+
+/* Helper: Free a rename map */
+static void free_rename_map(RenameMap* map) {
+    for (int k = 0; k < map->count; k++) free(map->to[k]);
+    free(map->from);
+    free(map->to);
+}
+
+/* Helper: Append renamed copies of instructions [first, last] */
+static void copy_range(CFG* cfg, int first, int last, RenameMap* map,
+                       TACInstruction** out, int* count) {
+    for (int j = first; j <= last; j++) {
+        TACInstruction* inst = cfg->insts[j];
+        const char* label = inst->label;
+        if (inst->opcode == TAC_LABEL || inst->opcode == TAC_GOTO || inst->opcode == TAC_IF_FALSE) {
+            label = rename_operand(map, label);
+        }
+        out[*count] = create_tac_instruction(inst->opcode,
+                                             rename_operand(map, inst->result),
+                                             rename_operand(map, inst->op1),
+                                             rename_operand(map, inst->op2),
+                                             label);
+        out[(*count)++]->line = inst->line;
+    }
+}
+
+/* Helper: Append one iteration (setup and body) of a counted loop */
+static void copy_iteration(CFG* cfg, LoopFacts* facts, CountedLoop* counted,
+                           TACInstruction** out, int* count, RenameMap* map) {
+    build_rename_map(cfg, facts, counted->first + 1, counted->last - 1, map);
+    copy_range(cfg, counted->first + 1, counted->relop - 1, map, out, count);
+    copy_range(cfg, counted->relop + 2, counted->last - 1, map, out, count);
+}
+
+/* Helper: Remember that a loop header came out of unrolling */
+static void mark_unrolled(const char* label) {
+    if (!unrolled_headers) unrolled_headers = create_name_table(16);
+    intern_name(unrolled_headers, label);
+}
+
+/* Helper: Unroll one loop; returns 1 if the code changed */
+static int unroll_loop(TACCode* code, CFG* cfg, LoopForest* forest, int l) {
+    Loop* loop = &forest->loops[l];
+    TACInstruction* header = block_first(cfg, loop->header);
+    if (header->opcode != TAC_LABEL) return 0;
+    if (unrolled_headers && lookup_name_id(unrolled_headers, header->label) >= 0) return 0;
+
+    LoopFacts facts;
+    collect_loop_facts(cfg, loop, &facts);
+    BasicIV* ivs = (BasicIV*)safe_malloc((cfg->num_insts + 1) * sizeof(BasicIV), "loop unrolling");
+    int num_ivs = find_basic_ivs(cfg, loop, &facts, ivs);
+
+    CountedLoop counted;
+    if (!match_counted_loop(cfg, forest, l, &facts, ivs, num_ivs, &counted)) {
+        free(ivs);
+        free_loop_facts(&facts);
+        return 0;
+    }
+
+    BasicIV* iv = &ivs[counted.iv];
+    const char* iv_name = facts.names->names[iv->var];
+    int iteration_size = (counted.relop - counted.first - 1) + (counted.last - counted.relop - 2);
+    int changed = 0;
+
+    /* Trip count, when both the start value and the bound are constants */
+    long long start, bound_value;
+    int bound_const, trip = -1;
+    int c;
+    bound_const = constant_operand(cfg, &facts, counted.bound, &c);
+    bound_value = c;
+    if (bound_const && value_on_entry(cfg, loop->preheader, iv_name, &start)) {
+        long long v = start;
+        for (trip = 0; trip <= unroll_options.max_full_trip && relop_holds(counted.op, v, bound_value); trip++) {
+            v += iv->step;
+        }
+        if (trip > unroll_options.max_full_trip) trip = -1;
+    }
+
+    int capacity = cfg->num_insts + (iteration_size + 8) *
+                   (unroll_options.max_full_trip > unroll_options.factor ?
+                    unroll_options.max_full_trip : unroll_options.factor) + 8;
+    TACInstruction** order = (TACInstruction**)safe_malloc(capacity * sizeof(TACInstruction*),
+                                                           "loop unrolling");
+    int count = 0;
+
+    if (trip >= 0 && trip * iteration_size <= unroll_options.max_loop_size &&
+        unroll_growth + trip * iteration_size <= unroll_options.growth_budget) {
+        /* Full unrolling: the loop becomes 'trip' straight-line copies */
+        for (int j = 0; j < counted.first + 1; j++) order[count++] = cfg->insts[j];
+        for (int k = 0; k < trip; k++) {
+            RenameMap map;
+            copy_iteration(cfg, &facts, &counted, order, &count, &map);
+            free_rename_map(&map);
+        }
+        for (int j = counted.last + 1; j < cfg->num_insts; j++) order[count++] = cfg->insts[j];
+
+        for (int j = counted.first + 1; j <= counted.last; j++) free_tac_instruction(cfg->insts[j]);
+        unroll_growth += trip * iteration_size;
+        printf("[OPTIMIZER] Loop unrolling: Fully unrolled loop %s (%d iterations)\n",
+               header->label, trip);
+        changed = 1;
+    } else if (unroll_options.factor > 1 &&
+               ((iv->step > 0 && (strcmp(counted.op, "<") == 0 || strcmp(counted.op, "<=") == 0)) ||
+                (iv->step < 0 && (strcmp(counted.op, ">") == 0 || strcmp(counted.op, ">=") == 0))) &&
+               unroll_options.factor * iteration_size <= unroll_options.max_loop_size &&
+               unroll_growth + (unroll_options.factor * iteration_size + 5) <= unroll_options.growth_budget) {
+        /* Partial unrolling: run 'factor' iterations per trip while the last
+         * of them still passes the test, then finish in the original loop */
+        char text[32];
+        char* unrolled = new_label();
+        RenameMap map;
+
+        for (int j = 0; j < counted.first; j++) order[count++] = cfg->insts[j];
+        order[count++] = create_tac_instruction(TAC_LABEL, NULL, NULL, NULL, unrolled);
+
+        build_rename_map(cfg, &facts, counted.first + 1, counted.last - 1, &map);
+        copy_range(cfg, counted.first + 1, counted.relop - 1, &map, order, &count);
+
+        char* last_iv = new_temp();
+        char* test = new_temp();
+        snprintf(text, sizeof(text), "%d", (unroll_options.factor - 1) * iv->step);
+        order[count++] = create_tac_instruction(TAC_ADD, last_iv, iv_name, text, NULL);
+        order[count++] = create_tac_instruction(TAC_RELOP, test, last_iv,
+                                                rename_operand(&map, counted.bound), counted.op);
+        order[count++] = create_tac_instruction(TAC_IF_FALSE, NULL, test, NULL, header->label);
+        copy_range(cfg, counted.relop + 2, counted.last - 1, &map, order, &count);
+        free_rename_map(&map);
+
+        for (int k = 1; k < unroll_options.factor; k++) {
+            copy_iteration(cfg, &facts, &counted, order, &count, &map);
+            free_rename_map(&map);
+        }
+        order[count++] = create_tac_instruction(TAC_GOTO, NULL, NULL, NULL, unrolled);
+
+        for (int j = counted.first; j < cfg->num_insts; j++) order[count++] = cfg->insts[j];
+
+        mark_unrolled(unrolled);
+        mark_unrolled(header->label);
+        unroll_growth += unroll_options.factor * iteration_size + 5;
+        printf("[OPTIMIZER] Loop unrolling: Unrolled loop %s by %d as %s, remainder in %s\n",
+               header->label, unroll_options.factor, unrolled, header->label);
+        free(last_iv);
+        free(test);
+        free(unrolled);
+        changed = 1;
+    }
+
+    if (changed) {
+        int old_count = cfg->num_insts;
+        relink_function(code, cfg, order, count);
+        code->instruction_count += count - old_count;
+    }
+
+    free(order);
+    free(ivs);
+    free_loop_facts(&facts);
+    return changed;
+}
+
+/* Loop unrolling driver: process each function */
+int unroll_loops(TACCode* code) {
+    int total = 0;
+    TACInstruction* start = code->head;
+
+    if (unroll_options.factor <= 0) return 0;
+
+    while (start) {
+        LoopForest* forest;
+        CFG* cfg = get_function_loops(start, &forest);
+
+        if (forest->num_loops > 0 && insert_preheaders(code, cfg, forest) > 0) {
+            cfg = reanalyze_loops(start, cfg, &forest);
+        }
+
+        /* Unrolling changes the block structure, so start over after each loop */
+        int l = 0;
+        while (l < forest->num_loops) {
+            if (unroll_loop(code, cfg, forest, l)) {
+                total++;
+                cfg = reanalyze_loops(start, cfg, &forest);
+                l = 0;
+            } else {
+                l++;
+            }
+        }
+
+        start = cfg->end;
+        release_analyses(cfg, forest, NULL);
+    }
+
+    return total;
+}
@@ -0,0 +1,53 @@
+/*
+ * LOOP_OPT.H - Loop Optimizations Header
+ * CST-405 Compiler Project
+ *
+ * This file defines the optimizations that work on the natural loops
+ * found in the control flow graph of each function:
+ * - Loop-invariant code motion
+ * - Induction-variable strength reduction for array indexing
+ * - Loop unrolling
+ */
+
+#ifndef LOOP_OPT_H
+#define LOOP_OPT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ircode.h"
+
+/* Loop unrolling limits */
+typedef struct {
+    int factor;              /* Partial unrolling factor (1 = full unrolling only, 0 = off) */
+    int max_full_trip;       /* Most iterations a loop may have to be fully unrolled */
+    int max_loop_size;       /* Most instructions an unrolled loop body may have */
+    int growth_budget;       /* Most instructions unrolling may add to the program */
+} UnrollOptions;
+
+/* LOOP OPTIMIZATION FUNCTIONS */
+
+/* Loop-invariant code motion: move computations whose operands do not
+ * change inside a loop into the loop preheader. Returns the number of
+ * instructions hoisted; a count per loop is logged. */
+int loop_invariant_code_motion(TACCode* code);
+
+/* Induction-variable strength reduction: array accesses indexed by a
+ * variable stepped by a constant each iteration switch to a byte offset
+ * that is bumped along with it, so no index scaling is left in the loop.
+ * An induction variable used only for addressing and the exit test is
+ * removed. Returns the number of accesses and variables rewritten. */
+int strength_reduce_induction_variables(TACCode* code);
+
+/* Loop unrolling: counted loops whose trip count is a small constant are
+ * replaced by copies of their body; other counted loops run 'factor'
+ * copies per trip while enough iterations remain, and finish in the
+ * original loop. Returns the number of loops unrolled. */
+int unroll_loops(TACCode* code);
+
+/* Get/set the loop unrolling limits (defaults: factor 4, full unrolling
+ * up to 16 iterations, 64-instruction bodies, 256 added instructions) */
+UnrollOptions get_unroll_options(void);
+void set_unroll_options(const UnrollOptions* options);
+
+#endif /* LOOP_OPT_H */
@@ -0,0 +1,522 @@
+/*
+ * MIR.C - Machine IR Implementation
+ * CST-405 Compiler Project
+ *
+ * This file implements the machine IR: the builder that reads emitted
+ * lines into instructions with the target description, the basic blocks,
+ * the printer, and the analyses passes share:
+ * - Effects: the registers an instruction reads and writes (a view such
+ *   as eax or al counts as its whole register) and the memory operand it
+ *   loads or stores, from the operand roles and implicit registers of
+ *   its opcode
+ * - Liveness: a register is dead after an instruction if every path from
+ *   there writes it before reading it. The search follows the successors
+ *   of the blocks with a step budget; code MIR cannot see (text lines,
+ *   jumps out of the program) counts as reading every register
+ * - Aliasing: memory operands are assumed to overlap unless both are
+ *   fixed words of the same frame or global that do not overlap, or one
+ *   is in the frame and the other in a global
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "mir.h"
+#include "diagnostics.h"
+
+#define REG_BIT(r) (1ULL << (r))
+#define LIVE_BUDGET 256             /* Instructions a liveness search may visit */
+#define LIVE_DEPTH 8                /* Branches it may follow at once */
+
+/* ============================================================
+ * BUILDING
+ * ============================================================ */
+
+/* Create an empty program for a target */
+MirProgram* create_mir(const MirTarget* target) {
+    MirProgram* program = (MirProgram*)safe_calloc(1, sizeof(MirProgram), "machine IR");
+    program->target = target;
+    return program;
+}
+
+/* Helper: Copy 'length' characters of 'source' without surrounding spaces */
+static void copy_trimmed(char* dest, size_t size, const char* source, size_t length) {
+    while (length > 0 && isspace((unsigned char)*source)) {
+        source++;
+        length--;
+    }
+    while (length > 0 && isspace((unsigned char)source[length - 1])) length--;
+    if (length >= size) length = size - 1;
+    memcpy(dest, source, length);
+    dest[length] = '\0';
+}
+
+/* Helper: Append a line */
+static MirInstr* add_line(MirProgram* program, MirLineKind kind, const char* text) {
+    if (program->count == program->capacity) {
+        program->capacity = program->capacity ? program->capacity * 2 : 256;
+        program->lines = (MirInstr*)safe_realloc(program->lines, program->capacity * sizeof(MirInstr),
+                                                 "machine IR");
+    }
+    MirInstr* instr = &program->lines[program->count++];
+    memset(instr, 0, sizeof(MirInstr));
+    instr->kind = kind;
+    instr->text = safe_strdup(text, "machine IR");
+    instr->block = -1;
+    return instr;
+}
+
+/* Helper: Split an operand list at commas outside brackets and parentheses */
+static int split_operands(const char* text, char operands[][MIR_NAME_SIZE], int* count) {
+    int depth = 0;
+    const char* start = text;
+    *count = 0;
+    if (*text == '\0') return 1;
+    for (const char* p = text; ; p++) {
+        if (*p == '[' || *p == '(') depth++;
+        if (*p == ']' || *p == ')') depth--;
+        if ((*p == ',' && depth == 0) || *p == '\0') {
+            if (*count == MIR_MAX_OPERANDS || (size_t)(p - start) >= MIR_NAME_SIZE) return 0;
+            copy_trimmed(operands[(*count)++], MIR_NAME_SIZE, start, p - start);
+            start = p + 1;
+        }
+        if (*p == '\0') break;
+    }
+    return 1;
+}
+
+/* Helper: Read one line of the code section */
+static void read_code_line(MirProgram* program, const char* text) {
+    const MirTarget* target = program->target;
+    const char* end = strchr(text, target->comment);
+    size_t length = end ? (size_t)(end - text) : strlen(text);
+    char body[512];
+
+    if (length >= sizeof(body)) {
+        add_line(program, MIR_TEXT, text);
+        return;
+    }
+    copy_trimmed(body, sizeof(body), text, length);
+    if (body[0] == '\0') {
+        add_line(program, MIR_NOTE, text);
+        return;
+    }
+
+    /* Label: an identifier followed by ':' and nothing else */
+    size_t n = strlen(body);
+    if (body[n - 1] == ':') {
+        for (size_t i = 0; i + 1 < n; i++) {
+            if (!isalnum((unsigned char)body[i]) && body[i] != '_' && body[i] != '.' && body[i] != '$') {
+                add_line(program, MIR_TEXT, text);
+                return;
+            }
+        }
+        body[n - 1] = '\0';
+        add_line(program, MIR_LABEL, body);
+        return;
+    }
+
+    /* Instruction: mnemonic, then operands */
+    char mnemonic[16];
+    char operands[MIR_MAX_OPERANDS][MIR_NAME_SIZE];
+    int count;
+    size_t m = 0;
+    while (body[m] && !isspace((unsigned char)body[m])) m++;
+    int opcode = -1;
+    if (m < sizeof(mnemonic)) {
+        for (size_t i = 0; i < m; i++) mnemonic[i] = (char)tolower((unsigned char)body[i]);
+        mnemonic[m] = '\0';
+        if (split_operands(body + m + (body[m] ? 1 : 0), operands, &count)) {
+            opcode = mir_find_opcode(target, mnemonic, count);
+        }
+    }
+    MirOperand parsed[MIR_MAX_OPERANDS];
+    for (int i = 0; opcode >= 0 && i < count; i++) {
+        memset(&parsed[i], 0, sizeof(MirOperand));
+        if (!target->parse_operand(operands[i], target->opcodes[opcode].roles[i], &parsed[i])) opcode = -1;
+    }
+    if (opcode < 0) {
+        add_line(program, MIR_TEXT, text);          /* Directive, or not an instruction MIR models */
+        return;
+    }
+    MirInstr* instr = add_line(program, MIR_INSTR, body);
+    instr->opcode = opcode;
+    instr->num_operands = count;
+    memcpy(instr->operands, parsed, count * sizeof(MirOperand));
+    if (end) instr->comment = safe_strdup(end + 1, "machine IR");
+}
+
+/* Helper: Read one emitted line */
+static void read_line(MirProgram* program, const char* text) {
+    int section = program->target->section(text);
+    if (section >= 0) {
+        program->code_section = section;
+        add_line(program, MIR_TEXT, text);
+    } else if (program->code_section) {
+        read_code_line(program, text);
+    } else {
+        add_line(program, MIR_TEXT, text);
+    }
+}
+
+/* Append the lines of formatted assembly text */
+void mir_vemit(MirProgram* program, const char* format, va_list args) {
+    char buffer[1024];
+    va_list copy;
+    va_copy(copy, args);
+    int length = vsnprintf(buffer, sizeof(buffer), format, copy);
+    va_end(copy);
+    char* text = buffer;
+    if (length < 0) return;
+    if ((size_t)length >= sizeof(buffer)) {
+        text = (char*)safe_malloc(length + 1, "machine IR");
+        vsnprintf(text, length + 1, format, args);
+    }
+
+    /* Join with the unfinished line, then read every finished one */
+    char* joined = text;
+    if (program->pending) {
+        joined = (char*)safe_malloc(strlen(program->pending) + length + 1, "machine IR");
+        strcpy(joined, program->pending);
+        strcat(joined, text);
+        free(program->pending);
+        program->pending = NULL;
+    }
+    char* start = joined;
+    char* newline;
+    while ((newline = strchr(start, '\n')) != NULL) {
+        *newline = '\0';
+        read_line(program, start);
+        start = newline + 1;
+    }
+    if (*start) program->pending = safe_strdup(start, "machine IR");
+    if (joined != text) free(joined);
+    if (text != buffer) free(text);
+}
+
+void mir_emit(MirProgram* program, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    mir_vemit(program, format, args);
+    va_end(args);
+}
+
+/* Helper: Block of the label 'name' (MIR_UNKNOWN if none) */
+static int label_block(const MirProgram* program, const char* name) {
+    for (int i = 0; i < program->count; i++) {
+        const MirInstr* line = &program->lines[i];
+        if (line->kind == MIR_LABEL && !strcmp(line->text, name)) return line->block;
+    }
+    return MIR_UNKNOWN;
+}
+
+/* Helper: Block execution falls into after line 'line' (MIR_UNKNOWN if none) */
+static int fall_through(const MirProgram* program, int line) {
+    int i = line + 1;
+    while (i < program->count && program->lines[i].kind == MIR_NOTE) i++;
+    if (i == program->count || program->lines[i].block < 0) return MIR_UNKNOWN;
+    return program->lines[i].block;
+}
+
+/* Helper: Finish the builder's unfinished line */
+static void flush_pending(MirProgram* program) {
+    if (!program->pending) return;
+    read_line(program, program->pending);
+    free(program->pending);
+    program->pending = NULL;
+}
+
+/* Split the code section into basic blocks */
+void build_mir_blocks(MirProgram* program) {
+    int capacity = 0;
+    int current = -1;
+    flush_pending(program);
+    free(program->blocks);
+    program->blocks = NULL;
+    program->num_blocks = 0;
+
+    /* A block starts at a label or after the end of another, and ends
+     * after a jump, branch or return or before a line MIR does not model */
+    for (int i = 0; i < program->count; i++) {
+        MirInstr* line = &program->lines[i];
+        line->block = -1;
+        if (line->kind == MIR_TEXT) {
+            current = -1;
+            continue;
+        }
+        if (line->kind == MIR_NOTE) {
+            line->block = current;
+            continue;
+        }
+        if (line->kind == MIR_LABEL || current < 0) {
+            if (program->num_blocks == capacity) {
+                capacity = capacity ? capacity * 2 : 64;
+                program->blocks = (MirBlock*)safe_realloc(program->blocks, capacity * sizeof(MirBlock),
+                                                          "machine IR");
+            }
+            current = program->num_blocks++;
+            program->blocks[current].first = i;
+        }
+        line->block = current;
+        program->blocks[current].last = i;
+        if (line->kind == MIR_INSTR) {
+            MirClass opclass = mir_opcode(program, line)->opclass;
+            if (opclass == MIR_CLASS_JUMP || opclass == MIR_CLASS_BRANCH || opclass == MIR_CLASS_RETURN) {
+                current = -1;
+            }
+        }
+    }
+
+    /* Successors */
+    for (int b = 0; b < program->num_blocks; b++) {
+        MirBlock* block = &program->blocks[b];
+        const MirInstr* last = &program->lines[block->last];
+        MirClass opclass = last->kind == MIR_INSTR ? mir_opcode(program, last)->opclass : MIR_CLASS_ALU;
+        const MirOperand* label = last->kind == MIR_INSTR && last->num_operands > 0 ?
+                                  &last->operands[last->num_operands - 1] : NULL;
+        block->succ[0] = fall_through(program, block->last);
+        block->succ[1] = MIR_EXIT;
+        if (opclass == MIR_CLASS_JUMP || opclass == MIR_CLASS_BRANCH) {
+            int taken = label && label->kind == MIR_OP_SYMBOL ? label_block(program, label->symbol) : MIR_UNKNOWN;
+            if (opclass == MIR_CLASS_JUMP) block->succ[0] = taken;
+            else block->succ[1] = taken;
+        } else if (opclass == MIR_CLASS_RETURN) {
+            block->succ[0] = MIR_EXIT;
+        }
+    }
+}
+
+/* Print the program as assembly */
+void print_mir(MirProgram* program, FILE* out) {
+    const MirTarget* target = program->target;
+    flush_pending(program);
+    for (int i = 0; i < program->count; i++) {
+        MirInstr* line = &program->lines[i];
+        if (line->deleted) continue;
+        if (line->kind == MIR_LABEL) {
+            fprintf(out, "%s:\n", line->text);
+            continue;
+        }
+        if (line->kind != MIR_INSTR) {
+            fprintf(out, "%s\n", line->text);
+            continue;
+        }
+        fprintf(out, "    %s", target->opcodes[line->opcode].mnemonic);
+        for (int k = 0; k < line->num_operands; k++) {
+            char operand[2 * MIR_NAME_SIZE];
+            target->format_operand(&line->operands[k], operand, sizeof(operand));
+            fprintf(out, "%s%s", k ? ", " : " ", operand);
+        }
+        if (line->comment) fprintf(out, "    %c%s", target->comment, line->comment);
+        fprintf(out, "\n");
+    }
+}
+
+/* Free the program */
+void free_mir(MirProgram* program) {
+    if (!program) return;
+    for (int i = 0; i < program->count; i++) {
+        free(program->lines[i].text);
+        free(program->lines[i].comment);
+    }
+    free(program->lines);
+    free(program->pending);
+    free(program->blocks);
+    free(program);
+}
+
+/* ============================================================
+ * INSTRUCTIONS
+ * ============================================================ */
+
+/* Index of an opcode in the target's table (-1 if none) */
+int mir_find_opcode(const MirTarget* target, const char* mnemonic, int num_operands) {
+    for (int i = 0; i < target->num_opcodes; i++) {
+        if (target->opcodes[i].num_operands == num_operands && !strcmp(target->opcodes[i].mnemonic, mnemonic)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Opcode of an instruction line */
+const MirOpcode* mir_opcode(const MirProgram* program, const MirInstr* instr) {
+    return &program->target->opcodes[instr->opcode];
+}
+
+/* Set an instruction to 'mnemonic operands' */
+int mir_set(const MirTarget* target, MirInstr* instr, const char* mnemonic, int num_operands,
+            const MirOperand* operands) {
+    int opcode = mir_find_opcode(target, mnemonic, num_operands);
+    if (opcode < 0) return 0;
+    MirOperand copy[MIR_MAX_OPERANDS];
+    memcpy(copy, operands, num_operands * sizeof(MirOperand));     /* May be the instruction's own */
+    instr->opcode = opcode;
+    instr->num_operands = num_operands;
+    memcpy(instr->operands, copy, num_operands * sizeof(MirOperand));
+    return 1;
+}
+
+/* Remove a line */
+void mir_delete(MirProgram* program, int line) {
+    program->lines[line].deleted = 1;
+}
+
+/* Next instruction of the same block after 'line' */
+int mir_next(const MirProgram* program, int line) {
+    int block = program->lines[line].block;
+    if (block < 0) return -1;
+    for (int i = line + 1; i <= program->blocks[block].last; i++) {
+        if (!program->lines[i].deleted && program->lines[i].kind == MIR_INSTR) return i;
+    }
+    return -1;
+}
+
+/* ============================================================
+ * ANALYSES
+ * ============================================================ */
+
+/* Registers a memory operand's address reads */
+unsigned long long mir_address_registers(const MirOperand* operand) {
+    unsigned long long regs = 0;
+    if (operand->kind != MIR_OP_MEM) return 0;
+    if (operand->reg != MIR_NO_REG) regs |= REG_BIT(operand->reg);
+    if (operand->index != MIR_NO_REG) regs |= REG_BIT(operand->index);
+    return regs;
+}
+
+/* Registers and memory an instruction reads and writes */
+MirEffects mir_effects(const MirProgram* program, int line) {
+    const MirTarget* target = program->target;
+    const MirInstr* instr = &program->lines[line];
+    MirEffects effects;
+    memset(&effects, 0, sizeof(MirEffects));
+    effects.load = -1;
+    effects.store = -1;
+    if (instr->kind != MIR_INSTR) {
+        effects.block_end = instr->kind != MIR_NOTE;
+        return effects;
+    }
+
+    const MirOpcode* opcode = mir_opcode(program, instr);
+    for (int i = 0; i < instr->num_operands; i++) {
+        const MirOperand* operand = &instr->operands[i];
+        char role = (char)tolower((unsigned char)opcode->roles[i]);
+        int read = role == 'u' || role == 'b';
+        int write = role == 'd' || role == 'b';
+        if (operand->kind == MIR_OP_REG) {
+            int partial = (target->partial_views & REG_BIT(operand->view)) != 0;
+            if (read || (write && partial)) effects.reads |= REG_BIT(operand->reg);
+            if (write) effects.writes |= REG_BIT(operand->reg);
+        } else if (operand->kind == MIR_OP_MEM) {
+            effects.reads |= mir_address_registers(operand);
+            if (read) effects.load = i;
+            if (write) effects.store = i;
+        }
+    }
+    if ((opcode->flags & MIR_ZERO_IDIOM) && instr->num_operands == 2 &&
+        mir_same_operand(&instr->operands[0], &instr->operands[1])) {
+        effects.reads &= ~REG_BIT(instr->operands[0].reg);
+    }
+    effects.reads |= opcode->uses;
+    effects.writes |= opcode->defs;
+    effects.barrier = (opcode->flags & MIR_MEMORY) != 0;
+    effects.block_end = opcode->opclass == MIR_CLASS_JUMP || opcode->opclass == MIR_CLASS_BRANCH ||
+                        opcode->opclass == MIR_CLASS_RETURN;
+    return effects;
+}
+
+/* Helper: Is 'reg' read on a path from line 'start' of 'block' before it
+ * is written? Fall-through and jumps are followed in a loop, the other
+ * side of a branch by a recursive search */
+static int live_from(const MirProgram* program, int block, int start, int reg, int* budget, int depth) {
+    unsigned long long bit = REG_BIT(reg);
+    for (;;) {
+        const MirBlock* b = &program->blocks[block];
+        if (--*budget < 0) return 1;
+        for (int i = start; i <= b->last; i++) {
+            const MirInstr* line = &program->lines[i];
+            if (line->deleted || line->kind != MIR_INSTR) continue;
+            if (--*budget < 0) return 1;
+            MirEffects effects = mir_effects(program, i);
+            if (effects.reads & bit) return 1;
+            if (effects.writes & bit) return 0;
+        }
+        if (b->succ[1] != MIR_EXIT) {
+            if (b->succ[1] == MIR_UNKNOWN || depth >= LIVE_DEPTH) return 1;
+            if (live_from(program, b->succ[1], program->blocks[b->succ[1]].first, reg, budget, depth + 1)) return 1;
+        }
+        if (b->succ[0] == MIR_EXIT) return 0;
+        if (b->succ[0] == MIR_UNKNOWN) return 1;
+        block = b->succ[0];
+        start = program->blocks[block].first;
+    }
+}
+
+/* Is 'reg' read on some path after 'line' before it is written? */
+int mir_live_after(const MirProgram* program, int line, int reg) {
+    int budget = LIVE_BUDGET;
+    int block = program->lines[line].block;
+    if (block < 0) return 1;
+    return live_from(program, block, line + 1, reg, &budget, 0);
+}
+
+/* Kinds of addresses */
+typedef enum { ADDRESS_FRAME, ADDRESS_GLOBAL, ADDRESS_OTHER } AddressKind;
+
+/* Helper: Where does a memory operand point, and is it one fixed word? */
+static AddressKind address_kind(const MirProgram* program, const MirOperand* operand, int* fixed) {
+    int frame = operand->reg != MIR_NO_REG && (program->target->frame_registers & REG_BIT(operand->reg));
+    *fixed = operand->index == MIR_NO_REG;
+    if (operand->symbol[0] != '\0') {
+        if (operand->reg != MIR_NO_REG) {
+            if (frame) return ADDRESS_OTHER;
+            *fixed = 0;                             /* label($t0): an element */
+        }
+        return ADDRESS_GLOBAL;
+    }
+    return frame ? ADDRESS_FRAME : ADDRESS_OTHER;
+}
+
+/* May two memory operands refer to the same word? */
+int mir_may_alias(const MirProgram* program, const MirOperand* a, const MirOperand* b) {
+    int fixed_a, fixed_b;
+    AddressKind kind_a = address_kind(program, a, &fixed_a);
+    AddressKind kind_b = address_kind(program, b, &fixed_b);
+    if (kind_a == ADDRESS_OTHER || kind_b == ADDRESS_OTHER) return 1;
+    if (kind_a != kind_b) return 0;                 /* The frame is not a global */
+    if (kind_a == ADDRESS_GLOBAL && strcmp(a->symbol, b->symbol) != 0) return 0;
+    if (kind_a == ADDRESS_FRAME && a->reg != b->reg) return 1;     /* rbp and rsp may meet */
+    if (!fixed_a || !fixed_b) return 1;
+    long long distance = a->value - b->value;
+    return distance > -program->target->word && distance < program->target->word;
+}
+
+/* Are two operands the same? */
+int mir_same_operand(const MirOperand* a, const MirOperand* b) {
+    if (a->kind != b->kind) return 0;
+    switch (a->kind) {
+        case MIR_OP_REG:
+            return a->reg == b->reg && a->view == b->view;
+        case MIR_OP_IMM:
+            return a->value == b->value;
+        case MIR_OP_MEM:
+            return a->reg == b->reg && a->index == b->index && a->value == b->value &&
+                   (a->index == MIR_NO_REG || a->scale == b->scale) && !strcmp(a->symbol, b->symbol);
+        case MIR_OP_SYMBOL:
+            return !strcmp(a->symbol, b->symbol);
+        default:
+            return 1;
+    }
+}
+
+/* Is the operand a whole register passes may rename? */
+int mir_plain_register(const MirProgram* program, const MirOperand* operand) {
+    return operand->kind == MIR_OP_REG && operand->view == 0 &&
+           !(program->target->reserved & REG_BIT(operand->reg));
+}
+
+/* Is the operand a whole memory word? */
+int mir_word_memory(const MirProgram* program, const MirOperand* operand) {
+    return operand->kind == MIR_OP_MEM && (operand->size == 0 || operand->size == program->target->word);
+}
@@ -0,0 +1,223 @@
+/*
+ * MIR.H - Machine IR Header
+ * CST-405 Compiler Project
+ *
+ * This file defines the machine IR (MIR) both back ends lower their code
+ * into. Passes over generated code work on MIR instead of on printed
+ * text, and a target's printer writes the assembly at the end:
+ * - An instruction is a target opcode with structured operands:
+ *   registers (physical, numbered by the target), immediates, memory
+ *   (label + base + index * scale + displacement) and symbols
+ * - The program keeps its lines in order: instructions, labels, and the
+ *   text MIR does not model (directives, data, comments), printed as it
+ *   was written
+ * - Basic blocks split the code section at labels and after jumps,
+ *   branches and returns, and know their successors
+ * - A target description lists the target's opcodes with what each one
+ *   does (the role of every operand, the registers it reads and writes
+ *   implicitly, whether it touches memory no operand names) and how to
+ *   read, print and build operands and copies. The analyses here
+ *   (effects, liveness, aliasing) and the passes over MIR (the peephole
+ *   pass in asmopt.c) are written once for every target
+ * The generators keep their instruction templates: mir_emit reads each
+ * line they emit into an instruction with the target description, like
+ * an assembler would.
+ */
+
+#ifndef MIR_H
+#define MIR_H
+
+#include <stdio.h>
+#include <stdarg.h>
+
+#define MIR_MAX_OPERANDS 3
+#define MIR_NAME_SIZE 96            /* Symbols and labels */
+#define MIR_NO_REG -1
+
+/* Operand kinds */
+typedef enum {
+    MIR_OP_NONE,
+    MIR_OP_REG,                     /* Register */
+    MIR_OP_IMM,                     /* Integer literal */
+    MIR_OP_MEM,                     /* Memory word */
+    MIR_OP_SYMBOL                   /* Label, function or address of a global */
+} MirOperandKind;
+
+/* Operand */
+typedef struct {
+    MirOperandKind kind;
+    int reg;                        /* REG: the register; MEM: base register (MIR_NO_REG if none) */
+    int view;                       /* REG: 0 for the whole register, else a narrower view (eax, al) */
+    int index;                      /* MEM: index register (MIR_NO_REG if none) */
+    int scale;                      /* MEM: index scale */
+    long long value;                /* IMM: the value; MEM: displacement */
+    int size;                       /* MEM, IMM: access size written out (x86 "qword"), 0 if implied */
+    char symbol[MIR_NAME_SIZE];     /* SYMBOL: the name; MEM: label the address is off ("" if none) */
+} MirOperand;
+
+/* Opcode classes */
+typedef enum {
+    MIR_CLASS_COPY,                 /* First 'd' operand = first 'u' operand (mov, move, li, lw, sw) */
+    MIR_CLASS_ALU,                  /* Any other computation */
+    MIR_CLASS_COMPARE,              /* Sets condition flags only */
+    MIR_CLASS_JUMP,                 /* Jump to its label */
+    MIR_CLASS_BRANCH,               /* Conditional branch to its last operand */
+    MIR_CLASS_CALL,
+    MIR_CLASS_RETURN
+} MirClass;
+
+/* Opcode flags */
+#define MIR_MEMORY 1                /* Reads or writes memory no operand names (push, call) */
+#define MIR_ZERO_IDIOM 2            /* "op r, r" sets r without reading it (xor rax, rax) */
+
+/* Opcode description. roles has one letter per operand: 'u' read,
+ * 'd' written, 'b' read and written, 'a' address only (lea), 'l' label;
+ * upper case where the target writes a memory operand in its own syntax
+ * (MIPS lw/sw/la) */
+typedef struct {
+    const char* mnemonic;
+    int num_operands;
+    MirClass opclass;
+    const char* roles;
+    unsigned long long uses;        /* Registers read implicitly */
+    unsigned long long defs;        /* Registers written implicitly */
+    int flags;
+} MirOpcode;
+
+/* Line kinds */
+typedef enum {
+    MIR_INSTR,                      /* Instruction of the code section */
+    MIR_LABEL,                      /* "name:" in the code section */
+    MIR_NOTE,                       /* Blank or comment-only line */
+    MIR_TEXT                        /* Anything else, printed as written */
+} MirLineKind;
+
+/* Line of the program */
+typedef struct {
+    MirLineKind kind;
+    int opcode;                     /* INSTR: index in the target's opcode table */
+    MirOperand operands[MIR_MAX_OPERANDS];
+    int num_operands;
+    char* text;                     /* Line as written (LABEL: the name; unused for INSTR) */
+    char* comment;                  /* INSTR: comment after it (NULL if none) */
+    int block;                      /* Basic block (-1 if none) */
+    int deleted;                    /* Removed by a pass */
+} MirInstr;
+
+#define MIR_EXIT -1                 /* Successor: none (return, jump) */
+#define MIR_UNKNOWN -2              /* Successor: code MIR cannot see */
+
+/* Basic block */
+typedef struct {
+    int first;                      /* First line */
+    int last;                       /* Last line */
+    int succ[2];                    /* Fall-through and branch target (block, MIR_EXIT or MIR_UNKNOWN) */
+} MirBlock;
+
+struct MirTarget;
+
+/* Machine code of one output file */
+typedef struct {
+    const struct MirTarget* target;
+    MirInstr* lines;
+    int count;
+    int capacity;
+    int code_section;               /* Builder: inside the code section */
+    char* pending;                  /* Builder: emitted text not ended by a newline yet */
+    MirBlock* blocks;
+    int num_blocks;
+} MirProgram;
+
+/* Target description */
+typedef struct MirTarget {
+    const char* name;
+    char comment;                   /* Comment character */
+    int word;                       /* Bytes per word */
+    const MirOpcode* opcodes;
+    int num_opcodes;
+    unsigned long long frame_registers; /* Registers frames are addressed from */
+    unsigned long long reserved;    /* Registers passes never rename (stack, frame, zero, ...) */
+    unsigned long long partial_views; /* Register views whose writes keep the rest of the register */
+    /* Is the line a section switch? 1: code section, 0: other, -1: not a switch */
+    int (*section)(const char* line);
+    /* Read an operand for an operand role; 0 if it is not a valid one */
+    int (*parse_operand)(const char* text, char role, MirOperand* operand);
+    /* Print an operand */
+    void (*format_operand)(const MirOperand* operand, char* text, size_t size);
+    /* Build "dest = source" as one instruction; 0 if the target has none */
+    int (*copy)(const struct MirTarget* target, MirInstr* instr, const MirOperand* dest, const MirOperand* source);
+    /* Make an instruction read 'memory' where it reads register 'reg'; 0
+     * if the target has no such form (NULL: never) */
+    int (*fold_load)(const struct MirTarget* target, MirInstr* instr, int reg, const MirOperand* memory);
+} MirTarget;
+
+/* What an instruction does */
+typedef struct {
+    unsigned long long reads;       /* Registers read */
+    unsigned long long writes;      /* Registers written */
+    int load;                       /* Operand loaded from memory (-1 if none) */
+    int store;                      /* Operand stored to memory (-1 if none) */
+    int barrier;                    /* Touches memory no operand names */
+    int block_end;                  /* Not an instruction, or ends its block */
+} MirEffects;
+
+/* BUILDING AND PRINTING */
+
+/* Create an empty program for a target */
+MirProgram* create_mir(const MirTarget* target);
+
+/* Append the lines of formatted assembly text (a line is read once it ends) */
+void mir_emit(MirProgram* program, const char* format, ...);
+void mir_vemit(MirProgram* program, const char* format, va_list args);
+
+/* Split the code section into basic blocks */
+void build_mir_blocks(MirProgram* program);
+
+/* Print the program as assembly */
+void print_mir(MirProgram* program, FILE* out);
+
+/* Free the program */
+void free_mir(MirProgram* program);
+
+/* INSTRUCTIONS */
+
+/* Index of an opcode in the target's table (-1 if none) */
+int mir_find_opcode(const MirTarget* target, const char* mnemonic, int num_operands);
+
+/* Opcode of an instruction line */
+const MirOpcode* mir_opcode(const MirProgram* program, const MirInstr* instr);
+
+/* Set an instruction to 'mnemonic operands' (0 if the target has no such opcode) */
+int mir_set(const MirTarget* target, MirInstr* instr, const char* mnemonic, int num_operands,
+            const MirOperand* operands);
+
+/* Remove a line */
+void mir_delete(MirProgram* program, int line);
+
+/* Next instruction of the same block after 'line' (-1 at the end of the block) */
+int mir_next(const MirProgram* program, int line);
+
+/* ANALYSES */
+
+/* Registers and memory an instruction reads and writes */
+MirEffects mir_effects(const MirProgram* program, int line);
+
+/* Is 'reg' read on some path after 'line' before it is written? */
+int mir_live_after(const MirProgram* program, int line, int reg);
+
+/* May two memory operands refer to the same word? */
+int mir_may_alias(const MirProgram* program, const MirOperand* a, const MirOperand* b);
+
+/* Are two operands the same? */
+int mir_same_operand(const MirOperand* a, const MirOperand* b);
+
+/* Is the operand a whole register passes may rename? */
+int mir_plain_register(const MirProgram* program, const MirOperand* operand);
+
+/* Is the operand a whole memory word? */
+int mir_word_memory(const MirProgram* program, const MirOperand* operand);
+
+/* Registers a memory operand's address reads */
+unsigned long long mir_address_registers(const MirOperand* operand);
+
+#endif /* MIR_H */
@@ -7,22 +7,10 @@
  */
 
 #include "optimizer.h"
-#include <ctype.h>
-
-/* Helper function: Check if a string represents a number */
-int is_number(const char* str) {
-    if (!str || *str == '\0') return 0;
-
-    /* Handle negative numbers */
-    if (*str == '-') str++;
-
-    /* Check if all remaining characters are digits */
-    while (*str) {
-        if (!isdigit(*str)) return 0;
-        str++;
-    }
-    return 1;
-}
+#include "passes.h"
+#include "cfg.h"
+#include "range.h"
+#include "diagnostics.h"
 
 /* Helper function: Evaluate binary operation on two constants */
 int evaluate_binary_op(const char* op, int left, int right) {
@@ -116,9 +104,143 @@ int constant_folding(TACCode* code) {
     return optimizations;
 }
 
+/* Helper: Does this instruction only compute its result (no side effects)? */
+static int is_pure_definition(TACInstruction* inst) {
+    switch (inst->opcode) {
+        case TAC_ADD: case TAC_SUB: case TAC_MUL: case TAC_DIV: case TAC_MOD:
+        case TAC_ASSIGN: case TAC_LOAD_CONST: case TAC_RELOP: case TAC_ARRAY_LOAD:
+        case TAC_ARRAY_LOAD_OFFSET:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* Helper: Count how many instructions of [start, end) read each variable */
+static NameTable* count_uses(TACCode* code, TACInstruction* start, TACInstruction* end, int** use_counts) {
+    NameTable* names = create_name_table(code->instruction_count);
+    int capacity = 0;
+    *use_counts = NULL;
+
+    for (TACInstruction* inst = start; inst != end; inst = inst->next) {
+        const char* uses[3];
+        int n = tac_uses(inst, uses);
+        for (int u = 0; u < n; u++) {
+            int id = intern_name(names, uses[u]);
+            if (id >= capacity) {
+                int old_capacity = capacity;
+                capacity = names->capacity;
+                *use_counts = (int*)safe_realloc(*use_counts, capacity * sizeof(int), "use counts");
+                memset(*use_counts + old_capacity, 0, (capacity - old_capacity) * sizeof(int));
+            }
+            (*use_counts)[id]++;
+        }
+    }
+
+    return names;
+}
+
+/* Helper: Remove pure definitions of temporaries that are never read.
+ * Temporaries belong to one function, so a scan of the function finds
+ * every use; repeat until nothing more is removed. */
+static int remove_unused_temps(TACCode* code) {
+    int removed = 0;
+    TACInstruction* before = NULL;      /* Last instruction ahead of the function */
+
+    while (before ? before->next : code->head) {
+        TACInstruction* end = function_end(before ? before->next : code->head);
+        TACInstruction* prev = before;
+        int changed = 1;
+
+        while (changed) {
+            TACInstruction* start = before ? before->next : code->head;
+            int* use_counts;
+            NameTable* names = count_uses(code, start, end, &use_counts);
+            TACInstruction* inst = start;
+            prev = before;
+            changed = 0;
+
+            while (inst != end) {
+                TACInstruction* next = inst->next;
+                if (is_pure_definition(inst) && is_temp_name(inst->result) &&
+                    lookup_name_id(names, inst->result) < 0) {
+
+                    if (prev) prev->next = next;
+                    else code->head = next;
+                    if (code->tail == inst) code->tail = prev;
+
+                    printf("[OPTIMIZER] Dead code elimination: Removed unused temporary %s\n",
+                           inst->result);
+                    free_tac_instruction(inst);
+                    code->instruction_count--;
+                    removed++;
+                    changed = 1;
+                } else {
+                    prev = inst;
+                }
+                inst = next;
+            }
+
+            free(use_counts);
+            free_name_table(names);
+        }
+        if (!end) break;
+        before = prev;                  /* Now directly ahead of 'end' */
+    }
+
+    return removed;
+}
+
+/* Helper: Remove pure definitions of temporaries that no path reads
+ * before the temporary is redefined. Unlike remove_unused_temps this
+ * also catches temporaries defined more than once (induction-variable
+ * offsets, inlined return values). */
+static int remove_dead_stores(TACCode* code) {
+    int removed = 0;
+    TACInstruction* start = code->head;
+
+    while (start) {
+        Liveness* live;
+        CFG* cfg = get_function_liveness(start, &live);
+        TACInstruction* end = cfg->end;
+        char* dead = (char*)safe_calloc(cfg->num_insts + 1, sizeof(char), "dead stores");
+        unsigned int* set = (unsigned int*)safe_malloc(live->num_words * sizeof(unsigned int),
+                                                       "dead stores");
+        int found = 0;
+
+        for (int b = 0; b < cfg->num_blocks; b++) {
+            BasicBlock* blk = &cfg->blocks[b];
+            memcpy(set, live_out_set(live, b), live->num_words * sizeof(unsigned int));
+
+            for (int i = blk->start + blk->count - 1; i >= blk->start; i--) {
+                TACInstruction* inst = cfg->insts[i];
+                if (i > 0 && is_pure_definition(inst) && is_temp_name(inst->result) &&
+                    !is_live_in_set(live, set, inst->result)) {
+                    printf("[OPTIMIZER] Dead code elimination: Removed dead store to %s\n",
+                           inst->result);
+                    dead[i] = 1;
+                    found++;
+                    continue;
+                }
+                liveness_transfer(live, set, inst);
+            }
+        }
+
+        if (found > 0) removed += remove_dead_instructions(code, cfg, dead);
+        free(set);
+        free(dead);
+        release_analyses(cfg, NULL, live);
+        if (found > 0) invalidate_function_analyses(start);
+        start = end;
+    }
+
+    return removed;
+}
+
 /* Dead Code Elimination: Remove unreachable or unused code
  * - Remove code after unconditional jumps
- * - Remove unused temporary variables (basic version)
+ * - Remove unused temporary variables
+ * - Remove stores to temporaries that are dead (liveness)
  */
 int eliminate_dead_code(TACCode* code) {
     int optimizations = 0;
@@ -178,6 +300,12 @@ int eliminate_dead_code(TACCode* code) {
         inst = inst->next;
     }
 
+    optimizations += remove_unused_temps(code);
+
+    /* The steps above edit the IR behind the analysis cache */
+    if (optimizations > 0) invalidate_analyses(0);
+    optimizations += remove_dead_stores(code);
+
     return optimizations;
 }
 
@@ -208,6 +336,12 @@ int copy_propagation(TACCode* code) {
                     break;
                 }
 
+                /* Stop at calls: the callee may change a global original,
+                 * or assign a global copy so it no longer holds the original */
+                if (next->opcode == TAC_CALL && (!is_temp_name(original) || !is_temp_name(temp))) {
+                    break;
+                }
+
                 /* Replace uses in op1 */
                 if (next->op1 && strcmp(next->op1, temp) == 0) {
                     free(next->op1);
@@ -249,6 +383,832 @@ int copy_propagation(TACCode* code) {
     return optimizations;
 }
 
+/* Sparse Conditional Constant Propagation: Propagate constants through
+ * assignments, relational operations and branches of each function
+ * Example: x = 5; t0 = x < 10; if_false t0 goto L1; becomes x = 5; t0 = 1;
+ *
+ * Every variable has a lattice value at each block entry: UNDEFINED (no
+ * definition seen yet), CONSTANT, or VARYING. A block is only analyzed
+ * once an executable edge reaches it, and a branch on a constant only
+ * makes one of its edges executable, so code guarded by a constant
+ * condition never pollutes the facts of the code that follows it.
+ */
+
+#define LATTICE_UNDEFINED 0
+#define LATTICE_CONSTANT  1
+#define LATTICE_VARYING   2
+
+/* Lattice value of one variable */
+typedef struct {
+    int state;               /* UNDEFINED, CONSTANT or VARYING */
+    int value;               /* Value when CONSTANT */
+} LatticeValue;
+
+/* Per-function constant propagation state */
+typedef struct {
+    CFG* cfg;
+    NameTable* names;
+    LatticeValue** out;      /* Per block: values at block exit (NULL until visited) */
+    char* executable;        /* Per block: reached by an executable edge? */
+    char* edge_executable;   /* Per block and successor index: edge is executable? */
+    char* is_temp;           /* Per name: compiler temporary? */
+} SCCPState;
+
+/* Helper function: Evaluate relational operation on two constants */
+static int evaluate_relop(const char* op, int left, int right) {
+    if (strcmp(op, "<") == 0) return left < right;
+    if (strcmp(op, ">") == 0) return left > right;
+    if (strcmp(op, "<=") == 0) return left <= right;
+    if (strcmp(op, ">=") == 0) return left >= right;
+    if (strcmp(op, "==") == 0) return left == right;
+    return left != right;
+}
+
+/* Helper: Lattice value of an operand (literal or variable) */
+static LatticeValue sccp_operand(SCCPState* st, LatticeValue* values, const char* operand) {
+    LatticeValue v;
+    if (is_number(operand)) {
+        v.state = LATTICE_CONSTANT;
+        v.value = atoi(operand);
+        return v;
+    }
+    return values[lookup_name_id(st->names, operand)];
+}
+
+/* Helper: Apply one instruction to the lattice values */
+static void sccp_transfer(SCCPState* st, LatticeValue* values, TACInstruction* inst) {
+    LatticeValue result = { LATTICE_VARYING, 0 };
+
+    switch (inst->opcode) {
+        case TAC_LOAD_CONST:
+        case TAC_ASSIGN:
+            result = sccp_operand(st, values, inst->op1);
+            break;
+
+        case TAC_ADD:
+        case TAC_SUB:
+        case TAC_MUL:
+        case TAC_DIV:
+        case TAC_MOD:
+        case TAC_RELOP: {
+            LatticeValue left = sccp_operand(st, values, inst->op1);
+            LatticeValue right = sccp_operand(st, values, inst->op2);
+
+            if (left.state == LATTICE_VARYING || right.state == LATTICE_VARYING) {
+                result.state = LATTICE_VARYING;
+            } else if (left.state == LATTICE_UNDEFINED || right.state == LATTICE_UNDEFINED) {
+                result.state = LATTICE_UNDEFINED;
+            } else if (inst->opcode == TAC_RELOP) {
+                result.state = LATTICE_CONSTANT;
+                result.value = evaluate_relop(inst->label, left.value, right.value);
+            } else if ((inst->opcode == TAC_DIV || inst->opcode == TAC_MOD) && right.value == 0) {
+                result.state = LATTICE_VARYING;   /* Leave the runtime behavior alone */
+            } else {
+                result.state = LATTICE_CONSTANT;
+                result.value = evaluate_binary_op(opcode_to_string(inst->opcode),
+                                                  left.value, right.value);
+            }
+            break;
+        }
+
+        case TAC_CALL:
+            /* The callee may write any global variable */
+            for (int id = 0; id < st->names->count; id++) {
+                if (!st->is_temp[id]) values[id].state = LATTICE_VARYING;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    const char* def = tac_def(inst);
+    if (def) values[lookup_name_id(st->names, def)] = result;
+}
+
+/* Helper: Compute the lattice values at the entry of a block */
+static void sccp_block_entry(SCCPState* st, int b, LatticeValue* values) {
+    CFG* cfg = st->cfg;
+    int num_names = st->names->count;
+
+    if (b == cfg->rpo_order[0]) {
+        /* Globals and parameters come from outside; temporaries are undefined */
+        for (int id = 0; id < num_names; id++) {
+            values[id].state = st->is_temp[id] ? LATTICE_UNDEFINED : LATTICE_VARYING;
+            values[id].value = 0;
+        }
+        return;
+    }
+
+    for (int id = 0; id < num_names; id++) {
+        values[id].state = LATTICE_UNDEFINED;
+        values[id].value = 0;
+    }
+
+    BasicBlock* blk = &cfg->blocks[b];
+    for (int p = 0; p < blk->num_preds; p++) {
+        int pred = blk->preds[p];
+        BasicBlock* pblk = &cfg->blocks[pred];
+        int live_edge = 0;
+        for (int k = 0; k < pblk->num_succs; k++) {
+            if (pblk->succs[k] == b && st->edge_executable[pred * 2 + k]) live_edge = 1;
+        }
+        if (!live_edge || !st->out[pred]) continue;
+
+        /* Meet: equal constants stay constant, anything else varies */
+        for (int id = 0; id < num_names; id++) {
+            LatticeValue in = st->out[pred][id];
+            if (in.state == LATTICE_UNDEFINED || values[id].state == LATTICE_VARYING) continue;
+            if (values[id].state == LATTICE_UNDEFINED) {
+                values[id] = in;
+            } else if (in.state == LATTICE_VARYING || in.value != values[id].value) {
+                values[id].state = LATTICE_VARYING;
+            }
+        }
+    }
+}
+
+/* Helper: Mark the edge from b to target executable; returns 1 if new */
+static int sccp_mark_edge(SCCPState* st, int b, int target) {
+    BasicBlock* blk = &st->cfg->blocks[b];
+    int changed = 0;
+    for (int k = 0; k < blk->num_succs; k++) {
+        if (blk->succs[k] == target && !st->edge_executable[b * 2 + k]) {
+            st->edge_executable[b * 2 + k] = 1;
+            st->executable[target] = 1;
+            changed = 1;
+        }
+    }
+    return changed;
+}
+
+/* Helper: Mark the outgoing edges of b that its final branch can take */
+static int sccp_mark_successors(SCCPState* st, int b, LatticeValue* values) {
+    CFG* cfg = st->cfg;
+    BasicBlock* blk = &cfg->blocks[b];
+    TACInstruction* last = block_last(cfg, b);
+    int changed = 0;
+
+    if (last->opcode == TAC_IF_FALSE) {
+        LatticeValue cond = sccp_operand(st, values, last->op1);
+        if (cond.state == LATTICE_UNDEFINED) return 0;
+        if (cond.state == LATTICE_CONSTANT) {
+            int target = cond.value == 0 ? find_label_block(cfg, last->label) : b + 1;
+            return sccp_mark_edge(st, b, target);
+        }
+    }
+
+    for (int k = 0; k < blk->num_succs; k++) {
+        changed |= sccp_mark_edge(st, b, blk->succs[k]);
+    }
+    return changed;
+}
+
+/* Helper: Replace a computed constant with a constant load */
+static void sccp_make_constant(TACInstruction* inst, int value) {
+    char value_str[32];
+    snprintf(value_str, sizeof(value_str), "%d", value);
+
+    free(inst->op1);
+    free(inst->op2);
+    free(inst->label);
+    inst->opcode = TAC_LOAD_CONST;
+    inst->op1 = strdup(value_str);
+    inst->op2 = NULL;
+    inst->label = NULL;
+}
+
+/* Helper: Run constant propagation over one function */
+static int sccp_function(TACCode* code, CFG* cfg) {
+    if (cfg->num_reachable == 0) return 0;
+
+    SCCPState st;
+    st.cfg = cfg;
+    st.names = create_name_table(cfg->num_insts * 2);
+    intern_cfg_names(st.names, cfg);
+
+    int num_names = st.names->count;
+    st.out = (LatticeValue**)safe_calloc(cfg->num_blocks, sizeof(LatticeValue*), "SCCP");
+    st.executable = (char*)safe_calloc(cfg->num_blocks, 1, "SCCP");
+    st.edge_executable = (char*)safe_calloc(cfg->num_blocks * 2, 1, "SCCP");
+    st.is_temp = (char*)safe_calloc(num_names + 1, 1, "SCCP");
+    for (int id = 0; id < num_names; id++) st.is_temp[id] = is_temp_name(st.names->names[id]);
+
+    LatticeValue* values = (LatticeValue*)safe_malloc((num_names + 1) * sizeof(LatticeValue), "SCCP");
+    st.executable[cfg->rpo_order[0]] = 1;
+
+    /* Iterate in reverse postorder until no lattice value or edge changes */
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int i = 0; i < cfg->num_reachable; i++) {
+            int b = cfg->rpo_order[i];
+            if (!st.executable[b]) continue;
+
+            sccp_block_entry(&st, b, values);
+            BasicBlock* blk = &cfg->blocks[b];
+            for (int j = blk->start; j < blk->start + blk->count; j++) {
+                sccp_transfer(&st, values, cfg->insts[j]);
+            }
+
+            if (!st.out[b]) {
+                st.out[b] = (LatticeValue*)safe_malloc((num_names + 1) * sizeof(LatticeValue), "SCCP");
+                changed = 1;
+            } else if (memcmp(st.out[b], values, num_names * sizeof(LatticeValue)) != 0) {
+                changed = 1;
+            }
+            memcpy(st.out[b], values, num_names * sizeof(LatticeValue));
+
+            changed |= sccp_mark_successors(&st, b, values);
+        }
+    }
+
+    /* Rewrite constant computations and branches; drop unexecutable blocks */
+    int optimizations = 0;
+    char* dead = (char*)safe_calloc(cfg->num_insts + 1, 1, "SCCP");
+
+    for (int b = 0; b < cfg->num_blocks; b++) {
+        BasicBlock* blk = &cfg->blocks[b];
+
+        if (!st.executable[b]) {
+            for (int j = blk->start; j < blk->start + blk->count; j++) dead[j] = 1;
+            if (blk->start > 0) {
+                optimizations++;
+                printf("[OPTIMIZER] SCCP: Removed unreachable block (%d instructions)\n", blk->count);
+            }
+            continue;
+        }
+
+        sccp_block_entry(&st, b, values);
+        for (int j = blk->start; j < blk->start + blk->count; j++) {
+            TACInstruction* inst = cfg->insts[j];
+
+            if (inst->opcode == TAC_IF_FALSE) {
+                LatticeValue cond = sccp_operand(&st, values, inst->op1);
+                if (cond.state != LATTICE_CONSTANT) continue;
+
+                if (cond.value == 0) {
+                    inst->opcode = TAC_GOTO;
+                    free(inst->op1);
+                    inst->op1 = NULL;
+                    printf("[OPTIMIZER] SCCP: Condition is always false, converted branch to goto %s\n",
+                           inst->label);
+                } else {
+                    dead[j] = 1;
+                    printf("[OPTIMIZER] SCCP: Condition is always true, removed branch to %s\n",
+                           inst->label);
+                }
+                optimizations++;
+                continue;
+            }
+
+            sccp_transfer(&st, values, inst);
+
+            const char* def = tac_def(inst);
+            if (!def || inst->opcode == TAC_LOAD_CONST || inst->opcode == TAC_CALL ||
+                inst->opcode == TAC_ARRAY_LOAD || inst->opcode == TAC_ARRAY_LOAD_OFFSET) {
+                continue;
+            }
+
+            LatticeValue v = values[lookup_name_id(st.names, def)];
+            if (v.state == LATTICE_CONSTANT) {
+                printf("[OPTIMIZER] SCCP: %s = %s is always %d\n",
+                       inst->result, opcode_to_string(inst->opcode), v.value);
+                sccp_make_constant(inst, v.value);
+                optimizations++;
+            }
+        }
+    }
+
+    remove_dead_instructions(code, cfg, dead);
+
+    for (int b = 0; b < cfg->num_blocks; b++) free(st.out[b]);
+    free(st.out);
+    free(st.executable);
+    free(st.edge_executable);
+    free(st.is_temp);
+    free(values);
+    free(dead);
+    free_name_table(st.names);
+
+    return optimizations;
+}
+
+/* Sparse Conditional Constant Propagation driver: process each function */
+int sparse_conditional_constant_propagation(TACCode* code) {
+    int optimizations = 0;
+    TACInstruction* start = code->head;
+
+    while (start) {
+        CFG* cfg = get_function_cfg(start);
+        TACInstruction* end = cfg->end;
+        int changed = sccp_function(code, cfg);
+        release_analyses(cfg, NULL, NULL);
+        if (changed > 0) invalidate_function_analyses(start);
+        optimizations += changed;
+        start = end;
+    }
+
+    return optimizations;
+}
+
+/* Value Range Propagation: Replace computations whose value the range
+ * analysis (range.c) proves to be a single constant, and resolve the
+ * branches they decide
+ * Example: for (i = 0; i < 10; i = i + 1) { if (i < 20) ... }
+ *          t5 = i < 20 becomes t5 = 1 inside the loop
+ *
+ * Unlike SCCP, this also decides comparisons and divisions of variables
+ * that are not constants but whose intervals settle the outcome.
+ */
+
+/* Helper: Value of a definition decided by the ranges before it (0 if unknown) */
+static int vrp_decided_value(RangeAnalysis* ranges, int index, TACInstruction* inst, long long* value) {
+    Interval result;
+
+    switch (inst->opcode) {
+        case TAC_ASSIGN:
+            result = range_before(ranges, index, inst->op1);
+            break;
+        case TAC_ADD: case TAC_SUB: case TAC_MUL: case TAC_DIV: case TAC_MOD:
+            result = range_binary(inst->opcode, range_before(ranges, index, inst->op1),
+                                  range_before(ranges, index, inst->op2));
+            break;
+        case TAC_RELOP: {
+            int outcome = range_compare(inst->label, range_before(ranges, index, inst->op1),
+                                        range_before(ranges, index, inst->op2));
+            if (outcome < 0) return 0;
+            *value = outcome;
+            return 1;
+        }
+        default:
+            return 0;
+    }
+
+    return range_is_constant(result, value);
+}
+
+/* Helper: Run value range propagation over one function */
+static int vrp_function(TACCode* code, CFG* cfg, RangeAnalysis* ranges) {
+    int optimizations = 0;
+    char* dead = (char*)safe_calloc(cfg->num_insts + 1, 1, "VRP");
+    char range_str[64];
+    long long value;
+
+    for (int j = 0; j < cfg->num_insts; j++) {
+        TACInstruction* inst = cfg->insts[j];
+        if (!range_reached(ranges, j)) continue;
+
+        if (inst->opcode == TAC_IF_FALSE && inst->op1 && !is_number(inst->op1)) {
+            Interval cond = range_before(ranges, j, inst->op1);
+            int always_zero = cond.lo == 0 && cond.hi == 0;
+            if (!always_zero && range_contains(cond, 0)) continue;
+
+            if (always_zero) {
+                printf("[OPTIMIZER] Value ranges: %s is always 0, converted branch to goto %s\n",
+                       inst->op1, inst->label);
+                inst->opcode = TAC_GOTO;
+                free(inst->op1);
+                inst->op1 = NULL;
+            } else {
+                printf("[OPTIMIZER] Value ranges: %s is %s (never 0), removed branch to %s\n",
+                       inst->op1, range_to_string(cond, range_str, sizeof(range_str)), inst->label);
+                dead[j] = 1;
+            }
+            optimizations++;
+            continue;
+        }
+
+        const char* def = tac_def(inst);
+        if (!def || !vrp_decided_value(ranges, j, inst, &value)) continue;
+        if (inst->opcode == TAC_ASSIGN && is_number(inst->op1)) continue;
+
+        printf("[OPTIMIZER] Value ranges: %s = %s is always %lld\n",
+               inst->result, opcode_to_string(inst->opcode), value);
+        sccp_make_constant(inst, (int)value);
+        optimizations++;
+    }
+
+    remove_dead_instructions(code, cfg, dead);
+    free(dead);
+    return optimizations;
+}
+
+/* Value Range Propagation driver: process each function */
+int value_range_propagation(TACCode* code) {
+    int optimizations = 0;
+    TACInstruction* start = code->head;
+
+    while (start) {
+        RangeAnalysis* ranges;
+        CFG* cfg = get_function_ranges(start, &ranges);
+        TACInstruction* end = cfg->end;
+        int changed = vrp_function(code, cfg, ranges);
+        release_ranges(cfg, ranges);
+        if (changed > 0) invalidate_function_analyses(start);
+        optimizations += changed;
+        start = end;
+    }
+
+    return optimizations;
+}
+
+/* Global Value Numbering: Replace recomputations of an available value
+ * with a copy of the variable that already holds it
+ * Example: t3 = a * b; ... t7 = b * a; becomes t7 = t3;
+ *
+ * Every variable is mapped to a value number (VN). An expression is keyed
+ * by its opcode and operand VNs (commutative operands and mirrored
+ * relational operators are canonicalized), and array loads also include
+ * a VN for the array contents that every store to that array renews.
+ * The name->VN map is scoped along the dominator tree: a block inherits
+ * the map of its immediate dominator, minus every variable that may be
+ * written on some path between the two.
+ */
+
+/* Hashed expression: value = opcode(vn1, vn2) */
+typedef struct {
+    TACOpcode opcode;        /* Operation (LOAD_CONST for literal values) */
+    const char* relop;       /* Relational operator for RELOP */
+    long long constant;      /* Literal value for LOAD_CONST */
+    int vn1, vn2;            /* Operand value numbers */
+    int value;               /* Value number of the result */
+    int holder;              /* Name id that last held the value (-1 if none) */
+    int chain;               /* Next expression in the hash bucket */
+} ValueExpr;
+
+/* Per-function value numbering state */
+typedef struct {
+    CFG* cfg;
+    NameTable* names;
+    ValueExpr* exprs;        /* Expression table (shared by all blocks) */
+    int num_exprs;
+    int expr_capacity;
+    int* buckets;
+    int num_buckets;
+    int next_vn;             /* Next unused value number */
+    char** block_kills;      /* Per block: names written in the block */
+    char* block_calls;       /* Per block: does the block contain a call? */
+    char* is_temp;           /* Per name: compiler temporary? */
+    char* dead;              /* Per instruction: removed by the pass */
+    int replaced;            /* Number of redundant computations removed */
+} GVNState;
+
+/* Helper: Canonicalize a relational operator so that a > b and b < a
+ * share one key. Returns the operator to use and swaps if needed. */
+static const char* canonical_relop(const char* op, int* vn1, int* vn2) {
+    int tmp;
+    if (strcmp(op, ">") == 0 || strcmp(op, ">=") == 0) {
+        tmp = *vn1; *vn1 = *vn2; *vn2 = tmp;
+        return op[1] == '=' ? "<=" : "<";
+    }
+    if ((strcmp(op, "==") == 0 || strcmp(op, "!=") == 0) && *vn1 > *vn2) {
+        tmp = *vn1; *vn1 = *vn2; *vn2 = tmp;
+    }
+    return op;
+}
+
+/* Helper: Hash an expression key */
+static unsigned int gvn_hash(GVNState* st, TACOpcode opcode, const char* relop,
+                             long long constant, int vn1, int vn2) {
+    unsigned long h = (unsigned long)opcode * 31u + (unsigned long)constant;
+    h = h * 31u + (unsigned long)(vn1 + 1);
+    h = h * 31u + (unsigned long)(vn2 + 1);
+    if (relop) h = h * 31u + hash(relop, st->num_buckets);
+    return (unsigned int)(h % (unsigned long)st->num_buckets);
+}
+
+/* Helper: Find an expression, or add it with a fresh value number */
+static ValueExpr* gvn_lookup(GVNState* st, TACOpcode opcode, const char* relop,
+                             long long constant, int vn1, int vn2, int* found) {
+    unsigned int bucket = gvn_hash(st, opcode, relop, constant, vn1, vn2);
+
+    for (int e = st->buckets[bucket]; e >= 0; e = st->exprs[e].chain) {
+        ValueExpr* expr = &st->exprs[e];
+        if (expr->opcode == opcode && expr->constant == constant &&
+            expr->vn1 == vn1 && expr->vn2 == vn2 &&
+            (!relop || strcmp(expr->relop, relop) == 0)) {
+            *found = 1;
+            return expr;
+        }
+    }
+
+    if (st->num_exprs == st->expr_capacity) {
+        st->expr_capacity *= 2;
+        st->exprs = (ValueExpr*)safe_realloc(st->exprs, st->expr_capacity * sizeof(ValueExpr),
+                                             "value numbering");
+    }
+
+    ValueExpr* expr = &st->exprs[st->num_exprs];
+    expr->opcode = opcode;
+    expr->relop = relop;
+    expr->constant = constant;
+    expr->vn1 = vn1;
+    expr->vn2 = vn2;
+    expr->value = st->next_vn++;
+    expr->holder = -1;
+    expr->chain = st->buckets[bucket];
+    st->buckets[bucket] = st->num_exprs++;
+
+    *found = 0;
+    return expr;
+}
+
+/* Helper: Value number of an operand (literal or variable) */
+static int gvn_operand(GVNState* st, int* vn_of, const char* operand) {
+    if (is_number(operand)) {
+        int found;
+        return gvn_lookup(st, TAC_LOAD_CONST, NULL, atoll(operand), -1, -1, &found)->value;
+    }
+    int id = lookup_name_id(st->names, operand);
+    if (vn_of[id] < 0) vn_of[id] = st->next_vn++;   /* Unknown value: give it a name */
+    return vn_of[id];
+}
+
+/* Helper: Find a variable currently holding a value (-1 if none) */
+static int gvn_holder(GVNState* st, int* vn_of, ValueExpr* expr) {
+    if (expr->holder >= 0 && vn_of[expr->holder] == expr->value) return expr->holder;
+
+    /* Prefer temporaries: calls cannot clobber them */
+    int holder = -1;
+    for (int id = 0; id < st->names->count; id++) {
+        if (vn_of[id] == expr->value) {
+            if (st->is_temp[id]) return id;
+            if (holder < 0) holder = id;
+        }
+    }
+    return holder;
+}
+
+/* Helper: Value-number one instruction, rewriting it if it is redundant */
+static void gvn_instruction(GVNState* st, int* vn_of, int index) {
+    TACInstruction* inst = st->cfg->insts[index];
+    int found = 0;
+    ValueExpr* expr = NULL;
+
+    switch (inst->opcode) {
+        case TAC_LOAD_CONST:
+            vn_of[lookup_name_id(st->names, inst->result)] = gvn_operand(st, vn_of, inst->op1);
+            return;
+
+        case TAC_ASSIGN:
+            vn_of[lookup_name_id(st->names, inst->result)] = gvn_operand(st, vn_of, inst->op1);
+            return;
+
+        case TAC_ADD:
+        case TAC_SUB:
+        case TAC_MUL:
+        case TAC_DIV:
+        case TAC_MOD:
+        case TAC_RELOP: {
+            int vn1 = gvn_operand(st, vn_of, inst->op1);
+            int vn2 = gvn_operand(st, vn_of, inst->op2);
+            const char* relop = NULL;
+
+            if (inst->opcode == TAC_RELOP) {
+                relop = canonical_relop(inst->label, &vn1, &vn2);
+            } else if ((inst->opcode == TAC_ADD || inst->opcode == TAC_MUL) && vn1 > vn2) {
+                int tmp = vn1; vn1 = vn2; vn2 = tmp;
+            }
+            expr = gvn_lookup(st, inst->opcode, relop, 0, vn1, vn2, &found);
+            break;
+        }
+
+        case TAC_ARRAY_LOAD:
+        case TAC_ARRAY_LOAD_OFFSET: {
+            int memory = gvn_operand(st, vn_of, inst->op1);
+            int vn_index = gvn_operand(st, vn_of, inst->op2);
+            expr = gvn_lookup(st, inst->opcode, NULL, 0, memory, vn_index, &found);
+            break;
+        }
+
+        case TAC_ARRAY_STORE:
+        case TAC_ARRAY_STORE_OFFSET: {
+            /* The array contents change; the stored value is what a load
+             * of the same element will now produce */
+            int vn_index = gvn_operand(st, vn_of, inst->op1);
+            int vn_value = gvn_operand(st, vn_of, inst->op2);
+            int array = lookup_name_id(st->names, inst->result);
+            vn_of[array] = st->next_vn++;
+
+            TACOpcode load_opcode = inst->opcode == TAC_ARRAY_STORE ?
+                                    TAC_ARRAY_LOAD : TAC_ARRAY_LOAD_OFFSET;
+            ValueExpr* load = gvn_lookup(st, load_opcode, NULL, 0, vn_of[array],
+                                         vn_index, &found);
+            load->value = vn_value;
+            load->holder = is_number(inst->op2) ? -1 : lookup_name_id(st->names, inst->op2);
+            return;
+        }
+
+        case TAC_CALL:
+            /* The callee may write any global variable or array */
+            for (int id = 0; id < st->names->count; id++) {
+                if (!st->is_temp[id]) vn_of[id] = -1;
+            }
+            if (inst->result) {
+                vn_of[lookup_name_id(st->names, inst->result)] = st->next_vn++;
+            }
+            return;
+
+        default:
+            return;
+    }
+
+    int result = lookup_name_id(st->names, inst->result);
+    if (found) {
+        int holder = gvn_holder(st, vn_of, expr);
+        if (holder == result) {
+            /* The variable already holds this value: drop the recomputation */
+            st->dead[index] = 1;
+            st->replaced++;
+            printf("[OPTIMIZER] Value numbering: Removed redundant %s into %s\n",
+                   opcode_to_string(inst->opcode), inst->result);
+            return;
+        }
+        if (holder >= 0) {
+            printf("[OPTIMIZER] Value numbering: %s = %s reuses %s\n",
+                   inst->result, opcode_to_string(inst->opcode), st->names->names[holder]);
+            free(inst->op1);
+            free(inst->op2);
+            free(inst->label);
+            inst->opcode = TAC_ASSIGN;
+            inst->op1 = strdup(st->names->names[holder]);
+            inst->op2 = NULL;
+            inst->label = NULL;
+            st->replaced++;
+        }
+    }
+
+    vn_of[result] = expr->value;
+    if (expr->holder < 0 || vn_of[expr->holder] != expr->value) expr->holder = result;
+}
+
+/* Helper: Mark names that may be written between the end of idom(b) and
+ * the start of b, i.e. in any block that reaches b without passing idom(b) */
+static void gvn_path_kills(GVNState* st, int b, char* killed, int* has_call) {
+    CFG* cfg = st->cfg;
+    int idom = cfg->blocks[b].idom;
+    char* visited = (char*)safe_calloc(cfg->num_blocks, 1, "value numbering");
+    int* worklist = (int*)safe_malloc(cfg->num_blocks * sizeof(int), "value numbering");
+    int count = 0;
+
+    for (int p = 0; p < cfg->blocks[b].num_preds; p++) {
+        int pred = cfg->blocks[b].preds[p];
+        if (pred != idom && !visited[pred]) {
+            visited[pred] = 1;
+            worklist[count++] = pred;
+        }
+    }
+
+    while (count > 0) {
+        int x = worklist[--count];
+        for (int id = 0; id < st->names->count; id++) {
+            if (st->block_kills[x][id]) killed[id] = 1;
+        }
+        if (st->block_calls[x]) *has_call = 1;
+
+        for (int p = 0; p < cfg->blocks[x].num_preds; p++) {
+            int pred = cfg->blocks[x].preds[p];
+            if (pred != idom && !visited[pred]) {
+                visited[pred] = 1;
+                worklist[count++] = pred;
+            }
+        }
+    }
+
+    free(visited);
+    free(worklist);
+}
+
+/* Helper: Value-number a block, then its dominator-tree children */
+static void gvn_visit(GVNState* st, int b, const int* parent_vn_of, int* children, int* first_child) {
+    int num_names = st->names->count;
+    int* vn_of = (int*)safe_malloc((num_names + 1) * sizeof(int), "value numbering");
+
+    if (parent_vn_of) {
+        memcpy(vn_of, parent_vn_of, num_names * sizeof(int));
+
+        char* killed = (char*)safe_calloc(num_names + 1, 1, "value numbering");
+        int has_call = 0;
+        gvn_path_kills(st, b, killed, &has_call);
+        for (int id = 0; id < num_names; id++) {
+            if (killed[id] || (has_call && !st->is_temp[id])) vn_of[id] = -1;
+        }
+        free(killed);
+    } else {
+        for (int id = 0; id < num_names; id++) vn_of[id] = -1;
+    }
+
+    BasicBlock* blk = &st->cfg->blocks[b];
+    for (int i = blk->start; i < blk->start + blk->count; i++) {
+        gvn_instruction(st, vn_of, i);
+    }
+
+    for (int c = first_child[b]; c >= 0; c = children[c]) {
+        gvn_visit(st, c, vn_of, children, first_child);
+    }
+
+    free(vn_of);
+}
+
+/* Helper: Run value numbering over one function */
+static int gvn_function(TACCode* code, CFG* cfg) {
+    if (cfg->num_reachable == 0) return 0;
+
+    GVNState st;
+    memset(&st, 0, sizeof(st));
+    st.cfg = cfg;
+    st.names = create_name_table(cfg->num_insts * 2);
+    intern_cfg_names(st.names, cfg);
+
+    int num_names = st.names->count;
+    st.expr_capacity = cfg->num_insts * 2 + 8;
+    st.exprs = (ValueExpr*)safe_malloc(st.expr_capacity * sizeof(ValueExpr), "value numbering");
+    st.num_buckets = st.expr_capacity + 1;
+    st.buckets = (int*)safe_malloc(st.num_buckets * sizeof(int), "value numbering");
+    for (int i = 0; i < st.num_buckets; i++) st.buckets[i] = -1;
+    st.dead = (char*)safe_calloc(cfg->num_insts + 1, 1, "value numbering");
+    st.is_temp = (char*)safe_calloc(num_names + 1, 1, "value numbering");
+    for (int id = 0; id < num_names; id++) st.is_temp[id] = is_temp_name(st.names->names[id]);
+
+    /* Names written (and calls made) in each block */
+    st.block_kills = (char**)safe_malloc(cfg->num_blocks * sizeof(char*), "value numbering");
+    st.block_calls = (char*)safe_calloc(cfg->num_blocks, 1, "value numbering");
+    for (int b = 0; b < cfg->num_blocks; b++) {
+        st.block_kills[b] = (char*)safe_calloc(num_names + 1, 1, "value numbering");
+        BasicBlock* blk = &cfg->blocks[b];
+        for (int i = blk->start; i < blk->start + blk->count; i++) {
+            TACInstruction* inst = cfg->insts[i];
+            const char* def = tac_def(inst);
+            if (def) st.block_kills[b][lookup_name_id(st.names, def)] = 1;
+            if (inst->opcode == TAC_ARRAY_STORE || inst->opcode == TAC_ARRAY_STORE_OFFSET) {
+                st.block_kills[b][lookup_name_id(st.names, inst->result)] = 1;
+            }
+            if (inst->opcode == TAC_CALL) st.block_calls[b] = 1;
+        }
+    }
+
+    /* Dominator tree as child lists */
+    int* first_child = (int*)safe_malloc(cfg->num_blocks * sizeof(int), "value numbering");
+    int* next_sibling = (int*)safe_malloc(cfg->num_blocks * sizeof(int), "value numbering");
+    for (int b = 0; b < cfg->num_blocks; b++) first_child[b] = -1;
+    for (int i = cfg->num_reachable - 1; i > 0; i--) {
+        int b = cfg->rpo_order[i];
+        int idom = cfg->blocks[b].idom;
+        next_sibling[b] = first_child[idom];
+        first_child[idom] = b;
+    }
+
+    gvn_visit(&st, cfg->rpo_order[0], NULL, next_sibling, first_child);
+    remove_dead_instructions(code, cfg, st.dead);
+
+    for (int b = 0; b < cfg->num_blocks; b++) free(st.block_kills[b]);
+    free(st.block_kills);
+    free(st.block_calls);
+    free(first_child);
+    free(next_sibling);
+    free(st.exprs);
+    free(st.buckets);
+    free(st.dead);
+    free(st.is_temp);
+    free_name_table(st.names);
+
+    return st.replaced;
+}
+
+/* Global Value Numbering driver: process each function separately */
+int global_value_numbering(TACCode* code) {
+    int optimizations = 0;
+    TACInstruction* start = code->head;
+
+    while (start) {
+        CFG* cfg = get_function_dominators(start);
+        TACInstruction* end = cfg->end;
+        int changed = gvn_function(code, cfg);
+        release_analyses(cfg, NULL, NULL);
+        if (changed > 0) invalidate_function_analyses(start);
+        optimizations += changed;
+        start = end;
+    }
+
+    return optimizations;
+}
+
+/* Helper: Count the instructions of the function starting at 'start'
+ * that read a temporary */
+static int count_temp_uses(TACInstruction* start, const char* temp) {
+    int count = 0;
+    TACInstruction* end = function_end(start);
+    for (TACInstruction* inst = start; inst != end; inst = inst->next) {
+        const char* uses[3];
+        int n = tac_uses(inst, uses);
+        for (int u = 0; u < n; u++) {
+            if (strcmp(uses[u], temp) == 0) count++;
+        }
+    }
+    return count;
+}
+
 /* Peephole Optimization: Optimize small instruction sequences
  * - Remove redundant loads
  * - Combine operations
@@ -257,14 +1217,18 @@ int copy_propagation(TACCode* code) {
 int peephole_optimization(TACCode* code) {
     int optimizations = 0;
     TACInstruction* inst = code->head;
+    TACInstruction* function = code->head;      /* First instruction of inst's function */
 
     while (inst && inst->next) {
+        if (inst->opcode == TAC_FUNCTION_LABEL) function = inst;
+
         /* Remove redundant load followed by assignment
          * Pattern: t0 = 5; x = t0; becomes x = 5;
          */
         if (inst->opcode == TAC_LOAD_CONST && inst->next->opcode == TAC_ASSIGN &&
             inst->result && inst->next->op1 &&
-            strcmp(inst->result, inst->next->op1) == 0) {
+            strcmp(inst->result, inst->next->op1) == 0 &&
+            is_temp_name(inst->result) && count_temp_uses(function, inst->result) == 1) {
 
             /* Merge the two instructions */
             TACInstruction* assign = inst->next;
@@ -276,6 +1240,7 @@ int peephole_optimization(TACCode* code) {
 
             /* Remove the first instruction */
             TACInstruction* to_remove = inst;
+            if (function == inst) function = inst->next;
 
             /* Adjust pointers */
             if (code->head == inst) {
@@ -305,23 +1270,96 @@ int peephole_optimization(TACCode* code) {
             continue;
         }
 
-        /* Strength reduction: Division by power of 2 -> shift
-         * Note: We track this as an optimization but don't change the TAC
-         * (the code generator could handle this)
-         */
-        if (inst->opcode == TAC_DIV && inst->op2 && is_number(inst->op2)) {
-            int divisor = atoi(inst->op2);
-            /* Check if divisor is power of 2 */
-            if (divisor > 0 && (divisor & (divisor - 1)) == 0) {
-                /* This is a power of 2 - could be optimized to shift */
-                /* For now, just log it */
-                printf("[OPTIMIZER] Peephole: Division by power of 2 detected (can use shift)\n");
+        inst = inst->next;
+    }
+
+    return optimizations;
+}
+
+/* Strength Reduction: Give multiplications, divisions and modulos by a
+ * constant a literal operand, so the code generators can replace them
+ * with shifts, adds and multiply-high sequences (see strength.c)
+ * Example: t1 = 7; t2 = x / t1; becomes t2 = x / 7;
+ * Trivial cases are simplified here: x / 1 = x, x / -1 = x * -1,
+ * x % 1 = x % -1 = 0.
+ */
+int strength_reduction(TACCode* code) {
+    int optimizations = 0;
+
+    for (TACInstruction* start = code->head; start; start = function_end(start)) {
+        TACInstruction* end = function_end(start);
+
+        /* Temporaries defined once in the function by a constant load hold
+         * that constant */
+        int capacity = 1;
+        for (TACInstruction* inst = start; inst != end; inst = inst->next) capacity++;
+        NameTable* names = create_name_table(capacity);
+        int* def_counts = (int*)safe_calloc(capacity, sizeof(int), "strength reduction");
+        TACInstruction** const_defs = (TACInstruction**)safe_calloc(capacity, sizeof(TACInstruction*),
+                                                                    "strength reduction");
+        for (TACInstruction* inst = start; inst != end; inst = inst->next) {
+            const char* def = tac_def(inst);
+            if (!def || !is_temp_name(def)) continue;
+            int id = intern_name(names, def);
+            def_counts[id]++;
+            if (inst->opcode == TAC_LOAD_CONST) const_defs[id] = inst;
+        }
+
+        for (TACInstruction* inst = start; inst != end; inst = inst->next) {
+            if (inst->opcode != TAC_MUL && inst->opcode != TAC_DIV && inst->opcode != TAC_MOD) continue;
+
+            /* Replace a constant temporary operand by its value (for
+             * multiplication a constant, literal or not, is moved to the right) */
+            for (int side = 2; side >= 1; side--) {
+                char** operand = side == 2 ? &inst->op2 : &inst->op1;
+                if (side == 1 && (inst->opcode != TAC_MUL || is_number(inst->op2))) break;
+                if (is_number(*operand) && side == 2) continue;
+
+                if (!is_number(*operand)) {
+                    int id = lookup_name_id(names, *operand);
+                    if (id < 0 || def_counts[id] != 1 || !const_defs[id]) continue;
+
+                    free(*operand);
+                    *operand = strdup(const_defs[id]->op1);
+                }
+                if (side == 1) {
+                    char* swap = inst->op1;
+                    inst->op1 = inst->op2;
+                    inst->op2 = swap;
+                }
+                optimizations++;
+                printf("[OPTIMIZER] Strength reduction: %s = %s %s %s uses a constant operand\n",
+                       inst->result, inst->op1, opcode_to_string(inst->opcode), inst->op2);
+            }
+
+            if (!is_number(inst->op2) || is_number(inst->op1)) continue;
+            int value = atoi(inst->op2);
+
+            if (inst->opcode == TAC_DIV && value == 1) {
+                free(inst->op2);
+                inst->op2 = NULL;
+                inst->opcode = TAC_ASSIGN;
+                optimizations++;
+                printf("[OPTIMIZER] Strength reduction: x / 1 = x\n");
+            } else if (inst->opcode == TAC_DIV && value == -1) {
+                inst->opcode = TAC_MUL;
+                optimizations++;
+                printf("[OPTIMIZER] Strength reduction: x / -1 = x * -1\n");
+            } else if (inst->opcode == TAC_MOD && (value == 1 || value == -1)) {
+                free(inst->op1);
+                free(inst->op2);
+                inst->op1 = strdup("0");
+                inst->op2 = NULL;
+                inst->opcode = TAC_LOAD_CONST;
+                optimizations++;
+                printf("[OPTIMIZER] Strength reduction: x %% %d = 0\n", value);
             }
         }
 
-        inst = inst->next;
+        free(def_counts);
+        free(const_defs);
+        free_name_table(names);
     }
-
     return optimizations;
 }
 
@@ -410,61 +1448,127 @@ int flow_optimization(TACCode* code) {
     return optimizations;
 }
 
-/* Main optimization driver: Apply all optimizations iteratively */
-TACCode* optimize_tac(TACCode* original_code, OptimizationStats* stats) {
-    printf("\n============ CODE OPTIMIZATION STARTED =============\n\n");
-
-    /* Initialize statistics */
-    stats->constant_folds = 0;
-    stats->dead_code_eliminated = 0;
-    stats->copy_propagations = 0;
-    stats->peephole_opts = 0;
-    stats->total_optimizations = 0;
+/* Tail Recursion Elimination: A function that returns the result of a
+ * call to itself reassigns its parameters and jumps back to its start
+ * Example: param x; t1 = call f, 1; return t1
+ *          becomes t2 = x; n = t2; goto L5   (L5 placed after 'f:')
+ * The arguments go through fresh temporaries first, since an argument
+ * may read a parameter that an earlier reassignment already changed.
+ */
+int eliminate_tail_recursion(TACCode* code) {
+    int optimizations = 0;
+    if (!code->symbols) return 0;
+
+    for (TACInstruction* func = code->head; func; func = func->next) {
+        if (func->opcode != TAC_FUNCTION_LABEL) continue;
+        Symbol* symbol = lookup_symbol(code->symbols, func->label);
+        if (!symbol || symbol->kind != SYMBOL_FUNCTION) continue;
+
+        TACInstruction** params = (TACInstruction**)safe_malloc(
+            (code->instruction_count + 1) * sizeof(TACInstruction*), "tail recursion");
+        int num_params = 0;
+        char* entry = NULL;
+        TACInstruction* prev = func;
+
+        for (TACInstruction* inst = func->next; inst && inst->opcode != TAC_FUNCTION_LABEL;
+             prev = inst, inst = inst->next) {
+            if (inst->opcode == TAC_PARAM) {
+                params[num_params++] = inst;
+                continue;
+            }
+            if (inst->opcode != TAC_CALL) continue;
 
-    /* Apply optimizations multiple times until no more improvements */
-    int iteration = 0;
-    int total_opts = 0;
+            int num_args = atoi(inst->op1);
+            TACInstruction** args = params + (num_params >= num_args ? num_params - num_args : 0);
+            num_params = num_params >= num_args ? num_params - num_args : 0;
 
-    do {
-        total_opts = 0;
-        iteration++;
+            if (strcmp(inst->label, func->label) != 0 || !is_tail_call(inst) ||
+                num_args != symbol->param_count) {
+                continue;
+            }
 
-        printf("[OPTIMIZER] === Optimization Pass %d ===\n", iteration);
+            /* Entry label just after the function label, made once */
+            if (!entry) {
+                entry = new_label();
+                insert_tac_after(code, func, create_tac_instruction(TAC_LABEL, NULL, NULL, NULL, entry));
+                if (prev == func) prev = func->next;
+            }
 
-        /* Constant folding */
-        int cf = constant_folding(original_code);
-        stats->constant_folds += cf;
-        total_opts += cf;
+            /* param a_i becomes s_i = a_i; p_i = s_i goes just before the jump */
+            for (int p = 0; p < num_args; p++) {
+                char* saved = new_temp();
+                args[p]->opcode = TAC_ASSIGN;
+                args[p]->result = strdup(saved);
+
+                TACInstruction* copy = create_tac_instruction(TAC_ASSIGN, symbol->param_names[p],
+                                                              saved, NULL, NULL);
+                insert_tac_after(code, prev, copy);
+                prev = copy;
+                free(saved);
+            }
 
-        /* Copy propagation */
-        int cp = copy_propagation(original_code);
-        stats->copy_propagations += cp;
-        total_opts += cp;
+            /* The call becomes the jump; the return after it is dropped */
+            TACInstruction* ret = inst->next;
+            inst->next = ret->next;
+            if (code->tail == ret) code->tail = inst;
+            free_tac_instruction(ret);
+            code->instruction_count--;
 
-        /* Peephole optimization */
-        int po = peephole_optimization(original_code);
-        stats->peephole_opts += po;
-        total_opts += po;
+            free(inst->result);
+            free(inst->op1);
+            free(inst->label);
+            inst->opcode = TAC_GOTO;
+            inst->result = NULL;
+            inst->op1 = NULL;
+            inst->label = strdup(entry);
+
+            printf("[OPTIMIZER] Tail recursion: Call to %s replaced by a jump to %s\n",
+                   func->label, entry);
+            optimizations++;
+        }
 
-        /* Flow optimization */
-        int fo = flow_optimization(original_code);
-        total_opts += fo;
+        free(params);
+        free(entry);
+    }
 
-        /* Dead code elimination (should be last) */
-        int dce = eliminate_dead_code(original_code);
-        stats->dead_code_eliminated += dce;
-        total_opts += dce;
+    return optimizations;
+}
 
-        printf("[OPTIMIZER] Pass %d: %d optimizations applied\n\n", iteration, total_opts);
+/* Main optimization driver: Run the optimization pipeline */
+TACCode* optimize_tac(TACCode* original_code, OptimizationStats* stats) {
+    printf("\n============ CODE OPTIMIZATION STARTED =============\n\n");
 
-        /* Limit iterations to prevent infinite loops */
-        if (iteration >= 5) break;
+    /* Initialize statistics */
+    stats->constant_folds = 0;
+    stats->dead_code_eliminated = 0;
+    stats->copy_propagations = 0;
+    stats->peephole_opts = 0;
+    stats->constant_propagations = 0;
+    stats->cse_eliminations = 0;
+    stats->licm_hoisted = 0;
+    stats->iv_reductions = 0;
+    stats->loops_unrolled = 0;
+    stats->calls_inlined = 0;
+    stats->tail_calls_eliminated = 0;
+    stats->strength_reductions = 0;
+    stats->range_propagations = 0;
+    stats->total_optimizations = 0;
 
-    } while (total_opts > 0);
+    /* The pass manager runs the selected pipeline (passes.c) */
+    int iteration = run_pass_pipeline(original_code, stats);
 
     stats->total_optimizations = stats->constant_folds +
+                                 stats->constant_propagations +
+                                 stats->range_propagations +
                                  stats->copy_propagations +
+                                 stats->cse_eliminations +
+                                 stats->licm_hoisted +
+                                 stats->iv_reductions +
+                                 stats->loops_unrolled +
+                                 stats->calls_inlined +
+                                 stats->tail_calls_eliminated +
                                  stats->peephole_opts +
+                                 stats->strength_reductions +
                                  stats->dead_code_eliminated;
 
     printf("============ CODE OPTIMIZATION COMPLETE ============\n");
@@ -478,7 +1582,16 @@ TACCode* optimize_tac(TACCode* original_code, OptimizationStats* stats) {
 void print_optimization_stats(OptimizationStats* stats) {
     printf("\n=============== OPTIMIZATION STATISTICS ================\n\n");
     printf("Constant folding:          %d\n", stats->constant_folds);
+    printf("Constant propagation:      %d\n", stats->constant_propagations);
+    printf("Value range folds:         %d\n", stats->range_propagations);
     printf("Copy propagations:         %d\n", stats->copy_propagations);
+    printf("Value numbering (CSE):     %d\n", stats->cse_eliminations);
+    printf("Loop-invariant hoists:     %d\n", stats->licm_hoisted);
+    printf("IV strength reductions:    %d\n", stats->iv_reductions);
+    printf("Loops unrolled:            %d\n", stats->loops_unrolled);
+    printf("Calls inlined:             %d\n", stats->calls_inlined);
+    printf("Tail calls eliminated:     %d\n", stats->tail_calls_eliminated);
+    printf("Strength reductions:       %d\n", stats->strength_reductions);
     printf("Peephole optimizations:    %d\n", stats->peephole_opts);
     printf("Dead code eliminations:    %d\n", stats->dead_code_eliminated);
     printf("----------------------------------------\n");
@@ -5,9 +5,16 @@
  * This file defines the optimization phase which improves the
  * intermediate representation (TAC) through various optimization techniques:
  * - Constant folding
+ * - Sparse conditional constant propagation
+ * - Value range propagation (interval analysis in range.c)
  * - Dead code elimination
  * - Copy propagation
+ * - Global value numbering (common subexpression elimination)
+ * - Loop-invariant code motion, induction-variable strength
+ *   reduction and loop unrolling (loop_opt.c)
+ * - Function inlining (inliner.c) and tail recursion elimination
  * - Peephole optimization
+ * - Strength reduction of multiply/divide/modulo by constants
  */
 
 #ifndef OPTIMIZER_H
@@ -21,38 +28,64 @@
 /* Optimization statistics */
 typedef struct {
     int constant_folds;         /* Number of constant folding optimizations */
+    int constant_propagations;  /* Number of constants propagated and branches resolved */
+    int range_propagations;     /* Number of computations and branches decided by value ranges */
     int dead_code_eliminated;   /* Number of dead code instructions removed */
     int copy_propagations;      /* Number of copy propagations */
     int peephole_opts;          /* Number of peephole optimizations */
+    int cse_eliminations;       /* Number of redundant computations removed */
+    int licm_hoisted;           /* Number of instructions hoisted out of loops */
+    int iv_reductions;          /* Number of array accesses/induction variables reduced */
+    int loops_unrolled;         /* Number of loops fully or partially unrolled */
+    int calls_inlined;          /* Number of call sites replaced by the callee body */
+    int tail_calls_eliminated;  /* Number of self-recursive tail calls turned into jumps */
+    int strength_reductions;    /* Number of constant multiply/divide/modulo operands reduced */
     int total_optimizations;    /* Total optimizations performed */
 } OptimizationStats;
 
 /* OPTIMIZATION FUNCTIONS */
 
-/* Main optimization driver - applies all optimizations */
+/* Main optimization driver - runs the pass manager's pipeline (passes.h) */
 TACCode* optimize_tac(TACCode* original_code, OptimizationStats* stats);
 
 /* Constant folding: evaluate constant expressions at compile time */
 int constant_folding(TACCode* code);
 
+/* Sparse conditional constant propagation: propagate constants across
+ * branches, resolve constant conditions and drop unreachable blocks */
+int sparse_conditional_constant_propagation(TACCode* code);
+
+/* Value range propagation: replace computations and branches that the
+ * interval analysis decides with constants */
+int value_range_propagation(TACCode* code);
+
 /* Dead code elimination: remove unreachable or unused code */
 int eliminate_dead_code(TACCode* code);
 
 /* Copy propagation: replace copies with original values */
 int copy_propagation(TACCode* code);
 
+/* Global value numbering: remove redundant computations along the
+ * dominator tree of each function */
+int global_value_numbering(TACCode* code);
+
+/* Tail recursion elimination: turn self-recursive tail calls into
+ * parameter reassignment and a jump to the function start */
+int eliminate_tail_recursion(TACCode* code);
+
 /* Peephole optimization: improve small sequences of instructions */
 int peephole_optimization(TACCode* code);
 
+/* Strength reduction: give multiply/divide/modulo by a constant a
+ * literal operand for the code generators' shift/magic-number sequences */
+int strength_reduction(TACCode* code);
+
 /* Flow optimization: optimize control flow structures */
 int flow_optimization(TACCode* code);
 
 /* Print optimization statistics */
 void print_optimization_stats(OptimizationStats* stats);
 
-/* Helper function to check if a string is a number */
-int is_number(const char* str);
-
 /* Helper function to evaluate binary operation on constants */
 int evaluate_binary_op(const char* op, int left, int right);
 
@@ -43,6 +43,10 @@ SymbolTable* global_symtab = NULL;
 /* Statistics */
 int syntax_errors = 0;
 
+/* Set while a function body is parsed: its declarations are local to the
+ * function and are added to the symbol table by the semantic analyzer */
+static int in_function_body = 0;
+
 %}
 
 %code requires {
@@ -217,8 +221,8 @@ var_declaration:
         $$ = create_declaration_node($2);
         printf("[PARSER] Declaration: int %s;\n", $2);
 
-        /* Add to symbol table during parsing for early error detection */
-        if (global_symtab && !add_symbol(global_symtab, $2, TYPE_INT, line_num)) {
+        /* Add globals to symbol table during parsing for early error detection */
+        if (global_symtab && !in_function_body && !add_symbol(global_symtab, $2, TYPE_INT, line_num)) {
             fprintf(stderr, "Semantic Error at line %d: Variable '%s' already declared\n",
                     line_num, $2);
         }
@@ -228,8 +232,8 @@ var_declaration:
         $$ = create_array_declaration_node($2, $4);
         printf("[PARSER] Array Declaration: int %s[%d];\n", $2, $4);
 
-        /* Add array to symbol table during parsing for early error detection */
-        if (global_symtab && !add_array_symbol(global_symtab, $2, TYPE_INT, $4, line_num)) {
+        /* Add global arrays to symbol table during parsing for early error detection */
+        if (global_symtab && !in_function_body && !add_array_symbol(global_symtab, $2, TYPE_INT, $4, line_num)) {
             fprintf(stderr, "Semantic Error at line %d: Array '%s' already declared\n",
                     line_num, $2);
         }
@@ -245,11 +249,7 @@ assignment:
     }
     | ID LBRACKET expression RBRACKET ASSIGN expression SEMICOLON
     {
-        ASTNode* array_access = create_array_access_node($1, $3);
-        $$ = create_assignment_node($1, $6);
-        /* Replace the identifier with array access in assignment */
-        free($$->data.assignment.var_name);
-        $$->data.assignment.var_name = strdup($1);
+        $$ = create_array_assignment_node($1, $3, $6);
         printf("[PARSER] Array Assignment: %s[<index>] = <expression>;\n", $1);
     }
     ;
@@ -329,14 +329,16 @@ function_declaration:
 
 /* Function definition: int foo(params) { body } or void foo(params) { body } */
 function_definition:
-    INT ID LPAREN param_list RPAREN LBRACE statement_list RBRACE
+    INT ID LPAREN param_list RPAREN LBRACE { in_function_body = 1; } statement_list RBRACE
     {
-        $$ = create_function_def_node("int", $2, $4, $7);
+        in_function_body = 0;
+        $$ = create_function_def_node("int", $2, $4, $8);
         printf("[PARSER] Function definition: int %s(...) { ... }\n", $2);
     }
-    | VOID ID LPAREN param_list RPAREN LBRACE statement_list RBRACE
+    | VOID ID LPAREN param_list RPAREN LBRACE { in_function_body = 1; } statement_list RBRACE
     {
-        $$ = create_function_def_node("void", $2, $4, $7);
+        in_function_body = 0;
+        $$ = create_function_def_node("void", $2, $4, $8);
         printf("[PARSER] Function definition: void %s(...) { ... }\n", $2);
     }
     ;
@@ -415,7 +417,7 @@ term:
     }
     | term MOD factor
     {
-        $$ = create_binary_op_node("%%", $1, $3);
+        $$ = create_binary_op_node("%", $1, $3);
         printf("[PARSER] Binary operation: <term> %% <factor>\n");
     }
     | factor
@@ -0,0 +1,370 @@
+/*
+ * PASSES.C - Optimization Pass Manager Implementation
+ * CST-405 Compiler Project
+ *
+ * This file implements the pass registry, the pipeline parser, the
+ * optimization levels and the driver that runs a pipeline with the
+ * analysis cache enabled, iterating fixpoint groups until they settle.
+ */
+
+#include <stddef.h>
+#include <time.h>
+#include "passes.h"
+#include "cfg.h"
+#include "loop_opt.h"
+#include "inliner.h"
+#include "diagnostics.h"
+
+/* A pass takes the whole program and returns the number of changes it made */
+typedef int (*PassFunction)(TACCode* code);
+
+/* Registered pass */
+typedef struct {
+    const char* name;        /* Name used in pipelines */
+    const char* description; /* Shown by print_available_passes */
+    PassFunction run;        /* Pass entry point */
+    int stat_offset;         /* Counter in OptimizationStats (-1 if none) */
+    int preserves;           /* Analyses (ANALYSIS_*) still valid after it changes the IR */
+} PassInfo;
+
+/* Passes that only rewrite operands in place keep the CFG */
+static const PassInfo pass_table[] = {
+    { "inline",   "Function inlining",
+      inline_functions, offsetof(OptimizationStats, calls_inlined), 0 },
+    { "tailrec",  "Tail recursion elimination",
+      eliminate_tail_recursion, offsetof(OptimizationStats, tail_calls_eliminated), 0 },
+    { "fold",     "Constant folding and algebraic simplification",
+      constant_folding, offsetof(OptimizationStats, constant_folds), ANALYSIS_CFG },
+    { "sccp",     "Sparse conditional constant propagation",
+      sparse_conditional_constant_propagation, offsetof(OptimizationStats, constant_propagations), 0 },
+    { "vrp",      "Value range propagation",
+      value_range_propagation, offsetof(OptimizationStats, range_propagations), 0 },
+    { "gvn",      "Global value numbering",
+      global_value_numbering, offsetof(OptimizationStats, cse_eliminations), 0 },
+    { "licm",     "Loop-invariant code motion",
+      loop_invariant_code_motion, offsetof(OptimizationStats, licm_hoisted), 0 },
+    { "unroll",   "Loop unrolling",
+      unroll_loops, offsetof(OptimizationStats, loops_unrolled), 0 },
+    { "ivsr",     "Induction-variable strength reduction",
+      strength_reduce_induction_variables, offsetof(OptimizationStats, iv_reductions), 0 },
+    { "copyprop", "Copy propagation",
+      copy_propagation, offsetof(OptimizationStats, copy_propagations), ANALYSIS_CFG },
+    { "peephole", "Peephole optimization",
+      peephole_optimization, offsetof(OptimizationStats, peephole_opts), 0 },
+    { "strength", "Strength reduction of constant multiply/divide/modulo",
+      strength_reduction, offsetof(OptimizationStats, strength_reductions), ANALYSIS_CFG },
+    { "flow",     "Control flow cleanup",
+      flow_optimization, -1, 0 },
+    { "dce",      "Dead code elimination",
+      eliminate_dead_code, offsetof(OptimizationStats, dead_code_eliminated), 0 }
+};
+
+#define NUM_PASSES ((int)(sizeof(pass_table) / sizeof(pass_table[0])))
+#define MAX_PIPELINE 64
+#define MAX_PIPELINE_TEXT 512
+#define MAX_FIXPOINT_ROUNDS 10
+
+/* Pipeline of each optimization level */
+static const char* level_pipelines[] = {
+    "",
+    "fixpoint(fold,sccp,copyprop,peephole,strength,flow,dce)",
+    "inline,tailrec,fixpoint(fold,sccp,vrp,gvn,licm,unroll,fold,sccp,ivsr,copyprop,peephole,strength,flow,dce)",
+    "inline,tailrec,fixpoint(fold,sccp,vrp,gvn,licm,unroll,fold,sccp,ivsr,copyprop,peephole,strength,flow,dce)",
+    "inline,tailrec,fixpoint(fold,sccp,vrp,gvn,licm,copyprop,peephole,strength,flow,dce)"
+};
+
+/* One step of the pipeline */
+typedef struct {
+    int pass;                /* Index into pass_table */
+    int group;               /* Fixpoint group (-1 if the pass runs once) */
+} PipelineEntry;
+
+static PipelineEntry pipeline[MAX_PIPELINE];
+static int pipeline_length = 0;
+static char pipeline_text[MAX_PIPELINE_TEXT];
+static int pipeline_set = 0;
+static OptLevel opt_level = OPT_LEVEL_O2;
+
+/* Results of the last run, per pass */
+typedef struct {
+    int runs;                /* Times the pass ran */
+    int skipped;             /* Times it was skipped (nothing changed since it last found nothing) */
+    int changes;             /* Changes it reported */
+    double seconds;          /* Time spent in the pass */
+} PassReport;
+
+static PassReport pass_reports[NUM_PASSES];
+static int report_rounds = 0;
+static int report_cache_hits = 0;
+static int report_cache_misses = 0;
+static int report_valid = 0;
+
+/* Helper: Find a pass by name (-1 if unknown) */
+static int find_pass(const char* name) {
+    for (int p = 0; p < NUM_PASSES; p++) {
+        if (strcmp(pass_table[p].name, name) == 0) return p;
+    }
+    return -1;
+}
+
+/* Helper: Make sure a pipeline is selected (the default level's) */
+static void ensure_pipeline(void) {
+    if (!pipeline_set) set_pass_pipeline(level_pipelines[opt_level]);
+}
+
+/* Parse "-O0", "-O1", "-O2", "-O3" or "-Os" */
+int parse_optimization_level(const char* flag, OptLevel* level) {
+    if (strcmp(flag, "-O0") == 0) *level = OPT_LEVEL_O0;
+    else if (strcmp(flag, "-O1") == 0) *level = OPT_LEVEL_O1;
+    else if (strcmp(flag, "-O2") == 0) *level = OPT_LEVEL_O2;
+    else if (strcmp(flag, "-O3") == 0) *level = OPT_LEVEL_O3;
+    else if (strcmp(flag, "-Os") == 0) *level = OPT_LEVEL_OS;
+    else return 0;
+    return 1;
+}
+
+/* Select the pipeline and the inlining/unrolling limits of a level */
+void set_optimization_level(OptLevel level) {
+    InlineOptions inlining = { 24, 24, 24, 400 };
+    UnrollOptions unroll = { 4, 16, 64, 256 };
+
+    if (level == OPT_LEVEL_O3) {
+        InlineOptions aggressive_inlining = { 48, 48, 48, 1600 };
+        UnrollOptions aggressive_unroll = { 8, 32, 128, 1024 };
+        inlining = aggressive_inlining;
+        unroll = aggressive_unroll;
+    } else if (level == OPT_LEVEL_OS) {
+        /* Only callees about the size of their call sequence */
+        InlineOptions small_inlining = { 8, 0, 0, 32 };
+        inlining = small_inlining;
+        unroll.factor = 0;
+    }
+
+    opt_level = level;
+    set_inline_options(&inlining);
+    set_unroll_options(&unroll);
+    set_pass_pipeline(level_pipelines[level]);
+}
+
+OptLevel get_optimization_level(void) {
+    return opt_level;
+}
+
+/* Parse a pipeline string into pipeline entries */
+int set_pass_pipeline(const char* text) {
+    PipelineEntry entries[MAX_PIPELINE];
+    int count = 0;
+    int group = -1;
+    int num_groups = 0;
+    const char* p = text;
+
+    if (strlen(text) >= MAX_PIPELINE_TEXT) {
+        fprintf(stderr, "Error: Pass pipeline is too long\n");
+        return 0;
+    }
+
+    while (*p) {
+        if (*p == ',' || *p == ' ') {
+            p++;
+            continue;
+        }
+        if (*p == ')') {
+            if (group < 0) {
+                fprintf(stderr, "Error: Unbalanced ')' in pass pipeline '%s'\n", text);
+                return 0;
+            }
+            group = -1;
+            p++;
+            continue;
+        }
+
+        char name[32];
+        int len = 0;
+        while (*p && *p != ',' && *p != '(' && *p != ')' && *p != ' ') {
+            if (len < (int)sizeof(name) - 1) name[len++] = *p;
+            p++;
+        }
+        name[len] = '\0';
+
+        if (*p == '(') {
+            if (strcmp(name, "fixpoint") != 0 || group >= 0) {
+                fprintf(stderr, "Error: Expected 'fixpoint(' at the top level of pass pipeline '%s'\n",
+                        text);
+                return 0;
+            }
+            group = num_groups++;
+            p++;
+            continue;
+        }
+
+        int pass = find_pass(name);
+        if (pass < 0) {
+            fprintf(stderr, "Error: Unknown optimization pass '%s'\n", name);
+            print_available_passes(stderr);
+            return 0;
+        }
+        if (count == MAX_PIPELINE) {
+            fprintf(stderr, "Error: Pass pipeline has more than %d passes\n", MAX_PIPELINE);
+            return 0;
+        }
+        entries[count].pass = pass;
+        entries[count].group = group;
+        count++;
+    }
+
+    if (group >= 0) {
+        fprintf(stderr, "Error: Missing ')' in pass pipeline '%s'\n", text);
+        return 0;
+    }
+
+    memcpy(pipeline, entries, count * sizeof(PipelineEntry));
+    pipeline_length = count;
+    strcpy(pipeline_text, text);
+    pipeline_set = 1;
+    return 1;
+}
+
+/* Current pipeline string */
+const char* get_pass_pipeline(void) {
+    ensure_pipeline();
+    return pipeline_text;
+}
+
+/* Helper: Run one pass, record it, and invalidate what it changed.
+ * A pass that moved or inserted instructions without reporting it
+ * (LICM inserting preheaders) still counts as having changed the IR. */
+static int run_pass(TACCode* code, OptimizationStats* stats, int pass, int* modified) {
+    const PassInfo* info = &pass_table[pass];
+    int count_before = code->instruction_count;
+
+    clock_t begin = clock();
+    int changes = info->run(code);
+    pass_reports[pass].seconds += (double)(clock() - begin) / CLOCKS_PER_SEC;
+    pass_reports[pass].runs++;
+    pass_reports[pass].changes += changes;
+
+    if (info->stat_offset >= 0) {
+        *(int*)((char*)stats + info->stat_offset) += changes;
+    }
+
+    int resized = code->instruction_count != count_before;
+    *modified = changes > 0 || resized;
+    if (*modified) invalidate_analyses(resized ? 0 : info->preserves);
+
+    debug_print("Pass manager: %s made %d changes", info->name, changes);
+    return changes;
+}
+
+/* Run the pipeline over the code */
+int run_pass_pipeline(TACCode* code, OptimizationStats* stats) {
+    ensure_pipeline();
+    memset(pass_reports, 0, sizeof(pass_reports));
+    enable_analysis_cache(1);
+
+    /* The IR version counts the passes that changed the IR. A pass in a
+     * fixpoint group that found nothing at some version is skipped until
+     * the version moves on, since it would find nothing again. */
+    int ir_version = 0;
+    int clean_version[NUM_PASSES];
+    for (int p = 0; p < NUM_PASSES; p++) clean_version[p] = -1;
+
+    int rounds = 0;
+    int i = 0;
+
+    while (i < pipeline_length) {
+        int modified;
+
+        if (pipeline[i].group < 0) {
+            int pass = pipeline[i].pass;
+            run_pass(code, stats, pass, &modified);
+            if (modified) ir_version++;
+            clean_version[pass] = modified ? -1 : ir_version;
+            i++;
+            continue;
+        }
+
+        int first = i;
+        int last = i;
+        while (last < pipeline_length && pipeline[last].group == pipeline[first].group) last++;
+
+        int group_rounds = 0;
+        int round_changes;
+        int round_modified;
+
+        do {
+            round_changes = 0;
+            round_modified = 0;
+            group_rounds++;
+            rounds++;
+
+            printf("[OPTIMIZER] === Optimization Pass %d ===\n", rounds);
+
+            for (int k = first; k < last; k++) {
+                int pass = pipeline[k].pass;
+                if (clean_version[pass] == ir_version) {
+                    pass_reports[pass].skipped++;
+                    continue;
+                }
+
+                round_changes += run_pass(code, stats, pass, &modified);
+                if (modified) {
+                    ir_version++;
+                    round_modified = 1;
+                    clean_version[pass] = -1;
+                } else {
+                    clean_version[pass] = ir_version;
+                }
+            }
+
+            printf("[OPTIMIZER] Pass %d: %d optimizations applied\n\n", rounds, round_changes);
+
+            if (group_rounds >= MAX_FIXPOINT_ROUNDS && round_modified) {
+                printf("[OPTIMIZER] Stopping after %d passes without reaching a fixed point\n\n",
+                       group_rounds);
+                break;
+            }
+        } while (round_modified);
+
+        i = last;
+    }
+
+    get_analysis_cache_counts(&report_cache_hits, &report_cache_misses);
+    enable_analysis_cache(0);
+
+    report_rounds = rounds;
+    report_valid = 1;
+    return rounds;
+}
+
+/* Print the per-pass report of the last run */
+void print_pass_report(void) {
+    if (!report_valid) return;
+
+    printf("================= PASS MANAGER REPORT ==================\n\n");
+    printf("Pipeline: %s\n\n", pipeline_text);
+    printf("%-10s %6s %8s %8s %11s\n", "Pass", "Runs", "Skipped", "Changes", "Time (ms)");
+    printf("----------------------------------------------\n");
+
+    double total = 0.0;
+    for (int p = 0; p < NUM_PASSES; p++) {
+        PassReport* report = &pass_reports[p];
+        if (report->runs == 0 && report->skipped == 0) continue;
+        printf("%-10s %6d %8d %8d %11.3f\n", pass_table[p].name, report->runs,
+               report->skipped, report->changes, report->seconds * 1000.0);
+        total += report->seconds;
+    }
+
+    printf("----------------------------------------------\n");
+    printf("Fixpoint rounds:           %d\n", report_rounds);
+    printf("Analysis cache:            %d hits, %d misses\n", report_cache_hits, report_cache_misses);
+    printf("Total pass time:           %.3f ms\n", total * 1000.0);
+    printf("\n========================================================\n\n");
+}
+
+/* Print the pass names accepted in a pipeline */
+void print_available_passes(FILE* out) {
+    fprintf(out, "Available passes (group repeated passes with fixpoint(...)):\n");
+    for (int p = 0; p < NUM_PASSES; p++) {
+        fprintf(out, "  %-10s %s\n", pass_table[p].name, pass_table[p].description);
+    }
+}
@@ -0,0 +1,65 @@
+/*
+ * PASSES.H - Optimization Pass Manager Header
+ * CST-405 Compiler Project
+ *
+ * This file defines the pass manager that runs the optimization passes
+ * over the Three-Address Code. A pipeline is a comma-separated list of
+ * pass names; the passes inside fixpoint(...) are repeated until a whole
+ * round changes nothing:
+ *
+ *   inline,tailrec,fixpoint(fold,sccp,vrp,gvn,licm,unroll,fold,sccp,
+ *                           ivsr,copyprop,peephole,strength,flow,dce)
+ *
+ * Each optimization level (-O0 .. -O3, -Os) selects a pipeline and the
+ * inlining/unrolling limits. The manager keeps the CFG, dominators,
+ * loops and liveness of each function in the analysis cache (cfg.h) and
+ * drops them when a pass changes the IR, skips a pass inside a fixpoint
+ * group when nothing changed since it last found nothing to do, and
+ * records the runs, changes and time of every pass.
+ */
+
+#ifndef PASSES_H
+#define PASSES_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ircode.h"
+#include "optimizer.h"
+
+/* Optimization levels */
+typedef enum {
+    OPT_LEVEL_O0,            /* No optimization */
+    OPT_LEVEL_O1,            /* Local scalar cleanups only */
+    OPT_LEVEL_O2,            /* All passes with the default limits (default) */
+    OPT_LEVEL_O3,            /* All passes with larger inlining/unrolling limits */
+    OPT_LEVEL_OS             /* Optimize for size: no unrolling, little inlining */
+} OptLevel;
+
+/* PASS MANAGER FUNCTIONS */
+
+/* Parse "-O0", "-O1", "-O2", "-O3" or "-Os". Returns 1 on success. */
+int parse_optimization_level(const char* flag, OptLevel* level);
+
+/* Select the pipeline and the inlining/unrolling limits of a level */
+void set_optimization_level(OptLevel level);
+OptLevel get_optimization_level(void);
+
+/* Replace the pipeline. Returns 0 (and keeps the old pipeline) if the
+ * string names an unknown pass or has unbalanced parentheses. */
+int set_pass_pipeline(const char* pipeline);
+
+/* Current pipeline string ("" at -O0) */
+const char* get_pass_pipeline(void);
+
+/* Run the pipeline over the code, adding the changes of every pass to
+ * 'stats'. Returns the number of fixpoint rounds run. */
+int run_pass_pipeline(TACCode* code, OptimizationStats* stats);
+
+/* Print the runs, skips, changes and time of every pass of the last run */
+void print_pass_report(void);
+
+/* Print the pass names accepted in a pipeline */
+void print_available_passes(FILE* out);
+
+#endif /* PASSES_H */
@@ -0,0 +1,522 @@
+/*
+ * RANGE.C - Value Range Analysis Implementation
+ * CST-405 Compiler Project
+ *
+ * This file implements the interval analysis: interval arithmetic,
+ * branch refinement, the widening fixpoint over the CFG, the narrowing
+ * rounds, and the queries that replay a block up to an instruction.
+ *
+ * Every finite bound lies inside the int range. An operation that may
+ * leave it gives the unknown interval, which is sound both where values
+ * wrap (MIPS) and where they keep growing in 64 bits (x86-64).
+ */
+
+#include "range.h"
+#include "diagnostics.h"
+
+#define WIDEN_AFTER 2           /* Changes of a loop header before its bounds are widened */
+#define NARROWING_ROUNDS 2      /* Rounds recomputing block entries after the fixpoint */
+#define MAX_RANGE_ROUNDS 100    /* Give up (everything unknown) after this many rounds */
+
+/* Interval helpers */
+Interval range_full(void) {
+    Interval range = { RANGE_MIN, RANGE_MAX };
+    return range;
+}
+
+/* Helper: Build an interval, unknown if a finite bound leaves the int range */
+static Interval make_range(long long lo, long long hi) {
+    if ((lo != RANGE_MIN && (lo < INT_MIN || lo > INT_MAX)) ||
+        (hi != RANGE_MAX && (hi < INT_MIN || hi > INT_MAX))) {
+        return range_full();
+    }
+    Interval range = { lo, hi };
+    return range;
+}
+
+int range_is_constant(Interval range, long long* value) {
+    if (range.lo != range.hi || range.lo == RANGE_MIN || range.hi == RANGE_MAX) return 0;
+    if (value) *value = range.lo;
+    return 1;
+}
+
+int range_contains(Interval range, long long value) {
+    return range.lo <= value && value <= range.hi;
+}
+
+int range_is_bounded(Interval range) {
+    return range.lo != RANGE_MIN && range.hi != RANGE_MAX;
+}
+
+/* Format an interval as "[lo..hi]" */
+const char* range_to_string(Interval range, char* buffer, int size) {
+    char lo[24], hi[24];
+    long long value;
+
+    if (range_is_constant(range, &value)) {
+        snprintf(buffer, size, "%lld", value);
+        return buffer;
+    }
+    if (range.lo == RANGE_MIN) snprintf(lo, sizeof(lo), "-inf");
+    else snprintf(lo, sizeof(lo), "%lld", range.lo);
+    if (range.hi == RANGE_MAX) snprintf(hi, sizeof(hi), "+inf");
+    else snprintf(hi, sizeof(hi), "%lld", range.hi);
+    snprintf(buffer, size, "[%s..%s]", lo, hi);
+    return buffer;
+}
+
+/* Helper: Smallest and largest of four corner values */
+static Interval corners(long long a, long long b, long long c, long long d) {
+    long long lo = a, hi = a;
+    long long values[3] = { b, c, d };
+    for (int i = 0; i < 3; i++) {
+        if (values[i] < lo) lo = values[i];
+        if (values[i] > hi) hi = values[i];
+    }
+    return make_range(lo, hi);
+}
+
+/* Interval of 'a op b' */
+Interval range_binary(TACOpcode opcode, Interval a, Interval b) {
+    switch (opcode) {
+        case TAC_ADD:
+        case TAC_SUB: {
+            if (opcode == TAC_SUB) {
+                /* a - b = a + (-b) */
+                Interval negated = { b.hi == RANGE_MAX ? RANGE_MIN : -b.hi,
+                                     b.lo == RANGE_MIN ? RANGE_MAX : -b.lo };
+                b = negated;
+            }
+            long long lo = (a.lo == RANGE_MIN || b.lo == RANGE_MIN) ? RANGE_MIN : a.lo + b.lo;
+            long long hi = (a.hi == RANGE_MAX || b.hi == RANGE_MAX) ? RANGE_MAX : a.hi + b.hi;
+            return make_range(lo, hi);
+        }
+
+        case TAC_MUL: {
+            long long value;
+            if ((range_is_constant(a, &value) && value == 0) ||
+                (range_is_constant(b, &value) && value == 0)) {
+                return make_range(0, 0);
+            }
+            if (!range_is_bounded(a) || !range_is_bounded(b)) return range_full();
+            return corners(a.lo * b.lo, a.lo * b.hi, a.hi * b.lo, a.hi * b.hi);
+        }
+
+        case TAC_DIV:
+            /* Division truncates, so the extremes are at the corners */
+            if (range_contains(b, 0) || !range_is_bounded(a) || !range_is_bounded(b)) {
+                return range_full();
+            }
+            return corners(a.lo / b.lo, a.lo / b.hi, a.hi / b.lo, a.hi / b.hi);
+
+        case TAC_MOD: {
+            /* The remainder has the sign of the dividend, |r| <= |a| and |r| < |b| */
+            if (range_contains(b, 0)) return range_full();
+            long long lo = a.lo >= 0 ? 0 : a.lo;
+            long long hi = a.hi <= 0 ? 0 : a.hi;
+            if (range_is_bounded(b)) {
+                long long mag_lo = b.lo < 0 ? -b.lo : b.lo;
+                long long mag_hi = b.hi < 0 ? -b.hi : b.hi;
+                long long limit = (mag_lo > mag_hi ? mag_lo : mag_hi) - 1;
+                if (lo < -limit) lo = -limit;
+                if (hi > limit) hi = limit;
+            }
+            return make_range(lo, hi);
+        }
+
+        default:
+            return range_full();
+    }
+}
+
+/* Decide 'a relop b' */
+int range_compare(const char* relop, Interval a, Interval b) {
+    if (strcmp(relop, "<") == 0) {
+        if (a.hi < b.lo) return 1;
+        if (a.lo >= b.hi) return 0;
+    } else if (strcmp(relop, "<=") == 0) {
+        if (a.hi <= b.lo) return 1;
+        if (a.lo > b.hi) return 0;
+    } else if (strcmp(relop, ">") == 0) {
+        return range_compare("<", b, a);
+    } else if (strcmp(relop, ">=") == 0) {
+        return range_compare("<=", b, a);
+    } else if (strcmp(relop, "==") == 0 || strcmp(relop, "!=") == 0) {
+        int equal = -1;
+        long long x, y;
+        if (range_is_constant(a, &x) && range_is_constant(b, &y) && x == y) equal = 1;
+        else if (a.hi < b.lo || b.hi < a.lo) equal = 0;
+        if (equal < 0 || relop[0] == '=') return equal;
+        return !equal;
+    }
+    return -1;
+}
+
+/* Helper: Interval of an operand in a state */
+static Interval operand_range(RangeAnalysis* ranges, const Interval* state, const char* operand) {
+    if (!operand) return range_full();
+    if (is_number(operand)) {
+        long long value = atoll(operand);
+        return make_range(value, value);
+    }
+    int id = lookup_name_id(ranges->names, operand);
+    return id >= 0 ? state[id] : range_full();
+}
+
+/* Helper: Step a state forward over one instruction */
+static void transfer(RangeAnalysis* ranges, Interval* state, TACInstruction* inst) {
+    Interval value = range_full();
+
+    switch (inst->opcode) {
+        case TAC_LOAD_CONST:
+        case TAC_ASSIGN:
+            value = operand_range(ranges, state, inst->op1);
+            break;
+        case TAC_ADD: case TAC_SUB: case TAC_MUL: case TAC_DIV: case TAC_MOD:
+            value = range_binary(inst->opcode, operand_range(ranges, state, inst->op1),
+                                 operand_range(ranges, state, inst->op2));
+            break;
+        case TAC_RELOP: {
+            int outcome = range_compare(inst->label, operand_range(ranges, state, inst->op1),
+                                        operand_range(ranges, state, inst->op2));
+            value = outcome < 0 ? make_range(0, 1) : make_range(outcome, outcome);
+            break;
+        }
+        case TAC_CALL:
+            /* The callee may change any variable that is not a temporary */
+            for (int v = 0; v < ranges->num_vars; v++) {
+                if (ranges->is_memory[v]) state[v] = range_full();
+            }
+            break;
+        default:
+            break;
+    }
+
+    const char* def = tac_def(inst);
+    if (def) {
+        int id = lookup_name_id(ranges->names, def);
+        if (id >= 0) state[id] = value;
+    }
+}
+
+/* Helper: Intervals at the end of a block */
+static void block_exit_state(RangeAnalysis* ranges, int b, Interval* state) {
+    BasicBlock* blk = &ranges->cfg->blocks[b];
+    memcpy(state, ranges->entry + (size_t)b * ranges->num_vars, ranges->num_vars * sizeof(Interval));
+    for (int i = blk->start; i < blk->start + blk->count; i++) {
+        transfer(ranges, state, ranges->cfg->insts[i]);
+    }
+}
+
+/* Helper: Lower a bound by one (no change at the ends of the int range) */
+static long long below(long long bound) {
+    return (bound == RANGE_MAX || bound <= INT_MIN) ? RANGE_MAX : bound - 1;
+}
+
+/* Helper: Raise a bound by one (no change at the ends of the int range) */
+static long long above(long long bound) {
+    return (bound == RANGE_MIN || bound >= INT_MAX) ? RANGE_MIN : bound + 1;
+}
+
+/* Helper: Narrow a state assuming 'a relop b' holds. Returns 0 if it cannot. */
+static int refine_relation(RangeAnalysis* ranges, Interval* state, const char* relop,
+                           const char* a_name, const char* b_name) {
+    Interval a = operand_range(ranges, state, a_name);
+    Interval b = operand_range(ranges, state, b_name);
+    long long value;
+
+    if (strcmp(relop, ">") == 0 || strcmp(relop, ">=") == 0) {
+        /* a > b is b < a */
+        Interval swap = a;
+        const char* swap_name = a_name;
+        a = b;
+        b = swap;
+        a_name = b_name;
+        b_name = swap_name;
+        relop = relop[1] == '=' ? "<=" : "<";
+    }
+
+    if (strcmp(relop, "<") == 0) {
+        long long hi = below(b.hi), lo = above(a.lo);
+        if (hi < a.hi) a.hi = hi;
+        if (lo > b.lo) b.lo = lo;
+    } else if (strcmp(relop, "<=") == 0) {
+        if (b.hi < a.hi) a.hi = b.hi;
+        if (a.lo > b.lo) b.lo = a.lo;
+    } else if (strcmp(relop, "==") == 0) {
+        if (b.lo > a.lo) a.lo = b.lo;
+        if (b.hi < a.hi) a.hi = b.hi;
+        b = a;
+    } else if (strcmp(relop, "!=") == 0) {
+        /* Only a constant on one side can cut an end off the other */
+        if (range_is_constant(b, &value)) {
+            if (a.lo == value && value < INT_MAX) a.lo = value + 1;
+            else if (a.hi == value && value > INT_MIN) a.hi = value - 1;
+        }
+        if (range_is_constant(a, &value)) {
+            if (b.lo == value && value < INT_MAX) b.lo = value + 1;
+            else if (b.hi == value && value > INT_MIN) b.hi = value - 1;
+        }
+    }
+
+    if (a.lo > a.hi || b.lo > b.hi) return 0;
+
+    int id = a_name && !is_number(a_name) ? lookup_name_id(ranges->names, a_name) : -1;
+    if (id >= 0) state[id] = a;
+    id = b_name && !is_number(b_name) ? lookup_name_id(ranges->names, b_name) : -1;
+    if (id >= 0) state[id] = b;
+    return 1;
+}
+
+/* Helper: Relation that holds when 'relop' does not */
+static const char* negate_relop(const char* relop) {
+    if (strcmp(relop, "<") == 0) return ">=";
+    if (strcmp(relop, "<=") == 0) return ">";
+    if (strcmp(relop, ">") == 0) return "<=";
+    if (strcmp(relop, ">=") == 0) return "<";
+    if (strcmp(relop, "==") == 0) return "!=";
+    return "==";
+}
+
+/* Helper: State along the edge b -> s, given the state at the end of b.
+ * An if_false narrows its condition (and the comparison that computed
+ * it, when no operand changes in between). Returns 0 if the edge cannot
+ * be taken. */
+static int edge_state(RangeAnalysis* ranges, int b, int s, const Interval* exit, Interval* out) {
+    CFG* cfg = ranges->cfg;
+    memcpy(out, exit, ranges->num_vars * sizeof(Interval));
+    if (ranges->branch_target[b] < 0) return 1;
+
+    BasicBlock* blk = &cfg->blocks[b];
+    int last = blk->start + blk->count - 1;
+    TACInstruction* branch = cfg->insts[last];
+    int taken = (s == ranges->branch_target[b]);   /* if_false jumps when the condition is 0 */
+    const char* cond = branch->op1;
+
+    if (!cond || is_number(cond)) return 1;
+
+    /* The condition itself */
+    if (!refine_relation(ranges, out, taken ? "==" : "!=", cond, "0")) return 0;
+
+    /* The comparison that computed it, if its operands still hold */
+    for (int i = last - 1; i >= blk->start; i--) {
+        TACInstruction* inst = cfg->insts[i];
+        const char* def = tac_def(inst);
+        if (!def || strcmp(def, cond) != 0) continue;
+        if (inst->opcode != TAC_RELOP) break;
+
+        for (int k = i + 1; k < last; k++) {
+            const char* later = tac_def(cfg->insts[k]);
+            if (cfg->insts[k]->opcode == TAC_CALL) return 1;
+            if (later && ((inst->op1 && strcmp(later, inst->op1) == 0) ||
+                          (inst->op2 && strcmp(later, inst->op2) == 0))) {
+                return 1;
+            }
+        }
+
+        const char* relop = taken ? negate_relop(inst->label) : inst->label;
+        return refine_relation(ranges, out, relop, inst->op1, inst->op2);
+    }
+
+    return 1;
+}
+
+/* Helper: Join a state into the entry of block s. Returns 1 if it changed. */
+static int join_into(RangeAnalysis* ranges, int s, const Interval* incoming, int widen) {
+    Interval* entry = ranges->entry + (size_t)s * ranges->num_vars;
+
+    if (!ranges->reached[s]) {
+        memcpy(entry, incoming, ranges->num_vars * sizeof(Interval));
+        ranges->reached[s] = 1;
+        return 1;
+    }
+
+    int changed = 0;
+    for (int v = 0; v < ranges->num_vars; v++) {
+        Interval old = entry[v];
+        Interval joined = old;
+        if (incoming[v].lo < joined.lo) joined.lo = widen ? RANGE_MIN : incoming[v].lo;
+        if (incoming[v].hi > joined.hi) joined.hi = widen ? RANGE_MAX : incoming[v].hi;
+        if (joined.lo != old.lo || joined.hi != old.hi) {
+            entry[v] = joined;
+            changed = 1;
+        }
+    }
+    return changed;
+}
+
+/* Analyze the ranges of a function */
+RangeAnalysis* analyze_ranges(CFG* cfg) {
+    if (!cfg->dominators_valid && cfg->num_reachable > 0) compute_dominators(cfg);
+
+    RangeAnalysis* ranges = (RangeAnalysis*)safe_calloc(1, sizeof(RangeAnalysis), "range analysis");
+    ranges->cfg = cfg;
+    ranges->names = create_name_table(cfg->num_insts);
+    intern_cfg_names(ranges->names, cfg);
+    ranges->num_vars = ranges->names->count;
+
+    int nb = cfg->num_blocks;
+    int nv = ranges->num_vars;
+    ranges->entry = (Interval*)safe_calloc((size_t)nb * nv + 1, sizeof(Interval), "range analysis");
+    ranges->reached = (char*)safe_calloc(nb + 1, sizeof(char), "range analysis");
+    ranges->block_of = (int*)safe_malloc((cfg->num_insts + 1) * sizeof(int), "range analysis");
+    ranges->branch_target = (int*)safe_malloc((nb + 1) * sizeof(int), "range analysis");
+    ranges->is_memory = (char*)safe_calloc(nv + 1, sizeof(char), "range analysis");
+    ranges->cursor = (Interval*)safe_malloc((nv + 1) * sizeof(Interval), "range analysis");
+    ranges->cursor_index = -1;
+
+    for (int v = 0; v < nv; v++) ranges->is_memory[v] = !is_temp_name(ranges->names->names[v]);
+    for (int b = 0; b < nb; b++) {
+        BasicBlock* blk = &cfg->blocks[b];
+        for (int i = blk->start; i < blk->start + blk->count; i++) ranges->block_of[i] = b;
+
+        /* Only an if_false with two distinct successors narrows its edges */
+        TACInstruction* last = block_last(cfg, b);
+        ranges->branch_target[b] = -1;
+        if (last->opcode == TAC_IF_FALSE && blk->num_succs == 2) {
+            ranges->branch_target[b] = find_label_block(cfg, last->label);
+        }
+    }
+
+    if (cfg->num_reachable == 0) return ranges;
+
+    /* Loop headers are the targets of back edges */
+    char* is_header = (char*)safe_calloc(nb + 1, sizeof(char), "range analysis");
+    int* updates = (int*)safe_calloc(nb + 1, sizeof(int), "range analysis");
+    for (int b = 0; b < nb; b++) {
+        for (int p = 0; p < cfg->blocks[b].num_preds; p++) {
+            if (dominates(cfg, b, cfg->blocks[b].preds[p])) is_header[b] = 1;
+        }
+    }
+
+    Interval* exit = (Interval*)safe_malloc((nv + 1) * sizeof(Interval), "range analysis");
+    Interval* out = (Interval*)safe_malloc((nv + 1) * sizeof(Interval), "range analysis");
+    int entry_block = cfg->rpo_order[0];
+
+    /* Nothing is known about any variable on entry */
+    for (int v = 0; v < nv; v++) ranges->entry[(size_t)entry_block * nv + v] = range_full();
+    ranges->reached[entry_block] = 1;
+
+    /* Ascending iteration with widening at loop headers */
+    int changed = 1;
+    int rounds = 0;
+    while (changed && rounds < MAX_RANGE_ROUNDS) {
+        changed = 0;
+        rounds++;
+        for (int r = 0; r < cfg->num_reachable; r++) {
+            int b = cfg->rpo_order[r];
+            if (!ranges->reached[b]) continue;
+            block_exit_state(ranges, b, exit);
+
+            for (int k = 0; k < cfg->blocks[b].num_succs; k++) {
+                int s = cfg->blocks[b].succs[k];
+                if (!edge_state(ranges, b, s, exit, out)) continue;
+                int widen = is_header[s] && updates[s] >= WIDEN_AFTER;
+                if (join_into(ranges, s, out, widen)) {
+                    updates[s]++;
+                    changed = 1;
+                }
+            }
+        }
+    }
+
+    if (changed) {
+        /* No fixpoint: fall back to knowing nothing */
+        debug_print("Range analysis: no fixpoint after %d rounds", rounds);
+        for (int r = 0; r < cfg->num_reachable; r++) {
+            int b = cfg->rpo_order[r];
+            ranges->reached[b] = 1;
+            for (int v = 0; v < nv; v++) ranges->entry[(size_t)b * nv + v] = range_full();
+        }
+    } else {
+        /* Descending rounds: recompute each entry from its predecessors
+         * without widening, which keeps the result sound and recovers
+         * the bounds that widening threw away */
+        for (int round = 0; round < NARROWING_ROUNDS; round++) {
+            for (int r = 1; r < cfg->num_reachable; r++) {
+                int b = cfg->rpo_order[r];
+                BasicBlock* blk = &cfg->blocks[b];
+                Interval* entry = ranges->entry + (size_t)b * nv;
+                int feasible = 0;
+
+                for (int p = 0; p < blk->num_preds; p++) {
+                    int pred = blk->preds[p];
+                    if (!ranges->reached[pred]) continue;
+                    block_exit_state(ranges, pred, exit);
+                    if (!edge_state(ranges, pred, b, exit, out)) continue;
+                    if (!feasible) {
+                        memcpy(entry, out, nv * sizeof(Interval));
+                        feasible = 1;
+                        continue;
+                    }
+                    for (int v = 0; v < nv; v++) {
+                        if (out[v].lo < entry[v].lo) entry[v].lo = out[v].lo;
+                        if (out[v].hi > entry[v].hi) entry[v].hi = out[v].hi;
+                    }
+                }
+                ranges->reached[b] = feasible;
+            }
+        }
+    }
+
+    free(exit);
+    free(out);
+    free(is_header);
+    free(updates);
+    return ranges;
+}
+
+/* Can instruction 'index' execute? */
+int range_reached(RangeAnalysis* ranges, int index) {
+    return ranges->reached[ranges->block_of[index]];
+}
+
+/* Interval of an operand just before instruction 'index' */
+Interval range_before(RangeAnalysis* ranges, int index, const char* operand) {
+    int b = ranges->block_of[index];
+    if (!ranges->reached[b]) return range_full();
+
+    /* Move the cursor forward within the block, or restart at its entry */
+    int from = ranges->cursor_index;
+    if (from < 0 || from > index || ranges->block_of[from] != b) {
+        from = ranges->cfg->blocks[b].start;
+        memcpy(ranges->cursor, ranges->entry + (size_t)b * ranges->num_vars,
+               ranges->num_vars * sizeof(Interval));
+    }
+    for (int i = from; i < index; i++) transfer(ranges, ranges->cursor, ranges->cfg->insts[i]);
+    ranges->cursor_index = index;
+
+    return operand_range(ranges, ranges->cursor, operand);
+}
+
+/* Helper: Round a byte offset down to an element index */
+static long long element_of(long long offset, int element_size) {
+    if (offset >= 0) return offset / element_size;
+    return -((-offset + element_size - 1) / element_size);
+}
+
+/* Element index accessed by an array instruction */
+Interval range_array_index(RangeAnalysis* ranges, int index, int element_size) {
+    TACInstruction* inst = ranges->cfg->insts[index];
+    int is_load = inst->opcode == TAC_ARRAY_LOAD || inst->opcode == TAC_ARRAY_LOAD_OFFSET;
+    Interval range = range_before(ranges, index, is_load ? inst->op2 : inst->op1);
+
+    if (inst->opcode == TAC_ARRAY_LOAD_OFFSET || inst->opcode == TAC_ARRAY_STORE_OFFSET) {
+        if (range.lo != RANGE_MIN) range.lo = element_of(range.lo, element_size);
+        if (range.hi != RANGE_MAX) range.hi = element_of(range.hi, element_size);
+    }
+    return range;
+}
+
+/* Free a range analysis */
+void free_range_analysis(RangeAnalysis* ranges) {
+    if (!ranges) return;
+    free_name_table(ranges->names);
+    free(ranges->entry);
+    free(ranges->reached);
+    free(ranges->block_of);
+    free(ranges->branch_target);
+    free(ranges->is_memory);
+    free(ranges->cursor);
+    free(ranges);
+}
@@ -0,0 +1,84 @@
+/*
+ * RANGE.H - Value Range Analysis Header
+ * CST-405 Compiler Project
+ *
+ * This file defines an interval analysis over the CFG of one function.
+ * Every variable gets an interval [lo, hi] holding all the values it may
+ * have at each program point. The analysis is an abstract interpretation:
+ * - Intervals join at block entries, and a branch on a comparison
+ *   narrows the compared variables along each outgoing edge
+ * - Loop headers widen unstable bounds to infinity so the iteration
+ *   ends, and narrowing rounds then recover bounds such as the limit of
+ *   the loop condition
+ * - A result that may leave the int range, an array element or a call
+ *   result is unknown, and a call makes every non-temporary unknown
+ *
+ * The security checks, the VRP pass and the --checked code generation
+ * read these facts.
+ */
+
+#ifndef RANGE_H
+#define RANGE_H
+
+#include <limits.h>
+#include "cfg.h"
+
+/* Unbounded ends of an interval */
+#define RANGE_MIN LLONG_MIN
+#define RANGE_MAX LLONG_MAX
+
+/* Values a variable may hold: lo <= value <= hi */
+typedef struct {
+    long long lo;
+    long long hi;
+} Interval;
+
+/* Intervals of every variable at the entry of every block */
+struct RangeAnalysis {
+    CFG* cfg;                   /* Function analyzed (dominators computed) */
+    NameTable* names;           /* Variables of the function */
+    int num_vars;               /* Number of variables */
+    Interval* entry;            /* Per block: num_vars intervals at block entry */
+    char* reached;              /* Per block: can the block execute? */
+    int* block_of;              /* Per instruction: its block */
+    int* branch_target;         /* Per block: block an ending if_false jumps to (-1 if none) */
+    char* is_memory;            /* Per variable: not a temporary (calls may change it) */
+    Interval* cursor;           /* Intervals just before instruction cursor_index */
+    int cursor_index;           /* Instruction the cursor stands at (-1 if none) */
+};
+
+/* RANGE ANALYSIS FUNCTIONS */
+
+/* Analyze the function of a CFG (computes the dominators if needed) */
+RangeAnalysis* analyze_ranges(CFG* cfg);
+
+/* Interval of an operand (variable or literal) just before instruction
+ * 'index' of the CFG. Queries in layout order are cheapest. */
+Interval range_before(RangeAnalysis* ranges, int index, const char* operand);
+
+/* Element index accessed by array instruction 'index' (the byte offsets
+ * of the *_OFFSET forms are divided by the element size) */
+Interval range_array_index(RangeAnalysis* ranges, int index, int element_size);
+
+/* Can instruction 'index' execute at all? */
+int range_reached(RangeAnalysis* ranges, int index);
+
+/* Interval of 'a op b' for ADD/SUB/MUL/DIV/MOD (unknown if it may overflow int) */
+Interval range_binary(TACOpcode opcode, Interval a, Interval b);
+
+/* Decide 'a relop b': 1 if always true, 0 if always false, -1 if unknown */
+int range_compare(const char* relop, Interval a, Interval b);
+
+/* Interval helpers */
+Interval range_full(void);
+int range_is_constant(Interval range, long long* value);
+int range_contains(Interval range, long long value);
+int range_is_bounded(Interval range);
+
+/* Format an interval as "[lo..hi]" (or "n" for a single value) */
+const char* range_to_string(Interval range, char* buffer, int size);
+
+/* Free a range analysis (the CFG is not freed) */
+void free_range_analysis(RangeAnalysis* ranges);
+
+#endif /* RANGE_H */
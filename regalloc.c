@@ -0,0 +1,474 @@
+/*
+ * REGALLOC.C - Linear Scan Register Allocator Implementation
+ * CST-405 Compiler Project
+ *
+ * This file computes the live intervals of one function and assigns
+ * registers to them with a linear scan (Poletto and Sarkar). Liveness
+ * is a backward dataflow over the CFG restricted to the values the
+ * allocator may keep in registers; every other variable lives in memory
+ * and is read and written there by the code generators.
+ */
+
+#include "regalloc.h"
+#include "diagnostics.h"
+
+/* Bitset helpers */
+#define SET_WORD(id) ((id) / 32)
+#define SET_BIT(id)  (1u << ((id) % 32))
+
+/* Loop depth weight cap (uses in deeper loops count as depth 4) */
+#define MAX_WEIGHT_DEPTH 4
+
+/* Helper: Does an instruction read or write a scalar name? */
+static int mentions(TACInstruction* inst, const char* name) {
+    const char* def = tac_def(inst);
+    if (def && strcmp(def, name) == 0) return 1;
+
+    const char* uses[3];
+    int count = tac_uses(inst, uses);
+    for (int u = 0; u < count; u++) {
+        if (strcmp(uses[u], name) == 0) return 1;
+    }
+    return 0;
+}
+
+/* Helper: Can 'function' call itself, directly or through other functions? */
+static int is_recursive(TACCode* program, const char* function) {
+    /* Functions reached so far; grow the set until nothing new is added */
+    int capacity = 16, count = 1;
+    const char** reached = (const char**)safe_malloc(capacity * sizeof(char*), "register allocation");
+    reached[0] = function;
+
+    int recursive = 0;
+    for (int r = 0; r < count && !recursive; r++) {
+        const char* current = NULL;
+        for (TACInstruction* inst = program->head; inst; inst = inst->next) {
+            if (inst->opcode == TAC_FUNCTION_LABEL) current = inst->label;
+            if (inst->opcode != TAC_CALL || !current || strcmp(current, reached[r]) != 0) continue;
+            if (strcmp(inst->label, function) == 0) {
+                recursive = 1;
+                break;
+            }
+
+            int seen = 0;
+            for (int k = 0; k < count && !seen; k++) seen = strcmp(reached[k], inst->label) == 0;
+            if (seen) continue;
+            if (count == capacity) {
+                capacity *= 2;
+                reached = (const char**)safe_realloc(reached, capacity * sizeof(char*), "register allocation");
+            }
+            reached[count++] = inst->label;
+        }
+    }
+
+    free(reached);
+    return recursive;
+}
+
+/* Helper: Is every read and write of a name inside 'function'? */
+static int only_used_in(TACCode* program, const char* function, const char* name) {
+    const char* current = NULL;
+    for (TACInstruction* inst = program->head; inst; inst = inst->next) {
+        if (inst->opcode == TAC_FUNCTION_LABEL) current = inst->label;
+        if ((!current || strcmp(current, function) != 0) && mentions(inst, name)) return 0;
+    }
+    return 1;
+}
+
+/* Helper: Can a value stay in a register for the whole function? Only
+ * temporaries, parameters and scalar variables owned by the function can:
+ * its locals, and globals no other function reads or writes when the
+ * function is not recursive (a nested activation would share them). */
+static int is_register_candidate(TACCode* program, SymbolTable* symtab, const char* function,
+                                 int recursive, const char* name, int* param) {
+    *param = -1;
+    if (!name || is_number(name)) return 0;
+    if (is_temp_name(name)) return 1;
+    if (!symtab || !function) return 0;
+
+    Symbol* owner = lookup_symbol(symtab, function);
+    for (int p = 0; owner && owner->kind == SYMBOL_FUNCTION && p < owner->param_count; p++) {
+        if (strcmp(owner->param_names[p], name) == 0) {
+            *param = p;
+            return 1;
+        }
+    }
+
+    for (Symbol* sym = symtab->table[hash(name, symtab->size)]; sym; sym = sym->next) {
+        if (strcmp(sym->name, name) != 0 || sym->kind != SYMBOL_VARIABLE) continue;
+        if (sym->is_array || !sym->scope) return 0;
+        if (strcmp(sym->scope, function) == 0) return 1;
+        if (strcmp(sym->scope, "global") != 0) continue;
+        return !recursive && only_used_in(program, function, name);
+    }
+    return 0;
+}
+
+/* Helper: Does an instruction call out (a user function, or printf on
+ * targets where print is a call)? */
+static int is_call(const RegisterFile* file, TACInstruction* inst) {
+    return inst->opcode == TAC_CALL || (inst->opcode == TAC_PRINT && file->print_is_call);
+}
+
+/* Helper: Widen an interval to cover a position */
+static void extend(LiveInterval* interval, int position) {
+    if (interval->start < 0 || position < interval->start) interval->start = position;
+    if (position > interval->end) interval->end = position;
+}
+
+/* Helper: Order intervals by start, then by end */
+static int compare_starts(const void* a, const void* b) {
+    const LiveInterval* x = (const LiveInterval*)a;
+    const LiveInterval* y = (const LiveInterval*)b;
+    if (x->start != y->start) return x->start - y->start;
+    return x->end - y->end;
+}
+
+/* Helper: Compute the live intervals of the candidate values */
+static void build_intervals(RegisterAllocation* alloc, CFG* cfg, LoopForest* forest,
+                            const char* candidate) {
+    NameTable* names = alloc->names;
+    int words = names->count / 32 + 1;
+    int sets = cfg->num_blocks > 0 ? cfg->num_blocks : 1;
+    unsigned int* live_in = (unsigned int*)safe_calloc(sets * words, sizeof(unsigned int), "register allocation");
+    unsigned int* live_out = (unsigned int*)safe_calloc(sets * words, sizeof(unsigned int), "register allocation");
+    unsigned int* set = (unsigned int*)safe_malloc(words * sizeof(unsigned int), "register allocation");
+
+    /* Backward dataflow: live_in = uses + (live_out - defs) */
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int b = cfg->num_blocks - 1; b >= 0; b--) {
+            BasicBlock* blk = &cfg->blocks[b];
+            unsigned int* out = live_out + b * words;
+            memset(out, 0, words * sizeof(unsigned int));
+            for (int s = 0; s < blk->num_succs; s++) {
+                unsigned int* succ_in = live_in + blk->succs[s] * words;
+                for (int w = 0; w < words; w++) out[w] |= succ_in[w];
+            }
+
+            memcpy(set, out, words * sizeof(unsigned int));
+            for (int i = blk->start + blk->count - 1; i >= blk->start; i--) {
+                TACInstruction* inst = cfg->insts[i];
+                const char* def = tac_def(inst);
+                int id = def ? lookup_name_id(names, def) : -1;
+                if (id >= 0 && candidate[id]) set[SET_WORD(id)] &= ~SET_BIT(id);
+
+                const char* uses[3];
+                int count = tac_uses(inst, uses);
+                for (int u = 0; u < count; u++) {
+                    id = lookup_name_id(names, uses[u]);
+                    if (id >= 0 && candidate[id]) set[SET_WORD(id)] |= SET_BIT(id);
+                }
+            }
+
+            unsigned int* in = live_in + b * words;
+            if (memcmp(set, in, words * sizeof(unsigned int)) != 0) {
+                memcpy(in, set, words * sizeof(unsigned int));
+                changed = 1;
+            }
+        }
+    }
+
+    /* Walk each block backward again and widen the intervals */
+    for (int b = 0; b < cfg->num_blocks; b++) {
+        BasicBlock* blk = &cfg->blocks[b];
+        int last = blk->start + blk->count - 1;
+        int depth = forest->innermost[b] >= 0 ? forest->loops[forest->innermost[b]].depth : 0;
+        int weight = 1;
+        for (int d = 0; d < depth && d < MAX_WEIGHT_DEPTH; d++) weight *= 10;
+
+        memcpy(set, live_out + b * words, words * sizeof(unsigned int));
+        for (int id = 0; id < names->count; id++) {
+            if (set[SET_WORD(id)] & SET_BIT(id)) extend(&alloc->intervals[alloc->interval_of[id]], 2 * last + 1);
+        }
+
+        for (int i = last; i >= blk->start; i--) {
+            TACInstruction* inst = cfg->insts[i];
+            const char* def = tac_def(inst);
+            int id = def ? lookup_name_id(names, def) : -1;
+            if (id >= 0 && candidate[id]) {
+                LiveInterval* interval = &alloc->intervals[alloc->interval_of[id]];
+                extend(interval, 2 * i + 1);
+                interval->weight += weight;
+                set[SET_WORD(id)] &= ~SET_BIT(id);
+            }
+
+            const char* uses[3];
+            int count = tac_uses(inst, uses);
+            for (int u = 0; u < count; u++) {
+                id = lookup_name_id(names, uses[u]);
+                if (id < 0 || !candidate[id]) continue;
+                LiveInterval* interval = &alloc->intervals[alloc->interval_of[id]];
+                extend(interval, 2 * i);
+                interval->weight += weight;
+                set[SET_WORD(id)] |= SET_BIT(id);
+            }
+        }
+
+        for (int id = 0; id < names->count; id++) {
+            if (set[SET_WORD(id)] & SET_BIT(id)) extend(&alloc->intervals[alloc->interval_of[id]], 2 * blk->start);
+        }
+    }
+
+    /* Parameters arrive in memory and are loaded at entry; any other
+     * value live at entry is read before it is written, so it keeps its
+     * memory home (and whatever an earlier call left there) */
+    for (int id = 0; id < names->count; id++) {
+        if (!candidate[id]) continue;
+        LiveInterval* interval = &alloc->intervals[alloc->interval_of[id]];
+        if (!(live_in[SET_WORD(id)] & SET_BIT(id))) interval->entry_load = 0;
+        else if (!interval->entry_load) interval->start = -1;
+    }
+
+    free(live_in);
+    free(live_out);
+    free(set);
+}
+
+/* Helper: Keep each argument live from its param to the call that
+ * consumes it (the params of nested calls come in between), and hint
+ * the register it is passed in */
+static void extend_arguments(RegisterAllocation* alloc, CFG* cfg) {
+    const RegisterFile* file = alloc->file;
+    int* pending = (int*)safe_malloc((cfg->num_insts + 1) * sizeof(int), "register allocation");
+    int top = 0;
+    for (int i = 0; i < cfg->num_insts; i++) {
+        TACInstruction* inst = cfg->insts[i];
+        if (inst->opcode == TAC_PARAM) pending[top++] = i;
+        if (inst->opcode != TAC_CALL) continue;
+
+        for (int a = atoi(inst->op1); a > 0 && top > 0; a--) {
+            int id = lookup_name_id(alloc->names, cfg->insts[pending[--top]]->op1);
+            if (id < 0 || alloc->interval_of[id] < 0) continue;
+            LiveInterval* interval = &alloc->intervals[alloc->interval_of[id]];
+            if (interval->start < 0) continue;
+            extend(interval, 2 * i);
+            if (interval->end == 2 * i && a <= file->num_arg_registers) interval->hint = file->arg_registers[a - 1];
+        }
+    }
+    free(pending);
+}
+
+/* Helper: Pick a free register, preferring callee-saved ones for values
+ * live across calls and caller-saved ones otherwise, and leaving alone
+ * the registers later overlapping intervals are hinted to */
+static int pick_register(const RegisterFile* file, const int* busy, const int* wanted, int want_callee_saved) {
+    int fallback = -1;
+    int taken = -1;
+    for (int r = 0; r < file->count; r++) {
+        if (busy[r]) continue;
+        if (wanted[r]) {
+            if (taken < 0) taken = r;
+            continue;
+        }
+        if (file->callee_saved[r] == want_callee_saved) return r;
+        if (fallback < 0) fallback = r;
+    }
+    return fallback >= 0 ? fallback : taken;
+}
+
+/* Helper: Linear scan over the intervals (ordered by start) */
+static void linear_scan(RegisterAllocation* alloc) {
+    const RegisterFile* file = alloc->file;
+    int* busy = (int*)safe_calloc(file->count, sizeof(int), "register allocation");
+    int* wanted = (int*)safe_calloc(file->count, sizeof(int), "register allocation");
+    int* active = (int*)safe_malloc((alloc->num_intervals + 1) * sizeof(int), "register allocation");
+    int num_active = 0;
+
+    for (int i = 0; i < alloc->num_intervals; i++) {
+        LiveInterval* current = &alloc->intervals[i];
+
+        /* Expire the intervals that ended before this one starts */
+        int kept = 0;
+        for (int a = 0; a < num_active; a++) {
+            LiveInterval* other = &alloc->intervals[active[a]];
+            if (other->end < current->start) busy[other->reg] = 0;
+            else active[kept++] = active[a];
+        }
+        num_active = kept;
+
+        memset(wanted, 0, file->count * sizeof(int));
+        for (int j = i + 1; j < alloc->num_intervals && alloc->intervals[j].start <= current->end; j++) {
+            if (alloc->intervals[j].hint >= 0) wanted[alloc->intervals[j].hint] = 1;
+        }
+        int reg = pick_register(file, busy, wanted, current->crosses_call);
+        if (current->hint >= 0 && !busy[current->hint] && !current->crosses_call) reg = current->hint;
+        if (reg < 0) {
+            /* Spill the cheapest of the active intervals and this one */
+            int victim = -1;
+            for (int a = 0; a < num_active; a++) {
+                LiveInterval* other = &alloc->intervals[active[a]];
+                if (other->weight < current->weight &&
+                    (victim < 0 || other->weight < alloc->intervals[active[victim]].weight ||
+                     (other->weight == alloc->intervals[active[victim]].weight &&
+                      other->end > alloc->intervals[active[victim]].end))) {
+                    victim = a;
+                }
+            }
+            if (victim < 0) continue;                    /* This one stays in memory */
+
+            LiveInterval* spilled = &alloc->intervals[active[victim]];
+            reg = spilled->reg;
+            spilled->reg = -1;
+            spilled->split = 0;
+            active[victim] = active[--num_active];
+        }
+
+        current->reg = reg;
+        current->split = current->crosses_call && !file->callee_saved[reg];
+        busy[reg] = 1;
+        active[num_active++] = i;
+    }
+
+    free(busy);
+    free(wanted);
+    free(active);
+}
+
+/* Allocate registers for one function */
+RegisterAllocation* allocate_registers(TACCode* program, TACInstruction* start, SymbolTable* symtab,
+                                       const RegisterFile* file, RegAllocStats* stats) {
+    LoopForest* forest = NULL;
+    CFG* cfg = get_function_loops(start, &forest);
+    const char* function = start->opcode == TAC_FUNCTION_LABEL ? start->label : NULL;
+
+    RegisterAllocation* alloc = (RegisterAllocation*)safe_calloc(1, sizeof(RegisterAllocation),
+                                                                 "register allocation");
+    alloc->file = file;
+    alloc->names = create_name_table(cfg->num_insts);
+    intern_cfg_names(alloc->names, cfg);
+
+    /* One interval per candidate value */
+    int count = alloc->names->count;
+    int recursive = function ? is_recursive(program, function) : 1;
+    char* candidate = (char*)safe_calloc(count + 1, 1, "register allocation");
+    alloc->interval_of = (int*)safe_malloc((count + 1) * sizeof(int), "register allocation");
+    alloc->intervals = (LiveInterval*)safe_calloc(count + 1, sizeof(LiveInterval), "register allocation");
+    for (int id = 0; id < count; id++) {
+        int param;
+        alloc->interval_of[id] = -1;
+        if (!is_register_candidate(program, symtab, function, recursive,
+                                   alloc->names->names[id], &param)) continue;
+
+        LiveInterval* interval = &alloc->intervals[alloc->num_intervals];
+        interval->name = alloc->names->names[id];
+        interval->start = -1;
+        interval->end = -1;
+        interval->entry_load = param >= 0;
+        interval->hint = param >= 0 && param < file->num_arg_registers ? file->arg_registers[param] : -1;
+        interval->reg = -1;
+        candidate[id] = 1;
+        alloc->interval_of[id] = alloc->num_intervals++;
+    }
+
+    build_intervals(alloc, cfg, forest, candidate);
+    if (file->num_arg_registers > 0) extend_arguments(alloc, cfg);
+
+    /* Values live across a call (their definition at the call excluded) */
+    for (int i = 0; i < cfg->num_insts; i++) {
+        if (!is_call(file, cfg->insts[i])) continue;
+        for (int v = 0; v < alloc->num_intervals; v++) {
+            LiveInterval* interval = &alloc->intervals[v];
+            if (interval->start >= 0 && interval->start <= 2 * i && interval->end >= 2 * i + 1) {
+                interval->crosses_call = 1;
+            }
+        }
+    }
+
+    /* Drop the values that must stay in memory, then scan in start order */
+    int kept = 0;
+    for (int v = 0; v < alloc->num_intervals; v++) {
+        if (alloc->intervals[v].start >= 0) alloc->intervals[kept++] = alloc->intervals[v];
+    }
+    alloc->num_intervals = kept;
+    qsort(alloc->intervals, kept, sizeof(LiveInterval), compare_starts);
+    for (int id = 0; id < count; id++) alloc->interval_of[id] = -1;
+    for (int v = 0; v < kept; v++) {
+        alloc->interval_of[lookup_name_id(alloc->names, alloc->intervals[v].name)] = v;
+    }
+
+    linear_scan(alloc);
+
+    /* Callee-saved registers the prologue must save */
+    alloc->callee_saved_used = (int*)safe_malloc((file->count + 1) * sizeof(int), "register allocation");
+    for (int r = 0; r < file->count; r++) {
+        if (!file->callee_saved[r]) continue;
+        for (int v = 0; v < kept; v++) {
+            if (alloc->intervals[v].reg == r) {
+                alloc->callee_saved_used[alloc->num_callee_saved_used++] = r;
+                break;
+            }
+        }
+    }
+
+    if (stats) {
+        for (int v = 0; v < kept; v++) {
+            stats->intervals++;
+            if (alloc->intervals[v].reg >= 0) stats->in_registers++;
+            else stats->spilled++;
+            if (alloc->intervals[v].split) stats->split++;
+        }
+        stats->callee_saved += alloc->num_callee_saved_used;
+    }
+
+    free(candidate);
+    release_analyses(cfg, forest, NULL);
+    return alloc;
+}
+
+/* Live intervals without registers: every value stays in memory */
+RegisterAllocation* compute_live_intervals(TACCode* program, TACInstruction* start, SymbolTable* symtab,
+                                           const RegisterFile* file) {
+    int no_registers[16];
+    RegisterFile memory_only = *file;
+    memory_only.count = 0;
+    for (int a = 0; a < file->num_arg_registers && a < 16; a++) no_registers[a] = -1;
+    memory_only.arg_registers = no_registers;
+
+    RegisterAllocation* alloc = allocate_registers(program, start, symtab, &memory_only, NULL);
+    alloc->file = file;
+    return alloc;
+}
+
+/* Register holding a value (-1 if it lives in memory) */
+int allocated_register(RegisterAllocation* alloc, const char* name) {
+    if (!alloc || !name || is_number(name)) return -1;
+    int id = lookup_name_id(alloc->names, name);
+    if (id < 0 || alloc->interval_of[id] < 0) return -1;
+    return alloc->intervals[alloc->interval_of[id]].reg;
+}
+
+/* Split intervals whose registers a call at instruction 'index' clobbers */
+int split_at_call(RegisterAllocation* alloc, int index, LiveInterval** out) {
+    int count = 0;
+    if (!alloc) return 0;
+    for (int v = 0; v < alloc->num_intervals; v++) {
+        LiveInterval* interval = &alloc->intervals[v];
+        if (interval->split && interval->start <= 2 * index && interval->end >= 2 * index + 1) {
+            out[count++] = interval;
+        }
+    }
+    return count;
+}
+
+/* Print the allocator statistics */
+void print_regalloc_stats(RegAllocStats* stats) {
+    printf("\n============== REGISTER ALLOCATION STATISTICS ============\n\n");
+    printf("Values allocated:          %d\n", stats->intervals);
+    printf("  In registers:            %d\n", stats->in_registers);
+    printf("  Spilled to memory:       %d\n", stats->spilled);
+    printf("  Split around calls:      %d\n", stats->split);
+    printf("Callee-saved registers:    %d\n", stats->callee_saved);
+    printf("\n==========================================================\n\n");
+}
+
+/* Free an allocation */
+void free_register_allocation(RegisterAllocation* alloc) {
+    if (!alloc) return;
+    free_name_table(alloc->names);
+    free(alloc->interval_of);
+    free(alloc->intervals);
+    free(alloc->callee_saved_used);
+    free(alloc);
+}
@@ -0,0 +1,109 @@
+/*
+ * REGALLOC.H - Linear Scan Register Allocator Header
+ * CST-405 Compiler Project
+ *
+ * This file defines the register allocator the back ends run on each
+ * function right before emitting it. Values that belong to the function
+ * (temporaries, parameters and scalar variables no other function
+ * touches) get a live interval over
+ * the TAC, and a linear scan over the intervals hands out the registers
+ * of a target register file:
+ * - Positions are numbered per instruction: 2i is where instruction i
+ *   reads its operands and 2i+1 is where it writes its result, so a
+ *   value may take over the register of an operand that dies there
+ * - An interval that is live across a call prefers a callee-saved
+ *   register; if it only gets a caller-saved one, it is split around
+ *   each call it crosses (stored to its memory home before the call and
+ *   reloaded after it)
+ * - On targets that pass arguments in registers, an argument is read by
+ *   the call rather than by its param, so it stays live until the call;
+ *   arguments and parameters that do not cross a call prefer the
+ *   register they travel in, which saves the moves around calls
+ * - When no register is free, the interval with the lowest spill weight
+ *   (uses weighted by loop depth) lives in memory instead
+ * - Spilled and split values use their memory home: a frame slot (see
+ *   frame.h), the argument slot of a parameter or the label of a global
+ * Arrays and the globals other functions use always stay in memory.
+ */
+
+#ifndef REGALLOC_H
+#define REGALLOC_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ircode.h"
+#include "cfg.h"
+#include "symtable.h"
+
+/* Registers a target hands out */
+typedef struct {
+    const char* const* names;   /* Register names */
+    const int* callee_saved;    /* Per register: preserved across calls? */
+    int count;                  /* Number of registers */
+    int print_is_call;          /* print clobbers caller-saved registers (printf, not a syscall) */
+    const int* arg_registers;   /* Per register argument: its register (-1: not handed out) */
+    int num_arg_registers;      /* Leading arguments passed in registers (0: all on the stack) */
+} RegisterFile;
+
+/* Live interval of one value in a function */
+typedef struct {
+    char* name;                 /* Variable or temporary (also its memory home) */
+    int start;                  /* First position where the value is live */
+    int end;                    /* Last position where the value is live */
+    int weight;                 /* Uses and definitions weighted by loop depth */
+    int crosses_call;           /* Live across a call (user function or printf) */
+    int entry_load;             /* Parameter live at entry: loaded from its argument */
+    int hint;                   /* Preferred register (-1: none) */
+    int reg;                    /* Assigned register (-1: lives in memory) */
+    int split;                  /* Caller-saved register split around calls */
+} LiveInterval;
+
+/* Register assignment of one function */
+typedef struct {
+    LiveInterval* intervals;    /* Intervals ordered by start */
+    int num_intervals;          /* Number of intervals */
+    NameTable* names;           /* Values of the function */
+    int* interval_of;           /* Per name id: interval index (-1 if not allocated) */
+    const RegisterFile* file;   /* Registers handed out */
+    int* callee_saved_used;     /* Callee-saved registers in use, in file order */
+    int num_callee_saved_used;  /* Number of them */
+} RegisterAllocation;
+
+/* Allocator statistics (summed over functions) */
+typedef struct {
+    int intervals;              /* Values considered */
+    int in_registers;           /* ... given a register */
+    int spilled;                /* ... left in memory */
+    int split;                  /* ... split around calls */
+    int callee_saved;           /* Callee-saved registers saved in prologues */
+} RegAllocStats;
+
+/* REGISTER ALLOCATION FUNCTIONS */
+
+/* Allocate registers for the function starting at 'start' (its FUNCTION
+ * label) in 'program'. Parameters are looked up in the symbol table; the
+ * rest of the program tells which variables no other function touches. */
+RegisterAllocation* allocate_registers(TACCode* program, TACInstruction* start, SymbolTable* symtab,
+                                       const RegisterFile* file, RegAllocStats* stats);
+
+/* Compute the live intervals of the function starting at 'start' but
+ * hand out no register, so every value keeps its memory home (frames
+ * share the slots of temporaries by these intervals under --no-regalloc) */
+RegisterAllocation* compute_live_intervals(TACCode* program, TACInstruction* start, SymbolTable* symtab,
+                                           const RegisterFile* file);
+
+/* Register holding a value (-1 if it lives in memory) */
+int allocated_register(RegisterAllocation* alloc, const char* name);
+
+/* Collect the split intervals whose registers a call at instruction
+ * 'index' clobbers; returns the number stored in 'out' */
+int split_at_call(RegisterAllocation* alloc, int index, LiveInterval** out);
+
+/* Print the allocator statistics */
+void print_regalloc_stats(RegAllocStats* stats);
+
+/* Free an allocation */
+void free_register_allocation(RegisterAllocation* alloc);
+
+#endif /* REGALLOC_H */
@@ -15,7 +15,29 @@ $tests = @(
     'test_arrays.c',
     'test_functions.c',
     'test_security.c',
-    'test_comprehensive.c'
+    'test_comprehensive.c',
+    'test_cse.c',
+    'test_sccp.c',
+    'test_licm.c',
+    'test_iv.c',
+    'test_unroll.c',
+    'test_inline.c',
+    'test_tailcall.c',
+    'test_strength.c',
+    'test_ranges.c',
+    'test_checked.c --checked',
+    'test_checked_trap.c --checked -O0',
+    'test_checked_trap.c --checked -O2',
+    'test_regalloc.c',
+    'test_recursion.c',
+    'test_arguments.c',
+    'test_isel.c',
+    'test_addressing.c',
+    'test_branches.c',
+    'test_immediates.c',
+    'test_temps.c',
+    'test_peephole.c',
+    'test_object.c --obj'
 )
 
 foreach ($test in $tests) {
@@ -23,7 +45,8 @@ foreach ($test in $tests) {
     Write-Host "========================================" -ForegroundColor DarkCyan -BackgroundColor Black
     Write-Host "Testing: $test" -ForegroundColor Black -BackgroundColor Yellow
     Write-Host "========================================" -ForegroundColor DarkCyan -BackgroundColor Black
-    .\compiler.exe $test
+    $arguments = $test -split ' '
+    .\compiler.exe @arguments
 }
 
 Write-Host ""
@@ -1,196 +1,193 @@
 /*
  * SECURITY.C - Security Analysis Implementation
  * CST-405 Compiler Project
+ *
+ * Array bounds, integer overflow and division checks run over the
+ * unoptimized TAC and read the interval of every operand from the range
+ * analysis (range.c), so an access is only reported when the intervals
+ * cannot rule the problem out. Loop and initialization checks walk the AST.
  */
 
 #include "security.h"
+#include "range.h"
 #include "diagnostics.h"
 #include <limits.h>
 
-/* Helper: Check if a node is a constant */
-static int is_constant_node(ASTNode* node, int* value) {
-    if (!node) return 0;
-
-    if (node->type == NODE_NUMBER) {
-        if (value) *value = node->data.num_value;
-        return 1;
+/* Per-instruction check run over the reached TAC of every function */
+typedef void (*InstructionCheck)(RangeAnalysis* ranges, int index, TACInstruction* inst,
+                                 TACCode* code, SymbolTable* symtab,
+                                 SecurityCheckResults* results);
+
+/* Helper: Run a check on every instruction that can execute */
+static void check_code(TACCode* code, SymbolTable* symtab, SecurityCheckResults* results,
+                       InstructionCheck check) {
+    TACInstruction* start = code->head;
+
+    while (start) {
+        RangeAnalysis* ranges;
+        CFG* cfg = get_function_ranges(start, &ranges);
+        for (int i = 0; i < cfg->num_insts; i++) {
+            if (range_reached(ranges, i)) check(ranges, i, cfg->insts[i], code, symtab, results);
+        }
+        start = cfg->end;
+        release_ranges(cfg, ranges);
     }
-    return 0;
 }
 
-/* Check for buffer overflow vulnerabilities */
-void check_buffer_overflow(ASTNode* node, SymbolTable* symtab, SecurityCheckResults* results) {
-    if (!node) return;
-
-    /* Check array access with potentially out-of-bounds index */
-    if (node->type == NODE_ARRAY_ACCESS) {
-        const char* array_name = node->data.array_access.array_name;
-        ASTNode* index = node->data.array_access.index;
-
-        /* Look up array in symbol table */
-        Symbol* sym = lookup_symbol(symtab, array_name);
-        if (sym && sym->is_array) {
-            int index_val;
-            if (is_constant_node(index, &index_val)) {
-                /* Static array bounds check */
-                if (index_val < 0 || index_val >= sym->array_size) {
-                    diag_security_warning(node->line_number, 0,
-                        "Array '%s' access with index %d is out of bounds [0..%d]",
-                        array_name, index_val, sym->array_size - 1);
-                    results->buffer_overflow_risks++;
-                }
-            } else {
-                /* Dynamic index - warn about potential overflow */
-                debug_print("Array '%s' accessed with non-constant index - potential buffer overflow",
-                           array_name);
-                results->array_access_risks++;
-            }
+/* Helper: Bounds-check one array element access (load or store) against
+ * the interval of its index */
+static void check_array_index(RangeAnalysis* ranges, int index, TACInstruction* inst,
+                              TACCode* code, SymbolTable* symtab,
+                              SecurityCheckResults* results) {
+    const char* array_name = tac_array(inst);
+    if (!array_name) return;
+
+    /* Look up array in symbol table */
+    Symbol* sym = lookup_symbol(symtab, array_name);
+    if (!sym || !sym->is_array) return;
+
+    Interval range = range_array_index(ranges, index, code->element_size);
+
+    long long value;
+    char range_str[64];
+    int last = sym->array_size - 1;
+
+    if (range_is_constant(range, &value)) {
+        /* Static array bounds check */
+        if (value < 0 || value > last) {
+            diag_security_warning(inst->line, 0,
+                "Array '%s' access with index %lld is out of bounds [0..%d]",
+                array_name, value, last);
+            results->buffer_overflow_risks++;
+        } else {
+            results->safe_array_accesses++;
         }
+    } else if ((range.lo != RANGE_MIN && range.lo > last) ||
+               (range.hi != RANGE_MAX && range.hi < 0)) {
+        diag_security_warning(inst->line, 0,
+            "Array '%s' index %s is always out of bounds [0..%d]",
+            array_name, range_to_string(range, range_str, sizeof(range_str)), last);
+        results->buffer_overflow_risks++;
+    } else if ((range.lo != RANGE_MIN && range.lo < 0) ||
+               (range.hi != RANGE_MAX && range.hi > last)) {
+        diag_security_warning(inst->line, 0,
+            "Array '%s' index %s may be out of bounds [0..%d]",
+            array_name, range_to_string(range, range_str, sizeof(range_str)), last);
+        results->buffer_overflow_risks++;
+    } else if (range_is_bounded(range)) {
+        debug_print("Array '%s' index %s proven within bounds",
+                   array_name, range_to_string(range, range_str, sizeof(range_str)));
+        results->safe_array_accesses++;
+    } else {
+        /* Unknown index - warn about potential overflow */
+        debug_print("Array '%s' accessed with unbounded index - potential buffer overflow",
+                   array_name);
+        results->array_access_risks++;
     }
+}
 
-    /* Recursively check children */
-    switch (node->type) {
-        case NODE_PROGRAM:
-            check_buffer_overflow(node->data.program.statements, symtab, results);
-            break;
-        case NODE_STATEMENT_LIST:
-            check_buffer_overflow(node->data.stmt_list.statement, symtab, results);
-            check_buffer_overflow(node->data.stmt_list.next, symtab, results);
-            break;
-        case NODE_BINARY_OP:
-        case NODE_CONDITION:
-            check_buffer_overflow(node->data.binary_op.left, symtab, results);
-            check_buffer_overflow(node->data.binary_op.right, symtab, results);
-            break;
-        case NODE_ASSIGNMENT:
-            check_buffer_overflow(node->data.assignment.expr, symtab, results);
-            break;
-        case NODE_PRINT:
-            check_buffer_overflow(node->data.print.expr, symtab, results);
-            break;
-        case NODE_WHILE:
-            check_buffer_overflow(node->data.while_loop.condition, symtab, results);
-            check_buffer_overflow(node->data.while_loop.body, symtab, results);
-            break;
-        case NODE_IF:
-            check_buffer_overflow(node->data.if_stmt.condition, symtab, results);
-            check_buffer_overflow(node->data.if_stmt.then_branch, symtab, results);
-            check_buffer_overflow(node->data.if_stmt.else_branch, symtab, results);
-            break;
-        case NODE_FOR:
-            check_buffer_overflow(node->data.for_loop.init, symtab, results);
-            check_buffer_overflow(node->data.for_loop.condition, symtab, results);
-            check_buffer_overflow(node->data.for_loop.update, symtab, results);
-            check_buffer_overflow(node->data.for_loop.body, symtab, results);
-            break;
-        case NODE_FUNCTION_CALL:
-            check_buffer_overflow(node->data.func_call.args, symtab, results);
-            break;
-        case NODE_ARG_LIST:
-            check_buffer_overflow(node->data.list.item, symtab, results);
-            check_buffer_overflow(node->data.list.next, symtab, results);
-            break;
-        default:
-            break;
-    }
+/* Check for buffer overflow vulnerabilities */
+void check_buffer_overflow(TACCode* code, SymbolTable* symtab, SecurityCheckResults* results) {
+    check_code(code, symtab, results, check_array_index);
 }
 
-/* Check for integer overflow/underflow */
-void check_integer_overflow(ASTNode* node, SecurityCheckResults* results) {
-    if (!node) return;
+/* Helper: Check that an arithmetic instruction stays inside the int range */
+static void check_arithmetic(RangeAnalysis* ranges, int index, TACInstruction* inst,
+                             TACCode* code, SymbolTable* symtab,
+                             SecurityCheckResults* results) {
+    (void)code;
+    (void)symtab;
+
+    const char* name;
+    const char* symbol;
+    switch (inst->opcode) {
+        case TAC_ADD: name = "addition"; symbol = "+"; break;
+        case TAC_SUB: name = "subtraction"; symbol = "-"; break;
+        case TAC_MUL: name = "multiplication"; symbol = "*"; break;
+        default: return;
+    }
 
-    /* Check arithmetic operations with constants */
-    if (node->type == NODE_BINARY_OP) {
-        int left_val, right_val;
-        if (is_constant_node(node->data.binary_op.left, &left_val) &&
-            is_constant_node(node->data.binary_op.right, &right_val)) {
-
-            const char* op = node->data.binary_op.operator;
-            long long result;
-
-            if (strcmp(op, "+") == 0) {
-                result = (long long)left_val + right_val;
-                if (result > INT_MAX || result < INT_MIN) {
-                    diag_security_warning(node->line_number, 0,
-                        "Integer overflow in addition: %d + %d",
-                        left_val, right_val);
-                    results->integer_overflow_risks++;
-                }
-            } else if (strcmp(op, "*") == 0) {
-                result = (long long)left_val * right_val;
-                if (result > INT_MAX || result < INT_MIN) {
-                    diag_security_warning(node->line_number, 0,
-                        "Integer overflow in multiplication: %d * %d",
-                        left_val, right_val);
-                    results->integer_overflow_risks++;
-                }
-            }
+    Interval a = range_before(ranges, index, inst->op1);
+    Interval b = range_before(ranges, index, inst->op2);
+    if (!range_is_bounded(a) || !range_is_bounded(b)) return;
+
+    /* Exact bounds of the result (int operands cannot overflow long long) */
+    long long lo, hi;
+    if (inst->opcode == TAC_ADD) {
+        lo = a.lo + b.lo;
+        hi = a.hi + b.hi;
+    } else if (inst->opcode == TAC_SUB) {
+        lo = a.lo - b.hi;
+        hi = a.hi - b.lo;
+    } else {
+        long long products[4] = { a.lo * b.lo, a.lo * b.hi, a.hi * b.lo, a.hi * b.hi };
+        lo = hi = products[0];
+        for (int k = 1; k < 4; k++) {
+            if (products[k] < lo) lo = products[k];
+            if (products[k] > hi) hi = products[k];
         }
     }
-
-    /* Recursively check children */
-    switch (node->type) {
-        case NODE_PROGRAM:
-            check_integer_overflow(node->data.program.statements, results);
-            break;
-        case NODE_STATEMENT_LIST:
-            check_integer_overflow(node->data.stmt_list.statement, results);
-            check_integer_overflow(node->data.stmt_list.next, results);
-            break;
-        case NODE_BINARY_OP:
-            check_integer_overflow(node->data.binary_op.left, results);
-            check_integer_overflow(node->data.binary_op.right, results);
-            break;
-        default:
-            break;
+    if (lo >= INT_MIN && hi <= INT_MAX) return;
+
+    long long x, y;
+    if (range_is_constant(a, &x) && range_is_constant(b, &y)) {
+        diag_security_warning(inst->line, 0,
+            "Integer overflow in %s: %lld %s %lld", name, x, symbol, y);
+    } else if (hi < INT_MIN || lo > INT_MAX) {
+        diag_security_warning(inst->line, 0,
+            "Integer overflow in %s: result is always outside the int range", name);
+    } else {
+        char a_str[64], b_str[64];
+        diag_security_warning(inst->line, 0,
+            "Integer %s may overflow: %s %s %s",
+            name, range_to_string(a, a_str, sizeof(a_str)), symbol,
+            range_to_string(b, b_str, sizeof(b_str)));
     }
+    results->integer_overflow_risks++;
 }
 
-/* Check for division by zero */
-void check_division_by_zero(ASTNode* node, SecurityCheckResults* results) {
-    if (!node) return;
+/* Check for integer overflow/underflow */
+void check_integer_overflow(TACCode* code, SecurityCheckResults* results) {
+    check_code(code, NULL, results, check_arithmetic);
+}
 
-    /* Check division and modulo operations */
-    if (node->type == NODE_BINARY_OP) {
-        const char* op = node->data.binary_op.operator;
-
-        if (strcmp(op, "/") == 0 || strcmp(op, "%") == 0) {
-            int divisor;
-            if (is_constant_node(node->data.binary_op.right, &divisor)) {
-                if (divisor == 0) {
-                    diag_error(node->line_number, 0,
-                        "Division by zero detected");
-                    results->division_by_zero_risks++;
-                }
-            } else {
-                /* Non-constant divisor - potential risk */
-                debug_print("Division by non-constant value - potential division by zero");
-            }
-        }
+/* Helper: Check the divisor of a division or modulo */
+static void check_divisor(RangeAnalysis* ranges, int index, TACInstruction* inst,
+                          TACCode* code, SymbolTable* symtab,
+                          SecurityCheckResults* results) {
+    (void)code;
+    (void)symtab;
+
+    if (inst->opcode != TAC_DIV && inst->opcode != TAC_MOD) return;
+
+    Interval divisor = range_before(ranges, index, inst->op2);
+    char range_str[64];
+
+    if (divisor.lo == 0 && divisor.hi == 0) {
+        diag_error(inst->line, 0, "Division by zero detected");
+        results->division_by_zero_risks++;
+    } else if (!range_contains(divisor, 0)) {
+        results->safe_divisions++;
+    } else if (range_is_bounded(divisor)) {
+        diag_security_warning(inst->line, 0,
+            "Divisor %s may be zero (range %s)",
+            inst->op2, range_to_string(divisor, range_str, sizeof(range_str)));
+        results->division_by_zero_risks++;
+    } else {
+        /* Unknown divisor - potential risk */
+        debug_print("Division by unbounded value - potential division by zero");
     }
+}
 
-    /* Recursively check children */
-    switch (node->type) {
-        case NODE_PROGRAM:
-            check_division_by_zero(node->data.program.statements, results);
-            break;
-        case NODE_STATEMENT_LIST:
-            check_division_by_zero(node->data.stmt_list.statement, results);
-            check_division_by_zero(node->data.stmt_list.next, results);
-            break;
-        case NODE_BINARY_OP:
-            check_division_by_zero(node->data.binary_op.left, results);
-            check_division_by_zero(node->data.binary_op.right, results);
-            break;
-        default:
-            break;
-    }
+/* Check for division by zero */
+void check_division_by_zero(TACCode* code, SecurityCheckResults* results) {
+    check_code(code, NULL, results, check_divisor);
 }
 
 /* Check for unsafe array accesses */
-void check_unsafe_array_access(ASTNode* node, SymbolTable* symtab, SecurityCheckResults* results) {
+void check_unsafe_array_access(TACCode* code, SymbolTable* symtab, SecurityCheckResults* results) {
     /* This is handled by check_buffer_overflow */
-    check_buffer_overflow(node, symtab, results);
+    check_buffer_overflow(code, symtab, results);
 }
 
 /* Check for potential infinite loops */
@@ -279,16 +276,18 @@ void check_uninitialized_use(ASTNode* node, SymbolTable* symtab, SecurityCheckRe
 }
 
 /* Main security analysis function */
-SecurityCheckResults* analyze_security(ASTNode* root, SymbolTable* symtab) {
+SecurityCheckResults* analyze_security(ASTNode* root, SymbolTable* symtab, TACCode* code) {
     SecurityCheckResults* results = (SecurityCheckResults*)safe_calloc(1,
         sizeof(SecurityCheckResults), "security results");
 
     debug_print("Starting security analysis...");
 
-    /* Perform all security checks */
-    check_buffer_overflow(root, symtab, results);
-    check_integer_overflow(root, results);
-    check_division_by_zero(root, results);
+    /* Perform all security checks (the ranges are computed once per function) */
+    enable_analysis_cache(1);
+    check_buffer_overflow(code, symtab, results);
+    check_integer_overflow(code, results);
+    check_division_by_zero(code, results);
+    enable_analysis_cache(0);
     check_infinite_loops(root, results);
 
     /* Calculate total */
@@ -318,6 +317,9 @@ void print_security_report(SecurityCheckResults* results) {
     printf("======================================================\n");
     printf("|| Total Security Issues:      %-4d               ||\n", results->total_security_issues);
     printf("======================================================\n");
+    printf("|| Safe Array Accesses:        %-4d               ||\n", results->safe_array_accesses);
+    printf("|| Safe Divisions:             %-4d               ||\n", results->safe_divisions);
+    printf("======================================================\n");
 
     if (results->total_security_issues == 0) {
         printf("\n[OK] No security issues detected!\n");
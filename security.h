@@ -4,6 +4,8 @@
  *
  * This module detects potentially unsafe constructs and security issues
  * in the source code, helping prevent common programming vulnerabilities.
+ * Array, overflow and division checks use the value ranges of range.h on
+ * the TAC, and also count the accesses and divisions proven safe.
  */
 
 #ifndef SECURITY_H
@@ -11,6 +13,7 @@
 
 #include "ast.h"
 #include "symtable.h"
+#include "ircode.h"
 
 /* Security check results */
 typedef struct {
@@ -21,24 +24,27 @@ typedef struct {
     int array_access_risks;         /* Unsafe array accesses */
     int infinite_loop_risks;        /* Potential infinite loops */
     int total_security_issues;      /* Total issues found */
+    int safe_array_accesses;        /* Array accesses proven within bounds */
+    int safe_divisions;             /* Divisions proven to have a non-zero divisor */
 } SecurityCheckResults;
 
 /* SECURITY CHECK FUNCTIONS */
 
-/* Perform comprehensive security analysis on AST */
-SecurityCheckResults* analyze_security(ASTNode* root, SymbolTable* symtab);
+/* Perform comprehensive security analysis on the AST and its
+ * unoptimized TAC */
+SecurityCheckResults* analyze_security(ASTNode* root, SymbolTable* symtab, TACCode* code);
 
-/* Check for buffer overflow vulnerabilities */
-void check_buffer_overflow(ASTNode* node, SymbolTable* symtab, SecurityCheckResults* results);
+/* Check for buffer overflow vulnerabilities (index ranges vs. array sizes) */
+void check_buffer_overflow(TACCode* code, SymbolTable* symtab, SecurityCheckResults* results);
 
-/* Check for integer overflow/underflow */
-void check_integer_overflow(ASTNode* node, SecurityCheckResults* results);
+/* Check for integer overflow/underflow (operand ranges of + - *) */
+void check_integer_overflow(TACCode* code, SecurityCheckResults* results);
 
-/* Check for division by zero */
-void check_division_by_zero(ASTNode* node, SecurityCheckResults* results);
+/* Check for division by zero (divisor ranges of / and %) */
+void check_division_by_zero(TACCode* code, SecurityCheckResults* results);
 
 /* Check for unsafe array accesses */
-void check_unsafe_array_access(ASTNode* node, SymbolTable* symtab, SecurityCheckResults* results);
+void check_unsafe_array_access(TACCode* code, SymbolTable* symtab, SecurityCheckResults* results);
 
 /* Check for potential infinite loops */
 void check_infinite_loops(ASTNode* node, SecurityCheckResults* results);
@@ -53,6 +53,24 @@ int check_initialized(const char* var_name, SymbolTable* symtab, int line) {
     return 1;
 }
 
+/* Add a variable (array_size 0) or array declared inside the current
+ * function to the function's scope. A local may shadow a global. */
+static void declare_local(const char* var_name, int array_size, SymbolTable* symtab, int line) {
+    if (!add_symbol_with_scope(symtab, var_name, TYPE_INT, line, current_function_scope)) {
+        char error_msg[100];
+        snprintf(error_msg, sizeof(error_msg),
+                 "Variable '%s' already declared in '%s'", var_name, current_function_scope);
+        semantic_error(error_msg, line);
+        return;
+    }
+    if (array_size > 0) {
+        Symbol* symbol = lookup_symbol_in_scope(symtab, var_name, current_function_scope);
+        symbol->is_array = 1;
+        symbol->array_size = array_size;
+        symbol->is_initialized = 1;  /* Arrays are considered initialized upon declaration */
+    }
+}
+
 /* Analyze an expression and return its type */
 DataType analyze_expression(ASTNode* node, SymbolTable* symtab) {
     if (!node) return TYPE_UNKNOWN;
@@ -75,7 +93,7 @@ DataType analyze_expression(ASTNode* node, SymbolTable* symtab) {
             }
 
             /* Return the variable's type from symbol table */
-            Symbol* symbol = lookup_symbol(symtab, var_name);
+            Symbol* symbol = lookup_symbol_in_scope(symtab, var_name, current_function_scope);
             return symbol ? symbol->type : TYPE_UNKNOWN;
         }
 
@@ -111,7 +129,7 @@ DataType analyze_expression(ASTNode* node, SymbolTable* symtab) {
             const char* array_name = node->data.array_access.array_name;
 
             /* Check if array is declared */
-            Symbol* symbol = lookup_symbol(symtab, array_name);
+            Symbol* symbol = lookup_symbol_in_scope(symtab, array_name, current_function_scope);
             if (!symbol) {
                 char error_msg[100];
                 snprintf(error_msg, sizeof(error_msg),
@@ -237,13 +255,28 @@ void analyze_statement(ASTNode* node, SymbolTable* symtab) {
 
     switch (node->type) {
         case NODE_DECLARATION: {
-            /* Declaration is already handled in the parser
-             * (added to symbol table during parsing) */
+            /* Global declarations are already handled in the parser
+             * (added to symbol table during parsing); locals are added to
+             * the scope of their function here */
+            if (strcmp(current_function_scope, "global") != 0) {
+                declare_local(node->data.str_value, 0, symtab, node->line_number);
+            }
             printf("[SEMANTIC] Declaration verified: int %s\n",
                    node->data.str_value);
             break;
         }
 
+        case NODE_ARRAY_DECLARATION: {
+            /* Local arrays live in the frame of their function */
+            if (strcmp(current_function_scope, "global") != 0) {
+                declare_local(node->data.array_decl.var_name, node->data.array_decl.size,
+                              symtab, node->line_number);
+            }
+            printf("[SEMANTIC] Array declaration verified: int %s[%d]\n",
+                   node->data.array_decl.var_name, node->data.array_decl.size);
+            break;
+        }
+
         case NODE_ASSIGNMENT: {
             /* Assignment: variable = expression */
             const char* var_name = node->data.assignment.var_name;
@@ -253,11 +286,27 @@ void analyze_statement(ASTNode* node, SymbolTable* symtab) {
                 break;
             }
 
+            /* Array element assignment: the target must be an array and
+             * the index an integer expression */
+            if (node->data.assignment.index) {
+                Symbol* array_sym = lookup_symbol_in_scope(symtab, var_name, current_function_scope);
+                if (array_sym && !array_sym->is_array) {
+                    char error_msg[100];
+                    snprintf(error_msg, sizeof(error_msg),
+                             "'%s' is not an array", var_name);
+                    semantic_error(error_msg, node->line_number);
+                }
+                DataType index_type = analyze_expression(node->data.assignment.index, symtab);
+                if (index_type != TYPE_INT && index_type != TYPE_UNKNOWN) {
+                    semantic_error("Array index must be an integer", node->line_number);
+                }
+            }
+
             /* Analyze the expression on the right side */
             DataType expr_type = analyze_expression(node->data.assignment.expr, symtab);
 
             /* Check type compatibility */
-            Symbol* symbol = lookup_symbol(symtab, var_name);
+            Symbol* symbol = lookup_symbol_in_scope(symtab, var_name, current_function_scope);
             if (symbol && expr_type != TYPE_UNKNOWN && symbol->type != expr_type) {
                 semantic_error("Type mismatch in assignment", node->line_number);
             }
@@ -0,0 +1,108 @@
+/*
+ * STRENGTH.C - Strength Reduction Helpers Implementation
+ * CST-405 Compiler Project
+ *
+ * This file implements the constant analysis behind the multiply, divide
+ * and modulo sequences of the code generators. Words of 32 bits (MIPS)
+ * are computed in 64-bit variables and masked after every step.
+ */
+
+#include "strength.h"
+
+/* Helper: Keep the low 'bits' bits of a value */
+static unsigned long long word(unsigned long long value, int bits) {
+    return bits >= 64 ? value : value & ((1ULL << bits) - 1);
+}
+
+/* Helper: Magnitude of a value that fits in a signed word (0 if it is the minimum) */
+static unsigned long long magnitude(long long value, int bits) {
+    unsigned long long limit = 1ULL << (bits - 1);
+    unsigned long long mag = value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+    return mag >= limit ? 0 : mag;
+}
+
+/* Helper: Return k if value == 2^k, otherwise -1 */
+static int exact_log2(unsigned long long value) {
+    if (value == 0 || (value & (value - 1)) != 0) return -1;
+    int k = 0;
+    while ((value >> k) != 1) k++;
+    return k;
+}
+
+/* Return k if |value| == 2^k for some k >= 1, otherwise -1 */
+int power_of_two_shift(long long value, int bits) {
+    int k = exact_log2(magnitude(value, bits));
+    return k >= 1 ? k : -1;
+}
+
+/* Choose a shift/add sequence for multiplying by c */
+MulPlan plan_multiply(long long c, int bits) {
+    MulPlan plan = { MUL_BY_MULTIPLY, 0, c < 0 };
+    unsigned long long mag = magnitude(c, bits);
+    int k;
+
+    if (c == 0) {
+        plan.kind = MUL_BY_ZERO;
+        plan.negate = 0;
+    } else if (mag == 0) {
+        plan.negate = 0;                         /* Minimum value: just multiply */
+    } else if ((k = exact_log2(mag)) >= 0) {
+        plan.kind = MUL_BY_SHIFT;
+        plan.shift = k;
+    } else if ((k = exact_log2(mag - 1)) >= 1) {
+        plan.kind = MUL_BY_SHIFT_ADD;
+        plan.shift = k;
+    } else if ((k = exact_log2(mag + 1)) >= 1) {
+        plan.kind = MUL_BY_SHIFT_SUB;
+        plan.shift = k;
+    } else {
+        plan.negate = 0;
+    }
+    return plan;
+}
+
+/* Compute the magic number for signed division by d (Hacker's Delight,
+ * figure 10-1): the smallest p with 2^p > anc * (d - 2^p mod d), where
+ * anc is the largest dividend with n mod d == d - 1 */
+int plan_divide(long long d, int bits, DivPlan* plan) {
+    unsigned long long ad = magnitude(d, bits);
+    if (ad < 2 || exact_log2(ad) >= 0) return 0;
+
+    const unsigned long long two = 1ULL << (bits - 1);
+    unsigned long long t = two + (d < 0 ? 1 : 0);
+    unsigned long long anc = t - 1 - t % ad;     /* Absolute value of nc */
+    unsigned long long q1 = two / anc;           /* q1 = 2^p / |nc| */
+    unsigned long long r1 = two - q1 * anc;      /* r1 = rem(2^p, |nc|) */
+    unsigned long long q2 = two / ad;            /* q2 = 2^p / |d| */
+    unsigned long long r2 = two - q2 * ad;       /* r2 = rem(2^p, |d|) */
+    unsigned long long delta;
+    int p = bits - 1;
+
+    do {
+        p++;
+        q1 = word(2 * q1, bits);
+        r1 = word(2 * r1, bits);
+        if (r1 >= anc) {
+            q1 = word(q1 + 1, bits);
+            r1 = word(r1 - anc, bits);
+        }
+        q2 = word(2 * q2, bits);
+        r2 = word(2 * r2, bits);
+        if (r2 >= ad) {
+            q2 = word(q2 + 1, bits);
+            r2 = word(r2 - ad, bits);
+        }
+        delta = ad - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+
+    /* Magic number as a signed word of the target width */
+    unsigned long long magic = word(q2 + 1, bits);
+    if (d < 0) magic = word(0ULL - magic, bits);
+    if (bits < 64 && (magic & two)) magic |= ~((1ULL << bits) - 1);
+
+    plan->magic = (long long)magic;
+    plan->shift = p - bits;
+    plan->add_dividend = d > 0 && plan->magic < 0;
+    plan->sub_dividend = d < 0 && plan->magic > 0;
+    return 1;
+}
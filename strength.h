@@ -0,0 +1,55 @@
+/*
+ * STRENGTH.H - Strength Reduction Helpers Header
+ * CST-405 Compiler Project
+ *
+ * This file defines the arithmetic the code generators use to replace
+ * multiplication, division and modulo by a constant with cheaper
+ * instruction sequences:
+ * - Multiplication by shifts, adds and subtracts
+ * - Signed division/modulo by a power of two by shifts with a rounding
+ *   correction for negative dividends
+ * - Signed division/modulo by any other constant by a multiply-high with
+ *   a "magic number" (Hacker's Delight, chapter 10)
+ *
+ * All sequences round toward zero, like the idiv/div instructions.
+ */
+
+#ifndef STRENGTH_H
+#define STRENGTH_H
+
+/* How to multiply by a constant c */
+typedef enum {
+    MUL_BY_ZERO,         /* Result is 0 */
+    MUL_BY_SHIFT,        /* x << shift */
+    MUL_BY_SHIFT_ADD,    /* (x << shift) + x */
+    MUL_BY_SHIFT_SUB,    /* (x << shift) - x */
+    MUL_BY_MULTIPLY      /* No cheap sequence: multiply instruction */
+} MulKind;
+
+typedef struct {
+    MulKind kind;
+    int shift;           /* Shift amount for the shift kinds */
+    int negate;          /* Negate the result (c < 0) */
+} MulPlan;
+
+/* Signed division by a constant d (|d| >= 2, not a power of two):
+ *   q = mulhi(magic, n); q += n if add_dividend; q -= n if sub_dividend;
+ *   q >>= shift (arithmetic); q += (q < 0)  */
+typedef struct {
+    long long magic;     /* Multiplier (a signed word of the target width) */
+    int shift;           /* Arithmetic shift after the multiply-high */
+    int add_dividend;    /* Add n after the multiply-high (d > 0, magic < 0) */
+    int sub_dividend;    /* Subtract n after the multiply-high (d < 0, magic > 0) */
+} DivPlan;
+
+/* Return k if |value| == 2^k for some k >= 1, otherwise -1 */
+int power_of_two_shift(long long value, int bits);
+
+/* Choose a shift/add sequence for multiplying a word of 'bits' bits by c */
+MulPlan plan_multiply(long long c, int bits);
+
+/* Compute the magic number for signed division of a word of 'bits' bits
+ * (32 or 64) by d. Returns 0 if d is 0, +-1, a power of two or out of range. */
+int plan_divide(long long d, int bits, DivPlan* plan);
+
+#endif /* STRENGTH_H */
@@ -0,0 +1,62 @@
+// Test program for array addressing modes
+// Tests elements addressed as base + index*8 + displacement: constant
+// indexes, neighbours a[i - 1] and a[i + 1], elements used directly as
+// operands, and local arrays in leaf and non-leaf functions
+
+int grid[8];
+int total;
+
+// Local array in a leaf function (addressed from the stack pointer)
+int window(int k) {
+    int w[6];
+    int i;
+    for (i = 0; i < 6; i = i + 1;) {
+        w[i] = i * k;
+    }
+    return w[0] + w[2] + w[5];
+}
+
+// Local array in a function that calls (addressed from the frame pointer)
+int smooth(int k) {
+    int s[5];
+    int i;
+    int sum;
+    for (i = 0; i < 5; i = i + 1;) {
+        s[i] = window(i) + k;
+    }
+    sum = 0;
+    for (i = 1; i < 4; i = i + 1;) {
+        sum = sum + s[i - 1] + s[i] + s[i + 1];
+    }
+    return sum;
+}
+
+int main() {
+    int i;
+    grid[0] = 3;
+    grid[7] = 4;
+    for (i = 1; i < 7; i = i + 1;) {
+        grid[i] = i * i;
+    }
+    print(grid[0] + grid[7]);           // Should print 7
+
+    // Neighbours and elements as operands
+    total = 0;
+    for (i = 1; i < 7; i = i + 1;) {
+        total = total + grid[i + 1] - grid[i - 1];
+        if (grid[i] > 10) {
+            total = total + 100;
+        }
+    }
+    print(total);                       // Should print 336
+
+    // Element copied between arrays and updated through its index
+    for (i = 0; i < 7; i = i + 1;) {
+        grid[i] = grid[i + 1] * 2;
+    }
+    print(grid[0]);                     // Should print 2
+    print(grid[6]);                     // Should print 8
+    print(window(3));                   // Should print 21
+    print(smooth(1));                   // Should print 135
+    return 0;
+}
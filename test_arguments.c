@@ -0,0 +1,44 @@
+// Test program for argument passing
+// Tests functions with more than six parameters, calls nested in
+// arguments, arguments that swap places, and a global changed by a
+// nested call after it was passed
+
+int counter;
+
+// Seven and eight parameters: the last ones travel on the stack
+int weigh7(int a, int b, int c, int d, int e, int f, int g) {
+    return a + b * 2 + c * 3 + d * 4 + e * 5 + f * 6 + g * 7;
+}
+
+int weigh8(int a, int b, int c, int d, int e, int f, int g, int h) {
+    return weigh7(a, b, c, d, e, f, g) * 10 + h;
+}
+
+// The arguments rotate on every call
+int rotate(int a, int b, int c, int n) {
+    if (n == 0) {
+        return a * 100 + b * 10 + c;
+    }
+    return rotate(b, c, a, n - 1);
+}
+
+int diff(int a, int b) {
+    return a - b;
+}
+
+// Changes the global after the caller has passed it
+int reset(int value) {
+    counter = value;
+    return value;
+}
+
+int main() {
+    counter = 1;
+    print(weigh7(1, 1, 1, 1, 1, 1, 1));          // Should print 28
+    print(weigh8(1, 2, 3, 4, 5, 6, 7, 8));       // Should print 1408
+    print(rotate(1, 2, 3, 4));                   // Should print 231
+    print(diff(diff(9, 4), diff(3, 1)));         // Should print 3
+    print(diff(counter, reset(6)));              // Should print -5
+    print(weigh7(counter, reset(10), 0, 0, 0, 0, diff(counter, 1)));  // Should print 89
+    return 0;
+}
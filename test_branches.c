@@ -0,0 +1,93 @@
+// Test program for compare-and-branch
+// Tests every relational operator as a loop and if condition, against a
+// variable, a constant, zero and an array element
+
+int limits[4];
+
+// Count how many of the six relations hold for (a, b)
+int relations(int a, int b) {
+    int count;
+    count = 0;
+    if (a < b) {
+        count = count + 1;
+    }
+    if (a <= b) {
+        count = count + 10;
+    }
+    if (a > b) {
+        count = count + 100;
+    }
+    if (a >= b) {
+        count = count + 1000;
+    }
+    if (a == b) {
+        count = count + 10000;
+    }
+    if (a != b) {
+        count = count + 100000;
+    }
+    return count;
+}
+
+// The same relations against zero
+int signs(int a) {
+    int count;
+    count = 0;
+    if (a < 0) {
+        count = count + 1;
+    }
+    if (a <= 0) {
+        count = count + 10;
+    }
+    if (a > 0) {
+        count = count + 100;
+    }
+    if (a >= 0) {
+        count = count + 1000;
+    }
+    return count;
+}
+
+int main() {
+    int i;
+    int n;
+    int steps;
+    print(relations(1, 2));             // Should print 100011
+    print(relations(2, 2));             // Should print 11010
+    print(relations(3, 2));             // Should print 101100
+    print(signs(0 - 4));                // Should print 11
+    print(signs(0));                    // Should print 1010
+    print(signs(4));                    // Should print 1100
+
+    // Loops counting up and down with each bound form
+    n = 7;
+    steps = 0;
+    i = 0;
+    while (i < n) {
+        steps = steps + 1;
+        i = i + 1;
+    }
+    while (i >= 2) {
+        steps = steps + 10;
+        i = i - 2;
+    }
+    while (i != 5) {
+        steps = steps + 100;
+        i = i + 1;
+    }
+    print(steps);                       // Should print 437
+
+    // Element compared against a constant
+    limits[0] = 4;
+    limits[1] = 9;
+    limits[2] = 2;
+    limits[3] = 12;
+    steps = 0;
+    for (i = 0; i < 4; i = i + 1;) {
+        if (limits[i] > 5) {
+            steps = steps + limits[i];
+        }
+    }
+    print(steps);                       // Should print 21
+    return 0;
+}
@@ -0,0 +1,45 @@
+// Test program for the --checked mode
+// Compile with --checked: every access below is in bounds, so the program
+// prints the same values as without it
+
+int data[16];
+int i;
+int n;
+int d;
+int sum;
+
+int fill(int count) {
+    // count is unknown: one check of count before the loop covers it
+    for (i = 0; i < count; i = i + 1;) {
+        data[i] = i * 3;
+    }
+    return count;
+}
+
+int average(int total, int parts) {
+    // parts may be zero: the division keeps its check
+    return total / parts;
+}
+
+int main() {
+    // Constant bound: proven in bounds, no check emitted
+    for (i = 0; i < 16; i = i + 1;) {
+        data[i] = 0;
+    }
+
+    n = fill(12);
+    print(n);  // Should print 12
+
+    // Loop-invariant divisor: checked once before the loop
+    d = n / 4;
+    sum = 0;
+    for (i = 0; i <= 11; i = i + 1;) {
+        sum = sum + data[i] / d;
+    }
+    print(sum);  // Should print 66
+
+    n = average(sum, 6);
+    print(n);  // Should print 11
+
+    return 0;
+}
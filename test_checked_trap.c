@@ -0,0 +1,26 @@
+// Test program for the --checked mode: a loop that leaves its array
+// Compile with --checked at -O0 and at -O2: both print the elements the
+// loop reaches in bounds, then trap at the first index past the end
+// (the check of the loop cannot move before the loop, or the prints
+// of the passing trips would be lost)
+
+int a[5];
+
+int show(int count) {
+    int i;
+    // count is unknown here: the loop runs past the end of a
+    for (i = 0; i < count; i = i + 1;) {
+        print(a[i]);  // Should print 0 1 2 3 4, then trap: index out of bounds at line 13
+    }
+    return count;
+}
+
+int main() {
+    int i;
+    for (i = 0; i < 5; i = i + 1;) {
+        a[i] = i;
+    }
+    i = show(10);
+    print(99);        // Not reached
+    return 0;
+}
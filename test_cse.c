@@ -0,0 +1,73 @@
+// Test program for common subexpression elimination
+// Tests value numbering across blocks, commutative operands, and array loads
+
+int data[4];
+int a;
+int b;
+int x;
+int y;
+int z;
+int i;
+
+int bump(int n) {
+    a = n + 1;
+    return a;
+}
+
+int reset_b() {
+    b = 9;
+    return 1;
+}
+
+int main() {
+    a = 6;
+    b = 7;
+
+    // Same product with operands swapped
+    x = a * b;
+    y = b * a;
+    print(x + y);  // Should print 84
+
+    // Expression available in both branches from the dominating block
+    z = a + b;
+    if (a < b) {
+        x = a + b;
+    } else {
+        x = b + a;
+    }
+    print(x + z);  // Should print 26
+
+    // Array load reused until the element is stored
+    data[1] = 5;
+    i = 1;
+    x = data[i];
+    y = data[i];
+    print(x + y);  // Should print 10
+    data[i] = 9;
+    y = data[i];
+    print(x + y);  // Should print 14
+
+    // A call may change globals, so a + b is recomputed
+    x = a + b;
+    y = bump(a);
+    z = a + b;
+    print(z - x);  // Should print 1
+
+    // A call may also overwrite a global just assigned from a temporary
+    b = 5 - reset_b();
+    x = reset_b() + b;
+    print(x);      // Should print 10
+    b = 7;
+
+    // Loop variable changes every iteration
+    x = 0;
+    i = 0;
+    while (i < 3) {
+        x = x + i * 2;
+        y = i * 2;
+        i = i + 1;
+    }
+    print(x + y);  // Should print 10
+
+    return 0;
+}
@@ -0,0 +1,52 @@
+// Test program for immediate operands
+// Tests literals used directly by instructions: updates in place,
+// constants on either side of an operator, compares against constants,
+// and values too wide for a short immediate field
+int counts[3];
+
+// Literal on the left of each operator
+int left(int x) {
+    return (10 - x) + (3 * x) + (7 + x);
+}
+
+// Constants wider than 16 bits
+int wide(int x) {
+    int big;
+    big = 123456;
+    if (x < 70000) {
+        big = big + 70000;
+    }
+    if (x > 65536) {
+        big = big - 65536;
+    }
+    return big + x;
+}
+
+int main() {
+    int i;
+    int n;
+    n = 0;
+    for (i = 0; i < 10; i = i + 1;) {
+        n = n + 3;
+        n = n - 1;
+    }
+    print(n);                           // Should print 20
+    print(left(4));                     // Should print 29
+    print(wide(5));                     // Should print 193461
+    print(wide(100000));                // Should print 157920
+    print(wide(65536));                 // Should print 258992
+    print(0 - 2147483647);              // Should print -2147483647
+    counts[0] = 0;
+    counts[1] = 0;
+    counts[2] = 0;
+    for (i = 0; i < 90000; i = i + 1;) {
+        if (i >= 32768) {
+            counts[2] = counts[2] + 1;
+        } else {
+            counts[i - (i / 2) * 2] = counts[i - (i / 2) * 2] + 1;
+        }
+    }
+    print(counts[0] + counts[1]);       // Should print 32768
+    print(counts[2]);                   // Should print 57232
+    return 0;
+}
@@ -0,0 +1,87 @@
+// Test program for function inlining
+// Tests inlining of small helpers, nested calls, recursive functions that stay calls,
+// and helpers using a global the caller shadows with a local
+
+int total;
+
+int square(int x) {
+    return x * x;
+}
+
+int sum_squares(int a, int b) {
+    return square(a) + square(b);
+}
+
+// Two returns: both store the result and leave the copy
+int clamp(int v, int hi) {
+    if (v > hi) {
+        return hi;
+    }
+    return v;
+}
+
+// Parameter reassigned inside the body
+int countdown(int n) {
+    int steps;
+    steps = 0;
+    while (n > 0) {
+        n = n - 3;
+        steps = steps + 1;
+    }
+    return steps;
+}
+
+int accumulate(int sum, int amount) {
+    return sum + amount;
+}
+
+// Recursive: never inlined
+int fib(int n) {
+    if (n < 2) {
+        return n;
+    }
+    return fib(n - 1) + fib(n - 2);
+}
+
+// Use the global 'level'; main has a local of that name
+int level;
+
+int set_level(int a) {
+    level = a;
+    return level;
+}
+
+int above_level(int a) {
+    return a + level;
+}
+
+int k;
+
+int main() {
+    int level;
+    int r;
+
+    print(square(7));              // Should print 49
+    print(sum_squares(3, 4));      // Should print 25
+    print(clamp(square(5), 20));   // Should print 20
+    print(clamp(3, 20));           // Should print 3
+    print(countdown(10));          // Should print 4
+
+    // Call inside a loop
+    total = 0;
+    for (k = 1; k <= 5; k = k + 1;) {
+        total = accumulate(total, square(k));
+    }
+    print(total);                  // Should print 55
+
+    print(fib(10));                // Should print 55
+
+    // The copies must keep using the global, not main's local
+    r = set_level(50);
+    level = 100;
+    print(above_level(1));         // Should print 51
+    r = set_level(7);
+    print(level);                  // Should print 100
+    print(above_level(0));         // Should print 7
+    return 0;
+}
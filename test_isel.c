@@ -0,0 +1,71 @@
+// Test program for instruction selection
+// Tests expression trees covered by address arithmetic (base + index *
+// scale + displacement), immediates, multiplies by 3, 5, 9 and powers of
+// two, updates in place, compares against zero and constants on the
+// left, and deep expressions
+
+int total;
+
+// base + index * 8 + 5 and friends: lea patterns
+int address(int base, int index) {
+    return base + index * 8 + 5;
+}
+
+// x * 9, x * 5 - 7, x * 16, x * 12: lea, shifts and imul with immediates
+int scale(int x) {
+    int a;
+    int b;
+    a = x * 9 + x * 5 - 7;
+    b = x * 16 - x * 12;
+    return a - b;
+}
+
+// Constants on the left of a subtraction and a compare
+int left(int x) {
+    int d;
+    d = 100 - x;
+    if (3 < x) {
+        d = d + 1000;
+    }
+    return 0 - d;
+}
+
+// Compares against zero
+int flags(int x) {
+    int count;
+    count = 0;
+    if (x == 0) {
+        count = count + 1;
+    }
+    if (x != 0) {
+        count = count + 10;
+    }
+    if (x < 0) {
+        count = count + 100;
+    }
+    return count;
+}
+
+// Deep expression: more operands than scratch registers at once
+int deep(int a, int b, int c, int d) {
+    return (a + b) * (c + d) - (a - b) * (c - d) + (a * b - c * d) * (a + d);
+}
+
+int main() {
+    int i;
+    total = 0;
+    for (i = 0; i < 10; i = i + 1;) {
+        total = total + address(i, i + 1);
+    }
+    print(total);                       // Should print 535
+    print(scale(3));                    // Should print 23
+    print(left(2));                     // Should print -98
+    print(left(4));                     // Should print -1096
+    print(flags(0));                    // Should print 1
+    print(flags(5));                    // Should print 10
+    print(flags(0 - 5));                // Should print 110
+    print(deep(1, 2, 3, 4));            // Should print -30
+    total = total + total;
+    print(total);                       // Should print 1070
+    return 0;
+}
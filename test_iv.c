@@ -0,0 +1,58 @@
+// Test program for induction-variable strength reduction
+// Tests array sweeps whose index scaling becomes a running byte offset
+
+int a[10];
+int b[10];
+int i;
+int j;
+int n;
+int sum;
+
+int main() {
+    n = 10;
+
+    // Fill both arrays: the index is only used for addressing
+    for (i = 0; i < n; i = i + 1;) {
+        a[i] = i * 3;
+        b[i] = 1;
+    }
+
+    // Neighbouring elements: a[i - 1] and a[i + 1] get their own offsets
+    sum = 0;
+    i = 1;
+    while (i < 9) {
+        sum = sum + a[i - 1] + a[i + 1];
+        i = i + 1;
+    }
+    print(sum);  // Should print 216
+
+    // Counting down by two; i is still needed after the loop
+    sum = 0;
+    i = 9;
+    while (i >= 0) {
+        sum = sum + a[i];
+        i = i - 2;
+    }
+    print(sum);  // Should print 75
+    print(i);    // Should print -1
+
+    // do-while: the exit test reads the incremented value
+    sum = 0;
+    j = 0;
+    do {
+        sum = sum + b[j];
+        j = j + 1;
+    } while (j < 7);
+    print(sum);  // Should print 7
+
+    // Nested loops: the inner sweep is reduced, the outer counter is not
+    sum = 0;
+    for (i = 0; i < 3; i = i + 1;) {
+        for (j = 0; j < 10; j = j + 1;) {
+            sum = sum + a[j] * i;
+        }
+    }
+    print(sum);  // Should print 405
+
+    return 0;
+}
@@ -0,0 +1,52 @@
+// Test program for loop-invariant code motion
+// Tests hoisting invariant expressions out of while, for, and do-while loops
+
+int a[10];
+int n;
+int k;
+int i;
+int j;
+int sum;
+
+int main() {
+    n = 3;
+    k = 2;
+
+    // Fill the array: n * 2 does not change inside the loop
+    i = 0;
+    while (i < 10) {
+        a[i] = i + n * 2;
+        i = i + 1;
+    }
+
+    // a[k] and n * 4 are invariant in the inner loop
+    sum = 0;
+    for (i = 0; i < 3; i = i + 1;) {
+        for (j = 0; j < 4; j = j + 1;) {
+            sum = sum + a[k] + n * 4;
+        }
+    }
+    print(sum);  // Should print 240 (12 * (8 + 12))
+
+    // Loop inside a branch gets its own preheader
+    if (sum > 100) {
+        i = 0;
+        do {
+            sum = sum - k * 10;
+            i = i + 1;
+        } while (i < 5);
+    }
+    print(sum);  // Should print 140
+
+    // A store to the array inside the loop keeps a[k] in the loop
+    sum = 0;
+    i = 0;
+    while (i < 3) {
+        sum = sum + a[k];
+        a[k] = a[k] + 1;
+        i = i + 1;
+    }
+    print(sum);  // Should print 27 (8 + 9 + 10)
+
+    return 0;
+}
@@ -0,0 +1,47 @@
+// Test program for object file output (--obj)
+// Tests the encodings the assembler used to choose: jumps over more
+// code than a short jump reaches, globals past a short displacement,
+// many locals (frame slots far from rbp), and calls between functions
+int table[100];
+int last;
+
+int twice(int x) {
+    return x * 2 + 1;
+}
+
+// Enough locals that, kept in memory, some slots need a 32-bit displacement
+int spread(int a, int b) {
+    int c; int d; int e; int f; int g; int h; int i; int j;
+    int k; int l; int m; int n; int o; int p; int q; int r;
+    c = a + b; d = c + a; e = d + b; f = e + c; g = f + d; h = g + e;
+    i = h + f; j = i + g; k = j + h; l = k + i; m = l + j; n = m + k;
+    o = n + l; p = o + m; q = p + n; r = q + o;
+    return r - q - p + o + twice(a);
+}
+
+int main() {
+    int i;
+    int sum;
+    sum = 0;
+
+    // A loop body longer than 127 bytes: the back edge needs a near jump
+    for (i = 0; i < 100; i = i + 1;) {
+        table[i] = i * 3 + 1;
+        if (table[i] > 150) {
+            sum = sum + table[i] - 150;
+        } else {
+            sum = sum + table[i];
+        }
+        if (i == 50) {
+            last = table[i] * 2 + table[i - 1] * 3 + table[i - 2] * 5;
+        }
+        if (i > 90) {
+            last = last + table[i] - table[i - 10] + table[i - 20] - table[i - 30];
+        }
+    }
+    print(sum);                         // Should print 7450
+    print(last);                        // Should print 2011
+    print(table[99]);                   // Should print 298
+    print(spread(1, 2));                // Should print 151
+    return 0;
+}
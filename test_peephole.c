@@ -0,0 +1,66 @@
+// Test program for the assembly peephole pass
+// Tests values stored and loaded back in the same block, a global stored
+// twice in a row, elements written through one index and read back
+// through another that may be the same, and values copied into a
+// register before a compare and used again after it
+
+int cells[6];
+int last;
+
+// Two stores that may hit the same element, then both read back
+int overlap(int i, int j) {
+    cells[i] = 7;
+    cells[j] = 9;
+    return cells[i] * 10 + cells[j];
+}
+
+// Only the second store to the global is visible
+int twice(int x) {
+    last = x;
+    last = x + 1;
+    return last;
+}
+
+// A copy that feeds the compares and the result
+int clamp(int x, int low, int high) {
+    int y;
+    y = x;
+    if (y < low) {
+        y = low;
+    }
+    if (y > high) {
+        y = high;
+    }
+    return y;
+}
+
+int main() {
+    int a;
+    int b;
+    int i;
+    int sum;
+    print(overlap(2, 3));               // Should print 79
+    print(overlap(4, 4));               // Should print 99
+    print(cells[2] + cells[3]);         // Should print 16
+    print(twice(5));                    // Should print 6
+    print(last);                        // Should print 6
+    print(clamp(0 - 3, 0, 10));         // Should print 0
+    print(clamp(4, 0, 10));             // Should print 4
+    print(clamp(12, 0, 10));            // Should print 10
+
+    // A chain of values in one block
+    a = 3;
+    b = a * 4;
+    a = b + a;
+    b = a - 1;
+    print(a * b);                       // Should print 210
+
+    // Each element stored and read back at once
+    sum = 0;
+    for (i = 0; i < 6; i = i + 1;) {
+        cells[i] = i * i;
+        sum = sum + cells[i];
+    }
+    print(sum);                         // Should print 55
+    return 0;
+}
@@ -0,0 +1,77 @@
+// Test program for value range analysis
+// Tests loop bounds, branch refinement, and the range-based security checks
+
+int arr[10];
+int i;
+int j;
+int n;
+int sum;
+int q;
+
+int pick(int k) {
+    // Off-by-one guard: k may be 10 or 11 (warning)
+    if (k < 12) {
+        if (k >= 0) {
+            return arr[k];
+        }
+    }
+    return 0;
+}
+
+int scale(int v) {
+    // v is unknown here, so the divisor check cannot prove anything
+    return 100 / v;
+}
+
+int main() {
+    // Loop counter stays in [0..9]: every access is proven safe
+    for (i = 0; i < 10; i = i + 1;) {
+        arr[i] = i * 2;
+    }
+
+    // Inside the loop i < 20 always holds, so the branch is removed
+    sum = 0;
+    for (i = 0; i < 10; i = i + 1;) {
+        if (i < 20) {
+            sum = sum + arr[i];
+        } else {
+            sum = 0;
+        }
+    }
+    print(sum);  // Should print 90
+
+    // The branch narrows j to [1..9] on the then side
+    j = arr[3] / 2;
+    if (j > 0) {
+        if (j < 10) {
+            q = 36 / j;
+            print(arr[j]);  // Should print 6
+        }
+    }
+    print(q);  // Should print 12
+
+    // Division by i % 4 + 1 never divides by zero
+    n = 0;
+    for (i = 0; i < 8; i = i + 1;) {
+        n = n + 12 / (i % 4 + 1);
+    }
+    print(n);  // Should print 50
+
+    // The loop exits with i == 8
+    print(i);  // Should print 8
+
+    // An inclusive loop bound is also proven safe
+    sum = 0;
+    for (j = 0; j <= 9; j = j + 1;) {
+        sum = sum + arr[j];
+    }
+    print(sum);  // Should print 90
+
+    n = pick(4);
+    print(n);  // Should print 8
+
+    n = scale(4);
+    print(n);  // Should print 25
+
+    return 0;
+}
@@ -0,0 +1,64 @@
+// Test program for stack frames
+// Tests recursion that needs its own copy of parameters, locals and
+// local arrays, locals that shadow a global, nested calls as arguments,
+// and a leaf function whose frame is too big for the red zone
+
+int depth;
+
+// Non-tail recursion: n and the first result live across the second call
+int fib(int n) {
+    int left;
+    if (n < 2) {
+        return n;
+    }
+    left = fib(n - 1);
+    return left + fib(n - 2);
+}
+
+// Each activation fills its own local array before recursing
+int digits(int n) {
+    int seen[4];
+    int k;
+    for (k = 0; k < 4; k = k + 1;) {
+        seen[k] = n * 10 + k;
+    }
+    if (n > 0) {
+        k = digits(n - 1);
+    }
+    return seen[3] + k;
+}
+
+// This local shadows the global depth
+int shadow(int x) {
+    int depth;
+    depth = x * 2;
+    return depth;
+}
+
+// Same local name as shadow(), different function
+int combine(int a, int b, int c) {
+    int depth;
+    depth = a * 100 + b * 10 + c;
+    return depth;
+}
+
+// Leaf function (no calls) with a 40-element local array
+int spread(int n) {
+    int cells[40];
+    int k;
+    for (k = 0; k < 40; k = k + 1;) {
+        cells[k] = n + k;
+    }
+    return cells[0] + cells[39];
+}
+
+int main() {
+    depth = 7;
+    print(fib(15));                          // Should print 610
+    print(digits(3));                        // Should print 76
+    print(shadow(21));                       // Should print 42
+    print(depth);                            // Should print 7
+    print(combine(1, shadow(1), fib(5)));    // Should print 125
+    print(spread(5));                        // Should print 49
+    return 0;
+}
@@ -0,0 +1,56 @@
+// Test program for register allocation
+// Tests more live values than registers, values live across calls and
+// variables that only one function touches
+
+int count;
+int trace[10];
+
+// Reset the shared counter before anyone reads it
+int init() {
+    count = 0;
+    return 0;
+}
+
+// Touches the global counter: count must stay in memory
+int bump() {
+    int twice;
+    twice = count * 2;
+    count = count + 1;
+    print(twice);
+    return twice + 1;
+}
+
+int main() {
+    int a;
+    int b;
+    int c;
+    int d;
+    int e;
+    int f;
+    int h;
+    int m;
+    int n;
+    int o;
+    int p;
+    int s;
+    int u;
+
+    // Twelve values live through the whole loop: some must be spilled
+    a = 1; b = 2; c = 3; d = 4; e = 5; f = 6;
+    h = 7; m = 8; n = 9; o = 10; p = 11; s = 12;
+    count = init();
+    for (u = 0; u < 10; u = u + 1;) {
+        // Values live across bump() and print() survive the calls
+        trace[u] = bump() + a * b - c;
+        print(a + b + c + d + e + f + h + m + n + o + p + s + u);
+        a = a + trace[u] % 7; b = b + a; c = c + b / 3; d = d + c;
+        e = e + d - a; f = f * 2 % 1000; h = h + f;
+        m = m + h % 5; n = n + m; o = o - n; p = p + o % 11; s = s + p;
+    }
+
+    print(a);        // Should print 33
+    print(s);        // Should print -55
+    print(count);    // Should print 10
+    print(trace[9]); // Should print 3889
+    return 0;
+}
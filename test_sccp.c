@@ -0,0 +1,55 @@
+// Test program for sparse conditional constant propagation
+// Tests constants flowing through assignments, comparisons, and branches
+
+int x;
+int y;
+int z;
+int i;
+
+int set(int n) {
+    x = n;
+    return n;
+}
+
+int main() {
+    // Condition is known at compile time: the else branch is removed
+    x = 5;
+    if (x < 10) {
+        y = x * 2;
+    } else {
+        y = 0;
+    }
+    print(y);  // Should print 10
+
+    // Both branches assign the same constant
+    if (y == 10) {
+        z = 3;
+    } else {
+        z = 3;
+    }
+    print(z + y);  // Should print 13
+
+    // A loop counter is not constant inside the loop
+    i = 0;
+    z = 0;
+    while (i < 4) {
+        z = z + x;
+        i = i + 1;
+    }
+    print(z);  // Should print 20
+
+    // After the loop y is still known, so this branch is always taken
+    if (y >= 10) {
+        print(y - x);  // Should print 5
+    }
+
+    // A call may change globals
+    z = set(7);
+    if (x == 5) {
+        print(0);
+    } else {
+        print(x);  // Should print 7
+    }
+
+    return 0;
+}
@@ -0,0 +1,52 @@
+// Test program for strength reduction of multiply, divide and modulo by constants
+// Tests shift, shift-add and magic-number sequences on positive and negative operands
+
+int values[8];
+int i;
+int r;
+
+// Every result must round toward zero, like a hardware divide
+int show(int n) {
+    print(n);
+    print(n * 8);
+    print(n * 9);
+    print(n * 7);
+    print(n * 0 - 3 * n);
+    print(n * 100);
+    print(n / 2);
+    print(n / 8);
+    print(n % 8);
+    print(n / (0 - 4));
+    print(n % (0 - 4));
+    print(n / 3);
+    print(n % 3);
+    print(n / 7);
+    print(n % 7);
+    print(n / (0 - 7));
+    print(n % (0 - 7));
+    print(n / 10);
+    print(n % 10);
+    print(n / 641);
+    print(n % 641);
+    print(n / 1);
+    print(n % 1);
+    print(n / (0 - 1));
+    return 0;
+}
+
+int main() {
+    values[0] = 0;
+    values[1] = 1;
+    values[2] = 0 - 1;
+    values[3] = 7;
+    values[4] = 0 - 7;
+    values[5] = 100;
+    values[6] = 0 - 100;
+    values[7] = 0 - 123456;
+
+    // Test matrix: every operand against every constant
+    for (i = 0; i < 8; i = i + 1;) {
+        r = show(values[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,47 @@
+// Test program for tail call elimination
+// Tests self-recursive tail calls that become loops and calls that must stay calls
+
+// Euclid by subtraction: every recursive call is the last thing done
+int gcd(int a, int b) {
+    if (a == b) {
+        return a;
+    }
+    if (a > b) {
+        return gcd(a - b, b);
+    }
+    return gcd(a, b - a);
+}
+
+// Accumulator: the arguments read the parameters being reassigned
+int sum_to(int n, int acc) {
+    if (n == 0) {
+        return acc;
+    }
+    return sum_to(n - 1, acc + n);
+}
+
+// Swapping arguments: each new value must come from the old parameters
+int swap_down(int x, int y, int steps) {
+    if (steps == 0) {
+        return x * 100 + y;
+    }
+    return swap_down(y, x, steps - 1);
+}
+
+// Not a tail call: the result is used after the call returns
+int fact(int n) {
+    if (n <= 1) {
+        return 1;
+    }
+    return n * fact(n - 1);
+}
+
+int main() {
+    print(gcd(1071, 462));      // Should print 21
+    print(gcd(17, 5));          // Should print 1
+    print(sum_to(100, 0));      // Should print 5050
+    print(swap_down(1, 2, 3));  // Should print 201
+    print(swap_down(1, 2, 4));  // Should print 102
+    print(fact(6));             // Should print 720
+    return 0;
+}
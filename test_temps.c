@@ -0,0 +1,61 @@
+// Test program for temporaries
+// Tests functions using well over a hundred temporaries, temporaries
+// live across calls, and recursion, where each activation needs its own
+// temporaries
+
+int data[10];
+
+// A long chain of expressions: one temporary per operator
+int chain(int x) {
+    int a;
+    int b;
+    int c;
+    a = x + 1;
+    b = (a * 2 + x * 3 - 4) % 10007;
+    c = ((a + b) * (a - b) + (b + x) * 2) % 10007;
+    a = (c - (a + b) * 3 + (x - 1) * (x + 1)) % 10007;
+    b = ((a + c) / 2 + (a - c) / 3 - b * 2) % 10007;
+    c = (a * 3 + b * 5 - c * 7 + (a + b + c) * 2) % 10007;
+    a = ((c + 1) * (c - 1) - (b + 2) * (b - 2) + a) % 10007;
+    b = (a % 1000 + b % 100 + c % 10) % 10007;
+    c = ((a + b) - (b + c) + (c + a) - (a - b) + (b - c)) % 10007;
+    a = (c * 2 + b * 3 + a * 4 - (c + b + a)) % 10007;
+    b = ((a - 7) * 3 + (b - 5) * 2 + (c - 3) * 4) % 10007;
+    c = (a + b + c + x + (a - b) + (b - c) + (c - x)) % 10007;
+    a = ((a + 11) * 2 - (b + 13) * 3 + (c + 17) * 4) % 10007;
+    b = (a % 97 + b % 89 + c % 83 + x % 79) % 10007;
+    c = ((a + b) * 2 + (b + c) * 3 + (c + a) * 4) % 10007;
+    a = (c - b - a + (c - 1) - (b - 2) + (a - 3)) % 10007;
+    b = ((a + b + c) % 1009 + (a - b - c) % 1013) % 10007;
+    c = (a * 2 - b * 3 + c * 5 - (a + b) * 7 + (b + c) * 11) % 10007;
+    return (a + b + c) % 100000;
+}
+
+// Temporaries live across calls
+int across(int n) {
+    return (n * 3 + 1) + chain(n) * 2 + (n * 5 - 2) + chain(n + 1) - (n + 7) * chain(n - 1) % 13;
+}
+
+// Recursion: every activation keeps its own temporaries
+int depth(int n) {
+    if (n <= 0) {
+        return 1;
+    }
+    return (n * 2 + 1) * 3 + depth(n - 1) * 2 - (n + 1) * (n - 1) + depth(n - 2);
+}
+
+int main() {
+    int i;
+    int sum;
+    print(chain(1));                    // Should print 8242
+    print(chain(7));                    // Should print 2276
+    print(across(3));                   // Should print 41642
+    print(depth(6));                    // Should print 1455
+    sum = 0;
+    for (i = 0; i < 10; i = i + 1;) {
+        data[i] = chain(i) % 1000 + (i * 3 + 1) * (i - 2) - (i + 5) * 2;
+        sum = sum + data[i];
+    }
+    print(sum);                         // Should print 5791
+    return 0;
+}
@@ -0,0 +1,62 @@
+// Test program for loop unrolling
+// Tests full unrolling of constant-trip loops and partial unrolling with a remainder loop
+
+int sum_to(int n) {
+    int s;
+    int k;
+    s = 0;
+    k = 0;
+    // Bound only known at run time: unrolled with a remainder loop
+    while (k < n) {
+        s = s + k;
+        k = k + 1;
+    }
+    return s;
+}
+
+int a[8];
+int i;
+int j;
+int sum;
+int odd;
+
+int main() {
+    // Four iterations: fully unrolled, then folded to constants
+    sum = 0;
+    for (i = 0; i < 4; i = i + 1;) {
+        sum = sum + i * i;
+    }
+    print(sum);  // Should print 14
+
+    // Fully unrolled array fill
+    for (i = 0; i < 8; i = i + 1;) {
+        a[i] = i + 1;
+    }
+
+    // Branch inside the body: the copies get their own labels
+    odd = 0;
+    for (i = 0; i < 8; i = i + 1;) {
+        if (a[i] > 4) {
+            odd = odd + a[i];
+        }
+    }
+    print(odd);  // Should print 26
+
+    // Nested loops: the inner loop is unrolled
+    sum = 0;
+    for (i = 0; i < 3; i = i + 1;) {
+        for (j = 0; j < 2; j = j + 1;) {
+            sum = sum + a[i] * a[j];
+        }
+    }
+    print(sum);  // Should print 18
+
+    // Trip counts that leave 0, 1, 2 and 3 iterations for the remainder loop
+    print(sum_to(8));   // Should print 28
+    print(sum_to(9));   // Should print 36
+    print(sum_to(10));  // Should print 45
+    print(sum_to(11));  // Should print 55
+    print(sum_to(0));   // Should print 0
+
+    return 0;
+}
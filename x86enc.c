@@ -0,0 +1,727 @@
+/*
+ * X86ENC.C - x86-64 Machine Code Encoder Implementation
+ * CST-405 Compiler Project
+ *
+ * This file implements the encoder of the x86-64 back end. It reads the
+ * program in one pass into a list of code items (labels, encoded
+ * instructions, and jumps whose size depends on the layout), lays the
+ * items out until no jump grows, then writes the bytes, labels and
+ * relocations into the object. Data lines go straight into .data and
+ * .bss, whose sizes do not depend on the code.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "x86enc.h"
+#include "diagnostics.h"
+
+#define X86_MAX_LENGTH 15           /* Longest x86-64 instruction */
+
+/* Hardware numbers of the machine IR registers */
+static const int hardware[16] = { 0, 3, 1, 2, 6, 7, 5, 4, 8, 9, 10, 11, 12, 13, 14, 15 };
+
+/* Place in an instruction only the layout or the linker can fill */
+typedef enum {
+    FIX_NONE,
+    FIX_ABSOLUTE,                   /* 32-bit address of a symbol (R_X86_64_32S) */
+    FIX_RELATIVE                    /* 32-bit distance to a symbol (R_X86_64_PC32) */
+} FixKind;
+
+/* Code item */
+typedef struct {
+    int label;                      /* Label defined here (-1: an instruction) */
+    unsigned char bytes[X86_MAX_LENGTH];
+    int length;
+    FixKind fix;
+    int fix_at;                     /* Offset of the fixed field in the instruction */
+    int symbol;                     /* Symbol of the fix, or target of a jump or call */
+    long long addend;
+    int jump;                       /* 0: none, 1: jmp, 2: jcc, 3: call */
+    int condition;                  /* jcc: condition code */
+    int near;                       /* Jump: 32-bit displacement */
+    size_t offset;                  /* Layout: offset in .text */
+} X86Code;
+
+/* Encoder state */
+typedef struct {
+    MirProgram* program;
+    ElfObject* object;
+    int section;                    /* ElfSection lines go to (-1 if none) */
+    int rip;                        /* "default rel": labels alone are rip-relative */
+    X86Code* code;
+    int count;
+    int capacity;
+} Encoder;
+
+/* Condition codes by jcc/setcc suffix */
+static const struct {
+    const char* suffix;
+    int code;
+} conditions[] = {
+    { "o", 0x0 }, { "no", 0x1 }, { "b", 0x2 }, { "ae", 0x3 }, { "e", 0x4 }, { "z", 0x4 },
+    { "ne", 0x5 }, { "nz", 0x5 }, { "be", 0x6 }, { "a", 0x7 }, { "s", 0x8 }, { "ns", 0x9 },
+    { "l", 0xc }, { "ge", 0xd }, { "le", 0xe }, { "g", 0xf }
+};
+
+/* /digit of the two-operand ALU instructions (opcode = digit * 8 + form) */
+static const char* const alu_mnemonics[8] = { "add", "or", "adc", "sbb", "and", "sub", "xor", "cmp" };
+
+/* ============================================================
+ * INSTRUCTIONS
+ * ============================================================ */
+
+/* Helper: Condition code of a jcc/setcc suffix (-1 if none) */
+static int condition_code(const char* suffix) {
+    for (size_t i = 0; i < sizeof(conditions) / sizeof(conditions[0]); i++) {
+        if (!strcmp(conditions[i].suffix, suffix)) return conditions[i].code;
+    }
+    return -1;
+}
+
+/* Helper: Does a value fit a sign-extended 8- or 32-bit field? */
+static int fits8(long long value) {
+    return value >= -128 && value <= 127;
+}
+
+static int fits32(long long value) {
+    return value >= -2147483648LL && value <= 2147483647LL;
+}
+
+/* Helper: Bytes an operand reads or writes (0 if the operand does not say) */
+static int operand_size(const MirOperand* operand) {
+    static const int views[4] = { 8, 4, 2, 1 };
+    if (operand->kind == MIR_OP_REG) return views[operand->view];
+    if (operand->kind == MIR_OP_MEM) return operand->size;
+    return 0;
+}
+
+/* Helper: Does an immediate fit the field of an operation of 'size' bytes? */
+static int fits_size(long long value, int size) {
+    if (size == 1) return value >= -128 && value <= 255;
+    if (size == 4) return value >= -2147483648LL && value <= 4294967295LL;
+    return fits32(value);
+}
+
+static void put_byte(X86Code* code, int byte) {
+    code->bytes[code->length++] = (unsigned char)byte;
+}
+
+/* Helper: Append a little-endian value of 'size' bytes */
+static void put_value(X86Code* code, long long value, int size) {
+    for (int i = 0; i < size; i++) put_byte(code, (int)((unsigned long long)value >> (8 * i)) & 0xff);
+}
+
+/* Helper: Does an 8-bit register need a REX prefix (spl, bpl, sil, dil)? */
+static int needs_rex(const MirOperand* operand) {
+    if (operand->kind != MIR_OP_REG || operand->view != 3) return 0;
+    int r = hardware[operand->reg];
+    return r >= 4 && r <= 7;
+}
+
+/* Helper: Append the prefix, opcode and ModRM operand of an instruction:
+ * 'reg' is the register (or /digit) of the reg field, 'rm' a register
+ * or memory operand; 'wide' is REX.W (64-bit operation) */
+static int put_modrm(Encoder* enc, X86Code* code, int wide, const char* opcode, int opcode_length,
+                     int reg, int reg_needs_rex, const MirOperand* rm) {
+    int rex = wide ? 8 : 0;
+    int base = -1;
+    int index = -1;
+    if (reg & 8) rex |= 4;
+    if (rm->kind == MIR_OP_REG) {
+        base = hardware[rm->reg];
+        if (base & 8) rex |= 1;
+    } else if (rm->kind == MIR_OP_MEM) {
+        if (rm->reg != MIR_NO_REG) base = hardware[rm->reg];
+        if (rm->index != MIR_NO_REG) index = hardware[rm->index];
+        if (base >= 0 && (base & 8)) rex |= 1;
+        if (index >= 0 && (index & 8)) rex |= 2;
+        if (index == 4) return 0;                   /* rsp cannot be an index */
+    } else {
+        return 0;
+    }
+    if (rex || reg_needs_rex || needs_rex(rm)) put_byte(code, 0x40 | rex);
+    for (int i = 0; i < opcode_length; i++) put_byte(code, (unsigned char)opcode[i]);
+
+    reg &= 7;
+    if (rm->kind == MIR_OP_REG) {
+        put_byte(code, 0xc0 | (reg << 3) | (base & 7));
+        return 1;
+    }
+
+    int scale = 0;
+    if (index >= 0) {
+        while (scale < 4 && (1 << scale) != rm->scale) scale++;
+        if (scale == 4) return 0;
+    }
+    int symbol = rm->symbol[0] != '\0';
+    if (!fits32(rm->value)) return 0;
+    if (symbol) {
+        code->symbol = elf_symbol(enc->object, rm->symbol);
+        code->addend = rm->value;
+    }
+
+    if (symbol && base < 0 && index < 0 && enc->rip) {
+        /* [rip + disp32] */
+        put_byte(code, (reg << 3) | 5);
+        code->fix = FIX_RELATIVE;
+        code->fix_at = code->length;
+        put_value(code, 0, 4);
+    } else if (base < 0) {
+        /* [index*scale + disp32] (SIB without a base) */
+        put_byte(code, (reg << 3) | 4);
+        put_byte(code, (scale << 6) | ((index >= 0 ? index : 4) & 7) << 3 | 5);
+        code->fix = symbol ? FIX_ABSOLUTE : FIX_NONE;
+        code->fix_at = code->length;
+        put_value(code, symbol ? 0 : rm->value, 4);
+    } else {
+        /* With a symbol the linker fills a 32-bit field; [rbp] and [r13]
+         * need a displacement */
+        int mod = 2;
+        if (!symbol && rm->value == 0 && (base & 7) != 5) mod = 0;
+        else if (!symbol && fits8(rm->value)) mod = 1;
+        if (index >= 0 || (base & 7) == 4) {
+            put_byte(code, (mod << 6) | (reg << 3) | 4);
+            put_byte(code, (scale << 6) | ((index >= 0 ? index : 4) & 7) << 3 | (base & 7));
+        } else {
+            put_byte(code, (mod << 6) | (reg << 3) | (base & 7));
+        }
+        code->fix = symbol ? FIX_ABSOLUTE : FIX_NONE;
+        code->fix_at = code->length;
+        if (mod == 1) put_value(code, rm->value, 1);
+        if (mod == 2) put_value(code, symbol ? 0 : rm->value, 4);
+    }
+    return 1;
+}
+
+/* Helper: Instruction with one opcode byte, chosen by operand size:
+ * 'byte_opcode' for 8-bit operations, 'opcode' otherwise */
+static int put_sized(Encoder* enc, X86Code* code, int size, int byte_opcode, int opcode, int reg,
+                     int reg_needs_rex, const MirOperand* rm) {
+    char op = (char)(size == 1 ? byte_opcode : opcode);
+    if (size != 1 && size != 4 && size != 8) return 0;
+    return put_modrm(enc, code, size == 8, &op, 1, reg, reg_needs_rex, rm);
+}
+
+/* Helper: Immediate of an operation of 'size' bytes */
+static void put_immediate(X86Code* code, long long value, int size) {
+    put_value(code, value, size == 1 ? 1 : 4);
+}
+
+/* Helper: Register operand or memory operand? */
+static int is_rm(const MirOperand* operand) {
+    return operand->kind == MIR_OP_REG || operand->kind == MIR_OP_MEM;
+}
+
+/* Helper: Two-operand ALU instruction with /digit 'digit' */
+static int encode_alu(Encoder* enc, X86Code* code, int digit, const MirOperand* a, const MirOperand* b) {
+    int size = operand_size(a) ? operand_size(a) : operand_size(b);
+    if (b->kind == MIR_OP_REG && is_rm(a)) {
+        if (a->kind == MIR_OP_REG && operand_size(a) != operand_size(b)) return 0;
+        return put_sized(enc, code, operand_size(b), digit * 8, digit * 8 + 1, hardware[b->reg], needs_rex(b), a);
+    }
+    if (b->kind == MIR_OP_MEM && a->kind == MIR_OP_REG) {
+        return put_sized(enc, code, size, digit * 8 + 2, digit * 8 + 3, hardware[a->reg], needs_rex(a), b);
+    }
+    if (b->kind == MIR_OP_IMM && is_rm(a) && fits_size(b->value, size)) {
+        int short_form = size != 1 && fits8(b->value);
+        if (!put_sized(enc, code, size, 0x80, short_form ? 0x83 : 0x81, digit, 0, a)) return 0;
+        put_immediate(code, b->value, short_form ? 1 : size);
+        return 1;
+    }
+    return 0;
+}
+
+/* Helper: mov */
+static int encode_mov(Encoder* enc, X86Code* code, const MirOperand* a, const MirOperand* b) {
+    int size = operand_size(a);
+    if (b->kind == MIR_OP_REG && is_rm(a)) {
+        if (a->kind == MIR_OP_REG && size != operand_size(b)) return 0;
+        return put_sized(enc, code, operand_size(b), 0x88, 0x89, hardware[b->reg], needs_rex(b), a);
+    }
+    if (b->kind == MIR_OP_MEM && a->kind == MIR_OP_REG) {
+        return put_sized(enc, code, size, 0x8a, 0x8b, hardware[a->reg], needs_rex(a), b);
+    }
+    if (b->kind == MIR_OP_IMM && a->kind == MIR_OP_REG) {
+        int r = hardware[a->reg];
+        if (size == 8 && b->value < 0 && fits32(b->value)) {
+            /* mov r64, simm32 (sign-extended) */
+            if (!put_sized(enc, code, 8, 0, 0xc7, 0, 0, a)) return 0;
+            put_value(code, b->value, 4);
+            return 1;
+        }
+        if ((size == 8 && b->value >= 0 && b->value <= 4294967295LL) || (size == 4 && fits_size(b->value, 4))) {
+            /* mov r32, imm32: writing the 32-bit register clears the rest */
+            if (r & 8) put_byte(code, 0x41);
+            put_byte(code, 0xb8 + (r & 7));
+            put_value(code, b->value, 4);
+            return 1;
+        }
+        if (size == 8) {
+            /* movabs r64, imm64 */
+            put_byte(code, 0x48 | (r >> 3));
+            put_byte(code, 0xb8 + (r & 7));
+            put_value(code, b->value, 8);
+            return 1;
+        }
+        if (size == 1 && fits_size(b->value, 1)) {
+            if ((r & 8) || needs_rex(a)) put_byte(code, 0x40 | (r >> 3));
+            put_byte(code, 0xb0 + (r & 7));
+            put_value(code, b->value, 1);
+            return 1;
+        }
+        return 0;
+    }
+    if (b->kind == MIR_OP_IMM && a->kind == MIR_OP_MEM && fits_size(b->value, size)) {
+        if (!put_sized(enc, code, size, 0xc6, 0xc7, 0, 0, a)) return 0;
+        put_immediate(code, b->value, size);
+        return 1;
+    }
+    if (b->kind == MIR_OP_SYMBOL && a->kind == MIR_OP_REG && size == 8) {
+        /* mov r64, label: the address, sign-extended from 32 bits */
+        if (!put_sized(enc, code, 8, 0, 0xc7, 0, 0, a)) return 0;
+        code->fix = FIX_ABSOLUTE;
+        code->fix_at = code->length;
+        code->symbol = elf_symbol(enc->object, b->symbol);
+        code->addend = 0;
+        put_value(code, 0, 4);
+        return 1;
+    }
+    return 0;
+}
+
+/* Helper: Jump or call to a label ("printf wrt ..plt": the PLT is the
+ * linker's choice, made by the relocation) */
+static int encode_jump(Encoder* enc, X86Code* code, int jump, int condition, const MirOperand* target) {
+    char name[MIR_NAME_SIZE];
+    if (target->kind != MIR_OP_SYMBOL) return 0;
+    snprintf(name, sizeof(name), "%s", target->symbol);
+    char* wrt = strstr(name, " wrt ");
+    if (wrt) *wrt = '\0';
+    code->jump = jump;
+    code->condition = condition;
+    code->symbol = elf_symbol(enc->object, name);
+    code->near = jump == 3;
+    return 1;
+}
+
+/* Helper: Encode one instruction */
+static int encode_instruction(Encoder* enc, const MirInstr* instr, X86Code* code) {
+    const char* mnemonic = enc->program->target->opcodes[instr->opcode].mnemonic;
+    const MirOperand* a = &instr->operands[0];
+    const MirOperand* b = &instr->operands[1];
+    const MirOperand* c = &instr->operands[2];
+    int n = instr->num_operands;
+
+    if (n == 0) {
+        if (!strcmp(mnemonic, "ret")) put_byte(code, 0xc3);
+        else if (!strcmp(mnemonic, "leave")) put_byte(code, 0xc9);
+        else if (!strcmp(mnemonic, "nop")) put_byte(code, 0x90);
+        else if (!strcmp(mnemonic, "cqo")) put_value(code, 0x9948, 2);
+        else if (!strcmp(mnemonic, "cdq")) put_byte(code, 0x99);
+        else return 0;
+        return 1;
+    }
+    if (!strcmp(mnemonic, "jmp")) return encode_jump(enc, code, 1, 0, a);
+    if (!strcmp(mnemonic, "call")) return encode_jump(enc, code, 3, 0, a);
+    if (mnemonic[0] == 'j' && condition_code(mnemonic + 1) >= 0) {
+        return encode_jump(enc, code, 2, condition_code(mnemonic + 1), a);
+    }
+    if (!strncmp(mnemonic, "set", 3) && condition_code(mnemonic + 3) >= 0) {
+        char opcode[2] = { 0x0f, (char)(0x90 + condition_code(mnemonic + 3)) };
+        if (operand_size(a) != 1) return 0;
+        return put_modrm(enc, code, 0, opcode, 2, 0, 0, a);
+    }
+
+    if (n == 2) {
+        for (int digit = 0; digit < 8; digit++) {
+            if (!strcmp(mnemonic, alu_mnemonics[digit])) return encode_alu(enc, code, digit, a, b);
+        }
+        if (!strcmp(mnemonic, "mov")) return encode_mov(enc, code, a, b);
+        if (!strcmp(mnemonic, "test")) {
+            if (b->kind == MIR_OP_MEM) {
+                const MirOperand* t = a;
+                a = b;
+                b = t;
+            }
+            int size = operand_size(a);
+            if (b->kind == MIR_OP_REG && is_rm(a) && operand_size(b) == (size ? size : operand_size(b))) {
+                return put_sized(enc, code, operand_size(b), 0x84, 0x85, hardware[b->reg], needs_rex(b), a);
+            }
+            if (b->kind == MIR_OP_IMM && is_rm(a) && fits_size(b->value, size)) {
+                if (!put_sized(enc, code, size, 0xf6, 0xf7, 0, 0, a)) return 0;
+                put_immediate(code, b->value, size);
+                return 1;
+            }
+            return 0;
+        }
+        if (!strcmp(mnemonic, "lea")) {
+            if (a->kind != MIR_OP_REG || b->kind != MIR_OP_MEM) return 0;
+            return put_sized(enc, code, operand_size(a), 0, 0x8d, hardware[a->reg], 0, b);
+        }
+        if (!strcmp(mnemonic, "movzx") || !strcmp(mnemonic, "movsx")) {
+            int from = operand_size(b);
+            char opcode[2] = { 0x0f, (char)((mnemonic[3] == 'z' ? 0xb6 : 0xbe) + (from == 2)) };
+            if (a->kind != MIR_OP_REG || (from != 1 && from != 2) || operand_size(a) < 4) return 0;
+            return put_modrm(enc, code, operand_size(a) == 8, opcode, 2, hardware[a->reg], 0, b);
+        }
+        if (!strcmp(mnemonic, "movsxd")) {
+            char opcode = 0x63;
+            if (a->kind != MIR_OP_REG || operand_size(a) != 8 || operand_size(b) != 4) return 0;
+            return put_modrm(enc, code, 1, &opcode, 1, hardware[a->reg], 0, b);
+        }
+        if (!strcmp(mnemonic, "shl") || !strcmp(mnemonic, "sal") || !strcmp(mnemonic, "shr") ||
+            !strcmp(mnemonic, "sar")) {
+            int digit = mnemonic[2] == 'r' ? (mnemonic[1] == 'a' ? 7 : 5) : 4;
+            int size = operand_size(a);
+            if (!is_rm(a)) return 0;
+            if (b->kind == MIR_OP_REG && b->reg == X86_RCX && b->view == 3) {
+                return put_sized(enc, code, size, 0xd2, 0xd3, digit, 0, a);
+            }
+            if (b->kind != MIR_OP_IMM || b->value < 0 || b->value > 63) return 0;
+            if (b->value == 1) return put_sized(enc, code, size, 0xd0, 0xd1, digit, 0, a);
+            if (!put_sized(enc, code, size, 0xc0, 0xc1, digit, 0, a)) return 0;
+            put_value(code, b->value, 1);
+            return 1;
+        }
+        if (!strcmp(mnemonic, "imul")) {
+            /* imul r, imm is imul r, r, imm */
+            if (b->kind == MIR_OP_IMM) {
+                c = b;
+                b = a;
+                n = 3;
+            } else {
+                char opcode[2] = { 0x0f, (char)0xaf };
+                int size = operand_size(a);
+                if (a->kind != MIR_OP_REG || !is_rm(b) || (size != 4 && size != 8)) return 0;
+                return put_modrm(enc, code, size == 8, opcode, 2, hardware[a->reg], 0, b);
+            }
+        }
+    }
+
+    if (n == 3 && !strcmp(mnemonic, "imul")) {
+        int size = operand_size(a);
+        int short_form = fits8(c->value);
+        char opcode = short_form ? 0x6b : 0x69;
+        if (a->kind != MIR_OP_REG || !is_rm(b) || c->kind != MIR_OP_IMM || (size != 4 && size != 8) ||
+            !fits_size(c->value, size)) {
+            return 0;
+        }
+        if (!put_modrm(enc, code, size == 8, &opcode, 1, hardware[a->reg], 0, b)) return 0;
+        put_value(code, c->value, short_form ? 1 : 4);
+        return 1;
+    }
+
+    if (n == 1) {
+        static const struct {
+            const char* mnemonic;
+            int byte_opcode;
+            int opcode;
+            int digit;
+        } groups[] = {
+            { "not", 0xf6, 0xf7, 2 }, { "neg", 0xf6, 0xf7, 3 }, { "mul", 0xf6, 0xf7, 4 },
+            { "imul", 0xf6, 0xf7, 5 }, { "div", 0xf6, 0xf7, 6 }, { "idiv", 0xf6, 0xf7, 7 },
+            { "inc", 0xfe, 0xff, 0 }, { "dec", 0xfe, 0xff, 1 }
+        };
+        for (size_t g = 0; g < sizeof(groups) / sizeof(groups[0]); g++) {
+            if (!strcmp(mnemonic, groups[g].mnemonic)) {
+                if (!is_rm(a)) return 0;
+                return put_sized(enc, code, operand_size(a), groups[g].byte_opcode, groups[g].opcode,
+                                 groups[g].digit, 0, a);
+            }
+        }
+        if (!strcmp(mnemonic, "push") || !strcmp(mnemonic, "pop")) {
+            int push = mnemonic[1] == 'u';
+            if (a->kind == MIR_OP_REG) {
+                int r = hardware[a->reg];
+                if (a->view != 0) return 0;
+                if (r & 8) put_byte(code, 0x41);
+                put_byte(code, (push ? 0x50 : 0x58) + (r & 7));
+                return 1;
+            }
+            if (a->kind == MIR_OP_MEM) {
+                char opcode = (char)(push ? 0xff : 0x8f);
+                return put_modrm(enc, code, 0, &opcode, 1, push ? 6 : 0, 0, a);
+            }
+            if (push && a->kind == MIR_OP_IMM && fits32(a->value)) {
+                put_byte(code, fits8(a->value) ? 0x6a : 0x68);
+                put_value(code, a->value, fits8(a->value) ? 1 : 4);
+                return 1;
+            }
+            return 0;
+        }
+    }
+    return 0;
+}
+
+/* ============================================================
+ * DIRECTIVES AND DATA
+ * ============================================================ */
+
+/* Helper: Copy a line without its comment (a ';' outside quotes) and
+ * surrounding spaces */
+static void strip_line(const char* text, char* line, size_t size) {
+    char quote = 0;
+    size_t n = 0;
+    while (isspace((unsigned char)*text)) text++;
+    for (const char* p = text; *p && n + 1 < size; p++) {
+        if (quote) {
+            if (*p == quote) quote = 0;
+        } else if (*p == '"' || *p == '\'') {
+            quote = *p;
+        } else if (*p == ';') {
+            break;
+        }
+        line[n++] = *p;
+    }
+    while (n > 0 && isspace((unsigned char)line[n - 1])) n--;
+    line[n] = '\0';
+}
+
+/* Helper: Read a decimal integer and the spaces after it */
+static int read_integer(const char** p, long long* value) {
+    char* end;
+    if (!isdigit((unsigned char)(*p)[(*p)[0] == '-'])) return 0;
+    *value = strtoll(*p, &end, 10);
+    *p = end;
+    while (isspace((unsigned char)**p)) (*p)++;
+    return 1;
+}
+
+/* Helper: Append the items of a db/dq line ("%d", 10, 0) */
+static int put_data(Encoder* enc, const char* items, int width) {
+    const char* p = items;
+    for (;;) {
+        long long value;
+        if ((*p == '"' || *p == '\'') && width == 1) {
+            const char* close = strchr(p + 1, *p);
+            if (!close) return 0;
+            elf_append(enc->object, (ElfSection)enc->section, p + 1, close - p - 1);
+            p = close + 1;
+            while (isspace((unsigned char)*p)) p++;
+        } else if (read_integer(&p, &value)) {
+            unsigned char bytes[8];
+            for (int i = 0; i < width; i++) bytes[i] = (unsigned char)((unsigned long long)value >> (8 * i));
+            elf_append(enc->object, (ElfSection)enc->section, bytes, width);
+        } else {
+            return 0;
+        }
+        if (*p == '\0') return 1;
+        if (*p++ != ',') return 0;
+        while (isspace((unsigned char)*p)) p++;
+    }
+}
+
+/* Helper: Read a directive or data line */
+static int encode_directive(Encoder* enc, const char* text) {
+    char line[512];
+    strip_line(text, line, sizeof(line));
+    if (line[0] == '\0') return 1;
+
+    if (!strncmp(line, "section ", 8)) {
+        const char* name = line + 8;
+        size_t n = strcspn(name, " ");
+        enc->section = -1;
+        if (n == 5 && !strncmp(name, ".text", 5)) enc->section = ELF_TEXT;
+        else if (n == 5 && !strncmp(name, ".data", 5)) enc->section = ELF_DATA;
+        else if (n == 4 && !strncmp(name, ".bss", 4)) enc->section = ELF_BSS;
+        else if (n != 15 || strncmp(name, ".note.GNU-stack", 15)) return 0;  /* The writer adds it */
+        return 1;
+    }
+    if (!strcmp(line, "default rel")) {
+        enc->rip = 1;
+        return 1;
+    }
+    if (!strncmp(line, "global ", 7)) {
+        elf_global_symbol(enc->object, line + 7);
+        return 1;
+    }
+    if (!strncmp(line, "extern ", 7)) {
+        elf_symbol(enc->object, line + 7);
+        return 1;
+    }
+
+    /* Data: "name: db ...", "name: resq n" */
+    if (enc->section != ELF_DATA && enc->section != ELF_BSS) return 0;
+    char* p = line;
+    char* colon = strchr(line, ':');
+    if (colon && colon < line + strcspn(line, " \"'")) {
+        *colon = '\0';
+        if (!elf_define_symbol(enc->object, line, (ElfSection)enc->section)) return 0;
+        p = colon + 1;
+        while (isspace((unsigned char)*p)) p++;
+        if (*p == '\0') return 1;
+    }
+    long long count;
+    const char* rest;
+    if (!strncmp(p, "resb ", 5) || !strncmp(p, "resq ", 5)) {
+        rest = p + 5;
+        if (!read_integer(&rest, &count) || *rest != '\0' || count < 0) return 0;
+        if (enc->section == ELF_BSS) elf_append(enc->object, ELF_BSS, NULL, count * (p[3] == 'q' ? 8 : 1));
+        else elf_append(enc->object, ELF_DATA, NULL, count * (p[3] == 'q' ? 8 : 1));
+        return 1;
+    }
+    if (enc->section == ELF_DATA && (!strncmp(p, "db ", 3) || !strncmp(p, "dq ", 3))) {
+        rest = p + 3;
+        while (isspace((unsigned char)*rest)) rest++;
+        return put_data(enc, rest, p[1] == 'q' ? 8 : 1);
+    }
+    return 0;
+}
+
+/* ============================================================
+ * LAYOUT AND OUTPUT
+ * ============================================================ */
+
+/* Helper: Append a code item */
+static X86Code* add_code(Encoder* enc) {
+    if (enc->count == enc->capacity) {
+        enc->capacity = enc->capacity ? enc->capacity * 2 : 256;
+        enc->code = (X86Code*)safe_realloc(enc->code, enc->capacity * sizeof(X86Code), "x86 encoder");
+    }
+    X86Code* code = &enc->code[enc->count++];
+    memset(code, 0, sizeof(X86Code));
+    code->label = -1;
+    return code;
+}
+
+/* Helper: Bytes of a code item */
+static int code_length(const X86Code* code) {
+    if (code->label >= 0) return 0;
+    if (code->jump == 0) return code->length;
+    if (code->jump == 2) return code->near ? 6 : 2;
+    return code->near ? 5 : 2;
+}
+
+/* Helper: Lay the code out until no jump grows; 'offsets' gets the
+ * offset of every label (-1 for symbols not defined in .text) */
+static void lay_out(Encoder* enc, long long* offsets, X86EncodeStats* stats) {
+    int grew;
+    do {
+        size_t offset = 0;
+        for (int s = 0; s < enc->object->num_symbols; s++) offsets[s] = -1;
+        for (int i = 0; i < enc->count; i++) {
+            X86Code* code = &enc->code[i];
+            code->offset = offset;
+            if (code->label >= 0) offsets[code->label] = (long long)offset;
+            offset += code_length(code);
+        }
+        grew = 0;
+        for (int i = 0; i < enc->count; i++) {
+            X86Code* code = &enc->code[i];
+            if (code->jump == 0 || code->near) continue;
+            long long target = offsets[code->symbol];
+            if (target < 0 || !fits8(target - (long long)(code->offset + 2))) {
+                code->near = 1;
+                grew = 1;
+            }
+        }
+        stats->passes++;
+    } while (grew);
+}
+
+/* Helper: Write the code items into .text (0 if a label is defined twice) */
+static int write_code(Encoder* enc, const long long* offsets, X86EncodeStats* stats) {
+    ElfObject* object = enc->object;
+    for (int i = 0; i < enc->count; i++) {
+        X86Code* code = &enc->code[i];
+        if (code->label >= 0) {
+            if (!elf_define_symbol(object, object->symbols[code->label].name, ELF_TEXT)) {
+                fprintf(stderr, "Fatal Error: label '%s' is defined twice\n", object->symbols[code->label].name);
+                return 0;
+            }
+            continue;
+        }
+        if (code->jump) {
+            long long target = offsets[code->symbol];
+            long long end = (long long)code->offset + code_length(code);
+            code->length = 0;
+            if (code->jump == 3) put_byte(code, 0xe8);
+            else if (code->jump == 1) put_byte(code, code->near ? 0xe9 : 0xeb);
+            else if (code->near) put_value(code, 0x800f + (code->condition << 8), 2);
+            else put_byte(code, 0x70 + code->condition);
+            if (!code->near) {
+                put_value(code, target - end, 1);
+                stats->short_jumps++;
+            } else {
+                if (target < 0) {
+                    elf_add_relocation(object, code->offset + code->length, code->symbol, R_X86_64_PLT32, -4);
+                }
+                put_value(code, target < 0 ? 0 : target - end, 4);
+                if (code->jump != 3) stats->near_jumps++;
+            }
+        } else if (code->fix == FIX_ABSOLUTE) {
+            elf_add_relocation(object, code->offset + code->fix_at, code->symbol, R_X86_64_32S, code->addend);
+        } else if (code->fix == FIX_RELATIVE) {
+            /* The distance is taken from the end of the instruction */
+            elf_add_relocation(object, code->offset + code->fix_at, code->symbol, R_X86_64_PC32,
+                               code->addend - (code->length - code->fix_at));
+        }
+        elf_append(object, ELF_TEXT, code->bytes, code->length);
+    }
+    return 1;
+}
+
+/* Helper: Report a line the encoder cannot encode */
+static void report_line(Encoder* enc, const MirInstr* instr) {
+    char text[512];
+    const MirTarget* target = enc->program->target;
+    if (instr->kind != MIR_INSTR) {
+        snprintf(text, sizeof(text), "%s", instr->text);
+    } else {
+        int n = snprintf(text, sizeof(text), "%s", target->opcodes[instr->opcode].mnemonic);
+        for (int i = 0; i < instr->num_operands && n < (int)sizeof(text); i++) {
+            char operand[128];
+            target->format_operand(&instr->operands[i], operand, sizeof(operand));
+            n += snprintf(text + n, sizeof(text) - n, "%s%s", i ? ", " : " ", operand);
+        }
+    }
+    fprintf(stderr, "Fatal Error: the x86-64 encoder has no encoding for '%s'\n", text);
+}
+
+/* Encode a program into an object */
+int encode_x86_object(MirProgram* program, ElfObject* object, X86EncodeStats* stats) {
+    Encoder enc = { program, object, -1, 0, NULL, 0, 0 };
+    int ok = 1;
+
+    for (int i = 0; i < program->count && ok; i++) {
+        const MirInstr* instr = &program->lines[i];
+        if (instr->deleted || instr->kind == MIR_NOTE) continue;
+        if (instr->kind == MIR_TEXT) {
+            ok = encode_directive(&enc, instr->text);
+        } else if (enc.section != ELF_TEXT) {
+            ok = 0;
+        } else if (instr->kind == MIR_LABEL) {
+            int symbol = elf_symbol(object, instr->text);
+            ok = object->symbols[symbol].section < 0;  /* Not a data label */
+            add_code(&enc)->label = symbol;
+        } else {
+            ok = encode_instruction(&enc, instr, add_code(&enc));
+            stats->instructions++;
+        }
+        if (!ok) report_line(&enc, instr);
+    }
+
+    if (ok) {
+        long long* offsets = (long long*)safe_malloc((object->num_symbols + 1) * sizeof(long long), "x86 encoder");
+        lay_out(&enc, offsets, stats);
+        ok = write_code(&enc, offsets, stats);
+        free(offsets);
+    }
+    free(enc.code);
+    return ok;
+}
+
+/* Print the statistics */
+void print_x86_encode_stats(ElfObject* object, X86EncodeStats* stats) {
+    printf("\n================ OBJECT FILE STATISTICS ===================\n\n");
+    printf("Instructions encoded:      %d\n", stats->instructions);
+    printf("Code bytes (.text):        %zu\n", object->size[ELF_TEXT]);
+    printf("Data bytes (.data):        %zu\n", object->size[ELF_DATA]);
+    printf("Zeroed bytes (.bss):       %zu\n", object->size[ELF_BSS]);
+    printf("Relocations:               %d\n", object->num_relocations);
+    printf("Short jumps:               %d\n", stats->short_jumps);
+    printf("Near jumps:                %d\n", stats->near_jumps);
+    printf("Layout passes:             %d\n", stats->passes);
+    printf("\n==========================================================\n\n");
+}
@@ -0,0 +1,50 @@
+/*
+ * X86ENC.H - x86-64 Machine Code Encoder Header
+ * CST-405 Compiler Project
+ *
+ * This file defines the encoder that turns the machine IR of the x86-64
+ * back end into machine code in an ELF64 object file (--obj), so a
+ * program is compiled without running an assembler:
+ * - Instructions: the opcode, ModRM, SIB, displacement and immediate
+ *   bytes of the forms the generator emits, in the shortest encoding
+ *   (8-bit displacements and immediates where they fit)
+ * - Jumps: every jump to a label starts in its 2-byte short form; a
+ *   jump whose target is out of reach grows to the near form and the
+ *   layout is redone until no jump grows
+ * - Directives: section, global, extern and default rel, and the db,
+ *   dq, resb and resq data lines
+ * - Relocations: a global addressed by an absolute 32-bit field
+ *   (R_X86_64_32S), a rip-relative one under "default rel"
+ *   (R_X86_64_PC32), and calls to functions the object does not define
+ *   (R_X86_64_PLT32); jumps and calls to local labels are resolved here
+ * A line it has no encoding for stops the compilation with its text:
+ * output.asm (without --obj) stays the way to read the code.
+ */
+
+#ifndef X86ENC_H
+#define X86ENC_H
+
+#include "mir.h"
+#include "elfobj.h"
+
+/* Register numbers of the machine IR (codegen.c names them by view) */
+enum {
+    X86_RAX, X86_RBX, X86_RCX, X86_RDX, X86_RSI, X86_RDI, X86_RBP, X86_RSP,
+    X86_R8, X86_R9, X86_R10, X86_R11, X86_R12, X86_R13, X86_R14, X86_R15
+};
+
+/* Encoder statistics */
+typedef struct {
+    int instructions;           /* Instructions encoded */
+    int short_jumps;            /* Jumps in the 2-byte form */
+    int near_jumps;             /* Jumps that needed a 32-bit displacement */
+    int passes;                 /* Layout passes until no jump grew */
+} X86EncodeStats;
+
+/* Encode a program into an object (0 on a line it cannot encode) */
+int encode_x86_object(MirProgram* program, ElfObject* object, X86EncodeStats* stats);
+
+/* Print the statistics */
+void print_x86_encode_stats(ElfObject* object, X86EncodeStats* stats);
+
+#endif /* X86ENC_H */